@@ -25,7 +25,10 @@
 
 // Vision Workbench
 #include <vw/Math/MatrixSparseSkyline.h>
+#include <vw/Math/ConjugateGradient.h>
 #include <vw/Core/Debugging.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/BundleAdjustment/AdjustBase.h>
 #include <vw/BundleAdjustment/CameraRelation.h>
 
@@ -34,6 +37,7 @@
 #include <boost/numeric/ublas/vector_sparse.hpp>
 #include <boost/numeric/ublas/io.hpp>
 #include <boost/version.hpp>
+#include <boost/exception_ptr.hpp>
 #if BOOST_VERSION<=103200
 // Mapped matrix doesn't exist in 1.32, but Sparse Matrix does
 //
@@ -73,6 +77,397 @@ namespace ba {
     std::vector< matrix_point_point > V, V_inverse;
     std::vector< vector_camera > epsilon_a;
     std::vector< vector_point > epsilon_b;
+    Vector<double> m_e, m_delta_a, m_delta_b;
+
+    // The features of each point, in camera order. The per point work is
+    // split between threads by point so that V and epsilon_b have a
+    // single writer.
+    std::vector< std::vector<JFeature*> > m_point_features;
+
+    // Per thread accumulators for the camera blocks and the errors. Each
+    // thread always gets the same range of points or cameras and the
+    // accumulators are summed in a fixed order, so the results don't
+    // depend on the order in which the threads finish.
+    int m_num_threads;
+    std::vector< std::vector< matrix_camera_camera > > m_thread_U;
+    std::vector< std::vector< vector_camera > > m_thread_epsilon_a;
+    std::vector< double > m_thread_sum;
+
+    // An exception thrown by the model in a worker thread, kept per
+    // thread and rethrown to the caller once all the threads are done.
+    std::vector< boost::exception_ptr > m_thread_error;
+
+    // The blocks of S in each camera's column, at or below the diagonal,
+    // keyed by the row camera.
+    std::vector< std::vector< std::pair<size_t, matrix_camera_camera> > > m_S_blocks;
+
+    // Iterative solver settings. When enabled S is never formed, only
+    // its diagonal blocks are kept for the block Jacobi preconditioner.
+    bool m_use_conjugate_gradient;
+    int m_cg_max_iterations;
+    double m_cg_tolerance;
+    int m_cg_iterations;
+    std::vector< matrix_camera_camera > m_S_diagonal_inverse;
+
+    // Workspace for the matrix free products with S.
+    Vector<double> const* m_product_in;
+    Vector<double>* m_product_out;
+    Vector<double> m_product_points;
+
+    typedef void (AdjustSparse::*RangeFunc)( size_t begin, size_t end, size_t thread );
+
+    /// Task which runs one of the update() passes over a range of points or cameras.
+    class RangeTask : public Task, private boost::noncopyable {
+      AdjustSparse& m_adjust;
+      RangeFunc     m_func;
+      size_t        m_begin, m_end, m_thread;
+    public:
+      RangeTask( AdjustSparse& adjust, RangeFunc func,
+                 size_t begin, size_t end, size_t thread ) :
+        m_adjust(adjust), m_func(func), m_begin(begin), m_end(end), m_thread(thread) {}
+      virtual ~RangeTask() {}
+      virtual void operator()() {
+        try {
+          (m_adjust.*m_func)( m_begin, m_end, m_thread );
+        } catch (...) {
+          m_adjust.m_thread_error[m_thread] = boost::current_exception();
+        }
+      }
+    };
+
+    /// Split [0,count) into one contiguous range per thread and run func on all of them.
+    void run_ranges( size_t count, RangeFunc func ) {
+      size_t num_threads = m_num_threads;
+      if ( num_threads == 1 ) {
+        (this->*func)( 0, count, 0 );
+        return;
+      }
+      FifoWorkQueue queue( num_threads );
+      for ( size_t t = 0; t < num_threads; t++ ) {
+        boost::shared_ptr<Task> task( new RangeTask( *this, func, (count*t)/num_threads,
+                                                     (count*(t+1))/num_threads, t ) );
+        queue.add_task( task );
+      }
+      queue.join_all();
+
+      // Rethrow the exception of the lowest numbered thread that failed.
+      for ( size_t t = 0; t < num_threads; t++ ) {
+        if ( m_thread_error[t] ) {
+          boost::exception_ptr error = m_thread_error[t];
+          std::fill( m_thread_error.begin(), m_thread_error.end(), boost::exception_ptr() );
+          boost::rethrow_exception( error );
+        }
+      }
+    }
+
+    /// Sum of the per thread scalar accumulators.
+    double thread_sum() const {
+      double sum = 0;
+      BOOST_FOREACH( double const& value, m_thread_sum )
+        sum += value;
+      return sum;
+    }
+
+    /// Measurement inverse covariance of a feature.
+    static Matrix2x2 inverse_covariance( JFeature const& feature ) {
+      Matrix2x2 inverse_cov;
+      Vector2 pixel_sigma = feature.m_scale;
+      inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
+      inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
+      return inverse_cov;
+    }
+
+    // Computes the Jacobians and errors of every measure of the points in
+    // [begin,end). V and epsilon_b are written directly, the camera terms
+    // go to this thread's accumulators.
+    void jacobian_pass( size_t begin, size_t end, size_t thread ) {
+      std::vector< matrix_camera_camera >& thread_U = m_thread_U[thread];
+      std::vector< vector_camera >& thread_epsilon_a = m_thread_epsilon_a[thread];
+      BOOST_FOREACH( matrix_camera_camera& element, thread_U )
+        element = matrix_camera_camera();
+      BOOST_FOREACH( vector_camera& element, thread_epsilon_a )
+        element = vector_camera();
+      double error_total = 0;
+
+      for ( size_t i = begin; i < end; i++ ) {
+        V[i] = matrix_point_point();
+        epsilon_b[i] = vector_point();
+        BOOST_FOREACH( JFeature* measure, m_point_features[i] ) {
+          size_t j = measure->m_camera_id;
+
+          matrix_2_camera A =
+            this->m_model.cam_jacobian( i, j,
+                                      this->m_model.cam_params(j),
+                                      this->m_model.point_params(i) );
+          matrix_2_point B =
+            this->m_model.point_jacobian( i, j,
+                                      this->m_model.cam_params(j),
+                                      this->m_model.point_params(i) );
+
+          // Apply robust cost function weighting
+          Vector2 error;
+          try {
+            error = measure->m_location -
+              this->m_model.cam_pixel(i,j,this->m_model.cam_params(j),
+                            this->m_model.point_params(i) );
+          } catch (const camera::PointToPixelErr& e) {}
+
+          if ( error != Vector2() ) {
+            double mag = norm_2(error);
+            double weight = sqrt(this->m_robust_cost_func(mag)) / mag;
+            error *= weight;
+          }
+
+          Matrix2x2 inverse_cov = inverse_covariance( *measure );
+          error_total += .5 * transpose(error) *
+            inverse_cov * error;
+
+          // Storing intermediate values
+          thread_U[j] += transpose(A) * inverse_cov * A;
+          V[i] += transpose(B) * inverse_cov * B;
+          thread_epsilon_a[j] += transpose(A) * inverse_cov * error;
+          epsilon_b[i] += transpose(B) * inverse_cov * error;
+          measure->m_w = transpose(A) * inverse_cov * B;
+        }
+      }
+      m_thread_sum[thread] = error_total;
+    }
+
+    // Inverts V for the points in [begin,end) and computes the Y blocks of their features.
+    void v_inverse_pass( size_t begin, size_t end, size_t /*thread*/ ) {
+      for ( size_t i = begin; i < end; i++ ) {
+        Matrix<double> V_temp = V[i];
+        chol_inverse( V_temp );
+        V_inverse[i] = transpose(V_temp)*V_temp;
+        BOOST_FOREACH( JFeature* feature, m_point_features[i] )
+          feature->m_y = feature->m_w * V_inverse[i];
+      }
+    }
+
+    // Finishes 'e' and computes the S blocks for the cameras in
+    // [begin,end). Only the blocks at or below the diagonal are made,
+    // and only the inverse of the diagonal ones for conjugate gradient.
+    void reduced_system_pass( size_t begin, size_t end, size_t /*thread*/ ) {
+      const size_t num_cam_params = BundleAdjustModelT::camera_params_n;
+      for ( size_t j = begin; j < end; j++ ) {
+        m_S_blocks[j].clear();
+
+        // Filling in diagonal
+        matrix_camera_camera S_jj;
+
+        // Iterate across all features seen by the camera
+        for ( crn_iter fiter = m_crn[j].begin();
+              fiter != m_crn[j].end(); fiter++ ) {
+          // Flatten the block structure to compute 'e'
+          subvector(m_e, j*num_cam_params, num_cam_params) -= (**fiter).m_y
+            * epsilon_b[ (**fiter).m_point_id ];
+          S_jj -= (**fiter).m_y*transpose((**fiter).m_w);
+        }
+
+        // Augmenting Diagonal
+        S_jj += U[j];
+        if ( m_use_conjugate_gradient ) {
+          Matrix<double> S_temp = S_jj;
+          chol_inverse( S_temp );
+          m_S_diagonal_inverse[j] = transpose(S_temp)*S_temp;
+          continue;
+        }
+        m_S_blocks[j].push_back( std::make_pair( j, S_jj ) );
+
+        // Filling in off diagonal
+        for ( size_t k = j+1; k < m_crn.size(); k++ ) {
+          typedef boost::shared_ptr<JFeature> f_ptr;
+          typedef typename std::multimap< size_t, f_ptr >::iterator mm_iterator;
+          std::pair< mm_iterator, mm_iterator > feature_range;
+          feature_range = m_crn[j].map.equal_range( k );
+          if ( feature_range.first == feature_range.second )
+            continue;
+
+          // Iterating through all features in camera j that have
+          // connections to camera k.
+          matrix_camera_camera S_jk;
+          for ( mm_iterator f_j_iter = feature_range.first;
+                f_j_iter != feature_range.second; f_j_iter++ ) {
+            boost::shared_ptr<JFeature> f_k = (*f_j_iter).second->m_map.find(k)->second.lock();
+            S_jk -= (*f_j_iter).second->m_y *
+              transpose( f_k->m_w );
+          }
+          m_S_blocks[j].push_back( std::make_pair( k, S_jk ) );
+        }
+      }
+    }
+
+    // First half of the product of S with m_product_in: W^T x for the
+    // points in [begin,end).
+    void product_point_pass( size_t begin, size_t end, size_t /*thread*/ ) {
+      const size_t num_cam_params = BundleAdjustModelT::camera_params_n;
+      const size_t num_pt_params  = BundleAdjustModelT::point_params_n;
+      for ( size_t i = begin; i < end; i++ ) {
+        vector_point w_x;
+        BOOST_FOREACH( JFeature* feature, m_point_features[i] )
+          w_x += transpose( feature->m_w ) *
+            subvector( *m_product_in, feature->m_camera_id*num_cam_params, num_cam_params );
+        subvector( m_product_points, i*num_pt_params, num_pt_params ) = w_x;
+      }
+    }
+
+    // Second half of the product of S with m_product_in, for the cameras
+    // in [begin,end): S x = U x - Y (W^T x), since S = U - W V^-1 W^T.
+    void product_camera_pass( size_t begin, size_t end, size_t /*thread*/ ) {
+      const size_t num_cam_params = BundleAdjustModelT::camera_params_n;
+      const size_t num_pt_params  = BundleAdjustModelT::point_params_n;
+      for ( size_t j = begin; j < end; j++ ) {
+        vector_camera s_x = U[j] * subvector( *m_product_in, j*num_cam_params, num_cam_params );
+        for ( crn_iter fiter = m_crn[j].begin();
+              fiter != m_crn[j].end(); fiter++ )
+          s_x -= (**fiter).m_y *
+            subvector( m_product_points, (**fiter).m_point_id*num_pt_params, num_pt_params );
+        subvector( *m_product_out, j*num_cam_params, num_cam_params ) = s_x;
+      }
+    }
+
+    /// Matrix free product with the reduced camera matrix S.
+    class SchurProduct {
+      AdjustSparse& m_adjust;
+    public:
+      SchurProduct( AdjustSparse& adjust ) : m_adjust(adjust) {}
+      void operator()( Vector<double> const& x, Vector<double>& y ) const {
+        y.set_size( x.size() );
+        m_adjust.m_product_in  = &x;
+        m_adjust.m_product_out = &y;
+        m_adjust.run_ranges( m_adjust.m_model.num_points(), &AdjustSparse::product_point_pass );
+        m_adjust.run_ranges( m_adjust.m_crn.size(), &AdjustSparse::product_camera_pass );
+      }
+    };
+
+    /// Block Jacobi preconditioner, the inverse of the diagonal blocks of S.
+    class BlockJacobiPreconditioner {
+      std::vector< matrix_camera_camera > const& m_inverse;
+    public:
+      BlockJacobiPreconditioner( std::vector< matrix_camera_camera > const& inverse ) :
+        m_inverse(inverse) {}
+      void operator()( Vector<double> const& r, Vector<double>& z ) const {
+        const size_t num_cam_params = BundleAdjustModelT::camera_params_n;
+        z.set_size( r.size() );
+        for ( size_t j = 0; j < m_inverse.size(); j++ )
+          subvector( z, j*num_cam_params, num_cam_params ) =
+            m_inverse[j] * subvector( r, j*num_cam_params, num_cam_params );
+      }
+    };
+
+    // Builds the skyline S from m_S_blocks and solves S * delta_a = e
+    // with its LDL^T decomposition.
+    void solve_skyline() {
+      const size_t num_cam_params = BundleAdjustModelT::camera_params_n;
+      boost::scoped_ptr<Timer> time;
+      time.reset(new Timer("Fill Skyline", DebugMessage, "ba"));
+
+      // The S matrix is a m x m block matrix with blocks that are
+      // camera_params_n x camera_params_n in size.  It has a sparse
+      // skyline structure, which makes it more efficient to solve
+      // through L*D*L^T decomposition and forward/back substitution
+      // below. Insertion into it is not thread safe so it is filled here.
+      math::MatrixSparseSkyline<double> S(this->m_model.num_cameras()*num_cam_params,
+                                          this->m_model.num_cameras()*num_cam_params);
+      for ( size_t j = 0; j < m_crn.size(); j++ ) {
+        typedef std::pair<size_t, matrix_camera_camera> block_type;
+        BOOST_FOREACH( block_type const& block, m_S_blocks[j] ) {
+          size_t k = block.first;
+          if ( k == j ) {
+            // Loading into sparse matrix
+            size_t offset = j * num_cam_params;
+            for ( size_t aa = 0; aa < num_cam_params; aa++ ) {
+              for ( size_t bb = aa; bb < num_cam_params; bb++ ) {
+                S( offset+bb, offset+aa ) = block.second(aa,bb);  // Transposing
+              }
+            }
+          } else {
+            // Loading into sparse matrix
+            // - if it seems we are loading in oddly, it's because the sparse
+            //   matrix is row major.
+            submatrix( S, k*num_cam_params, j*num_cam_params,
+                       num_cam_params, num_cam_params ) = transpose(block.second);
+          }
+        }
+      }
+
+      m_S = S; // S is modified in sparse solve. Keeping a copy.
+      time.reset();
+
+      // Computing ideal ordering
+      if (!m_found_ideal_ordering) {
+        time.reset(new Timer("Solving Cuthill-Mckee", DebugMessage, "ba"));
+        m_ideal_ordering = cuthill_mckee_ordering(S,num_cam_params);
+        math::MatrixReorganize<math::MatrixSparseSkyline<double> > mod_S( S, m_ideal_ordering );
+        m_ideal_skyline = solve_for_skyline(mod_S);
+
+        m_found_ideal_ordering = true;
+        time.reset();
+      }
+
+      time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
+
+      // Compute the LDL^T decomposition and solve using sparse methods.
+      math::MatrixReorganize<math::MatrixSparseSkyline<double> > modified_S( S, m_ideal_ordering );
+      m_delta_a = sparse_solve( modified_S,
+                                reorganize(m_e, m_ideal_ordering),
+                                m_ideal_skyline );
+      m_delta_a = reorganize(m_delta_a, modified_S.inverse());
+    }
+
+    // Back solves delta_b for the points in [begin,end), also
+    // accumulating their part of the predicted improvement.
+    void delta_b_pass( size_t begin, size_t end, size_t thread ) {
+      const size_t num_cam_params = BundleAdjustModelT::camera_params_n;
+      const size_t num_pt_params  = BundleAdjustModelT::point_params_n;
+      double dS = 0;
+      for ( size_t i = begin; i < end; i++ ) {
+        // delta_b = inverse(V)*( epsilon_b - sum_across_cam( WijT * delta_aj ) )
+        vector_point right_delta_b;
+        BOOST_FOREACH( JFeature* feature, m_point_features[i] )
+          right_delta_b += transpose( feature->m_w ) *
+            subvector( m_delta_a, feature->m_camera_id*num_cam_params, num_cam_params );
+
+        Vector<double> delta_temp = epsilon_b[i] - right_delta_b;
+        Matrix<double> hessian = V[i];
+        solve( delta_temp, hessian );
+        subvector( m_delta_b, i*num_pt_params, num_pt_params ) = delta_temp;
+
+        dS += transpose(delta_temp) * ( this->m_lambda * delta_temp + epsilon_b[i] );
+      }
+      m_thread_sum[thread] = dS;
+    }
+
+    // Error of the measures of the points in [begin,end) after applying the update.
+    void updated_error_pass( size_t begin, size_t end, size_t thread ) {
+      const size_t num_cam_params = BundleAdjustModelT::camera_params_n;
+      const size_t num_pt_params  = BundleAdjustModelT::point_params_n;
+      double new_error_total = 0;
+      for ( size_t i = begin; i < end; i++ ) {
+        vector_point new_b = this->m_model.point_params(i) +
+          subvector( m_delta_b, num_pt_params*i, num_pt_params );
+        BOOST_FOREACH( JFeature* feature, m_point_features[i] ) {
+          size_t j = feature->m_camera_id;
+          vector_camera new_a = this->m_model.cam_params(j) +
+            subvector( m_delta_a, num_cam_params*j, num_cam_params );
+
+          // Apply robust cost function weighting
+          Vector2 error;
+          try {
+            error = feature->m_location -
+              this->m_model.cam_pixel(i,j,new_a,new_b);
+          } catch (const camera::PointToPixelErr& e) {}
+          double mag = norm_2( error );
+          double weight = sqrt( this->m_robust_cost_func(mag)) / mag;
+          error *= weight;
+
+          Matrix2x2 inverse_cov = inverse_covariance( *feature );
+          new_error_total += .5 * transpose(error) *
+            inverse_cov * error;
+        }
+      }
+      m_thread_sum[thread] = new_error_total;
+    }
 
   public:
 
@@ -89,8 +484,59 @@ namespace ba {
       vw_out(DebugMessage,"ba") << "Constructed Sparse Bundle Adjuster.\n";
       m_crn.read_controlnetwork( *(this->m_control_net).get() );
       m_found_ideal_ordering = false;
+
+      m_point_features.resize( this->m_model.num_points() );
+      for ( size_t j = 0; j < m_crn.size(); j++ )
+        for ( crn_iter fiter = m_crn[j].begin(); fiter != m_crn[j].end(); fiter++ )
+          m_point_features[ (**fiter).m_point_id ].push_back( fiter->get() );
+      m_S_blocks.resize( m_crn.size() );
+
+      m_use_conjugate_gradient = false;
+      m_cg_max_iterations = 0;
+      m_cg_tolerance = 1e-10;
+      m_cg_iterations = 0;
+      m_product_in = 0;
+      m_product_out = 0;
+
+      set_num_threads( 1 );
+    }
+
+    /// Number of threads used by update(), one by default. The model's
+    /// cam_pixel() and Jacobians are called from all of them at once, so
+    /// only raise this for models which are thread safe. Exceptions the
+    /// model throws are passed back to the caller of update().
+    int num_threads() const { return m_num_threads; }
+    void set_num_threads( int num_threads ) {
+      m_num_threads = std::max( num_threads, 1 );
+      m_thread_U.resize( m_num_threads );
+      m_thread_epsilon_a.resize( m_num_threads );
+      m_thread_sum.resize( m_num_threads );
+      m_thread_error.resize( m_num_threads );
+      for ( int t = 0; t < m_num_threads; t++ ) {
+        m_thread_U[t].resize( this->m_model.num_cameras() );
+        m_thread_epsilon_a[t].resize( this->m_model.num_cameras() );
+      }
     }
 
+    /// Solve for the camera update with block Jacobi preconditioned
+    /// conjugate gradient instead of factoring S. S is then never formed,
+    /// so memory scales with the number of measures instead of with the
+    /// skyline of S, which makes this the better choice for large and
+    /// loosely connected networks. Iteration stops when the residual
+    /// drops by tolerance or after max_iterations (0 means the number
+    /// of camera parameters). S() and covCalc() are not available in
+    /// this mode.
+    void set_conjugate_gradient( bool use, int max_iterations = 0,
+                                 double tolerance = 1e-10 ) {
+      m_use_conjugate_gradient = use;
+      m_cg_max_iterations = max_iterations;
+      m_cg_tolerance = tolerance;
+    }
+    bool conjugate_gradient() const { return m_use_conjugate_gradient; }
+
+    /// Conjugate gradient iterations taken by the last update().
+    int conjugate_gradient_iterations() const { return m_cg_iterations; }
+
     math::MatrixSparseSkyline<double> S() const { return m_S; }
 
     // Covariance Calculator
@@ -133,16 +579,6 @@ namespace ba {
 
       VW_DEBUG_ASSERT(this->m_control_net->size() == this->m_model.num_points(), LogicErr() << "BundleAdjustment::update() : Number of bundles does not match the number of points in the bundle adjustment model.");
 
-      // Reseting the values for U, V, epsilon
-      BOOST_FOREACH( matrix_camera_camera& element, U )
-        element = matrix_camera_camera();
-      BOOST_FOREACH( vector_camera& element, epsilon_a )
-        element = vector_camera();
-      BOOST_FOREACH( matrix_point_point& element, V )
-        element = matrix_point_point();
-      BOOST_FOREACH( vector_point& element, epsilon_b )
-        element = vector_point();
-
       size_t num_cam_params = BundleAdjustModelT::camera_params_n;
       size_t num_pt_params = BundleAdjustModelT::point_params_n;
 
@@ -150,47 +586,14 @@ namespace ba {
       // matrices A & B, as well as the error matrix and the W
       // matrix.
       time.reset(new Timer("Solve for Image Error, Jacobian, U, V, and W:", DebugMessage, "ba"));
-      double error_total = 0; // assume this is r^T\Sigma^{-1}r
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        BOOST_FOREACH( boost::shared_ptr<JFeature> measure, m_crn[j] ) {
-          size_t i = measure->m_point_id;
-
-          matrix_2_camera A =
-            this->m_model.cam_jacobian( i, j,
-                                      this->m_model.cam_params(j),
-                                      this->m_model.point_params(i) );
-          matrix_2_point B =
-            this->m_model.point_jacobian( i, j,
-                                      this->m_model.cam_params(j),
-                                      this->m_model.point_params(i) );
-
-          // Apply robust cost function weighting
-          Vector2 error;
-          try {
-            error = measure->m_location -
-              this->m_model.cam_pixel(i,j,this->m_model.cam_params(j),
-                            this->m_model.point_params(i) );
-          } catch (const camera::PointToPixelErr& e) {}
-
-          if ( error != Vector2() ) {
-            double mag = norm_2(error);
-            double weight = sqrt(this->m_robust_cost_func(mag)) / mag;
-            error *= weight;
-          }
-
-          Matrix2x2 inverse_cov;
-          Vector2 pixel_sigma = measure->m_scale;
-          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
-          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
-          error_total += .5 * transpose(error) *
-            inverse_cov * error;
-
-          // Storing intermediate values
-          U[j] += transpose(A) * inverse_cov * A;
-          V[i] += transpose(B) * inverse_cov * B;
-          epsilon_a[j] += transpose(A) * inverse_cov * error;
-          epsilon_b[i] += transpose(B) * inverse_cov * error;
-          measure->m_w = transpose(A) * inverse_cov * B;
+      run_ranges( this->m_model.num_points(), &AdjustSparse::jacobian_pass );
+      double error_total = thread_sum(); // assume this is r^T\Sigma^{-1}r
+      for ( size_t j = 0; j < U.size(); j++ ) {
+        U[j] = matrix_camera_camera();
+        epsilon_a[j] = vector_camera();
+        for ( int t = 0; t < m_num_threads; t++ ) {
+          U[j] += m_thread_U[t][j];
+          epsilon_a[j] += m_thread_epsilon_a[t][j];
         }
       }
       time.reset();
@@ -266,194 +669,68 @@ namespace ba {
       // to "flatten" our block structure to a vector that contains
       // scalar entries.
       time.reset(new Timer("Create special e vector", DebugMessage, "ba"));
-      Vector<double> e(this->m_model.num_cameras() * BundleAdjustModelT::camera_params_n);
+      m_e.set_size(this->m_model.num_cameras() * BundleAdjustModelT::camera_params_n);
       for (size_t j = 0; j < epsilon_a.size(); ++j) {
-        subvector(e, j*BundleAdjustModelT::camera_params_n, BundleAdjustModelT::camera_params_n) =
+        subvector(m_e, j*BundleAdjustModelT::camera_params_n, BundleAdjustModelT::camera_params_n) =
           epsilon_a[j];
       }
 
-      // Compute V inverse
-      for ( size_t i = 0; i < this->m_model.num_points(); i++ ) {
-        Matrix<double> V_temp = V[i];
-        chol_inverse( V_temp );
-        V_inverse[i] = transpose(V_temp)*V_temp;
-      }
-
-      // Compute Y and finish constructing e.
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
-          // Compute the blocks of Y
-          (**fiter).m_y = (**fiter).m_w * V_inverse[(**fiter).m_point_id];
-          // Flatten the block structure to compute 'e'
-          subvector(e, j*num_cam_params, num_cam_params) -= (**fiter).m_y
-            * epsilon_b[ (**fiter).m_point_id ];
-        }
-      }
-
+      // Compute V inverse and Y
+      run_ranges( this->m_model.num_points(), &AdjustSparse::v_inverse_pass );
       time.reset();
 
       // --- BUILD SPARSE, SOLVE A'S UPDATE STEP -------------------------
       time.reset(new Timer("Build Sparse", DebugMessage, "ba"));
 
-      // The S matrix is a m x m block matrix with blocks that are
-      // camera_params_n x camera_params_n in size.  It has a sparse
-      // skyline structure, which makes it more efficient to solve
-      // through L*D*L^T decomposition and forward/back substitution
-      // below.
-      math::MatrixSparseSkyline<double> S(this->m_model.num_cameras()*num_cam_params,
-                                          this->m_model.num_cameras()*num_cam_params);
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        { // Filling in diagonal
-          matrix_camera_camera S_jj;
-
-          // Iterate across all features seen by the camera
-          for ( crn_iter fiter = m_crn[j].begin();
-                fiter != m_crn[j].end(); fiter++ ) {
-            S_jj -= (**fiter).m_y*transpose((**fiter).m_w);
-          }
-
-          // Augmenting Diagonal
-          S_jj += U[j];
-
-          // Loading into sparse matrix
-          size_t offset = j * num_cam_params;
-          for ( size_t aa = 0; aa < num_cam_params; aa++ ) {
-            for ( size_t bb = aa; bb < num_cam_params; bb++ ) {
-              S( offset+bb, offset+aa ) = S_jj(aa,bb);  // Transposing
-            }
-          }
-        }
-
-        // Filling in off diagonal
-        for ( size_t k = j+1; k < m_crn.size(); k++ ) {
-          typedef boost::weak_ptr<JFeature> w_ptr;
-          typedef boost::shared_ptr<JFeature> f_ptr;
-          typedef std::multimap< size_t, f_ptr >::iterator mm_iterator;
-          std::pair< mm_iterator, mm_iterator > feature_range;
-          feature_range = m_crn[j].map.equal_range( k );
-
-          // Iterating through all features in camera j that have
-          // connections to camera k.
-          matrix_camera_camera S_jk;
-          bool found = false;
-          for ( mm_iterator f_j_iter = feature_range.first;
-                f_j_iter != feature_range.second; f_j_iter++ ) {
-            w_ptr f_k = (*f_j_iter).second->m_map[k];
-            found = true;
-            S_jk -= (*f_j_iter).second->m_y *
-              transpose( f_k.lock()->m_w );
-          }
-
-          // Loading into sparse matrix
-          // - if it seems we are loading in oddly, it's because the sparse
-          //   matrix is row major.
-          if ( found ) {
-            submatrix( S, k*num_cam_params, j*num_cam_params,
-                       num_cam_params, num_cam_params ) = transpose(S_jk);
-          }
-        }
-      }
-
-      m_S = S; // S is modified in sparse solve. Keeping a copy.
+      // Finish constructing e and compute the blocks of S, one camera
+      // (block row) per thread.
+      if ( m_use_conjugate_gradient )
+        m_S_diagonal_inverse.resize( m_crn.size() );
+      run_ranges( m_crn.size(), &AdjustSparse::reduced_system_pass );
       time.reset();
 
-      // Computing ideal ordering
-      if (!m_found_ideal_ordering) {
-        time.reset(new Timer("Solving Cuthill-Mckee", DebugMessage, "ba"));
-        m_ideal_ordering = cuthill_mckee_ordering(S,num_cam_params);
-        math::MatrixReorganize<math::MatrixSparseSkyline<double> > mod_S( S, m_ideal_ordering );
-        m_ideal_skyline = solve_for_skyline(mod_S);
-
-        m_found_ideal_ordering = true;
-        time.reset();
+      if ( m_use_conjugate_gradient ) {
+        time.reset(new Timer("Solve Delta A with conjugate gradient", DebugMessage, "ba"));
+        m_product_points.set_size( this->m_model.num_points() * num_pt_params );
+        int max_iterations = m_cg_max_iterations > 0 ? m_cg_max_iterations : int(m_e.size());
+        m_delta_a.set_size( m_e.size() );
+        fill( m_delta_a, 0.0 );
+        m_cg_iterations =
+          math::preconditioned_conjugate_gradient( SchurProduct( *this ),
+                                                   BlockJacobiPreconditioner( m_S_diagonal_inverse ),
+                                                   m_e, m_delta_a, max_iterations, m_cg_tolerance );
+        vw_out(DebugMessage,"ba") << "Conjugate gradient iterations: " << m_cg_iterations << std::endl;
+      } else {
+        solve_skyline();
       }
-
-      time.reset(new Timer("Solve Delta A", DebugMessage, "ba"));
-
-      // Compute the LDL^T decomposition and solve using sparse methods.
-      math::MatrixReorganize<math::MatrixSparseSkyline<double> > modified_S( S, m_ideal_ordering );
-      Vector<double> delta_a = sparse_solve( modified_S,
-                                             reorganize(e, m_ideal_ordering),
-                                             m_ideal_skyline );
-      delta_a = reorganize(delta_a, modified_S.inverse());
-      BOOST_FOREACH( double& e, delta_a )
+      BOOST_FOREACH( double& e, m_delta_a )
         if ( std::isnan( e ) ) e = 0;
+      Vector<double> const& delta_a = m_delta_a;
       time.reset();
 
       // --- SOLVE B'S UPDATE STEP ---------------------------------
 
       // Back Solving for Delta B
       time.reset(new Timer("Solve Delta B", DebugMessage, "ba"));
-      Vector<double> delta_b( this->m_model.num_points() * num_pt_params );
-      {
-        // delta_b = inverse(V)*( epsilon_b - sum_across_cam( WijT * delta_aj ) )
-
-        // Building right half, sum( WijT * delta_aj )
-        std::vector< vector_point > right_delta_b( this->m_model.num_points() );
-        for ( size_t j = 0; j < m_crn.size(); j++ ) {
-          for ( crn_iter fiter = m_crn[j].begin();
-                fiter != m_crn[j].end(); fiter++ ) {
-            right_delta_b[ (**fiter).m_point_id ] += transpose( (**fiter).m_w ) *
-              subvector( delta_a, j*num_cam_params, num_cam_params );
-          }
-        }
-
-        // Solving for delta b
-        for ( size_t i = 0; i < this->m_model.num_points(); i++ ) {
-          Vector<double> delta_temp = epsilon_b[i] - right_delta_b[i];
-          Matrix<double> hessian = V[i];
-          solve( delta_temp, hessian );
-          subvector( delta_b, i*num_pt_params, num_pt_params ) = delta_temp;
-        }
-      }
+      m_delta_b.set_size( this->m_model.num_points() * num_pt_params );
+      run_ranges( this->m_model.num_points(), &AdjustSparse::delta_b_pass );
+      Vector<double> const& delta_b = m_delta_b;
       time.reset();
 
       //Predicted improvement for Fletcher modification
-      double dS = 0;
+      double dS = thread_sum();
       for ( size_t j = 0; j < this->m_model.num_cameras(); j++ )
         dS += transpose(subvector(delta_a,j*num_cam_params,num_cam_params))
           * ( this->m_lambda * subvector(delta_a,j*num_cam_params,num_cam_params) +
               epsilon_a[j] );
-      for ( size_t i = 0; i < this->m_model.num_points(); i++ )
-        dS += transpose(subvector(delta_b,i*num_pt_params,num_pt_params))
-          * ( this->m_lambda * subvector(delta_b,i*num_pt_params,num_pt_params) +
-              epsilon_b[i] );
       dS *= 0.5;
 
       // -------------------------------
       // Compute the update error vector and predicted change
       // -------------------------------
       time.reset(new Timer("Solve for Updated Error", DebugMessage, "ba"));
-      double new_error_total = 0;
-      for ( size_t j = 0; j < m_crn.size(); j++ ) {
-        for ( crn_iter fiter = m_crn[j].begin();
-              fiter != m_crn[j].end(); fiter++ ) {
-          // Compute error vector
-          vector_camera new_a = this->m_model.cam_params(j) +
-            subvector( delta_a, num_cam_params*j, num_cam_params );
-          vector_point new_b = this->m_model.point_params((**fiter).m_point_id) +
-            subvector( delta_b, num_pt_params*(**fiter).m_point_id, num_pt_params );
-
-          // Apply robust cost function weighting
-          Vector2 error;
-          try {
-            error = (**fiter).m_location -
-              this->m_model.cam_pixel((**fiter).m_point_id,j,new_a,new_b);
-          } catch (const camera::PointToPixelErr& e) {}
-          double mag = norm_2( error );
-          double weight = sqrt( this->m_robust_cost_func(mag)) / mag;
-          error *= weight;
-
-          Matrix2x2 inverse_cov;
-          Vector2 pixel_sigma = (**fiter).m_scale;
-          inverse_cov(0,0) = 1/(pixel_sigma(0)*pixel_sigma(0));
-          inverse_cov(1,1) = 1/(pixel_sigma(1)*pixel_sigma(1));
-
-          new_error_total += .5 * transpose(error) *
-            inverse_cov * error;
-        }
-      }
+      run_ranges( this->m_model.num_points(), &AdjustSparse::updated_error_pass );
+      double new_error_total = thread_sum();
 
       // Camera Constraints
       if ( this->m_use_camera_constraint )
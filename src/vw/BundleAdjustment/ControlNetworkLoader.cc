@@ -19,6 +19,9 @@
 #include <vw/BundleAdjustment/ControlNetworkLoader.h>
 #include <vw/Stereo/StereoModel.h>
 #include <vw/InterestPoint/Matcher.h>
+#include <vw/Math/DisjointSet.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 
 using namespace vw;
 using namespace vw::ba;
@@ -27,23 +30,110 @@ using namespace vw::ba;
 
 namespace fs = boost::filesystem;
 
-struct ContainsEqualIP {
-  ip::InterestPoint& m_compare;
-  ContainsEqualIP( ip::InterestPoint& comp ) : m_compare(comp) {}
-
-  bool operator()( boost::shared_ptr<IPFeature> in ) {
-    if (  m_compare.x == in->m_ip.x &&
-          m_compare.y == in->m_ip.y )
-      return true;
-    return false;
-  }
-};
-
 // Utility for checking that the point is BA safe
 void safe_measurement( ip::InterestPoint& ip ) {
   if ( ip.scale <= 0 ) ip.scale = 10;
 }
 
+namespace {
+
+  // Matches of one image pair, as read from its match file.
+  struct MatchPair {
+    std::string match_file;
+    size_t index1, index2;
+    std::vector<ip::InterestPoint> ip1, ip2;
+  };
+
+  // Reads a match file and strips the descriptors, which would
+  // otherwise dominate the memory use while the files are merged.
+  class MatchFileLoadTask : public Task, private boost::noncopyable {
+    MatchPair& m_pair;
+  public:
+    MatchFileLoadTask( MatchPair& pair ) : m_pair(pair) {}
+    virtual ~MatchFileLoadTask() {}
+    virtual void operator()() {
+      ip::read_binary_match_file( m_pair.match_file, m_pair.ip1, m_pair.ip2 );
+      std::for_each( m_pair.ip1.begin(), m_pair.ip1.end(), ip::remove_descriptor );
+      std::for_each( m_pair.ip2.begin(), m_pair.ip2.end(), ip::remove_descriptor );
+      std::for_each( m_pair.ip1.begin(), m_pair.ip1.end(), safe_measurement );
+      std::for_each( m_pair.ip2.begin(), m_pair.ip2.end(), safe_measurement );
+    }
+  };
+
+  // Every distinct interest point of every image, stored flat. A feature
+  // is identified by its index, and its track by its set in a disjoint
+  // set that is merged with every match.
+  class FeatureTracks {
+    typedef math::DisjointSet<size_t> set_type;
+    typedef std::map<std::pair<float,float>, size_t> lookup_type;
+
+    std::vector<lookup_type>     m_lookup;   // Per image, location -> feature
+    std::vector<size_t>          m_image_id;
+    std::vector<ip::InterestPoint> m_ip;
+    std::vector<set_type::Elem>  m_elem;
+    set_type                     m_sets;
+
+  public:
+    FeatureTracks( size_t num_images ) : m_lookup( num_images ) {}
+
+    size_t size() const { return m_ip.size(); }
+
+    /// Returns the feature at the location of ip in the image, adding it
+    /// if it is new. The first observation of a location is kept.
+    size_t intern( ip::InterestPoint const& ip, size_t image_id ) {
+      std::pair<lookup_type::iterator, bool> result =
+        m_lookup[image_id].insert( std::make_pair( std::make_pair( ip.x, ip.y ), m_ip.size() ) );
+      if ( result.second ) {
+        m_image_id.push_back( image_id );
+        m_ip.push_back( ip );
+        m_elem.push_back( m_sets.insert( m_ip.size()-1 ) );
+      }
+      return result.first->second;
+    }
+
+    void link( size_t feature1, size_t feature2 ) {
+      m_sets.combine( m_sets.find( m_elem[feature1] ), m_sets.find( m_elem[feature2] ) );
+    }
+
+    /// Groups the features by track. track_offsets has one more entry
+    /// than there are tracks; the features of track t are
+    /// track_features[track_offsets[t]] to track_features[track_offsets[t+1]-1].
+    /// Tracks are ordered by their first feature.
+    void tracks( std::vector<size_t>& track_offsets,
+                 std::vector<size_t>& track_features ) {
+      std::map<set_type::Set, size_t> track_of_root;
+      std::vector<size_t> feature_track( size() );
+      std::vector<size_t> track_size;
+      for ( size_t f = 0; f < size(); f++ ) {
+        std::pair<std::map<set_type::Set, size_t>::iterator, bool> result =
+          track_of_root.insert( std::make_pair( m_sets.find( m_elem[f] ), track_size.size() ) );
+        if ( result.second )
+          track_size.push_back( 0 );
+        feature_track[f] = result.first->second;
+        track_size[feature_track[f]]++;
+      }
+
+      track_offsets.resize( track_size.size() + 1 );
+      track_offsets[0] = 0;
+      for ( size_t t = 0; t < track_size.size(); t++ )
+        track_offsets[t+1] = track_offsets[t] + track_size[t];
+
+      track_features.resize( size() );
+      std::vector<size_t> next( track_offsets.begin(), track_offsets.end()-1 );
+      for ( size_t f = 0; f < size(); f++ )
+        track_features[ next[feature_track[f]]++ ] = f;
+    }
+
+    ControlMeasure control_measure( size_t feature ) const {
+      ip::InterestPoint const& ip = m_ip[feature];
+      return ControlMeasure( ip.x, ip.y, ip.scale, ip.scale, m_image_id[feature] );
+    }
+
+    size_t image_id( size_t feature ) const { return m_image_id[feature]; }
+  };
+
+} // end anonymous namespace
+
 double vw::ba::triangulate_control_point( ControlPoint& cp,
                                           std::vector<boost::shared_ptr<camera::CameraModel> >
                                           const& camera_models,
@@ -129,6 +219,9 @@ bool vw::ba::build_control_network( bool triangulate_control_points,
                                     double min_angle_radians,
                                     double forced_triangulation_distance) {
 
+  if ( image_files.empty() )
+    vw_throw( ArgumentErr() << "No images to build a control network for." );
+
   // Note that this statement does not clear the network fully.
   // TODO: Clear all items here. 
   cnet.clear();
@@ -137,12 +230,9 @@ bool vw::ba::build_control_network( bool triangulate_control_points,
   // std::map to give ourselves a sorted list and access to a binary search.
   std::map<std::string,size_t> image_prefix_map;
   size_t count = 0;
-  ba::CameraRelationNetwork<ba::IPFeature> crn;
   BOOST_FOREACH( std::string const& file, image_files ) {
     fs::path file_path(file);
     image_prefix_map[file_path.replace_extension().string()] = count;
-    crn.add_node( ba::CameraNode<ba::IPFeature>( count,
-                                                 file_path.stem().string() ) );
     cnet.add_image_name(file);
     count++;
   }
@@ -186,67 +276,54 @@ bool vw::ba::build_control_network( bool triangulate_control_points,
     }
   }
 
-  // Loop through the match files...
+  // Read the match files concurrently, a batch at a time so only a
+  // bounded number of them is held in memory, and merge each batch
+  // into the feature tracks.
+  FeatureTracks features( image_files.size() );
   size_t num_load_rejected = 0, num_loaded = 0;
-  for (size_t file_iter = 0; file_iter < match_files_vec.size(); file_iter++){
-    std::string match_file = match_files_vec[file_iter];
-    size_t index1 = index1_vec[file_iter];
-    size_t index2 = index2_vec[file_iter];
-
-    // Actually read in the file as it seems we've found something correct
-    std::vector<ip::InterestPoint> ip1, ip2;
-    vw_out(DebugMessage,"ba") << "Loading: " << match_file << std::endl;
-    ip::read_binary_match_file( match_file, ip1, ip2 );
-    if ( ip1.size() < min_matches ) {
-      vw_out(DebugMessage,"ba") << "\t" << match_file << "    "
-                                << ip1.size() << " matches. [rejected]\n";
-      num_load_rejected += ip1.size();
-      continue;
+  size_t num_threads = vw_settings().default_num_threads();
+  size_t batch_size = 4 * num_threads;
+  TerminalProgressCallback progress("ba", "Building: ");
+  progress.report_progress(0);
+  for ( size_t batch_start = 0; batch_start < match_files_vec.size();
+        batch_start += batch_size ) {
+    size_t batch_end = std::min( batch_start + batch_size, match_files_vec.size() );
+    std::vector<MatchPair> batch( batch_end - batch_start );
+    {
+      FifoWorkQueue queue( num_threads );
+      for ( size_t file_iter = batch_start; file_iter < batch_end; file_iter++ ) {
+        MatchPair& pair = batch[file_iter - batch_start];
+        pair.match_file = match_files_vec[file_iter];
+        pair.index1     = index1_vec[file_iter];
+        pair.index2     = index2_vec[file_iter];
+        vw_out(DebugMessage,"ba") << "Loading: " << pair.match_file << std::endl;
+        boost::shared_ptr<Task> task( new MatchFileLoadTask( pair ) );
+        queue.add_task( task );
+      }
+      queue.join_all();
     }
-    vw_out(DebugMessage,"ba") << "\t" << match_file << "    "
-                              << ip1.size() << " matches.\n";
-    num_loaded += ip1.size();
-
-    // Remove descriptors from interest points and correct scale
-    std::for_each( ip1.begin(), ip1.end(), ip::remove_descriptor );
-    std::for_each( ip2.begin(), ip2.end(), ip::remove_descriptor );
-    std::for_each( ip1.begin(), ip1.end(), safe_measurement );
-    std::for_each( ip2.begin(), ip2.end(), safe_measurement );
-
-    typedef boost::shared_ptr< ba::IPFeature > f_ptr;
-    typedef std::list< f_ptr >::iterator f_itr;
-
-    // Checking to see if features already exist, adding if they
-    // don't, then linking them.
-    vw_out() << "Building the control network for " << match_file <<".\n";
-    TerminalProgressCallback progress("ba", "Building: ");
-    progress.report_progress(0);
-    double inc_prog = 1.0/double(ip1.size());
-    for ( size_t k = 0; k < ip1.size(); k++ ) { // Loop through all existing IP
-      // Check if either IP is already in the lists
-      f_itr ipfeature1 = std::find_if( crn[index1].begin(),
-                                       crn[index1].end(),
-                                       ContainsEqualIP( ip1[k] ) );
-      f_itr ipfeature2 = std::find_if( crn[index2].begin(),
-                                       crn[index2].end(),
-                                       ContainsEqualIP( ip2[k] ) );
-      // If the IP are new, add them to the list
-      if ( ipfeature1 == crn[index1].end() ) {
-        crn[index1].relations.push_front( f_ptr( new ba::IPFeature( ip1[k], index1 ) ) );
-        ipfeature1 = crn[index1].begin();
+
+    // Merging in file order keeps the result independent of the threads
+    BOOST_FOREACH( MatchPair const& pair, batch ) {
+      if ( pair.ip1.size() < min_matches ) {
+        vw_out(DebugMessage,"ba") << "\t" << pair.match_file << "    "
+                                  << pair.ip1.size() << " matches. [rejected]\n";
+        num_load_rejected += pair.ip1.size();
+        continue;
       }
-      if ( ipfeature2 == crn[index2].end() ) {
-        crn[index2].relations.push_front( f_ptr( new ba::IPFeature( ip2[k], index2 ) ) );
-        ipfeature2 = crn[index2].begin();
+      vw_out(DebugMessage,"ba") << "\t" << pair.match_file << "    "
+                                << pair.ip1.size() << " matches.\n";
+      num_loaded += pair.ip1.size();
+
+      for ( size_t k = 0; k < pair.ip1.size(); k++ ) {
+        size_t feature1 = features.intern( pair.ip1[k], pair.index1 );
+        size_t feature2 = features.intern( pair.ip2[k], pair.index2 );
+        features.link( feature1, feature2 );
       }
-
-      // Doubly linking
-      (*ipfeature1)->connection( *ipfeature2, false );
-      (*ipfeature2)->connection( *ipfeature1, false );
-      progress.report_incremental_progress(inc_prog );
-    } // End loop through ip1
-    progress.report_finished();
-  } // End loop through match files
+    }
+    progress.report_progress( double(batch_end) / double(match_files_vec.size()) );
+  }
+  progress.report_finished();
 
   if ( num_load_rejected != 0 ) {
     vw_out(WarningMessage,"ba") << "\tDidn't load " << num_load_rejected
@@ -256,8 +333,42 @@ bool vw::ba::build_control_network( bool triangulate_control_points,
     vw_out(WarningMessage,"ba") << "\tLoaded " << num_loaded << " matches.\n";
   }
 
-  // Building control network
-  bool success = crn.write_controlnetwork( cnet );
+  // Building control network. Tracks which see an image twice are
+  // 'spiral' errors and are dropped.
+  std::vector<size_t> track_offsets, track_features;
+  features.tracks( track_offsets, track_features );
+  size_t spiral_error_count = 0;
+  std::vector<bool> image_seen( image_files.size(), false );
+  for ( size_t t = 0; t + 1 < track_offsets.size(); t++ ) {
+    bool spiral = false;
+    for ( size_t m = track_offsets[t]; m < track_offsets[t+1]; m++ ) {
+      size_t image_id = features.image_id( track_features[m] );
+      if ( image_seen[image_id] )
+        spiral = true;
+      image_seen[image_id] = true;
+    }
+    for ( size_t m = track_offsets[t]; m < track_offsets[t+1]; m++ )
+      image_seen[ features.image_id( track_features[m] ) ] = false;
+    if ( spiral ) {
+      spiral_error_count++;
+      continue;
+    }
+
+    ControlPoint cpoint( ControlPoint::TiePoint );
+    for ( size_t m = track_offsets[t]; m < track_offsets[t+1]; m++ )
+      cpoint.add_measure( features.control_measure( track_features[m] ) );
+    cnet.add_control_point( cpoint );
+  }
+  if ( spiral_error_count != 0 )
+    vw_out(WarningMessage,"ba") << "\t" << spiral_error_count
+                                << " control points removed due to spiral errors.\n";
+
+  bool success = true;
+  if ( cnet.size() == 0 ) {
+    vw_out(WarningMessage,"ba")
+      << "Failed to load any points, control network is empty.";
+    success = false;
+  }
 
   // Triangulating Positions
   if (triangulate_control_points){
@@ -118,6 +118,25 @@ public:
     return m_cnet; }
 };
 
+// A model whose projection can be made to fail for the last point, as
+// a model which cannot handle some input might.
+class ThrowingBAModel : public TestBAModel {
+  bool m_throw;
+public:
+  ThrowingBAModel( std::vector< boost::shared_ptr<PinholeModel> > const& cameras,
+                   boost::shared_ptr<ControlNetwork> network ) : TestBAModel(cameras, network), m_throw(false) {}
+
+  void set_throw( bool throw_error ) { m_throw = throw_error; }
+
+  Vector2 cam_pixel(size_t i, size_t j,
+                    Vector<double,6> const& cam_j,
+                    Vector<double,3> const& point_i ) const {
+    if ( m_throw && i + 1 == num_points() )
+      vw_throw( LogicErr() << "Cannot project point " << i << "." );
+    return TestBAModel::cam_pixel( i, j, cam_j, point_i );
+  }
+};
+
 // Generating Data
 // ----------------------
 
@@ -320,6 +339,78 @@ TEST_F( ComparisonTest, Ref_VS_Sparse ) {
                         1e-3 );
 }
 
+TEST_F( ComparisonTest, Sparse_VS_ThreadedSparse ) {
+  std::vector<Vector<double> > single_solution;
+  std::vector<Vector<double> > threaded_solution;
+
+  for ( int num_threads = 1; num_threads <= 4; num_threads += 3 ) {
+    TestBAModel model( cameras, cnet );
+    AdjustSparse< TestBAModel, L2Error > adjuster( model, L2Error(), false, false);
+    adjuster.set_num_threads( num_threads );
+    EXPECT_EQ( num_threads, adjuster.num_threads() );
+
+    // Running BA
+    double abs_tol = 1e10, rel_tol = 1e10;
+    for ( unsigned i = 0; i < 10; i++ )
+      adjuster.update(abs_tol,rel_tol);
+
+    // Storing result
+    std::vector<Vector<double> >& solution =
+      num_threads == 1 ? single_solution : threaded_solution;
+    for ( uint32 i = 0; i < 5; i++ )
+      solution.push_back( model.cam_params(i) );
+  }
+
+  // Only the summation order differs
+  for ( uint32 i = 0; i < 5; i++ )
+    ASSERT_VECTOR_NEAR( single_solution[i],
+                        threaded_solution[i],
+                        1e-6 );
+}
+
+TEST_F( ComparisonTest, ThreadedSparse_Exception ) {
+  ThrowingBAModel model( cameras, cnet );
+  AdjustSparse< ThrowingBAModel, L2Error > adjuster( model, L2Error(), false, false);
+  adjuster.set_num_threads( 4 );
+  model.set_throw( true );
+
+  // The worker's exception reaches the caller
+  double abs_tol = 1e10, rel_tol = 1e10;
+  EXPECT_THROW( adjuster.update(abs_tol,rel_tol), LogicErr );
+}
+
+TEST_F( ComparisonTest, Sparse_VS_ConjugateGradient ) {
+  std::vector<Vector<double> > skyline_solution;
+  std::vector<Vector<double> > cg_solution;
+
+  for ( int use_cg = 0; use_cg < 2; use_cg++ ) {
+    TestBAModel model( cameras, cnet );
+    AdjustSparse< TestBAModel, L2Error > adjuster( model, L2Error(), false, false);
+    adjuster.set_conjugate_gradient( use_cg );
+    EXPECT_EQ( bool(use_cg), adjuster.conjugate_gradient() );
+
+    // Running BA
+    double abs_tol = 1e10, rel_tol = 1e10;
+    for ( unsigned i = 0; i < 10; i++ ) {
+      adjuster.update(abs_tol,rel_tol);
+      if ( use_cg ) {
+        EXPECT_GT( adjuster.conjugate_gradient_iterations(), 0 );
+      }
+    }
+
+    // Storing result
+    std::vector<Vector<double> >& solution =
+      use_cg ? cg_solution : skyline_solution;
+    for ( uint32 i = 0; i < 5; i++ )
+      solution.push_back( model.cam_params(i) );
+  }
+
+  for ( uint32 i = 0; i < 5; i++ )
+    ASSERT_VECTOR_NEAR( skyline_solution[i],
+                        cg_solution[i],
+                        1e-4 );
+}
+
 // For whatever reason .. RobustRef and RobustSparse diverge
 // quickly. This is probably do to unwise application of floats or
 // arithmetic ordering.
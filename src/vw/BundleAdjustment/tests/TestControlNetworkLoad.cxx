@@ -94,3 +94,55 @@ TEST( GCPLoad, LoadingGCP ) {
   EXPECT_EQ(27, cnet.size());
 }
 
+
+TEST( ControlNetworkLoad, BuildControlNetwork ) {
+  std::vector<std::string> image_files;
+  image_files.push_back("a.tif");
+  image_files.push_back("b.tif");
+  image_files.push_back("c.tif");
+
+  // Each entry of a pair's match list is (x1,y1) <-> (x2,y2)
+  std::vector<ip::InterestPoint> ab1, ab2, bc1, bc2, ac1, ac2;
+  // A track seen in all three images
+  ab1.push_back( ip::InterestPoint(1,1) );   ab2.push_back( ip::InterestPoint(2,2) );
+  bc1.push_back( ip::InterestPoint(2,2) );   bc2.push_back( ip::InterestPoint(3,3) );
+  // A track which returns to image a at a different location
+  ab1.push_back( ip::InterestPoint(10,10) ); ab2.push_back( ip::InterestPoint(20,20) );
+  bc1.push_back( ip::InterestPoint(20,20) ); bc2.push_back( ip::InterestPoint(30,30) );
+  ac1.push_back( ip::InterestPoint(11,11) ); ac2.push_back( ip::InterestPoint(30,30) );
+  // A track seen in a and c only
+  ac1.push_back( ip::InterestPoint(5,5) );   ac2.push_back( ip::InterestPoint(6,6) );
+
+  UnlinkName ab_file("a__b.match"), bc_file("b__c.match"), ac_file("a__c.match");
+  ip::write_binary_match_file( ab_file, ab1, ab2 );
+  ip::write_binary_match_file( bc_file, bc1, bc2 );
+  ip::write_binary_match_file( ac_file, ac1, ac2 );
+
+  std::map< std::pair<int, int>, std::string> match_files;
+  match_files[ std::make_pair(0,1) ] = ab_file;
+  match_files[ std::make_pair(1,2) ] = bc_file;
+  match_files[ std::make_pair(0,2) ] = ac_file;
+
+  ControlNetwork cnet("build");
+  std::vector<boost::shared_ptr<camera::CameraModel> > camera_models;
+  EXPECT_TRUE( build_control_network( false, cnet, camera_models, image_files,
+                                      match_files, 0, 0, 0 ) );
+  EXPECT_EQ( 3u, cnet.get_image_list().size() );
+
+  // The spiral track is dropped
+  ASSERT_EQ( 2u, cnet.size() );
+  ASSERT_EQ( 3u, cnet[0].size() );
+  for ( size_t i = 0; i < 3; i++ ) {
+    EXPECT_EQ( i, cnet[0][i].image_id() );
+    EXPECT_VECTOR_NEAR( Vector2(i+1,i+1), cnet[0][i].position(), 1e-6 );
+  }
+  ASSERT_EQ( 2u, cnet[1].size() );
+  EXPECT_EQ( 0u, cnet[1][0].image_id() );
+  EXPECT_EQ( 2u, cnet[1][1].image_id() );
+  EXPECT_VECTOR_NEAR( Vector2(6,6), cnet[1][1].position(), 1e-6 );
+
+  // Pairs with too few matches are not used
+  EXPECT_FALSE( build_control_network( false, cnet, camera_models, image_files,
+                                       match_files, 3, 0, 0 ) );
+  EXPECT_EQ( 0u, cnet.size() );
+}
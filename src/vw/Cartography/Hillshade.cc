@@ -0,0 +1,188 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Cartography/Hillshade.h>
+#include <vw/Math/EulerAngles.h>
+#include <vw/Image/Filter.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace vw;
+using namespace vw::cartography;
+
+namespace {
+
+  // Blurs the rows of src into dst, which is narrower by the kernel
+  // size less one.  A pixel stays valid only if its whole window is.
+  void blur_rows( ImageView<float> const& src, ImageView<uint8> const& src_valid,
+                  std::vector<float> const& kernel,
+                  ImageView<float>& dst, ImageView<uint8>& dst_valid ) {
+    int32 width = src.cols() - int32(kernel.size()) + 1;
+    dst.set_size( width, src.rows() );
+    dst_valid.set_size( width, src.rows() );
+    for ( int32 row = 0; row < src.rows(); ++row ) {
+      const float* in       = &src(0,row);
+      const uint8* in_valid = &src_valid(0,row);
+      float* out       = &dst(0,row);
+      uint8* out_valid = &dst_valid(0,row);
+      std::fill( out, out + width, 0.0f );
+      std::fill( out_valid, out_valid + width, uint8(1) );
+      // One tap at a time, so that the inner loops are plain
+      // contiguous multiply-adds.
+      for ( size_t k = 0; k < kernel.size(); ++k ) {
+        const float tap = kernel[k];
+        for ( int32 x = 0; x < width; ++x ) {
+          out[x]       += tap * in[x+k];
+          out_valid[x] &= in_valid[x+k];
+        }
+      }
+    }
+  }
+
+  // Blurs the columns of src into dst, which is shorter by the kernel
+  // size less one.
+  void blur_cols( ImageView<float> const& src, ImageView<uint8> const& src_valid,
+                  std::vector<float> const& kernel,
+                  ImageView<float>& dst, ImageView<uint8>& dst_valid ) {
+    int32 width  = src.cols();
+    int32 height = src.rows() - int32(kernel.size()) + 1;
+    dst.set_size( width, height );
+    dst_valid.set_size( width, height );
+    for ( int32 row = 0; row < height; ++row ) {
+      float* out       = &dst(0,row);
+      uint8* out_valid = &dst_valid(0,row);
+      std::fill( out, out + width, 0.0f );
+      std::fill( out_valid, out_valid + width, uint8(1) );
+      for ( size_t k = 0; k < kernel.size(); ++k ) {
+        const float  tap      = kernel[k];
+        const float* in       = &src(0,row+k);
+        const uint8* in_valid = &src_valid(0,row+k);
+        for ( int32 x = 0; x < width; ++x ) {
+          out[x]       += tap * in[x];
+          out_valid[x] &= in_valid[x];
+        }
+      }
+    }
+  }
+
+} // namespace
+
+vw::cartography::detail::HillshadeParams::HillshadeParams( float u_scale, float v_scale,
+                                                           std::vector<HillshadeLight> const& lights,
+                                                           double blur_sigma )
+  : u_scale(u_scale), v_scale(v_scale) {
+  VW_ASSERT( !lights.empty(), ArgumentErr() << "hillshade: At least one light is required." );
+
+  double total = 0;
+  for ( size_t i = 0; i < lights.size(); ++i )
+    total += lights[i].weight;
+  VW_ASSERT( total > 0, ArgumentErr() << "hillshade: The light weights must sum to more than zero." );
+
+  for ( size_t i = 0; i < lights.size(); ++i ) {
+    // The light starts in an image space "ENU" coordinate system
+    // pointed toward E (right).
+    Vector3f light_0(1,0,0);
+    Vector3f light = vw::math::euler_to_rotation_matrix( lights[i].elevation*M_PI/180,
+                                                         lights[i].azimuth*M_PI/180, 0, "yzx" ) * light_0;
+    this->lights.push_back( normalize(light) );
+    weights.push_back( float(lights[i].weight / total) );
+  }
+
+  if ( blur_sigma > 0 ) {
+    generate_gaussian_kernel( kernel, blur_sigma );
+    // An even kernel would be off center; widen it by a tap.
+    if ( kernel.size() % 2 == 0 )
+      generate_gaussian_kernel( kernel, blur_sigma, int32(kernel.size()+1) );
+  }
+}
+
+void vw::cartography::detail::hillshade_tile( ImageView<float> const& dem, ImageView<uint8> const& valid,
+                                              BBox2i const& blur_box, Vector2i const& image_size,
+                                              HillshadeParams const& params, BBox2i const& out_box,
+                                              ImageView<PixelMask<PixelGray<float> > > & result ) {
+  // Blur the DEM over blur_box, both axes on contiguous rows.
+  ImageView<float> blurred;
+  ImageView<uint8> blurred_valid;
+  if ( params.kernel.empty() ) {
+    blurred       = dem;
+    blurred_valid = valid;
+  } else {
+    ImageView<float> rows_blurred;
+    ImageView<uint8> rows_valid;
+    blur_rows( dem, valid, params.kernel, rows_blurred, rows_valid );
+    blur_cols( rows_blurred, rows_valid, params.kernel, blurred, blurred_valid );
+  }
+  VW_DEBUG_ASSERT( blurred.cols() == blur_box.width() && blurred.rows() == blur_box.height(),
+                   LogicErr() << "hillshade_tile: Blurred DEM does not cover the blur box." );
+
+  const float u_scale = params.u_scale;
+  const float v_scale = params.v_scale;
+  const size_t num_lights = params.lights.size();
+
+  result.set_size( out_box.width(), out_box.height() );
+  for ( int32 y = out_box.min().y(); y < out_box.max().y(); ++y ) {
+    // The neighbours past the last row and column are the edge pixels
+    // themselves, as with a constant edge extension.
+    int32 row       = y - blur_box.min().y();
+    int32 row_below = std::min( y+1, image_size.y()-1 ) - blur_box.min().y();
+    const float* center = &blurred(0,row);
+    const float* below  = &blurred(0,row_below);
+    const uint8* center_valid = &blurred_valid(0,row);
+    const uint8* below_valid  = &blurred_valid(0,row_below);
+
+    for ( int32 x = out_box.min().x(); x < out_box.max().x(); ++x ) {
+      int32 col       = x - blur_box.min().x();
+      int32 col_right = std::min( x+1, image_size.x()-1 ) - blur_box.min().x();
+      PixelMask<PixelGray<float> >& out = result( x - out_box.min().x(), y - out_box.min().y() );
+      if ( !center_valid[col] || !center_valid[col_right] || !below_valid[col] ) {
+        out = PixelMask<PixelGray<float> >();
+        continue;
+      }
+
+      // The normal of the plane through this pixel and its neighbours
+      // to the right and below.
+      float dz_u = center[col_right] - center[col];
+      float dz_v = below[col]        - center[col];
+      Vector3f normal = normalize( Vector3f( -dz_u*v_scale, -u_scale*dz_v, u_scale*v_scale ) );
+
+      float shade = 0;
+      for ( size_t i = 0; i < num_lights; ++i ) {
+        float d = dot_prod( normal, params.lights[i] );
+        shade += params.weights[i] * std::max( 0.0f, std::min( 1.0f, d ) );
+      }
+      out = PixelMask<PixelGray<float> >( shade );
+    }
+  }
+}
+
+Vector2 vw::cartography::hillshade_pixel_scale( GeoReference const& georef ) {
+  Matrix3x3 transform = georef.transform();
+  if ( georef.is_projected() )
+    return Vector2( transform(0,0), transform(1,1) );
+  double meters_per_degree = 2*M_PI*georef.datum().semi_major_axis()/360.0;
+  return Vector2( transform(0,0), transform(1,1) ) * meters_per_degree;
+}
+
+double vw::cartography::image_azimuth_from_east( GeoReference const& georef, Vector2i const& image_size ) {
+  // The vector from the left to the right edge along the middle row.
+  Vector2 left_pixel ( 0,              image_size.y()/2 );
+  Vector2 right_pixel( image_size.x(), image_size.y()/2 );
+  Vector2 lonlat_vec = georef.pixel_to_lonlat(right_pixel) - georef.pixel_to_lonlat(left_pixel);
+  return atan2( lonlat_vec[1], lonlat_vec[0] ) * (180/M_PI);
+}
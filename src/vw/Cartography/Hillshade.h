@@ -0,0 +1,177 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Hillshade.h
+///
+/// Shaded relief of a DEM.
+///
+#ifndef __VW_CARTOGRAPHY_HILLSHADE_H__
+#define __VW_CARTOGRAPHY_HILLSHADE_H__
+
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Image/PixelTypes.h>
+#include <vw/Cartography/GeoReference.h>
+
+#include <vector>
+
+namespace vw {
+namespace cartography {
+
+  /// A light source for hillshade().
+  struct HillshadeLight {
+    double azimuth;   ///< Degrees counter-clockwise from the +x axis of the image.
+    double elevation; ///< Degrees above the horizon.
+    double weight;    ///< Share of the final shade; weights are normalized to sum to one.
+
+    HillshadeLight( double azimuth = 300, double elevation = 20, double weight = 1 )
+      : azimuth(azimuth), elevation(elevation), weight(weight) {}
+  };
+
+  namespace detail {
+
+    /// Everything about a hillshade that does not depend on the tile.
+    struct HillshadeParams {
+      float u_scale, v_scale;
+      std::vector<Vector3f> lights;  ///< Unit vectors towards each light.
+      std::vector<float>    weights; ///< Normalized weight of each light.
+      std::vector<float>    kernel;  ///< Gaussian blur kernel; empty for none.
+
+      HillshadeParams( float u_scale, float v_scale,
+                       std::vector<HillshadeLight> const& lights, double blur_sigma );
+
+      /// Number of pixels the blur reads on either side.
+      int32 radius() const { return kernel.empty() ? 0 : int32(kernel.size()-1)/2; }
+    };
+
+    /// Computes hillshade() for the pixels of out_box.
+    /// - dem and valid hold the DEM over blur_box expanded by the
+    ///   blur radius, edge extended.
+    /// - blur_box is out_box grown by one pixel to the right and down,
+    ///   cropped to the image.
+    void hillshade_tile( ImageView<float> const& dem, ImageView<uint8> const& valid,
+                         BBox2i const& blur_box, Vector2i const& image_size,
+                         HillshadeParams const& params, BBox2i const& out_box,
+                         ImageView<PixelMask<PixelGray<float> > > & result );
+
+    template <class PixelT>
+    inline float hillshade_elevation( PixelT const& pixel ) {
+      return float( compound_select_channel<typename CompoundChannelType<PixelT>::type const&>( pixel, 0 ) );
+    }
+  }
+
+  /// The shaded relief of a DEM: the cosine of the angle between the
+  /// surface normal and the direction to the light, clamped to [0,1].
+  /// With several lights, the shades are averaged by weight.  Masked
+  /// DEM pixels, and any pixel whose neighbourhood contains one, are
+  /// invalid in the result.
+  ///
+  /// The normal at a pixel is taken from the pixel and its neighbours
+  /// to the right and below, after an optional Gaussian blur of the
+  /// DEM.  This matches compute_normals() and gaussian_filter(), but
+  /// the blur, the normals and the shading are computed together a
+  /// tile at a time, reading the DEM once with a halo, instead of
+  /// through a chain of per-pixel views.
+  template <class ImageT>
+  class HillshadeView : public ImageViewBase<HillshadeView<ImageT> > {
+    ImageT m_dem;
+    detail::HillshadeParams m_params;
+
+  public:
+    typedef PixelMask<PixelGray<float> > pixel_type;
+    typedef pixel_type                   result_type;
+    typedef ProceduralPixelAccessor<HillshadeView> pixel_accessor;
+
+    HillshadeView( ImageT const& dem, float u_scale, float v_scale,
+                   std::vector<HillshadeLight> const& lights, double blur_sigma )
+      : m_dem(dem), m_params(u_scale, v_scale, lights, blur_sigma) {}
+
+    inline int32 cols  () const { return m_dem.cols(); }
+    inline int32 rows  () const { return m_dem.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this, 0, 0); }
+    inline result_type operator()( int32 i, int32 j, int32 p=0 ) const {
+      return prerasterize(BBox2i(i,j,1,1))(i,j,p);
+    }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      BBox2i blur_box( bbox.min(), bbox.max() + Vector2i(1,1) );
+      blur_box.crop( BBox2i(0, 0, cols(), rows()) );
+      BBox2i dem_box = blur_box;
+      dem_box.expand( m_params.radius() );
+
+      ImageView<typename ImageT::pixel_type> input =
+        crop( edge_extend( m_dem, ConstantEdgeExtension() ), dem_box );
+      ImageView<float> dem  ( input.cols(), input.rows() );
+      ImageView<uint8> valid( input.cols(), input.rows() );
+      for ( int32 row = 0; row < dem.rows(); ++row )
+        for ( int32 col = 0; col < dem.cols(); ++col ) {
+          dem  (col,row) = detail::hillshade_elevation( remove_mask( input(col,row) ) );
+          valid(col,row) = is_valid( input(col,row) );
+        }
+
+      ImageView<pixel_type> output;
+      detail::hillshade_tile( dem, valid, blur_box, Vector2i(cols(), rows()),
+                              m_params, bbox, output );
+      return crop( output, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+    }
+
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+  };
+
+  /// Shaded relief of a DEM lit from several directions; see HillshadeView.
+  /// - u_scale and v_scale are the size of a pixel in the units of the
+  ///   elevations, signed as in hillshade_pixel_scale().
+  /// - A blur_sigma of zero disables the blur.
+  template <class ImageT>
+  HillshadeView<ImageT>
+  inline hillshade( ImageViewBase<ImageT> const& dem, float u_scale, float v_scale,
+                    std::vector<HillshadeLight> const& lights, double blur_sigma = 0 ) {
+    return HillshadeView<ImageT>( dem.impl(), u_scale, v_scale, lights, blur_sigma );
+  }
+
+  /// Shaded relief of a DEM lit from a single direction; see HillshadeView.
+  template <class ImageT>
+  HillshadeView<ImageT>
+  inline hillshade( ImageViewBase<ImageT> const& dem, float u_scale, float v_scale,
+                    double azimuth, double elevation, double blur_sigma = 0 ) {
+    return HillshadeView<ImageT>( dem.impl(), u_scale, v_scale,
+                                  std::vector<HillshadeLight>( 1, HillshadeLight(azimuth, elevation) ),
+                                  blur_sigma );
+  }
+
+  /// The size of a pixel of a georeferenced DEM, in meters, along the
+  /// +x and +y axes of the image.  Unprojected georeferences are
+  /// converted at the equator.
+  Vector2 hillshade_pixel_scale( GeoReference const& georef );
+
+  /// The angle, in degrees counter-clockwise, from East to the +x axis
+  /// of the image, measured along its middle row.  Subtracting it from
+  /// an azimuth relative to East gives one relative to the image.
+  double image_azimuth_from_east( GeoReference const& georef, Vector2i const& image_size );
+
+}} // namespace vw::cartography
+
+#endif // __VW_CARTOGRAPHY_HILLSHADE_H__
@@ -0,0 +1,353 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Cartography/SlopeView.h>
+#include <vw/Math/Vector.h>
+
+#include <cmath>
+#include <vector>
+
+using namespace vw;
+using namespace vw::cartography;
+
+namespace {
+
+  double dist_from_2pi( double n ) {
+    if ( fabs(n+2*M_PI) < fabs(n) ) return n+2*M_PI;
+    if ( fabs(n-2*M_PI) < fabs(n) ) return n-2*M_PI;
+    return n;
+  }
+
+  Vector2 gradient_aspect_from_normals( Vector3 const& center_normal, Vector3 const& plane_normal ) {
+    // The slope is the angle between the two normals.
+    double dotprod        = dot_prod(plane_normal,center_normal);
+    double gradient_angle = acos(dotprod);
+    Vector3 surface_normal_on_sphere_tangent_plane =
+      normalize(plane_normal-dot_prod(plane_normal,center_normal)*center_normal);
+
+    // Get the projection of (0,0,1) onto the sphere tangent plane.
+    Vector3 north(0,0,1);
+    Vector3 north_projected = normalize(north-dot_prod(north,center_normal)*center_normal);
+
+    // The aspect is the angle between those two.
+    double dotprod2 = dot_prod(surface_normal_on_sphere_tangent_plane, north_projected);
+    double aspect   = acos(dotprod2);
+    if (dotprod2 >  1) aspect = 0;
+    if (dotprod2 < -1) aspect = 0;
+
+    if ( dot_prod(cross_prod(north_projected,surface_normal_on_sphere_tangent_plane),center_normal) < 0 )
+      aspect = M_PI+aspect;
+    else
+      aspect = M_PI-aspect;
+
+    if (aspect >= 2*M_PI)
+      aspect = aspect-2*M_PI;
+    return Vector2(aspect,gradient_angle);
+  }
+
+  Vector2 gradient_aspect_from_dx_dy( double dx, double dy ) {
+    double gradient       = norm_2(Vector2(dx,dy));
+    double gradient_angle = atan(gradient);
+    // dy/dx = tan(aspect)
+    double aspect = atan(dy/dx);
+    if (dx < 0) aspect = aspect+M_PI;
+    aspect = 2*M_PI-aspect+M_PI/2;
+    if (aspect < 0) aspect = 2*M_PI+aspect;
+    if (aspect >= 2*M_PI) aspect = aspect-2*M_PI*(int)(aspect/2/M_PI);
+    return Vector2(aspect,gradient_angle);
+  }
+
+  Vector2 gradient_aspect_from_dtheta_dphi( double rho, double theta, double phi,
+                                            double dtheta, double dphi, Vector3 const& center ) {
+    double r_comp     = 1;
+    double theta_comp = dtheta/rho;
+    double phi_comp   = 1/(rho*sin(theta))*dphi;
+
+    double n_x = r_comp*sin(theta)*cos(phi)-phi_comp*sin(phi)+theta_comp*cos(theta)*cos(phi);
+    double n_y = r_comp*sin(theta)*sin(phi)+phi_comp*cos(phi)+theta_comp*cos(theta)*sin(phi);
+    double n_z = r_comp*cos(theta)-theta_comp*sin(theta);
+
+    Vector3 plane_normal = normalize(Vector3(n_x,n_y,n_z));
+    return gradient_aspect_from_normals(normalize(center), plane_normal);
+  }
+
+  /// The lon/lat of every pixel of a tile and what is needed to turn
+  /// it into cartesian coordinates at any height.  The arithmetic is
+  /// that of Datum::geodetic_to_cartesian().  For an unprojected
+  /// georeference whose pixel axes follow lon and lat, it is only done
+  /// once per column and once per row.
+  class TileGeodesy {
+    struct Latitude  { double lat, slat, clat, radius; };
+    struct Longitude { double lon, slon, clon; };
+
+    int32 m_cols;
+    bool  m_separable;
+    double m_e2;
+    std::vector<Latitude>  m_lat;
+    std::vector<Longitude> m_lon;
+
+    Latitude make_latitude( double lat, double a, double e2 ) const {
+      Latitude result;
+      result.lat = lat;
+      if ( lat < -90 ) lat = -90;
+      if ( lat >  90 ) lat = 90;
+      double rlat   = lat * (M_PI/180);
+      result.slat   = sin( rlat );
+      result.clat   = cos( rlat );
+      result.radius = a / sqrt(1.0-e2*result.slat*result.slat);
+      return result;
+    }
+
+    Longitude make_longitude( double lon, double meridian_offset ) const {
+      Longitude result;
+      result.lon  = lon;
+      double rlon = (lon + meridian_offset) * (M_PI/180);
+      result.slon = sin( rlon );
+      result.clon = cos( rlon );
+      return result;
+    }
+
+    size_t lat_index( int32 col, int32 row ) const { return m_separable ? row : size_t(row)*m_cols + col; }
+    size_t lon_index( int32 col, int32 row ) const { return m_separable ? col : size_t(row)*m_cols + col; }
+
+  public:
+    TileGeodesy( GeoReference const& georef, BBox2i const& box ) : m_cols(box.width()) {
+      Datum const& datum = georef.datum();
+      double a  = datum.semi_major_axis();
+      double b  = datum.semi_minor_axis();
+      double a2 = a * a;
+      double b2 = b * b;
+      m_e2 = (a2 - b2) / a2;
+
+      Matrix3x3 const& M = georef.transform();
+      m_separable = !georef.is_projected() && M(0,1) == 0 && M(1,0) == 0 &&
+                    M(2,0) == 0 && M(2,1) == 0;
+
+      if ( m_separable ) {
+        for ( int32 col = 0; col < box.width(); ++col ) {
+          Vector2 lonlat = georef.pixel_to_lonlat( Vector2(box.min().x()+col, box.min().y()) );
+          m_lon.push_back( make_longitude( lonlat[0], datum.meridian_offset() ) );
+        }
+        for ( int32 row = 0; row < box.height(); ++row ) {
+          Vector2 lonlat = georef.pixel_to_lonlat( Vector2(box.min().x(), box.min().y()+row) );
+          m_lat.push_back( make_latitude( lonlat[1], a, m_e2 ) );
+        }
+      } else {
+        m_lon.reserve( box.width()*box.height() );
+        m_lat.reserve( box.width()*box.height() );
+        for ( int32 row = 0; row < box.height(); ++row )
+          for ( int32 col = 0; col < box.width(); ++col ) {
+            Vector2 lonlat = georef.pixel_to_lonlat( Vector2(box.min().x()+col, box.min().y()+row) );
+            m_lon.push_back( make_longitude( lonlat[0], datum.meridian_offset() ) );
+            m_lat.push_back( make_latitude ( lonlat[1], a, m_e2 ) );
+          }
+      }
+    }
+
+    Vector2 lonlat( int32 col, int32 row ) const {
+      return Vector2( m_lon[lon_index(col,row)].lon, m_lat[lat_index(col,row)].lat );
+    }
+
+    Vector3 cartesian( int32 col, int32 row, double height ) const {
+      Latitude  const& lat = m_lat[lat_index(col,row)];
+      Longitude const& lon = m_lon[lon_index(col,row)];
+      return Vector3( (lat.radius+height) * lat.clat * lon.clon,
+                      (lat.radius+height) * lat.clat * lon.slon,
+                      (lat.radius*(1-m_e2)+height) * lat.slat );
+    }
+  };
+
+  /// The eigenvector of the smallest eigenvalue of a symmetric 3x3
+  /// matrix, by cyclic Jacobi rotations.
+  Vector3 smallest_eigenvector( Matrix3x3 A ) {
+    Matrix3x3 V = math::identity_matrix<3>();
+    for ( int sweep = 0; sweep < 32; ++sweep ) {
+      double off = A(0,1)*A(0,1) + A(0,2)*A(0,2) + A(1,2)*A(1,2);
+      double on  = A(0,0)*A(0,0) + A(1,1)*A(1,1) + A(2,2)*A(2,2);
+      if ( off <= 1e-30 * on )
+        break;
+      for ( int p = 0; p < 2; ++p )
+        for ( int q = p+1; q < 3; ++q ) {
+          if ( A(p,q) == 0 )
+            continue;
+          double theta = (A(q,q) - A(p,p)) / (2*A(p,q));
+          double t = (theta >= 0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta*theta + 1));
+          double c = 1 / sqrt(t*t + 1);
+          double s = t*c;
+          for ( int k = 0; k < 3; ++k ) { // A = A*J
+            double akp = A(k,p), akq = A(k,q);
+            A(k,p) = c*akp - s*akq;
+            A(k,q) = s*akp + c*akq;
+          }
+          for ( int k = 0; k < 3; ++k ) { // A = J^T*A
+            double apk = A(p,k), aqk = A(q,k);
+            A(p,k) = c*apk - s*aqk;
+            A(q,k) = s*apk + c*aqk;
+          }
+          for ( int k = 0; k < 3; ++k ) { // V = V*J
+            double vkp = V(k,p), vkq = V(k,q);
+            V(k,p) = c*vkp - s*vkq;
+            V(k,q) = s*vkp + c*vkq;
+          }
+        }
+    }
+    int smallest = 0;
+    for ( int i = 1; i < 3; ++i )
+      if ( A(i,i) < A(smallest,smallest) )
+        smallest = i;
+    return Vector3( V(0,smallest), V(1,smallest), V(2,smallest) );
+  }
+
+  /// Least squares gradient of the window around (col,row) by
+  /// finite differences over the stencil of the chosen algorithm.
+  Vector2 uneven_grid( ImageView<double> const& dem, TileGeodesy const& geodesy,
+                       ImageView<Vector3> const& points, int32 col, int32 row,
+                       SlopeAlgorithm algorithm, bool spherical ) {
+    double  height        = dem(col,row);
+    Vector3 center        = geodesy.cartesian(col, row, height);
+    Vector3 center_normal = normalize(center);
+    Vector3 center_below  = geodesy.cartesian(col, row, 0);
+
+    Vector3 north(0,0,1);
+    Vector3 north_projected = normalize(north-dot_prod(north,center_normal)*center_normal);
+
+    // Local axes
+    Vector3 up_normal = normalize(north_projected);                   // Also theta hat
+    Vector3 third     = normalize(cross_prod(up_normal,center_normal)); // Also phi hat
+
+    Vector2 lonlat = geodesy.lonlat(col, row);
+
+    // Normal equations of rise = run * slope over the stencil.
+    double vtv00 = 0, vtv01 = 0, vtv11 = 0, vtr0 = 0, vtr1 = 0;
+    for ( int32 i = -1; i <= 1; ++i ) {
+      for ( int32 j = -1; j <= 1; ++j ) {
+        if ( i == 0 && j == 0 )
+          continue;
+        bool direct = (i == 0) != (j == 0);
+        if ( algorithm == FlemingHofferSlope && !direct )
+          continue;
+        int repeat = ( algorithm == HornSlope && direct ) ? 2 : 1;
+
+        double rise, run0, run1;
+        if ( !spherical ) {
+          Vector3 const& neighbor = points(col+i, row+j);
+          Vector3 neighbor_below_rescale =
+            normalize(neighbor)*(norm_2(center_below)/dot_prod(normalize(neighbor),center_normal));
+          Vector3 v = neighbor_below_rescale-center_below;
+          rise = (dem(col+i,row+j)-height)/norm_2(v);
+          v = normalize(v);
+          run0 = dot_prod(v,up_normal);
+          run1 = dot_prod(v,third);
+        } else {
+          rise = dem(col+i,row+j)-height;
+          Vector2 neighbor_lonlat = geodesy.lonlat(col+i, row+j);
+          run0 = (neighbor_lonlat[1]-lonlat[1])*M_PI/180.0;
+          run1 = dist_from_2pi(neighbor_lonlat[0]-lonlat[0])*M_PI/180.0;
+        }
+        for ( int k = 0; k < repeat; ++k ) {
+          vtv00 += run0*run0;
+          vtv01 += run0*run1;
+          vtv11 += run1*run1;
+          vtr0  += run0*rise;
+          vtr1  += run1*rise;
+        }
+      }
+    }
+
+    double det  = vtv00*vtv11 - vtv01*vtv01;
+    double ans0 = ( vtv11*vtr0 - vtv01*vtr1) / det;
+    double ans1 = (-vtv01*vtr0 + vtv00*vtr1) / det;
+
+    if ( spherical ) {
+      double rho   = norm_2(center);
+      double phi   = lonlat[0]/180.0*M_PI;
+      double theta = (-lonlat[1]+90.0)/180.0*M_PI;
+      return gradient_aspect_from_dtheta_dphi(rho, theta, phi, ans0, -ans1, center);
+    }
+    return gradient_aspect_from_dx_dy(ans1, ans0);
+  }
+
+  /// Fit a plane to the 9 points of the window around (col,row).
+  Vector2 interpolate_plane( ImageView<Vector3> const& points, int32 col, int32 row ) {
+    // Work relative to the center point; planetary radii would swamp
+    // the relief otherwise.
+    Vector3 center = points(col,row);
+    Vector3 offsets[9], mean;
+    int k = 0;
+    for ( int32 i = -1; i <= 1; ++i )
+      for ( int32 j = -1; j <= 1; ++j, ++k ) {
+        offsets[k] = points(col+i,row+j) - center;
+        mean += offsets[k];
+      }
+    mean /= 9.0;
+
+    Matrix3x3 scatter;
+    for ( k = 0; k < 9; ++k ) {
+      Vector3 d = offsets[k] - mean;
+      for ( int r = 0; r < 3; ++r )
+        for ( int c = 0; c < 3; ++c )
+          scatter(r,c) += d[r]*d[c];
+    }
+
+    Vector3 center_normal = normalize(center);
+    Vector3 plane_normal  = normalize(smallest_eigenvector(scatter));
+    if ( dot_prod(plane_normal,center_normal) < 0 )
+      plane_normal = -plane_normal;
+    return gradient_aspect_from_normals(center_normal, plane_normal);
+  }
+
+} // namespace
+
+void vw::cartography::detail::slope_aspect_tile( ImageView<double> const& dem, BBox2i const& dem_box,
+                                                 Vector2i const& image_size, GeoReference const& georef,
+                                                 SlopeAlgorithm algorithm, bool spherical,
+                                                 BBox2i const& out_box, ImageView<Vector2> & result ) {
+  result.set_size( out_box.width(), out_box.height() );
+  fill( result, Vector2() );
+
+  // Only pixels with a full window get a value.
+  BBox2i interior( 1, 1, image_size.x()-2, image_size.y()-2 );
+  if ( interior.empty() )
+    return;
+  interior.crop( out_box );
+  if ( interior.empty() )
+    return;
+
+  // Each tile gets its own copy, since projections are not thread safe.
+  GeoReference local_georef = georef;
+  TileGeodesy geodesy( local_georef, dem_box );
+
+  // The cartesian position of every pixel, where it is used more than once.
+  ImageView<Vector3> points;
+  if ( algorithm == PlaneFitSlope || !spherical ) {
+    points.set_size( dem.cols(), dem.rows() );
+    for ( int32 row = 0; row < dem.rows(); ++row )
+      for ( int32 col = 0; col < dem.cols(); ++col )
+        points(col,row) = geodesy.cartesian( col, row, dem(col,row) );
+  }
+
+  for ( int32 y = interior.min().y(); y < interior.max().y(); ++y ) {
+    int32 row = y - dem_box.min().y();
+    for ( int32 x = interior.min().x(); x < interior.max().x(); ++x ) {
+      int32 col = x - dem_box.min().x();
+      result( x - out_box.min().x(), y - out_box.min().y() ) =
+        ( algorithm == PlaneFitSlope ) ? interpolate_plane( points, col, row )
+                                       : uneven_grid( dem, geodesy, points, col, row, algorithm, spherical );
+    }
+  }
+}
@@ -0,0 +1,138 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file SlopeView.h
+///
+/// Slope and aspect of a georeferenced DEM.
+///
+#ifndef __VW_CARTOGRAPHY_SLOPEVIEW_H__
+#define __VW_CARTOGRAPHY_SLOPEVIEW_H__
+
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Cartography/GeoReference.h>
+
+#include <boost/utility/enable_if.hpp>
+
+namespace vw {
+namespace cartography {
+
+  /// The ways slope_aspect() can estimate the surface from the 3x3
+  /// window around a pixel.
+  enum SlopeAlgorithm {
+    HornSlope,          ///< Horn: all 8 neighbours, the direct ones weighted twice.
+    FlemingHofferSlope, ///< Fleming & Hoffer: the 4 direct neighbours (rook's case).
+    SharpnackAkinSlope, ///< Sharpnack & Akin: all 8 neighbours alike (queen's case).
+    PlaneFitSlope       ///< The plane that best fits all 9 points.
+  };
+
+  namespace detail {
+
+    /// Provide safe interaction with DEMs that are scalar or compound
+    template <class PixelT>
+    typename boost::enable_if< IsScalar<PixelT>, double >::type
+    inline elevation_value( PixelT const& pixel ) { return pixel; }
+
+    template <class PixelT>
+    typename boost::enable_if< IsCompound<PixelT>, double >::type
+    inline elevation_value( PixelT const& pixel ) { return pixel[0]; }
+
+    /// Computes slope_aspect() for the pixels of out_box.
+    /// - dem holds the elevations of dem_box, which is out_box grown by
+    ///   one pixel and cropped to the image.
+    /// - Pixels on the border of the image are set to zero.
+    void slope_aspect_tile( ImageView<double> const& dem, BBox2i const& dem_box,
+                            Vector2i const& image_size, GeoReference const& georef,
+                            SlopeAlgorithm algorithm, bool spherical,
+                            BBox2i const& out_box, ImageView<Vector2> & result );
+  }
+
+  /// The aspect and slope of each pixel of a DEM, in radians, as
+  /// Vector2(aspect, slope).  Aspect is the uphill direction, measured
+  /// clockwise from north.
+  ///
+  /// With spherical set, the gradient is found in the lon/lat frame
+  /// of the datum; otherwise neighbours are projected onto the plane
+  /// tangent to the datum below the pixel.  Pixels on the border of
+  /// the image have no full window and are set to zero.
+  ///
+  /// Tiles are computed whole, reading the DEM once with a one pixel
+  /// halo.  The geodetic to cartesian conversion of each pixel is
+  /// done once per tile instead of once per window it appears in, and
+  /// for unprojected, axis-aligned georeferences its trigonometry is
+  /// shared by every pixel in a row or column.
+  template <class ImageT>
+  class SlopeAspectView : public ImageViewBase<SlopeAspectView<ImageT> > {
+    ImageT         m_dem;
+    GeoReference   m_georef;
+    SlopeAlgorithm m_algorithm;
+    bool           m_spherical;
+
+  public:
+    typedef Vector2    pixel_type;
+    typedef pixel_type result_type;
+    typedef ProceduralPixelAccessor<SlopeAspectView> pixel_accessor;
+
+    SlopeAspectView( ImageT const& dem, GeoReference const& georef,
+                     SlopeAlgorithm algorithm, bool spherical )
+      : m_dem(dem), m_georef(georef), m_algorithm(algorithm), m_spherical(spherical) {}
+
+    inline int32 cols  () const { return m_dem.cols(); }
+    inline int32 rows  () const { return m_dem.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this, 0, 0); }
+    inline result_type operator()( int32 i, int32 j, int32 p=0 ) const {
+      return prerasterize(BBox2i(i,j,1,1))(i,j,p);
+    }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      BBox2i dem_box = bbox;
+      dem_box.expand(1);
+      dem_box.crop( BBox2i(0, 0, cols(), rows()) );
+
+      ImageView<typename ImageT::pixel_type> input = crop( m_dem, dem_box );
+      ImageView<double> dem( input.cols(), input.rows() );
+      for ( int32 row = 0; row < dem.rows(); ++row )
+        for ( int32 col = 0; col < dem.cols(); ++col )
+          dem(col,row) = detail::elevation_value( input(col,row) );
+
+      ImageView<pixel_type> output;
+      detail::slope_aspect_tile( dem, dem_box, Vector2i(cols(), rows()), m_georef,
+                                 m_algorithm, m_spherical, bbox, output );
+      return crop( output, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+    }
+
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+  };
+
+  /// Slope and aspect of a DEM; see SlopeAspectView.
+  template <class ImageT>
+  SlopeAspectView<ImageT>
+  inline slope_aspect( ImageViewBase<ImageT> const& dem, GeoReference const& georef,
+                       SlopeAlgorithm algorithm = HornSlope, bool spherical = true ) {
+    return SlopeAspectView<ImageT>( dem.impl(), georef, algorithm, spherical );
+  }
+
+}} // namespace vw::cartography
+
+#endif // __VW_CARTOGRAPHY_SLOPEVIEW_H__
@@ -0,0 +1,139 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/Cartography/Hillshade.h>
+#include <vw/Image/Algorithms.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/Filter.h>
+#include <vw/Image/MaskViews.h>
+#include <vw/Math/EulerAngles.h>
+
+using namespace vw;
+using namespace vw::cartography;
+using namespace vw::test;
+
+namespace {
+
+  ImageView<PixelMask<PixelGray<float> > > bumpy_dem() {
+    ImageView<PixelMask<PixelGray<float> > > dem( 41, 33 );
+    for ( int32 y = 0; y < dem.rows(); ++y )
+      for ( int32 x = 0; x < dem.cols(); ++x )
+        dem(x,y) = PixelGray<float>( 40*sin(x*0.3) + 25*cos(y*0.2) + 0.5*x*y );
+    return dem;
+  }
+
+  // The hillshade as a chain of per-pixel views.
+  template <class ViewT>
+  ImageView<PixelMask<PixelGray<float> > >
+  reference_hillshade( ViewT const& dem, float u_scale, float v_scale,
+                       double azimuth, double elevation ) {
+    Vector3f light = math::euler_to_rotation_matrix( elevation*M_PI/180, azimuth*M_PI/180, 0, "yzx" )
+                     * Vector3f(1,0,0);
+    return clamp( dot_prod( compute_normals( dem, u_scale, v_scale ), light ) );
+  }
+
+  double max_difference( ImageView<PixelMask<PixelGray<float> > > const& a,
+                         ImageView<PixelMask<PixelGray<float> > > const& b ) {
+    double result = 0;
+    for ( int32 y = 0; y < a.rows(); ++y )
+      for ( int32 x = 0; x < a.cols(); ++x ) {
+        EXPECT_EQ( is_valid(a(x,y)), is_valid(b(x,y)) ) << "at " << x << "," << y;
+        if ( is_valid(a(x,y)) && is_valid(b(x,y)) )
+          result = std::max( result, fabs( double(a(x,y).child()) - b(x,y).child() ) );
+      }
+    return result;
+  }
+}
+
+TEST( Hillshade, MatchesNormals ) {
+  ImageView<PixelMask<PixelGray<float> > > dem = bumpy_dem();
+  ImageView<PixelMask<PixelGray<float> > > shaded = hillshade( dem, 2.0, -2.0, 300, 20 );
+  EXPECT_EQ( 0, max_difference( shaded, reference_hillshade( dem, 2.0, -2.0, 300, 20 ) ) );
+}
+
+TEST( Hillshade, MatchesBlurredNormals ) {
+  ImageView<PixelMask<PixelGray<float> > > dem = bumpy_dem();
+  ImageView<PixelMask<PixelGray<float> > > shaded = hillshade( dem, 2.0, -2.0, 45, 30, 1.5 );
+  ImageView<PixelMask<PixelGray<float> > > expected =
+    reference_hillshade( gaussian_filter( dem, 1.5 ), 2.0, -2.0, 45, 30 );
+  EXPECT_LT( max_difference( shaded, expected ), 1e-4 );
+}
+
+TEST( Hillshade, Mask ) {
+  ImageView<PixelMask<PixelGray<float> > > dem = bumpy_dem();
+  dem(10,10).invalidate();
+
+  ImageView<PixelMask<PixelGray<float> > > shaded = hillshade( dem, 2.0, -2.0, 300, 20 );
+  EXPECT_EQ( 0, max_difference( shaded, reference_hillshade( dem, 2.0, -2.0, 300, 20 ) ) );
+  EXPECT_FALSE( is_valid( shaded(10,10) ) );
+  EXPECT_FALSE( is_valid( shaded( 9,10) ) );
+  EXPECT_FALSE( is_valid( shaded(10, 9) ) );
+  EXPECT_TRUE ( is_valid( shaded(11,10) ) );
+  EXPECT_TRUE ( is_valid( shaded( 9, 9) ) );
+
+  // With a blur the hole grows by the radius of the kernel.
+  shaded = hillshade( dem, 2.0, -2.0, 300, 20, 1.0 );
+  int32 radius = compute_kernel_size(1.0) / 2;
+  EXPECT_FALSE( is_valid( shaded(10+radius,10) ) );
+  EXPECT_TRUE ( is_valid( shaded(11+radius,10) ) );
+  EXPECT_FALSE( is_valid( shaded(10,9-radius) ) );
+  EXPECT_TRUE ( is_valid( shaded(10,8-radius) ) );
+}
+
+TEST( Hillshade, Unmasked ) {
+  ImageView<float> dem( 12, 9 );
+  for ( int32 y = 0; y < dem.rows(); ++y )
+    for ( int32 x = 0; x < dem.cols(); ++x )
+      dem(x,y) = x*x - 3*y;
+  ImageView<PixelMask<PixelGray<float> > > shaded = hillshade( dem, 1.0, -1.0, 10, 40 );
+  EXPECT_EQ( 0, max_difference( shaded, reference_hillshade( pixel_cast<PixelMask<PixelGray<float> > >(dem),
+                                                             1.0, -1.0, 10, 40 ) ) );
+}
+
+TEST( Hillshade, TilesMatchWhole ) {
+  ImageView<PixelMask<PixelGray<float> > > dem = bumpy_dem();
+  dem(20,5).invalidate();
+  for ( int blur = 0; blur < 2; ++blur ) {
+    ImageView<PixelMask<PixelGray<float> > > whole = hillshade( dem, 3.0, -3.0, 120, 25, blur*2.0 );
+    ImageView<PixelMask<PixelGray<float> > > tiled =
+      block_rasterize( hillshade( dem, 3.0, -3.0, 120, 25, blur*2.0 ), Vector2i(8,8) );
+    for ( int32 y = 0; y < dem.rows(); ++y )
+      for ( int32 x = 0; x < dem.cols(); ++x ) {
+        EXPECT_EQ( is_valid(whole(x,y)), is_valid(tiled(x,y)) );
+        EXPECT_EQ( whole(x,y).child(), tiled(x,y).child() );
+      }
+  }
+}
+
+TEST( Hillshade, Multidirectional ) {
+  ImageView<PixelMask<PixelGray<float> > > dem = bumpy_dem();
+  std::vector<HillshadeLight> lights;
+  lights.push_back( HillshadeLight( 300, 20, 3 ) );
+  lights.push_back( HillshadeLight(  30, 45, 1 ) );
+  ImageView<PixelMask<PixelGray<float> > > shaded = hillshade( dem, 2.0, -2.0, lights );
+  ImageView<PixelMask<PixelGray<float> > > first  = hillshade( dem, 2.0, -2.0, 300, 20 );
+  ImageView<PixelMask<PixelGray<float> > > second = hillshade( dem, 2.0, -2.0,  30, 45 );
+  for ( int32 y = 0; y < dem.rows(); ++y )
+    for ( int32 x = 0; x < dem.cols(); ++x )
+      EXPECT_NEAR( 0.75*first(x,y).child() + 0.25*second(x,y).child(), shaded(x,y).child(), 1e-6 );
+
+  EXPECT_THROW( hillshade( dem, 2.0, -2.0, std::vector<HillshadeLight>() ), ArgumentErr );
+}
@@ -0,0 +1,132 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/Cartography/SlopeView.h>
+#include <vw/Image/BlockRasterize.h>
+
+using namespace vw;
+using namespace vw::cartography;
+using namespace vw::test;
+
+namespace {
+
+  GeoReference lonlat_georef( double rotation = 0 ) {
+    Matrix3x3 transform;
+    transform(0,0) =  1e-4;
+    transform(0,1) =  rotation;
+    transform(1,1) = -1e-4;
+    transform(0,2) =  10;
+    transform(1,2) =  0.001;
+    transform(2,2) =  1;
+    GeoReference georef;
+    georef.set_transform( transform );
+    return georef;
+  }
+
+  ImageView<float> bumpy_dem() {
+    ImageView<float> dem( 37, 29 );
+    for ( int32 y = 0; y < dem.rows(); ++y )
+      for ( int32 x = 0; x < dem.cols(); ++x )
+        dem(x,y) = 20*sin(x*0.3) + 10*cos(y*0.2) + 0.5*x*y;
+    return dem;
+  }
+
+  // Distance between two aspect/slope pairs, with aspect wrapping around.
+  double difference( Vector2 const& a, Vector2 const& b ) {
+    double aspect = fabs(a[0] - b[0]);
+    aspect = std::min( aspect, 2*M_PI - aspect );
+    return std::max( aspect, fabs(a[1] - b[1]) );
+  }
+}
+
+TEST( SlopeView, Flat ) {
+  ImageView<float> dem( 8, 8 );
+  fill( dem, 100 );
+  ImageView<Vector2> result = slope_aspect( dem, lonlat_georef() );
+  ASSERT_EQ( 8, result.cols() );
+  ASSERT_EQ( 8, result.rows() );
+  for ( int32 y = 1; y < 7; ++y )
+    for ( int32 x = 1; x < 7; ++x )
+      EXPECT_NEAR( 0, result(x,y)[1], 1e-6 );
+}
+
+TEST( SlopeView, Border ) {
+  ImageView<Vector2> result = slope_aspect( bumpy_dem(), lonlat_georef() );
+  for ( int32 x = 0; x < result.cols(); ++x ) {
+    EXPECT_VW_EQ( Vector2(), result(x,0) );
+    EXPECT_VW_EQ( Vector2(), result(x,result.rows()-1) );
+  }
+  for ( int32 y = 0; y < result.rows(); ++y ) {
+    EXPECT_VW_EQ( Vector2(), result(0,y) );
+    EXPECT_VW_EQ( Vector2(), result(result.cols()-1,y) );
+  }
+  EXPECT_GT( result(5,5)[1], 0 );
+}
+
+TEST( SlopeView, Aspect ) {
+  // Aspect points uphill, clockwise from north.
+  ImageView<float> west( 5, 5 ), north( 5, 5 );
+  for ( int32 y = 0; y < 5; ++y )
+    for ( int32 x = 0; x < 5; ++x ) {
+      west (x,y) = 10 - x;
+      north(x,y) = 10 - y;
+    }
+
+  SlopeAlgorithm algorithms[] = { HornSlope, FlemingHofferSlope, SharpnackAkinSlope, PlaneFitSlope };
+  for ( int spherical = 0; spherical < 2; ++spherical )
+    for ( int i = 0; i < 4; ++i ) {
+      Vector2 value = slope_aspect( west, lonlat_georef(), algorithms[i], spherical )(2,2);
+      EXPECT_NEAR( 3*M_PI/2, value[0], 1e-2 );
+      EXPECT_GT( value[1], 0 );
+      value = slope_aspect( north, lonlat_georef(), algorithms[i], spherical )(2,2);
+      EXPECT_LT( difference( Vector2(0, value[1]), value ), 1e-2 );
+      EXPECT_GT( value[1], 0 );
+    }
+}
+
+TEST( SlopeView, TilesMatchWhole ) {
+  ImageView<float> dem = bumpy_dem();
+  SlopeAlgorithm algorithms[] = { HornSlope, FlemingHofferSlope, SharpnackAkinSlope, PlaneFitSlope };
+  for ( int rotated = 0; rotated < 2; ++rotated )
+    for ( int i = 0; i < 4; ++i ) {
+      GeoReference georef = lonlat_georef( rotated ? 2e-5 : 0 );
+      ImageView<Vector2> whole = slope_aspect( dem, georef, algorithms[i] );
+      ImageView<Vector2> tiled =
+        block_rasterize( slope_aspect( dem, georef, algorithms[i] ), Vector2i(8,8) );
+      for ( int32 y = 0; y < dem.rows(); ++y )
+        for ( int32 x = 0; x < dem.cols(); ++x )
+          EXPECT_EQ( whole(x,y), tiled(x,y) );
+    }
+}
+
+TEST( SlopeView, AlgorithmsAgree ) {
+  // On a smooth surface every estimate should be close.
+  ImageView<float> dem = bumpy_dem();
+  GeoReference georef = lonlat_georef();
+  ImageView<Vector2> horn = slope_aspect( dem, georef, HornSlope );
+  ImageView<Vector2> fit  = slope_aspect( dem, georef, PlaneFitSlope );
+  ImageView<Vector2> flat = slope_aspect( dem, georef, HornSlope, false );
+  for ( int32 y = 1; y < dem.rows()-1; ++y )
+    for ( int32 x = 1; x < dem.cols()-1; ++x ) {
+      EXPECT_LT( difference( horn(x,y), fit (x,y) ), 0.05 );
+      EXPECT_LT( difference( horn(x,y), flat(x,y) ), 0.05 );
+    }
+}
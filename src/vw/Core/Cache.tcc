@@ -98,7 +98,14 @@ typename Cache::CacheLine<GeneratorT>::value_type const& Cache::CacheLine<Genera
 
     //TODO: Why allocate and then generate?
     m_generation_count++; // Update stats
-    m_value = core::detail::pointerish(m_generator)->generate();
+    try {
+      m_value = core::detail::pointerish(m_generator)->generate();
+    } catch (...) {
+      // Leave the line empty and unlocked so the next caller can retry.
+      CacheLineBase::deallocate();
+      m_mutex.unlock();
+      throw;
+    }
     // Downgrade from exclusive access down to shared access
     m_mutex.unlock_and_lock_upgrade();
     m_mutex.unlock_upgrade_and_lock_shared();
@@ -114,7 +121,7 @@ void Cache::CacheLine<GeneratorT>::release() {
 template <class GeneratorT>
 bool Cache::CacheLine<GeneratorT>::valid() {
   Mutex::WriteLock line_lock(m_mutex);
-  return m_value;
+  return bool(m_value);
 }
 
 template <class GeneratorT>
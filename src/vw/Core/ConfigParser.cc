@@ -115,6 +115,14 @@ void vw::parse_config(std::basic_istream<char>& stream,
         settings.set_write_pool_size(boost::lexical_cast<uint32>(o.value[0]));
       else if (o.string_key == "general.tmp_directory")
         settings.set_tmp_directory(o.value[0]);
+      else if (o.string_key == "general.image_buffer_pool_size")
+        settings.set_image_buffer_pool_size(boost::lexical_cast<size_t>(o.value[0]));
+      else if (o.string_key == "general.image_buffer_huge_pages")
+        settings.set_image_buffer_huge_pages(boost::lexical_cast<bool>(o.value[0]));
+      else if (o.string_key == "general.prefetch_threads")
+        settings.set_prefetch_threads(boost::lexical_cast<uint32>(o.value[0]));
+      else if (o.string_key == "general.prefetch_bytes")
+        settings.set_prefetch_bytes(boost::lexical_cast<size_t>(o.value[0]));
       else if (o.string_key.compare(0, 8, "logfile ") == 0) {
         size_t sep = o.string_key.find_last_of('.');
         assert(sep != std::string::npos);
@@ -0,0 +1,257 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/config.h>
+#include <vw/Core/MemoryPool.h>
+#include <vw/Core/System.h>
+
+#include <cstdlib>
+#include <ostream>
+#include <vector>
+
+#ifdef WIN32
+#include <malloc.h>
+#endif
+
+#ifdef VW_HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+namespace vw {
+
+  // Blocks carry no header. The caller passes the requested size back
+  // to deallocate(), which is enough to recover the size class.
+  struct MemoryPool::ThreadCache {
+    MemoryPool* pool;
+    Mutex       mutex; // Only contended by stats()
+    std::vector<std::vector<void*> > free_lists;
+    MemoryPoolStats counters;
+
+    ThreadCache( MemoryPool* p ) : pool(p) {}
+  };
+
+  MemoryPoolStats::MemoryPoolStats()
+    : allocations(0), cache_hits(0), deallocations(0), system_allocs(0),
+      system_frees(0), huge_page_blocks(0), bytes_in_use(0), bytes_cached(0) {}
+
+  double MemoryPoolStats::hit_rate() const {
+    if (allocations == 0)
+      return 0.0;
+    return double(cache_hits) / double(allocations);
+  }
+
+  MemoryPoolStats& MemoryPoolStats::operator+=( MemoryPoolStats const& other ) {
+    allocations      += other.allocations;
+    cache_hits       += other.cache_hits;
+    deallocations    += other.deallocations;
+    system_allocs    += other.system_allocs;
+    system_frees     += other.system_frees;
+    huge_page_blocks += other.huge_page_blocks;
+    bytes_in_use     += other.bytes_in_use;
+    bytes_cached     += other.bytes_cached;
+    return *this;
+  }
+
+  std::ostream& operator<<( std::ostream& os, MemoryPoolStats const& stats ) {
+    os << "allocations: "    << stats.allocations
+       << " (hit rate "      << stats.hit_rate() << ")"
+       << ", deallocations: "<< stats.deallocations
+       << ", system allocs: "<< stats.system_allocs
+       << ", system frees: " << stats.system_frees
+       << ", huge-page blocks: " << stats.huge_page_blocks
+       << ", bytes in use: " << stats.bytes_in_use
+       << ", bytes cached: " << stats.bytes_cached;
+    return os;
+  }
+
+  MemoryPool::MemoryPool( size_t thread_cache_size, bool huge_pages )
+    : m_thread_cache_size(thread_cache_size), m_huge_pages(huge_pages),
+      m_caches(&MemoryPool::retire) {}
+
+  MemoryPool::~MemoryPool() {
+    // Only the calling thread's cache can be detached here; the
+    // others must already have exited (see the class comment).
+    m_caches.reset();
+    Mutex::Lock lock(m_registry_mutex);
+    for (std::set<ThreadCache*>::iterator it = m_registry.begin(); it != m_registry.end(); ++it) {
+      release_all(**it);
+      delete *it;
+    }
+    m_registry.clear();
+  }
+
+  size_t MemoryPool::class_index( size_t bytes ) {
+    if (bytes <= ALIGNMENT)
+      return 0;
+    // Find p such that 2^p < bytes <= 2^(p+1), then split that range
+    // into four equal steps.
+    size_t p = 0;
+    for (size_t v = bytes - 1; v > 1; v >>= 1)
+      ++p;
+    size_t step = size_t(1) << (p - 2);
+    size_t sub  = (bytes + step - 1) / step - 4; // 1..4
+    return (p - 6) * 4 + sub;
+  }
+
+  size_t MemoryPool::class_size( size_t bytes ) {
+    if (bytes <= ALIGNMENT)
+      return ALIGNMENT;
+    size_t index = class_index(bytes);
+    size_t p     = (index - 1) / 4 + 6;
+    size_t sub   = (index - 1) % 4 + 1;
+    return (size_t(1) << p) + sub * (size_t(1) << (p - 2));
+  }
+
+  MemoryPool::ThreadCache& MemoryPool::thread_cache() {
+    ThreadCache* cache = m_caches.get();
+    if (!cache) {
+      cache = new ThreadCache(this);
+      {
+        Mutex::Lock lock(m_registry_mutex);
+        m_registry.insert(cache);
+      }
+      m_caches.reset(cache);
+    }
+    return *cache;
+  }
+
+  void* MemoryPool::system_allocate( size_t bytes, ThreadCache& cache ) {
+    bool   huge      = m_huge_pages && bytes >= HUGE_PAGE_SIZE;
+    size_t alignment = huge ? HUGE_PAGE_SIZE : ALIGNMENT;
+    void*  ptr       = 0;
+#ifdef WIN32
+    ptr = _aligned_malloc(bytes, alignment);
+#else
+    if (posix_memalign(&ptr, alignment, bytes) != 0)
+      ptr = 0;
+#endif
+    if (!ptr)
+      return 0;
+    cache.counters.system_allocs++;
+#if defined(VW_HAVE_SYS_MMAN_H) && defined(MADV_HUGEPAGE)
+    if (huge && madvise(ptr, bytes, MADV_HUGEPAGE) == 0)
+      cache.counters.huge_page_blocks++;
+#endif
+    return ptr;
+  }
+
+  void MemoryPool::system_free( void* ptr ) {
+#ifdef WIN32
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+  }
+
+  void* MemoryPool::allocate( size_t bytes ) {
+    size_t size  = class_size(bytes);
+    size_t index = class_index(bytes);
+    ThreadCache& cache = thread_cache();
+    Mutex::Lock lock(cache.mutex);
+
+    void* ptr = 0;
+    if (index < cache.free_lists.size() && !cache.free_lists[index].empty()) {
+      ptr = cache.free_lists[index].back();
+      cache.free_lists[index].pop_back();
+      cache.counters.cache_hits++;
+      cache.counters.bytes_cached -= size;
+    } else {
+      ptr = system_allocate(size, cache);
+      if (!ptr)
+        return 0;
+    }
+    cache.counters.allocations++;
+    cache.counters.bytes_in_use += size;
+    return ptr;
+  }
+
+  void MemoryPool::deallocate( void* ptr, size_t bytes ) {
+    if (!ptr)
+      return;
+    size_t size  = class_size(bytes);
+    size_t index = class_index(bytes);
+    ThreadCache& cache = thread_cache();
+    Mutex::Lock lock(cache.mutex);
+
+    cache.counters.deallocations++;
+    cache.counters.bytes_in_use -= size;
+    if (uint64(cache.counters.bytes_cached) + size > m_thread_cache_size) {
+      system_free(ptr);
+      cache.counters.system_frees++;
+      return;
+    }
+    if (index >= cache.free_lists.size())
+      cache.free_lists.resize(index + 1);
+    cache.free_lists[index].push_back(ptr);
+    cache.counters.bytes_cached += size;
+  }
+
+  // Assumes the caller has exclusive access to the cache.
+  void MemoryPool::release_all( ThreadCache& cache ) {
+    for (size_t i = 0; i < cache.free_lists.size(); ++i) {
+      std::vector<void*>& list = cache.free_lists[i];
+      for (size_t j = 0; j < list.size(); ++j)
+        system_free(list[j]);
+      cache.counters.system_frees += list.size();
+      list.clear();
+    }
+    cache.counters.bytes_cached = 0;
+  }
+
+  void MemoryPool::purge() {
+    ThreadCache& cache = thread_cache();
+    Mutex::Lock lock(cache.mutex);
+    release_all(cache);
+  }
+
+  // Called by boost when a thread that used the pool exits.
+  void MemoryPool::retire( ThreadCache* cache ) {
+    MemoryPool* pool = cache->pool;
+    Mutex::Lock lock(pool->m_registry_mutex);
+    {
+      Mutex::Lock cache_lock(cache->mutex);
+      pool->release_all(*cache);
+      pool->m_retired += cache->counters;
+    }
+    pool->m_registry.erase(cache);
+    delete cache;
+  }
+
+  MemoryPoolStats MemoryPool::stats() const {
+    Mutex::Lock lock(m_registry_mutex);
+    MemoryPoolStats result = m_retired;
+    for (std::set<ThreadCache*>::const_iterator it = m_registry.begin(); it != m_registry.end(); ++it) {
+      Mutex::Lock cache_lock((*it)->mutex);
+      result += (*it)->counters;
+    }
+    return result;
+  }
+
+  bool detail::image_buffer_pool_enabled() {
+    return vw_memory_pool().enabled();
+  }
+
+  void* detail::image_buffer_allocate( size_t bytes ) {
+    return vw_memory_pool().allocate( bytes );
+  }
+
+  void detail::image_buffer_deallocate( void* ptr, size_t bytes ) {
+    vw_memory_pool().deallocate( ptr, bytes );
+  }
+
+} // namespace vw
@@ -0,0 +1,148 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file MemoryPool.h
+///
+/// A size-class pool allocator for large, short-lived buffers such as
+/// ImageView tiles.
+///
+#ifndef __VW_CORE_MEMORYPOOL_H__
+#define __VW_CORE_MEMORYPOOL_H__
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Thread.h>
+
+#include <set>
+#include <iosfwd>
+
+#include <boost/atomic.hpp>
+#include <boost/thread/tss.hpp>
+
+namespace vw {
+
+  /// Usage counters for a MemoryPool, summed over every thread that
+  /// has touched it.
+  struct MemoryPoolStats {
+    uint64 allocations;      ///< Number of blocks handed out.
+    uint64 cache_hits;       ///< Allocations served from a free list.
+    uint64 deallocations;    ///< Number of blocks handed back.
+    uint64 system_allocs;    ///< Blocks obtained from the system allocator.
+    uint64 system_frees;     ///< Blocks returned to the system allocator.
+    uint64 huge_page_blocks; ///< System blocks advised for huge-page backing.
+    int64  bytes_in_use;     ///< Bytes currently held by callers.
+    int64  bytes_cached;     ///< Bytes parked on free lists.
+
+    MemoryPoolStats();
+
+    /// Fraction of allocations that were served without calling the system allocator.
+    double hit_rate() const;
+
+    MemoryPoolStats& operator+=( MemoryPoolStats const& other );
+  };
+
+  std::ostream& operator<<( std::ostream& os, MemoryPoolStats const& stats );
+
+  /// A thread-caching, size-class pool allocator.
+  ///
+  /// Requests are rounded up to one of four size classes per power of
+  /// two (so at most 25% is wasted) and every block is aligned to
+  /// ALIGNMENT bytes.  Freed blocks are kept on a free list belonging
+  /// to the thread that freed them, so a thread that repeatedly
+  /// allocates and releases tiles of the same size never has to go
+  /// back to the system heap or take a lock shared with other threads.
+  /// Each thread keeps at most thread_cache_size() bytes; anything
+  /// beyond that goes straight back to the system.  A cache size of
+  /// zero disables pooling.
+  ///
+  /// When huge pages are enabled, blocks of HUGE_PAGE_SIZE or more
+  /// are aligned to a huge page boundary and advised for transparent
+  /// huge-page backing where the platform supports it.
+  ///
+  /// A MemoryPool must outlive every thread that allocated from it.
+  /// You should normally use the global instance, vw_memory_pool(),
+  /// which is configured through vw_settings().
+  class MemoryPool : private boost::noncopyable {
+  public:
+    static const size_t ALIGNMENT      = 64;
+    static const size_t HUGE_PAGE_SIZE = 2*1024*1024;
+
+    MemoryPool( size_t thread_cache_size = 0, bool huge_pages = false );
+    ~MemoryPool();
+
+    /// Returns a block of at least the requested size, or 0 if the
+    /// system is out of memory.
+    void* allocate( size_t bytes );
+
+    /// Returns a block obtained from allocate().  The size must be the
+    /// one that was originally requested.
+    void deallocate( void* ptr, size_t bytes );
+
+    /// True if freed blocks are being kept for reuse.
+    bool enabled() const { return m_thread_cache_size.load( boost::memory_order_relaxed ) != 0; }
+
+    size_t thread_cache_size() const { return m_thread_cache_size; }
+    void set_thread_cache_size( size_t bytes ) { m_thread_cache_size = bytes; }
+
+    bool huge_pages() const { return m_huge_pages; }
+    void set_huge_pages( bool enable ) { m_huge_pages = enable; }
+
+    /// Returns every block cached by the calling thread to the system.
+    void purge();
+
+    /// Returns a snapshot of the usage counters.
+    MemoryPoolStats stats() const;
+
+    /// The number of bytes actually reserved for a request of the given size.
+    static size_t class_size( size_t bytes );
+
+    /// The free list index used for a request of the given size.
+    static size_t class_index( size_t bytes );
+
+    struct ThreadCache;
+
+  private:
+    ThreadCache& thread_cache();
+    void* system_allocate( size_t bytes, ThreadCache& cache );
+    void  system_free( void* ptr );
+    void  release_all( ThreadCache& cache );
+    static void retire( ThreadCache* cache );
+
+    boost::atomic<size_t> m_thread_cache_size;
+    boost::atomic<bool>   m_huge_pages;
+
+    boost::thread_specific_ptr<ThreadCache> m_caches;
+    mutable Mutex             m_registry_mutex;
+    std::set<ThreadCache*>    m_registry;
+    MemoryPoolStats           m_retired;
+  };
+
+  namespace detail {
+    /// Out of line access to vw_memory_pool() for ImageView, which
+    /// allocates too often to re-read the settings each time.  The
+    /// settings are read on the first call only; after that this is a
+    /// lock-free read of the pool state.
+    bool image_buffer_pool_enabled();
+
+    /// Allocate and free ImageView buffers through vw_memory_pool().
+    void* image_buffer_allocate( size_t bytes );
+    void  image_buffer_deallocate( void* ptr, size_t bytes );
+  }
+
+} // namespace vw
+
+#endif // __VW_CORE_MEMORYPOOL_H__
@@ -0,0 +1,185 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Core/Prefetcher.h>
+#include <vw/Core/Log.h>
+
+#include <exception>
+#include <ostream>
+
+namespace vw {
+
+  // ---------------------------------------------------------------
+  // PrefetchStream
+
+  void PrefetchStream::cancel() {
+    Mutex::Lock lock(m_mutex);
+    m_epoch = m_epoch + 1;
+  }
+
+  void PrefetchStream::cancel_and_wait() {
+    Mutex::Lock lock(m_mutex);
+    m_epoch = m_epoch + 1;
+    while (m_running > 0)
+      m_idle_event.wait(lock);
+  }
+
+  int PrefetchStream::running() const {
+    Mutex::Lock lock(m_mutex);
+    return m_running;
+  }
+
+  // ---------------------------------------------------------------
+  // PrefetchStats
+
+  PrefetchStats::PrefetchStats()
+    : submitted(0), completed(0), cancelled(0), rejected(0), failed(0), bytes_outstanding(0) {}
+
+  std::ostream& operator<<( std::ostream& os, PrefetchStats const& stats ) {
+    os << "submitted: "   << stats.submitted
+       << ", completed: " << stats.completed
+       << ", cancelled: " << stats.cancelled
+       << ", rejected: "  << stats.rejected
+       << ", failed: "    << stats.failed
+       << ", bytes outstanding: " << stats.bytes_outstanding;
+    return os;
+  }
+
+  // ---------------------------------------------------------------
+  // Prefetcher
+
+  class Prefetcher::PrefetchTask : public Task {
+    Prefetcher& m_owner;
+    boost::shared_ptr<PrefetchStream>  m_stream;
+    boost::shared_ptr<PrefetchRequest> m_request;
+    uint64 m_epoch;
+  public:
+    size_t bytes;
+
+    PrefetchTask( Prefetcher& owner, boost::shared_ptr<PrefetchStream> const& stream,
+                  boost::shared_ptr<PrefetchRequest> const& request, uint64 epoch, size_t bytes )
+      : m_owner(owner), m_stream(stream), m_request(request), m_epoch(epoch), bytes(bytes) {}
+
+    virtual void operator()() {
+      bool run;
+      {
+        Mutex::Lock lock(m_stream->m_mutex);
+        run = ( m_stream->m_epoch == m_epoch );
+        if (run)
+          m_stream->m_running++;
+      }
+
+      bool failed = false;
+      if (run) {
+        try {
+          (*m_request)();
+        } catch (const std::exception& e) {
+          VW_OUT(DebugMessage, "cache") << "Prefetcher: read-ahead failed: " << e.what() << "\n";
+          failed = true;
+        }
+      }
+
+      // Let go of whatever the request holds (typically an open file)
+      // before telling anyone that the stream is idle.
+      m_request.reset();
+      if (run) {
+        Mutex::Lock lock(m_stream->m_mutex);
+        m_stream->m_running--;
+        m_stream->m_idle_event.notify_all();
+      }
+      m_owner.finished( *this, run, failed );
+    }
+  };
+
+  Prefetcher::Prefetcher( int num_threads, size_t max_bytes )
+    : m_num_threads(num_threads), m_max_bytes(max_bytes), m_pending(0), m_queue_threads(0) {}
+
+  Prefetcher::~Prefetcher() {
+    join();
+    // The workers may still be asking the queue for more work, which
+    // they cannot do once it is half destroyed.
+    if (m_queue)
+      m_queue->join_all();
+  }
+
+  void Prefetcher::set_num_threads( int num_threads ) {
+    m_num_threads = num_threads < 0 ? 0 : num_threads;
+  }
+
+  bool Prefetcher::submit( boost::shared_ptr<PrefetchStream> const& stream,
+                           boost::shared_ptr<PrefetchRequest> const& request ) {
+    if ( !enabled() )
+      return false;
+    size_t bytes = request->size();
+
+    boost::shared_ptr<PrefetchTask> task;
+    {
+      Mutex::Lock lock(m_mutex);
+      if ( m_stats.bytes_outstanding + bytes > m_max_bytes ) {
+        m_stats.rejected++;
+        return false;
+      }
+
+      // The thread count of a work queue is fixed, so a new one is
+      // only built while nothing is in flight.
+      if ( !m_queue || ( m_queue_threads != m_num_threads && m_pending == 0 ) ) {
+        if (m_queue)
+          m_queue->join_all();
+        m_queue_threads = m_num_threads;
+        m_queue.reset( new FifoWorkQueue( m_queue_threads ) );
+      }
+
+      uint64 epoch;
+      {
+        Mutex::Lock stream_lock(stream->m_mutex);
+        epoch = stream->m_epoch;
+      }
+      task.reset( new PrefetchTask( *this, stream, request, epoch, bytes ) );
+      m_stats.submitted++;
+      m_stats.bytes_outstanding += bytes;
+      m_pending++;
+    }
+    m_queue->add_task( task );
+    return true;
+  }
+
+  void Prefetcher::finished( PrefetchTask const& task, bool ran, bool failed ) {
+    Mutex::Lock lock(m_mutex);
+    if (!ran)
+      m_stats.cancelled++;
+    else if (failed)
+      m_stats.failed++;
+    else
+      m_stats.completed++;
+    m_stats.bytes_outstanding -= task.bytes;
+    if (--m_pending == 0)
+      m_idle_event.notify_all();
+  }
+
+  void Prefetcher::join() {
+    Mutex::Lock lock(m_mutex);
+    while (m_pending > 0)
+      m_idle_event.wait(lock);
+  }
+
+  PrefetchStats Prefetcher::stats() const {
+    Mutex::Lock lock(m_mutex);
+    return m_stats;
+  }
+
+} // namespace vw
@@ -0,0 +1,147 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file Prefetcher.h
+///
+/// Asynchronous read-ahead on a small pool of dedicated I/O threads.
+///
+#ifndef __VW_CORE_PREFETCHER_H__
+#define __VW_CORE_PREFETCHER_H__
+
+#include <vw/Core/FundamentalTypes.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/Condition.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <iosfwd>
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+namespace vw {
+
+  /// One read to be performed ahead of time.  Implementations
+  /// typically force a Cache line to be generated.
+  class PrefetchRequest {
+  public:
+    virtual ~PrefetchRequest() {}
+
+    /// The number of bytes this read will bring into memory.
+    virtual size_t size() const = 0;
+
+    /// Perform the read.  Called on an I/O thread.
+    virtual void operator()() = 0;
+  };
+
+  /// A cancellation token shared by a group of related requests, such
+  /// as the reads issued on behalf of one image.
+  ///
+  /// Cancelling a stream drops every request that has been submitted
+  /// for it but has not started yet.  Requests submitted afterwards
+  /// are unaffected.
+  class PrefetchStream : private boost::noncopyable {
+    mutable Mutex   m_mutex;
+    Condition       m_idle_event;
+    volatile uint64 m_epoch;
+    int             m_running;
+    friend class Prefetcher;
+
+  public:
+    PrefetchStream() : m_epoch(0), m_running(0) {}
+
+    /// Drop all queued requests.
+    void cancel();
+
+    /// Drop all queued requests and wait for the running ones to finish.
+    void cancel_and_wait();
+
+    /// Number of this stream's requests that are currently being read.
+    int running() const;
+  };
+
+  /// Usage counters for a Prefetcher.
+  struct PrefetchStats {
+    uint64 submitted;  ///< Requests accepted into the queue.
+    uint64 completed;  ///< Requests that ran to completion.
+    uint64 cancelled;  ///< Requests dropped because their stream was cancelled.
+    uint64 rejected;   ///< Requests refused because the byte budget was used up.
+    uint64 failed;     ///< Requests that threw.
+    size_t bytes_outstanding; ///< Bytes queued or being read right now.
+
+    PrefetchStats();
+  };
+
+  std::ostream& operator<<( std::ostream& os, PrefetchStats const& stats );
+
+  /// Runs PrefetchRequests on dedicated I/O threads so that they
+  /// overlap with computation on the calling threads.
+  ///
+  /// The total size of queued and running requests is capped at
+  /// max_bytes(); requests that do not fit are refused rather than
+  /// queued, since a read that happens too late is worthless.  Errors
+  /// thrown by a request are logged and swallowed: the data will
+  /// simply be read again, and the error reported, by whoever needs
+  /// it.  A prefetcher with no threads or no byte budget is disabled.
+  ///
+  /// You should normally use the global instance, vw_prefetcher(),
+  /// which is configured through vw_settings().
+  class Prefetcher : private boost::noncopyable {
+  public:
+    Prefetcher( int num_threads = 0, size_t max_bytes = 0 );
+    ~Prefetcher();
+
+    bool enabled() const { return m_num_threads > 0 && m_max_bytes > 0; }
+
+    /// The number of I/O threads.  Changing it only takes effect
+    /// once the requests already submitted have finished.
+    int  num_threads() const { return m_num_threads; }
+    void set_num_threads( int num_threads );
+
+    size_t max_bytes() const { return m_max_bytes; }
+    void   set_max_bytes( size_t bytes ) { m_max_bytes = bytes; }
+
+    /// Queue a request on behalf of a stream.  Returns false, and
+    /// does nothing, if the prefetcher is disabled or the request
+    /// would exceed the byte budget.
+    bool submit( boost::shared_ptr<PrefetchStream> const& stream,
+                 boost::shared_ptr<PrefetchRequest> const& request );
+
+    /// Wait until every submitted request has finished or been dropped.
+    void join();
+
+    /// Returns a snapshot of the usage counters.
+    PrefetchStats stats() const;
+
+  private:
+    class PrefetchTask;
+    friend class PrefetchTask;
+    void finished( PrefetchTask const& task, bool ran, bool failed );
+
+    volatile int    m_num_threads;
+    volatile size_t m_max_bytes;
+    mutable Mutex   m_mutex;
+    Condition       m_idle_event;
+    PrefetchStats   m_stats;
+    int             m_pending;
+    int             m_queue_threads;
+    boost::scoped_ptr<FifoWorkQueue> m_queue;
+  };
+
+} // namespace vw
+
+#endif // __VW_CORE_PREFETCHER_H__
@@ -18,6 +18,8 @@
 #include <vw/config.h>
 #include <vw/Core/Thread.h>
 #include <vw/Core/Cache.h>
+#include <vw/Core/MemoryPool.h>
+#include <vw/Core/Prefetcher.h>
 #include <vw/Core/Settings.h>
 #include <vw/Core/ConfigParser.h>
 
@@ -179,6 +181,10 @@ Settings::Settings()
     _VW_SET1(write_pool_size, 21), // 21 threads is about 252MB of back data for RGB f32 1024x1024 blocks
     _VW_SET1(default_tile_size, 256),
     _VW_SET1(tmp_directory, default_tmp_dir()),
+    _VW_SET1(image_buffer_pool_size, 0),
+    _VW_SET1(image_buffer_huge_pages, false),
+    _VW_SET1(prefetch_threads, 2),
+    _VW_SET1(prefetch_bytes, size_t(64) * 1024 * 1024),
     m_rc_poll_period(5.0f)
 {
   set_rc_filename(default_vwrc(), false);
@@ -203,5 +209,9 @@ GETSET(system_cache_size, size_t, vw_system_cache().resize(x););
 GETSET(write_pool_size, uint32, ;);
 GETSET(default_tile_size, uint32, ;);
 GETSET(tmp_directory, std::string, ;);
+GETSET(image_buffer_pool_size, size_t, vw_memory_pool().set_thread_cache_size(x););
+GETSET(image_buffer_huge_pages, bool, vw_memory_pool().set_huge_pages(x););
+GETSET(prefetch_threads, uint32, vw_prefetcher().set_num_threads(x););
+GETSET(prefetch_bytes, size_t, vw_prefetcher().set_max_bytes(x););
 
 } // namespace vw
@@ -75,6 +75,22 @@ namespace vw {
     // The directory used to store temporary files.
     VW_DECLARE_SETTING(tmp_directory, std::string);
 
+    // The number of bytes of freed ImageView buffers each thread keeps for
+    // reuse (see vw_memory_pool()). Zero disables the pool.
+    VW_DECLARE_SETTING(image_buffer_pool_size, size_t);
+
+    // If set, large pooled ImageView buffers are backed by huge pages where
+    // the platform supports it.
+    VW_DECLARE_SETTING(image_buffer_huge_pages, bool);
+
+    // The number of I/O threads used to read DiskImageView<> blocks ahead of
+    // the access pattern (see vw_prefetcher()). Zero disables read-ahead.
+    VW_DECLARE_SETTING(prefetch_threads, uint32);
+
+    // The maximum number of bytes of read-ahead that may be queued or in
+    // flight at once.
+    VW_DECLARE_SETTING(prefetch_bytes, size_t);
+
 #undef VW_DECLARE_SETTING
 
     // Member variables assoc. with periodically polling the log
@@ -19,21 +19,63 @@
 #include <vw/Core/System.h>
 #include <vw/Core/Cache.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/MemoryPool.h>
+#include <vw/Core/Prefetcher.h>
 #include <vw/Core/Settings.h>
 #include <vw/Core/Stopwatch.h>
 #include <vw/Core/RunOnce.h>
+#include <vw/Core/Thread.h>
+
+#include <boost/atomic.hpp>
 
 namespace {
+
+  // Runs a configuration function once, like RunOnce, but a call made
+  // from inside the function on the same thread returns at once instead
+  // of deadlocking.  That happens when reading the settings parses .vwrc,
+  // whose setters call back into the object being configured.  Once the
+  // function has run, run() is a single atomic read.
+  class ConfigureOnce {
+    boost::atomic<bool> m_done;
+    bool                m_running;
+    vw::RecursiveMutex  m_mutex;
+  public:
+    ConfigureOnce() : m_done(false), m_running(false) {}
+
+    void run( void (*func)() ) {
+      if ( m_done.load( boost::memory_order_acquire ) )
+        return;
+      vw::RecursiveMutex::Lock lock( m_mutex );
+      if ( m_done.load( boost::memory_order_relaxed ) || m_running )
+        return;
+      m_running = true;
+      try {
+        func();
+      } catch (...) {
+        m_running = false;
+        throw;
+      }
+      m_running = false;
+      m_done.store( true, boost::memory_order_release );
+    }
+  };
+
   vw::RunOnce settings_once      = VW_RUNONCE_INIT;
   vw::RunOnce resize_once        = VW_RUNONCE_INIT;
   vw::RunOnce stopwatch_set_once = VW_RUNONCE_INIT;
   vw::RunOnce system_cache_once  = VW_RUNONCE_INIT;
   vw::RunOnce log_once           = VW_RUNONCE_INIT;
+  vw::RunOnce memory_pool_once   = VW_RUNONCE_INIT;
+  vw::RunOnce prefetcher_once    = VW_RUNONCE_INIT;
 
   vw::Settings     *settings_ptr      = 0;
   vw::StopwatchSet *stopwatch_set_ptr = 0;
   vw::Cache        *system_cache_ptr  = 0;
   vw::Log          *log_ptr           = 0;
+  vw::MemoryPool   *memory_pool_ptr   = 0;
+  vw::Prefetcher   *prefetcher_ptr    = 0;
+  ConfigureOnce    *pool_config_ptr       = 0;
+  ConfigureOnce    *prefetch_config_ptr   = 0;
 
   void init_settings() {
     settings_ptr = new vw::Settings();
@@ -48,6 +90,29 @@ namespace {
     system_cache_ptr = new vw::Cache(0);
   }
 
+  void init_memory_pool() {
+    memory_pool_ptr = new vw::MemoryPool();
+    pool_config_ptr = new ConfigureOnce();
+  }
+
+  // Later changes to the settings reach the pool through their setters.
+  void configure_memory_pool() {
+    vw::Settings &settings = vw::vw_settings();
+    memory_pool_ptr->set_thread_cache_size(settings.image_buffer_pool_size());
+    memory_pool_ptr->set_huge_pages(settings.image_buffer_huge_pages());
+  }
+
+  void init_prefetcher() {
+    prefetcher_ptr      = new vw::Prefetcher();
+    prefetch_config_ptr = new ConfigureOnce();
+  }
+
+  void configure_prefetcher() {
+    vw::Settings &settings = vw::vw_settings();
+    prefetcher_ptr->set_num_threads(settings.prefetch_threads());
+    prefetcher_ptr->set_max_bytes(settings.prefetch_bytes());
+  }
+
   void init_stopwatch_set() {
     stopwatch_set_ptr = new vw::StopwatchSet();
   }
@@ -71,6 +136,20 @@ vw::Cache &vw::vw_system_cache() {
   return *system_cache_ptr;
 }
 
+// ImageView calls this for every buffer, so it must not poll .vwrc
+// (see Settings::reload_config()) or take any lock once configured.
+vw::MemoryPool &vw::vw_memory_pool() {
+  memory_pool_once.run( init_memory_pool );
+  pool_config_ptr->run( configure_memory_pool );
+  return *memory_pool_ptr;
+}
+
+vw::Prefetcher &vw::vw_prefetcher() {
+  prefetcher_once.run( init_prefetcher );
+  prefetch_config_ptr->run( configure_prefetcher );
+  return *prefetcher_ptr;
+}
+
 vw::StopwatchSet &vw::vw_stopwatch_set() {
   stopwatch_set_once.run( init_stopwatch_set );
   return *stopwatch_set_ptr;
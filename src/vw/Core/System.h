@@ -26,6 +26,8 @@ namespace vw {
 
   class Cache;
   class Log;
+  class MemoryPool;
+  class Prefetcher;
   class Settings;
   class StopwatchSet;
 
@@ -38,6 +40,14 @@ namespace vw {
   //     vw_log().console_log() << "Some text\n";
   Log& vw_log();
 
+  // The pool used for ImageView pixel buffers. It is configured by the
+  // image_buffer_* entries in vw_settings().
+  MemoryPool& vw_memory_pool();
+
+  // The I/O threads that read DiskImageView<> blocks ahead of time. It is
+  // configured by the prefetch_* entries in vw_settings().
+  Prefetcher& vw_prefetcher();
+
   // Global instance of Settings
   Settings& vw_settings();
 
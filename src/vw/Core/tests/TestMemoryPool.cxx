@@ -0,0 +1,141 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+
+#include <vw/Core/MemoryPool.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/System.h>
+
+#include <boost/thread/thread.hpp>
+
+using namespace vw;
+
+TEST(MemoryPool, SizeClasses) {
+  EXPECT_EQ( 64u,  MemoryPool::class_size(1)  );
+  EXPECT_EQ( 64u,  MemoryPool::class_size(64) );
+  EXPECT_EQ( 80u,  MemoryPool::class_size(65) );
+  EXPECT_EQ( 128u, MemoryPool::class_size(128) );
+  EXPECT_EQ( 160u, MemoryPool::class_size(129) );
+  EXPECT_EQ( 1280u*1024u, MemoryPool::class_size(1024*1024 + 1) );
+
+  // Every size lands in a class that covers it without wasting more
+  // than a quarter, and the class indices are consistent.
+  for (size_t bytes = 1; bytes < 100000; bytes += 37) {
+    size_t size = MemoryPool::class_size(bytes);
+    EXPECT_GE( size, bytes );
+    if (bytes > 64) {
+      EXPECT_LE( size, bytes + bytes/4 + 1 );
+    }
+    EXPECT_EQ( MemoryPool::class_index(bytes), MemoryPool::class_index(size) );
+    EXPECT_EQ( size, MemoryPool::class_size(size) );
+  }
+}
+
+TEST(MemoryPool, ReusesAlignedBlocks) {
+  MemoryPool pool(1024*1024);
+  void* a = pool.allocate(1000);
+  ASSERT_TRUE( a != 0 );
+  EXPECT_EQ( 0u, size_t(a) % MemoryPool::ALIGNMENT );
+  pool.deallocate(a, 1000);
+
+  // A request in the same size class gets the same block back.
+  void* b = pool.allocate(990);
+  EXPECT_EQ( a, b );
+  pool.deallocate(b, 990);
+
+  MemoryPoolStats stats = pool.stats();
+  EXPECT_EQ( 2u, stats.allocations );
+  EXPECT_EQ( 1u, stats.cache_hits );
+  EXPECT_EQ( 1u, stats.system_allocs );
+  EXPECT_EQ( 0,  stats.bytes_in_use );
+  EXPECT_EQ( int64(MemoryPool::class_size(1000)), stats.bytes_cached );
+
+  pool.purge();
+  stats = pool.stats();
+  EXPECT_EQ( 0, stats.bytes_cached );
+  EXPECT_EQ( 1u, stats.system_frees );
+}
+
+TEST(MemoryPool, ThreadCacheLimit) {
+  MemoryPool pool(4096);
+  void* a = pool.allocate(3000);
+  void* b = pool.allocate(3000);
+  EXPECT_NE( a, b );
+  pool.deallocate(a, 3000);
+  pool.deallocate(b, 3000); // Does not fit in the cache
+  MemoryPoolStats stats = pool.stats();
+  EXPECT_EQ( 1u, stats.system_frees );
+  EXPECT_EQ( int64(MemoryPool::class_size(3000)), stats.bytes_cached );
+
+  // With the cache disabled nothing is kept.
+  pool.set_thread_cache_size(0);
+  EXPECT_FALSE( pool.enabled() );
+  void* c = pool.allocate(100);
+  pool.deallocate(c, 100);
+  EXPECT_EQ( 2u, pool.stats().system_frees );
+}
+
+namespace {
+  struct PoolWorker {
+    MemoryPool* pool;
+    PoolWorker( MemoryPool* p ) : pool(p) {}
+    void operator()() {
+      for (int i = 0; i < 100; ++i) {
+        void* ptr = pool->allocate(256*256*4);
+        memset(ptr, i, 256*256*4);
+        pool->deallocate(ptr, 256*256*4);
+      }
+    }
+  };
+}
+
+TEST(MemoryPool, ThreadLocalCaches) {
+  MemoryPool pool(16*1024*1024);
+  boost::thread t1((PoolWorker(&pool)));
+  boost::thread t2((PoolWorker(&pool)));
+  t1.join();
+  t2.join();
+
+  // Each thread only had to go to the system once, and everything was
+  // released when the threads exited.
+  MemoryPoolStats stats = pool.stats();
+  EXPECT_EQ( 200u, stats.allocations );
+  EXPECT_EQ( 198u, stats.cache_hits );
+  EXPECT_EQ( 2u,   stats.system_frees );
+  EXPECT_EQ( 0,    stats.bytes_in_use );
+  EXPECT_EQ( 0,    stats.bytes_cached );
+}
+
+TEST(MemoryPool, HugePages) {
+  MemoryPool pool(64*1024*1024, true);
+  void* a = pool.allocate(4*1024*1024);
+  ASSERT_TRUE( a != 0 );
+  EXPECT_EQ( 0u, size_t(a) % MemoryPool::HUGE_PAGE_SIZE );
+  pool.deallocate(a, 4*1024*1024);
+}
+
+TEST(MemoryPool, Settings) {
+  vw_settings().set_image_buffer_pool_size(8*1024*1024);
+  EXPECT_TRUE( vw_memory_pool().enabled() );
+  EXPECT_EQ( 8u*1024u*1024u, vw_memory_pool().thread_cache_size() );
+  EXPECT_TRUE( detail::image_buffer_pool_enabled() );
+  vw_settings().set_image_buffer_pool_size(0);
+  EXPECT_FALSE( vw_memory_pool().enabled() );
+  EXPECT_FALSE( detail::image_buffer_pool_enabled() );
+}
@@ -0,0 +1,201 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+
+#include <vw/Core/Prefetcher.h>
+#include <vw/Core/Exception.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/System.h>
+
+using namespace vw;
+
+namespace {
+
+  // Counts how many times it has run.  While the gate is closed, it
+  // blocks until someone opens it.
+  struct Gate {
+    Mutex     mutex;
+    Condition event;
+    bool      open;
+    int       entered;
+    Gate() : open(true), entered(0) {}
+
+    void pass() {
+      Mutex::Lock lock(mutex);
+      entered++;
+      event.notify_all();
+      while (!open)
+        event.wait(lock);
+    }
+    void set_open( bool state ) {
+      Mutex::Lock lock(mutex);
+      open = state;
+      event.notify_all();
+    }
+    void wait_for( int count ) {
+      Mutex::Lock lock(mutex);
+      while (entered < count)
+        event.wait(lock);
+    }
+  };
+
+  class GateRequest : public PrefetchRequest {
+    Gate&  m_gate;
+    size_t m_size;
+    bool   m_fail;
+  public:
+    GateRequest( Gate& gate, size_t size, bool fail = false )
+      : m_gate(gate), m_size(size), m_fail(fail) {}
+    virtual size_t size() const { return m_size; }
+    virtual void operator()() {
+      m_gate.pass();
+      if (m_fail)
+        vw_throw( IOErr() << "Simulated read failure" );
+    }
+  };
+
+  struct Opener {
+    Gate& gate;
+    Opener( Gate& g ) : gate(g) {}
+    void operator()() { Thread::sleep_ms(50); gate.set_open(true); }
+  };
+
+  boost::shared_ptr<PrefetchRequest> request( Gate& gate, size_t size, bool fail = false ) {
+    return boost::shared_ptr<PrefetchRequest>( new GateRequest(gate, size, fail) );
+  }
+}
+
+TEST(Prefetcher, Disabled) {
+  Gate gate;
+  boost::shared_ptr<PrefetchStream> stream( new PrefetchStream() );
+  Prefetcher none;
+  EXPECT_FALSE( none.enabled() );
+  EXPECT_FALSE( none.submit( stream, request(gate, 10) ) );
+
+  Prefetcher no_budget(2, 0);
+  EXPECT_FALSE( no_budget.enabled() );
+  EXPECT_FALSE( no_budget.submit( stream, request(gate, 10) ) );
+  EXPECT_EQ( 0, gate.entered );
+}
+
+TEST(Prefetcher, RunsRequests) {
+  Gate gate;
+  boost::shared_ptr<PrefetchStream> stream( new PrefetchStream() );
+  Prefetcher prefetcher(2, 1000);
+  for (int i = 0; i < 10; ++i)
+    EXPECT_TRUE( prefetcher.submit( stream, request(gate, 10) ) );
+  prefetcher.join();
+
+  EXPECT_EQ( 10, gate.entered );
+  PrefetchStats stats = prefetcher.stats();
+  EXPECT_EQ( 10u, stats.submitted );
+  EXPECT_EQ( 10u, stats.completed );
+  EXPECT_EQ( 0u,  stats.bytes_outstanding );
+}
+
+TEST(Prefetcher, ByteBudget) {
+  Gate gate;
+  gate.set_open(false);
+  boost::shared_ptr<PrefetchStream> stream( new PrefetchStream() );
+  Prefetcher prefetcher(1, 100);
+  EXPECT_TRUE ( prefetcher.submit( stream, request(gate, 60) ) );
+  EXPECT_TRUE ( prefetcher.submit( stream, request(gate, 40) ) );
+  EXPECT_FALSE( prefetcher.submit( stream, request(gate, 1) ) );
+  EXPECT_EQ( 100u, prefetcher.stats().bytes_outstanding );
+
+  gate.set_open(true);
+  prefetcher.join();
+  PrefetchStats stats = prefetcher.stats();
+  EXPECT_EQ( 1u, stats.rejected );
+  EXPECT_EQ( 2u, stats.completed );
+  EXPECT_TRUE( prefetcher.submit( stream, request(gate, 100) ) );
+  prefetcher.join();
+}
+
+TEST(Prefetcher, Cancel) {
+  Gate gate;
+  gate.set_open(false);
+  boost::shared_ptr<PrefetchStream> stream( new PrefetchStream() );
+  boost::shared_ptr<PrefetchStream> other ( new PrefetchStream() );
+  Prefetcher prefetcher(1, 1000);
+
+  // The first request occupies the only thread; the rest queue up
+  // behind it.
+  prefetcher.submit( stream, request(gate, 1) );
+  gate.wait_for(1);
+  EXPECT_EQ( 1, stream->running() );
+  for (int i = 0; i < 5; ++i)
+    prefetcher.submit( stream, request(gate, 1) );
+  prefetcher.submit( other, request(gate, 1) );
+
+  // Only the queued requests of the cancelled stream are dropped, and
+  // later ones run as usual.
+  stream->cancel();
+  prefetcher.submit( stream, request(gate, 1) );
+  gate.set_open(true);
+  prefetcher.join();
+
+  EXPECT_EQ( 3, gate.entered );
+  PrefetchStats stats = prefetcher.stats();
+  EXPECT_EQ( 5u, stats.cancelled );
+  EXPECT_EQ( 3u, stats.completed );
+  EXPECT_EQ( 0,  stream->running() );
+}
+
+TEST(Prefetcher, CancelAndWait) {
+  Gate gate;
+  gate.set_open(false);
+  boost::shared_ptr<PrefetchStream> stream( new PrefetchStream() );
+  Prefetcher prefetcher(1, 1000);
+  prefetcher.submit( stream, request(gate, 1) );
+  prefetcher.submit( stream, request(gate, 1) );
+  gate.wait_for(1);
+  stream->cancel();
+
+  // Open the gate from another thread once we are waiting.
+  boost::shared_ptr<Opener> opener( new Opener(gate) );
+  Thread thread( opener );
+  stream->cancel_and_wait();
+  EXPECT_EQ( 0, stream->running() );
+  thread.join();
+  prefetcher.join();
+  EXPECT_EQ( 1, gate.entered );
+}
+
+TEST(Prefetcher, Failures) {
+  Gate gate;
+  boost::shared_ptr<PrefetchStream> stream( new PrefetchStream() );
+  Prefetcher prefetcher(1, 1000);
+  prefetcher.submit( stream, request(gate, 1, true) );
+  prefetcher.submit( stream, request(gate, 1) );
+  prefetcher.join();
+  PrefetchStats stats = prefetcher.stats();
+  EXPECT_EQ( 1u, stats.failed );
+  EXPECT_EQ( 1u, stats.completed );
+}
+
+TEST(Prefetcher, Settings) {
+  vw_settings().set_prefetch_threads(3);
+  vw_settings().set_prefetch_bytes(1024);
+  EXPECT_EQ( 3, vw_prefetcher().num_threads() );
+  EXPECT_EQ( 1024u, vw_prefetcher().max_bytes() );
+  EXPECT_TRUE( vw_prefetcher().enabled() );
+  vw_settings().set_prefetch_threads(0);
+  EXPECT_FALSE( vw_prefetcher().enabled() );
+}
@@ -29,6 +29,8 @@
 #include <vw/Image/ImageResourceView.h>
 #include <vw/Image/BlockRasterize.h>
 #include <vw/Core/Cache.h>
+#include <vw/Core/Prefetcher.h>
+#include <vw/Core/System.h>
 
 #include <boost/filesystem/operations.hpp>
 #include <string>
@@ -37,6 +39,9 @@
 namespace vw {
 
   /// A view of an image on disk.
+  ///
+  /// Blocks are cached in the given cache and, when vw_prefetcher()
+  /// is enabled, read ahead of the access pattern on its I/O threads.
   template <class PixelT>
   class DiskImageView : public ImageViewBase<DiskImageView<PixelT> >
   {
@@ -58,6 +63,7 @@ namespace vw {
       : m_rsrc( DiskImageResource::open( filename ) ),       // Init file interface
         m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), // Init memory storage
                 m_rsrc->block_read_size(), 1, cache ) {
+        m_impl.enable_read_ahead( vw_prefetcher() );
         // Check for type errors now instead of running into them when we access the image
         try {
           check_convertability(m_impl.child().format(), m_rsrc->format());
@@ -75,21 +81,27 @@ namespace vw {
     /// Constructs a DiskImageView of the given resource using the
     /// specified cache area.
     DiskImageView( boost::shared_ptr<DiskImageResource> resource, Cache* cache = &vw_system_cache())
-      : m_rsrc( resource ), m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), m_rsrc->block_read_size(), 1, cache ) {}
+      : m_rsrc( resource ), m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), m_rsrc->block_read_size(), 1, cache ) {
+      m_impl.enable_read_ahead( vw_prefetcher() );
+    }
 
     /// Constructs a DiskImageView of the given resource using the
     /// specified cache area.  Takes ownership of the resource object
     /// (i.e. deletes it when it's done using it).
     DiskImageView( DiskImageResource *resource, Cache* cache = &vw_system_cache() )
       : m_rsrc( resource ), 
-        m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), m_rsrc->block_read_size(), 1, cache ) {}
+        m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), m_rsrc->block_read_size(), 1, cache ) {
+      m_impl.enable_read_ahead( vw_prefetcher() );
+    }
 
     /// Constructs a DiskImageView of the given resource using the specified
     /// cache area. Does not take ownership, you must ensure resource stays
     /// valid for the lifetime of DiskImageView
     DiskImageView( DiskImageResource &resource, Cache* cache = &vw_system_cache() )
       : m_rsrc( &resource, NOP() ), 
-        m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), m_rsrc->block_read_size(), 1, cache ) {}
+        m_impl( boost::shared_ptr<SrcImageResource>(m_rsrc), m_rsrc->block_read_size(), 1, cache ) {
+      m_impl.enable_read_ahead( vw_prefetcher() );
+    }
 
     ~DiskImageView() {}
 
@@ -106,8 +118,15 @@ namespace vw {
 
     std::string filename() const { return m_rsrc->filename(); }
 
+    /// The block size the underlying resource prefers to be read in.
+    Vector2i block_read_size() const { return m_rsrc->block_read_size(); }
   };
 
+  template <class PixelT>
+  inline Vector2i preferred_block_size( DiskImageView<PixelT> const& view ) {
+    return view.block_read_size();
+  }
+
 
   template <class PixelT>
     class DiskCacheHandle : private boost::noncopyable {
@@ -0,0 +1,185 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Geometry/PackedRTree.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace vw;
+using namespace vw::geometry;
+
+namespace {
+
+  // Orders flat boxes by their center along one axis.
+  class CenterLess {
+    double const* m_boxes;
+    int32 m_dim, m_axis;
+  public:
+    CenterLess( double const* boxes, int32 dim, int32 axis )
+      : m_boxes(boxes), m_dim(dim), m_axis(axis) {}
+    bool operator()( size_t a, size_t b ) const {
+      double const* box_a = m_boxes + 2*m_dim*a;
+      double const* box_b = m_boxes + 2*m_dim*b;
+      return box_a[m_axis] + box_a[m_dim+m_axis] < box_b[m_axis] + box_b[m_dim+m_axis];
+    }
+  };
+
+  // Sort-Tile-Recursive ordering (Leutenegger et al., 1997) of the
+  // entries order[begin,end): sorted along the axis, cut into slabs
+  // that each hold a whole number of nodes, and each slab ordered the
+  // same way along the next axis.
+  void str_order( std::vector<size_t>& order, size_t begin, size_t end,
+                  double const* boxes, int32 dim, int32 axis, size_t node_size ) {
+    std::sort( order.begin() + begin, order.begin() + end, CenterLess( boxes, dim, axis ) );
+    if ( axis + 1 >= dim )
+      return;
+
+    size_t num_nodes  = ( end - begin + node_size - 1 ) / node_size;
+    size_t num_slabs  = size_t( std::ceil( std::pow( double(num_nodes), 1.0 / double(dim - axis) ) ) );
+    num_slabs = std::max( num_slabs, size_t(1) );
+    size_t slab_size = node_size * ( ( num_nodes + num_slabs - 1 ) / num_slabs );
+    for ( size_t slab = begin; slab < end; slab += slab_size )
+      str_order( order, slab, std::min( slab + slab_size, end ), boxes, dim, axis + 1, node_size );
+  }
+
+  // Rearranges count runs of stride values into the given order.
+  template <class T>
+  void permute( T* values, size_t count, size_t stride, std::vector<size_t> const& order ) {
+    std::vector<T> copy( values, values + count*stride );
+    for ( size_t i = 0; i < count; ++i )
+      std::copy( &copy[stride*order[i]], &copy[stride*order[i]] + stride, values + stride*i );
+  }
+
+  struct IndexCollector {
+    std::vector<size_t>& m_indices;
+    IndexCollector( std::vector<size_t>& indices ) : m_indices(indices) {}
+    bool operator()( size_t index ) {
+      m_indices.push_back( index );
+      return true;
+    }
+  };
+}
+
+const int32 PackedRTree::MAX_DIM;
+
+PackedRTree::PackedRTree( std::vector<BBoxT> const& boxes, int32 node_size )
+  : m_dim(0), m_num_leaves(0) {
+  VW_ASSERT( node_size >= 2, ArgumentErr() << "PackedRTree: node size must be at least 2." );
+  if ( boxes.empty() )
+    return;
+
+  m_dim = int32( boxes[0].min().size() );
+  VW_ASSERT( m_dim > 0 && m_dim <= MAX_DIM,
+             ArgumentErr() << "PackedRTree: boxes must have between 1 and " << MAX_DIM << " dimensions." );
+  const size_t stride = 2*m_dim, size = boxes.size(), fanout = node_size;
+
+  m_boxes.resize( stride * size );
+  for ( size_t i = 0; i < size; ++i ) {
+    VW_ASSERT( int32(boxes[i].min().size()) == m_dim && int32(boxes[i].max().size()) == m_dim,
+               ArgumentErr() << "PackedRTree: all boxes must have the same dimension." );
+    flatten( boxes[i], &m_boxes[stride*i] );
+  }
+
+  // The boxes themselves are put in STR order, and then each level of
+  // nodes in turn, before being packed into the level above.
+  m_index.resize( size );
+  for ( size_t i = 0; i < size; ++i )
+    m_index[i] = i;
+  str_order( m_index, 0, size, &m_boxes[0], m_dim, 0, fanout );
+  permute( &m_boxes[0], size, stride, m_index );
+
+  // The node arrays are sized up front, so that the level being
+  // packed can be read in place while the level above is written.
+  size_t num_nodes = 0;
+  for ( size_t level = size; level > 1 || num_nodes == 0; level = ( level + fanout - 1 ) / fanout )
+    num_nodes += ( level + fanout - 1 ) / fanout;
+  m_node_boxes.resize( stride * num_nodes );
+  m_first.reserve( num_nodes );
+  m_count.reserve( num_nodes );
+
+  double const* entries = &m_boxes[0];
+  size_t num_entries = size, entry_offset = 0;
+  while ( true ) {
+    const size_t level_begin = m_count.size();
+    for ( size_t k = 0; k < num_entries; k += fanout ) {
+      const size_t count = std::min( fanout, num_entries - k );
+      double* node = &m_node_boxes[stride*m_count.size()];
+      m_first.push_back( entry_offset + k );
+      m_count.push_back( count );
+
+      std::copy( entries + stride*k, entries + stride*(k+1), node );
+      for ( size_t c = k + 1; c < k + count; ++c ) {
+        double const* child = entries + stride*c;
+        for ( int32 d = 0; d < m_dim; ++d ) {
+          node[d]       = std::min( node[d],       child[d] );
+          node[m_dim+d] = std::max( node[m_dim+d], child[m_dim+d] );
+        }
+      }
+    }
+    if ( level_begin == 0 )
+      m_num_leaves = m_count.size();
+
+    const size_t level_size = m_count.size() - level_begin;
+    if ( level_size == 1 )
+      break;
+
+    std::vector<size_t> order( level_size );
+    for ( size_t i = 0; i < level_size; ++i )
+      order[i] = i;
+    str_order( order, 0, level_size, &m_node_boxes[stride*level_begin], m_dim, 0, fanout );
+    permute( &m_node_boxes[stride*level_begin], level_size, stride, order );
+    permute( &m_first[level_begin], level_size, 1, order );
+    permute( &m_count[level_begin], level_size, 1, order );
+
+    entries      = &m_node_boxes[stride*level_begin];
+    num_entries  = level_size;
+    entry_offset = level_begin;
+  }
+}
+
+void PackedRTree::flatten( BBoxT const& box, double* flat ) const {
+  VW_ASSERT( int32(box.min().size()) == m_dim && int32(box.max().size()) == m_dim,
+             ArgumentErr() << "PackedRTree: box must have dimension " << m_dim << "." );
+  for ( int32 d = 0; d < m_dim; ++d ) {
+    flat[d]       = box.min()[d];
+    flat[m_dim+d] = box.max()[d];
+  }
+}
+
+PackedRTree::BBoxT PackedRTree::bounding_box() const {
+  if ( empty() )
+    return BBoxT();
+  double const* box = &m_node_boxes[2*m_dim*root()];
+  VectorT min( m_dim ), max( m_dim );
+  for ( int32 d = 0; d < m_dim; ++d ) {
+    min[d] = box[d];
+    max[d] = box[m_dim+d];
+  }
+  return BBoxT( min, max );
+}
+
+void PackedRTree::intersects( BBoxT const& box, std::vector<size_t>& indices ) const {
+  IndexCollector collector( indices );
+  intersects( box, collector );
+}
+
+void PackedRTree::contains( VectorT const& point, std::vector<size_t>& indices ) const {
+  IndexCollector collector( indices );
+  contains( point, collector );
+}
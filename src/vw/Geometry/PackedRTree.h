@@ -0,0 +1,237 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file PackedRTree.h
+///
+/// A static R-tree of bounding boxes, bulk loaded and stored in flat
+/// arrays.
+///
+#ifndef __VW_GEOMETRY_PACKEDRTREE_H__
+#define __VW_GEOMETRY_PACKEDRTREE_H__
+
+#include <vw/Core/Exception.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/BBox.h>
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace vw {
+namespace geometry {
+
+  /// A static R-tree over a set of bounding boxes, for when the boxes
+  /// are all known up front, as with the footprints of a set of
+  /// images.  It answers the same box and point queries as SpatialTree
+  /// at a fraction of the cost.
+  /// - The tree is bulk loaded with Sort-Tile-Recursive packing, so the
+  ///   nodes are full and overlap little.
+  /// - The boxes and the nodes are kept in contiguous arrays, in the
+  ///   order they are visited.  Building allocates a handful of arrays;
+  ///   queries allocate nothing.
+  /// - Queries report the index of each box in the vector the tree was
+  ///   built from to a visitor, which returns false to stop the search.
+  /// - The tree is never modified after it is built, so any number of
+  ///   threads may query it at once.
+  /// - Boxes intersect and contain points in the same sense as
+  ///   BBox::intersects() and BBox::contains().
+  class PackedRTree {
+  public:
+    typedef BBoxN          BBoxT;
+    typedef Vector<double> VectorT;
+
+    /// The largest number of dimensions the tree handles.
+    static const int32 MAX_DIM = 8;
+
+    PackedRTree() : m_dim(0), m_num_leaves(0) {}
+
+    /// Builds the tree over the given boxes, which must all have the
+    /// same dimension.  Each node holds up to node_size children.
+    PackedRTree( std::vector<BBoxT> const& boxes, int32 node_size = 16 );
+
+    /// The number of boxes in the tree.
+    size_t size() const { return m_index.size(); }
+    bool empty() const { return m_index.empty(); }
+    int32 dim() const { return m_dim; }
+
+    /// The bounding box of all the boxes in the tree.
+    BBoxT bounding_box() const;
+
+    /// Calls visitor(i) for each box i that intersects the given box.
+    template <class VisitorT>
+    void intersects( BBoxT const& box, VisitorT& visitor ) const {
+      if ( empty() )
+        return;
+      double query[2*MAX_DIM];
+      flatten( box, query );
+      IntersectsTest test( query, m_dim );
+      search( root(), test, visitor );
+    }
+
+    /// Calls visitor(i) for each box i that contains the given point.
+    template <class VisitorT>
+    void contains( VectorT const& point, VisitorT& visitor ) const {
+      if ( empty() )
+        return;
+      VW_ASSERT( int32(point.size()) == m_dim,
+                 ArgumentErr() << "PackedRTree: point must have dimension " << m_dim << "." );
+      double query[MAX_DIM];
+      for ( int32 d = 0; d < m_dim; ++d )
+        query[d] = point[d];
+      ContainsTest test( query, m_dim );
+      search( root(), test, visitor );
+    }
+
+    /// Calls visitor(i) for the boxes near the given point, in no
+    /// particular order.  The visitor returns the distance beyond which
+    /// boxes are of no more interest, so that each box found closes in
+    /// the search, as when looking for the closest of some primitives
+    /// inside the boxes.  Boxes at exactly that distance are visited.
+    template <class VisitorT>
+    void closest( VectorT const& point, VisitorT& visitor ) const {
+      if ( empty() )
+        return;
+      VW_ASSERT( int32(point.size()) == m_dim,
+                 ArgumentErr() << "PackedRTree: point must have dimension " << m_dim << "." );
+      double query[MAX_DIM];
+      for ( int32 d = 0; d < m_dim; ++d )
+        query[d] = point[d];
+      search_closest( root(), query, std::numeric_limits<double>::infinity(), visitor );
+    }
+
+    /// Calls visitor(i, j), with i < j, once for each pair of boxes
+    /// that intersect each other.
+    template <class VisitorT>
+    void overlap_pairs( VisitorT& visitor ) const {
+      for ( size_t k = 0; k < size(); ++k ) {
+        IntersectsTest test( &m_boxes[2*m_dim*k], m_dim );
+        PairVisitor<VisitorT> pairs( m_index[k], visitor );
+        if ( !search( root(), test, pairs ) )
+          return;
+      }
+    }
+
+    /// Appends the index of each box that intersects the given box.
+    void intersects( BBoxT const& box, std::vector<size_t>& indices ) const;
+
+    /// Appends the index of each box that contains the given point.
+    void contains( VectorT const& point, std::vector<size_t>& indices ) const;
+
+  private:
+    // A box is stored as its dim minimum coordinates followed by its
+    // dim maximum coordinates.
+    void flatten( BBoxT const& box, double* flat ) const;
+
+    // The nodes are stored a level at a time, leaves first and the
+    // root last.  The children of node n are the entries
+    // [m_first[n], m_first[n]+m_count[n]) of the level below, which
+    // for a leaf are the boxes themselves.
+    size_t root() const { return m_count.size() - 1; }
+    bool is_leaf( size_t node ) const { return node < m_num_leaves; }
+
+    struct IntersectsTest {
+      double const* m_query;
+      int32 m_dim;
+      IntersectsTest( double const* query, int32 dim ) : m_query(query), m_dim(dim) {}
+      bool operator()( double const* box ) const {
+        for ( int32 d = 0; d < m_dim; ++d )
+          if ( box[d] >= m_query[m_dim+d] || box[m_dim+d] <= m_query[d] )
+            return false;
+        return true;
+      }
+    };
+
+    struct ContainsTest {
+      double const* m_point;
+      int32 m_dim;
+      ContainsTest( double const* point, int32 dim ) : m_point(point), m_dim(dim) {}
+      bool operator()( double const* box ) const {
+        for ( int32 d = 0; d < m_dim; ++d )
+          if ( m_point[d] < box[d] || m_point[d] >= box[m_dim+d] )
+            return false;
+        return true;
+      }
+    };
+
+    template <class VisitorT>
+    class PairVisitor {
+      size_t m_first;
+      VisitorT& m_visitor;
+    public:
+      PairVisitor( size_t first, VisitorT& visitor ) : m_first(first), m_visitor(visitor) {}
+      bool operator()( size_t second ) {
+        return second <= m_first || m_visitor( m_first, second );
+      }
+    };
+
+    // Visits the boxes under node that pass the test, and returns
+    // false if the visitor stopped the search.
+    template <class TestT, class VisitorT>
+    bool search( size_t node, TestT const& test, VisitorT& visitor ) const {
+      const size_t end = m_first[node] + m_count[node];
+      if ( is_leaf( node ) ) {
+        for ( size_t k = m_first[node]; k < end; ++k )
+          if ( test( &m_boxes[2*m_dim*k] ) && !visitor( m_index[k] ) )
+            return false;
+      } else {
+        for ( size_t child = m_first[node]; child < end; ++child )
+          if ( test( &m_node_boxes[2*m_dim*child] ) && !search( child, test, visitor ) )
+            return false;
+      }
+      return true;
+    }
+
+    // The Euclidean distance from the point to the box, zero inside it.
+    double distance( double const* box, double const* point ) const {
+      double sum = 0;
+      for ( int32 d = 0; d < m_dim; ++d ) {
+        double delta = point[d] < box[d]       ? box[d] - point[d]
+                     : point[d] > box[m_dim+d] ? point[d] - box[m_dim+d] : 0.0;
+        sum += delta * delta;
+      }
+      return std::sqrt( sum );
+    }
+
+    // Visits the boxes under node within radius of the point, and
+    // returns the radius as the visitor last narrowed it.
+    template <class VisitorT>
+    double search_closest( size_t node, double const* point, double radius, VisitorT& visitor ) const {
+      const size_t end = m_first[node] + m_count[node];
+      if ( is_leaf( node ) ) {
+        for ( size_t k = m_first[node]; k < end; ++k )
+          if ( distance( &m_boxes[2*m_dim*k], point ) <= radius )
+            radius = visitor( m_index[k] );
+      } else {
+        for ( size_t child = m_first[node]; child < end; ++child )
+          if ( distance( &m_node_boxes[2*m_dim*child], point ) <= radius )
+            radius = search_closest( child, point, radius, visitor );
+      }
+      return radius;
+    }
+
+    int32  m_dim;
+    size_t m_num_leaves;
+    std::vector<double> m_boxes;       ///< The boxes, in leaf order.
+    std::vector<size_t> m_index;       ///< The original index of each box.
+    std::vector<double> m_node_boxes;
+    std::vector<size_t> m_first, m_count;
+  };
+
+}} // namespace vw::geometry
+
+#endif // __VW_GEOMETRY_PACKEDRTREE_H__
@@ -21,6 +21,7 @@
 #include <cassert>
 #include <cfloat>
 #include <cassert>
+#include <cmath>
 #include <cstring>
 #include <string>
 #include <map>
@@ -31,6 +32,128 @@ namespace vw { namespace geometry {
 
 using namespace std;
 
+namespace dPoly_local_functions{
+
+  // The index tree is rebuilt once more than this many polygons, or an
+  // eighth of those in the tree, were appended, edited or erased since
+  // it was built.
+  const int MIN_UNINDEXED_POLYS = 64;
+
+  // The box which intersects, in the strict sense of PackedRTree, the
+  // same boxes as the closed box [xll, xur] x [yll, yur] touches.
+  BBoxN closedBox(double xll, double yll, double xur, double yur){
+    return BBoxN(Vector2(nextafter(xll, -HUGE_VAL), nextafter(yll, -HUGE_VAL)),
+                 Vector2(nextafter(xur,  HUGE_VAL), nextafter(yur,  HUGE_VAL)));
+  }
+
+  bool boxesTouch(const double * box, double xll, double yll, double xur, double yur){
+    return box[0] <= xur && box[2] >= xll && box[1] <= yur && box[3] >= yll;
+  }
+
+  // How far from (x0, y0) to keep looking once something was found at
+  // distance dist. The little extra makes sure that what is found in
+  // other polygons at the same distance, up to rounding, is looked at.
+  double searchRadius(double x0, double y0, double dist){
+    return dist + 1e-12*(std::abs(x0) + std::abs(y0) + dist);
+  }
+
+  // Visitors for the index tree, which look for the closest vertex or
+  // edge among the polygons they are given, in any order. Ties go to
+  // the last vertex or edge in storage order, as with a plain scan.
+  struct closestVertex{
+    const vector<double> & xv, & yv;
+    const vector<int>    & starts, & numVerts;
+    double x0, y0;
+    int    polyIndex, vertIndex;
+    double minX, minY, minDist;
+
+    closestVertex(const vector<double> & xv_, const vector<double> & yv_,
+                  const vector<int> & starts_, const vector<int> & numVerts_,
+                  double x0_, double y0_):
+      xv(xv_), yv(yv_), starts(starts_), numVerts(numVerts_), x0(x0_), y0(y0_),
+      polyIndex(-1), vertIndex(-1), minX(x0_), minY(y0_), minDist(DBL_MAX){}
+
+    double radius() const{ return searchRadius(x0, y0, minDist); }
+
+    double operator()(size_t index){
+      int pIter = index;
+      for (int vIter = 0; vIter < numVerts[pIter]; vIter++){
+        int v = starts[pIter] + vIter;
+        double dist = distance(x0, y0, xv[v], yv[v]);
+        if (dist < minDist || (dist == minDist && pIter >= polyIndex)){
+          polyIndex = pIter;
+          vertIndex = vIter;
+          minDist   = dist;
+          minX      = xv[v];
+          minY      = yv[v];
+        }
+      }
+      return searchRadius(x0, y0, minDist);
+    }
+  };
+
+  struct closestEdge{
+    const vector<double> & xv, & yv;
+    const vector<int>    & starts, & numVerts;
+    double x0, y0;
+    int    polyIndex, vertIndex;
+    double minX, minY, minDist;
+
+    closestEdge(const vector<double> & xv_, const vector<double> & yv_,
+                const vector<int> & starts_, const vector<int> & numVerts_,
+                double x0_, double y0_):
+      xv(xv_), yv(yv_), starts(starts_), numVerts(numVerts_), x0(x0_), y0(y0_),
+      polyIndex(-1), vertIndex(-1), minX(DBL_MAX), minY(DBL_MAX), minDist(DBL_MAX){}
+
+    double radius() const{ return searchRadius(x0, y0, minDist); }
+
+    double operator()(size_t index){
+      int pIter = index;
+      double xval, yval;
+      for (int vIter = 0; vIter < numVerts[pIter]; vIter++){
+
+        int beg = starts[pIter] + vIter;
+        int end = starts[pIter] + (vIter + 1)%numVerts[pIter];
+
+        double dist = DBL_MAX;
+        minDistFromPtToSeg(// inputs
+                           x0, y0, xv[beg], yv[beg], xv[end], yv[end],
+                           // outputs
+                           xval, yval, dist
+                           );
+
+        if (dist < minDist || (dist == minDist && pIter >= polyIndex)){
+          polyIndex = pIter;
+          vertIndex = vIter;
+          minX      = xval;
+          minY      = yval;
+          minDist   = dist;
+        }
+      }
+      return searchRadius(x0, y0, minDist);
+    }
+  };
+
+  // Passes on to the visitor the polygons of the tree entries which
+  // still stand for an unedited polygon.
+  template <class VisitorT>
+  struct treeEntryVisitor{
+    VisitorT               & visitor;
+    const vector<int>      & treePolys;
+    const vector<char>     & isPolyStale;
+
+    treeEntryVisitor(VisitorT & visitor_, const vector<int> & treePolys_,
+                     const vector<char> & isPolyStale_):
+      visitor(visitor_), treePolys(treePolys_), isPolyStale(isPolyStale_){}
+
+    double operator()(size_t entry){
+      int pIter = treePolys[entry];
+      if (pIter < 0 || isPolyStale[pIter]) return visitor.radius();
+      return visitor(pIter);
+    }
+  };
+}
+
 // A double precision polygon class
 
 void dPoly::reset(){
@@ -46,6 +169,16 @@ void dPoly::reset(){
   m_annotations.clear();
   m_vertIndexAnno.clear();
   m_layerAnno.clear();
+
+  invalidateIndex();
+  m_polyStarts.clear();
+  m_polyBoxes.clear();
+  m_polyTree = PackedRTree();
+  m_treePolys.clear();
+  m_isPolyStale.clear();
+  m_stalePolys.clear();
+  m_numIndexedPolys = 0;
+  m_numStaleEntries = 0;
 }
 
 void dPoly::bdBox(double & xll, double & yll, double & xur, double & yur) const{
@@ -143,6 +276,14 @@ void dPoly::appendPolygon(int numVerts,
     m_yv.push_back(yv[s]);
   }
 
+  if (m_isIndexValid){
+    m_polyStarts.push_back(m_totalNumVerts - numVerts);
+    m_polyBoxes.push_back(*min_element(xv, xv + numVerts));
+    m_polyBoxes.push_back(*min_element(yv, yv + numVerts));
+    m_polyBoxes.push_back(*max_element(xv, xv + numVerts));
+    m_polyBoxes.push_back(*max_element(yv, yv + numVerts));
+  }
+
   return;
 }
 
@@ -193,7 +334,7 @@ bool dPoly::isXYRect(){
   return true;
 }
 
-void dPoly::get_annoByType(std::vector<anno> & annotations, int annoType){
+void dPoly::get_annoByType(std::vector<anno> & annotations, int annoType) const{
 
   if (annoType == 0){
     get_annotations(annotations);
@@ -219,83 +360,213 @@ void dPoly::set_annoByType(const std::vector<anno> & annotations, int annoType){
   return;
 }
 
-void dPoly::clipPoly(// inputs
-                     double clip_xll, double clip_yll,
-                     double clip_xur, double clip_yur,
-                     dPoly & clippedPoly // output
-                     ){
+void dPoly::updateIndex() const{
 
-  assert(this != &clippedPoly); // source and destination must be different
+  // Bring the spatial index up to date with the polygons
 
-  clippedPoly.reset();
-  clippedPoly.set_isPointCloud(m_isPointCloud);
+  using namespace dPoly_local_functions;
 
-  const double * xv               = get_xv();
-  const double * yv               = get_yv();
-  const int    * numVerts         = get_numVerts();
-  int numPolys                    = get_numPolys();
-  const vector<char> isPolyClosed = get_isPolyClosed();
-  const vector<string> colors     = get_colors();
-  const vector<string> layers     = get_layers();
+  if (!m_isIndexValid){
 
-  int start = 0;
-  for (int pIter = 0; pIter < numPolys; pIter++){
+    m_polyStarts.resize(m_numPolys);
+    m_polyBoxes.resize(4*m_numPolys);
 
-    if (pIter > 0) start += numVerts[pIter - 1];
+    int start = 0;
+    for (int pIter = 0; pIter < m_numPolys; pIter++){
 
-    int  isClosed = isPolyClosed [pIter];
-    string color  = colors       [pIter];
-    string layer  = layers       [pIter];
+      if (pIter > 0) start += m_numVerts[pIter - 1];
+      m_polyStarts[pIter] = start;
 
-    vector<double> cutXv, cutYv;
-    vector<int> cutNumVerts;
-    cutXv.clear(); cutYv.clear(); cutNumVerts.clear();
+      int numV  = m_numVerts[pIter];
+      double * box = vecPtr(m_polyBoxes) + 4*pIter;
+      if (numV <= 0){
+        box[0] = DBL_MAX/4.0, box[2] = -DBL_MAX/4.0; // As in bdBoxes()
+        box[1] = DBL_MAX/4.0, box[3] = -DBL_MAX/4.0;
+      }else{
+        const double * px = vecPtr(m_xv) + start;
+        const double * py = vecPtr(m_yv) + start;
+        box[0] = *min_element( px, px + numV ); box[2] = *max_element( px, px + numV );
+        box[1] = *min_element( py, py + numV ); box[3] = *max_element( py, py + numV );
+      }
+    }
 
-    if (m_isPointCloud){
+    m_polyTree        = PackedRTree();
+    m_treePolys.clear();
+    m_isPolyStale.clear();
+    m_stalePolys.clear();
+    m_numIndexedPolys = 0;
+    m_numStaleEntries = 0;
+    m_isIndexValid    = true;
+  }
 
-      // To cut a point cloud to a box all is needed is to select
-      // which points are in the box
-      for (int vIter = 0; vIter < numVerts[pIter]; vIter++){
-        double x = xv[start + vIter];
-        double y = yv[start + vIter];
-        if (x >= clip_xll && x <= clip_xur &&
-            y >= clip_yll && y <= clip_yur
-            ){
-          cutXv.push_back(x);
-          cutYv.push_back(y);
-        }
-      }
-      cutNumVerts.push_back( cutXv.size() );
+  int numIndexed = m_numIndexedPolys;
+  if (m_numPolys - numIndexed + m_numStaleEntries > max(MIN_UNINDEXED_POLYS, numIndexed/8)){
+    vector<BBoxN> boxes(m_numPolys);
+    m_treePolys.resize(m_numPolys);
+    for (int pIter = 0; pIter < m_numPolys; pIter++){
+      const double * box = vecPtr(m_polyBoxes) + 4*pIter;
+      boxes[pIter] = BBoxN(Vector2(box[0], box[1]), Vector2(box[2], box[3]));
+      m_treePolys[pIter] = pIter;
+    }
+    m_polyTree = PackedRTree(boxes);
+    m_isPolyStale.assign(m_numPolys, 0);
+    m_stalePolys.clear();
+    m_numIndexedPolys = m_numPolys;
+    m_numStaleEntries = 0;
+  }
+
+  return;
+}
 
-    }else if (isClosed){
+void dPoly::updatePolyIndex(int polyIndex, int numVertsAdded){
 
-      cutPoly(1, numVerts + pIter, xv + start, yv + start,
-              clip_xll, clip_yll, clip_xur, clip_yur,
-              cutXv, cutYv, cutNumVerts // outputs
-              );
+  // Bring the index up to date after the vertices of one polygon were
+  // edited. Its box is recomputed, and if it is in the tree it is
+  // looked at one by one from now on, as the tree holds its old box.
 
-    }else{
+  if (!m_isIndexValid) return;
 
-      cutPolyLine(numVerts[pIter], xv + start, yv + start,
-                  clip_xll, clip_yll, clip_xur, clip_yur,
-                  cutXv, cutYv, cutNumVerts // outputs
-                  );
+  for (int pIter = polyIndex + 1; pIter < m_numPolys; pIter++)
+    m_polyStarts[pIter] += numVertsAdded;
 
-    }
+  int numV  = m_numVerts[polyIndex];
+  double * box = vecPtr(m_polyBoxes) + 4*polyIndex;
+  if (numV <= 0){
+    box[0] = DBL_MAX/4.0, box[2] = -DBL_MAX/4.0; // As in bdBoxes()
+    box[1] = DBL_MAX/4.0, box[3] = -DBL_MAX/4.0;
+  }else{
+    const double * px = vecPtr(m_xv) + m_polyStarts[polyIndex];
+    const double * py = vecPtr(m_yv) + m_polyStarts[polyIndex];
+    box[0] = *min_element( px, px + numV ); box[2] = *max_element( px, px + numV );
+    box[1] = *min_element( py, py + numV ); box[3] = *max_element( py, py + numV );
+  }
+
+  if (polyIndex < m_numIndexedPolys && !m_isPolyStale[polyIndex]){
+    m_isPolyStale[polyIndex] = 1;
+    m_stalePolys.push_back(polyIndex);
+    m_numStaleEntries++;
+  }
 
-    int cstart = 0;
-    for (int cIter = 0; cIter < (int)cutNumVerts.size(); cIter++){
+  return;
+}
 
-      if (cIter > 0) cstart += cutNumVerts[cIter - 1];
-      int cSize = cutNumVerts[cIter];
-      clippedPoly.appendPolygon(cSize,
-                                vecPtr(cutXv) + cstart,
-                                vecPtr(cutYv) + cstart,
-                                isClosed, color, layer
-                                );
+void dPoly::polysIntersectingBox(double xll, double yll, double xur, double yur,
+                                 std::vector<int> & polyIndices) const{
 
+  // The polygons whose bounding boxes touch the given box, in order.
+  // Those are the only ones which may have points in the box.
+
+  using namespace dPoly_local_functions;
+
+  updateIndex();
+
+  vector<size_t> hits;
+  m_polyTree.intersects(closedBox(xll, yll, xur, yur), hits);
+  polyIndices.clear();
+  for (int h = 0; h < (int)hits.size(); h++){
+    int pIter = m_treePolys[hits[h]];
+    if (pIter >= 0 && !m_isPolyStale[pIter]) polyIndices.push_back(pIter);
+  }
+  for (int s = 0; s < (int)m_stalePolys.size(); s++){
+    int pIter = m_stalePolys[s];
+    if (boxesTouch(vecPtr(m_polyBoxes) + 4*pIter, xll, yll, xur, yur))
+      polyIndices.push_back(pIter);
+  }
+  sort(polyIndices.begin(), polyIndices.end());
+
+  for (int pIter = m_numIndexedPolys; pIter < m_numPolys; pIter++){
+    if (boxesTouch(vecPtr(m_polyBoxes) + 4*pIter, xll, yll, xur, yur))
+      polyIndices.push_back(pIter);
+  }
+
+  return;
+}
+
+void dPoly::clipOnePoly(int polyIndex,
+                        double clip_xll, double clip_yll,
+                        double clip_xur, double clip_yur,
+                        dPoly & clippedPoly) const{
+
+  // Append to clippedPoly the pieces of the given polygon within the
+  // box. The index must be up to date.
+
+  int start           = m_polyStarts[polyIndex];
+  int numV            = m_numVerts[polyIndex];
+  const double * xv   = vecPtr(m_xv) + start;
+  const double * yv   = vecPtr(m_yv) + start;
+  int  isClosed       = m_isPolyClosed [polyIndex];
+  const string & color = m_colors      [polyIndex];
+  const string & layer = m_layers      [polyIndex];
+
+  vector<double> cutXv, cutYv;
+  vector<int> cutNumVerts;
+
+  if (m_isPointCloud){
+
+    // To cut a point cloud to a box all is needed is to select
+    // which points are in the box
+    for (int vIter = 0; vIter < numV; vIter++){
+      double x = xv[vIter];
+      double y = yv[vIter];
+      if (x >= clip_xll && x <= clip_xur &&
+          y >= clip_yll && y <= clip_yur
+          ){
+        cutXv.push_back(x);
+        cutYv.push_back(y);
+      }
     }
+    cutNumVerts.push_back( cutXv.size() );
+
+  }else if (isClosed){
+
+    cutPoly(1, &numV, xv, yv,
+            clip_xll, clip_yll, clip_xur, clip_yur,
+            cutXv, cutYv, cutNumVerts // outputs
+            );
 
+  }else{
+
+    cutPolyLine(numV, xv, yv,
+                clip_xll, clip_yll, clip_xur, clip_yur,
+                cutXv, cutYv, cutNumVerts // outputs
+                );
+
+  }
+
+  int cstart = 0;
+  for (int cIter = 0; cIter < (int)cutNumVerts.size(); cIter++){
+
+    if (cIter > 0) cstart += cutNumVerts[cIter - 1];
+    int cSize = cutNumVerts[cIter];
+    clippedPoly.appendPolygon(cSize,
+                              vecPtr(cutXv) + cstart,
+                              vecPtr(cutYv) + cstart,
+                              isClosed, color, layer
+                              );
+
+  }
+
+  return;
+}
+
+void dPoly::clipPoly(// inputs
+                     double clip_xll, double clip_yll,
+                     double clip_xur, double clip_yur,
+                     dPoly & clippedPoly // output
+                     ) const{
+
+  assert(this != &clippedPoly); // source and destination must be different
+
+  clippedPoly.reset();
+  clippedPoly.set_isPointCloud(m_isPointCloud);
+
+  // Polygons away from the box are skipped
+  vector<int> polyIndices;
+  polysIntersectingBox(clip_xll, clip_yll, clip_xur, clip_yur, // inputs
+                       polyIndices                             // output
+                       );
+  for (int s = 0; s < (int)polyIndices.size(); s++){
+    clipOnePoly(polyIndices[s], clip_xll, clip_yll, clip_xur, clip_yur, clippedPoly);
   }
 
   // Cutting inherits the annotations at the vertices of the uncut
@@ -321,8 +592,74 @@ void dPoly::clipPoly(// inputs
   return;
 }
 
+void dPoly::clipPolyToBoxes(// inputs
+                            const std::vector<double> & clip_xll,
+                            const std::vector<double> & clip_yll,
+                            const std::vector<double> & clip_xur,
+                            const std::vector<double> & clip_yur,
+                            // output
+                            std::vector<dPoly> & clippedPolys
+                            ) const{
+
+  // Rather than looking up the polygons near each box, the boxes are
+  // indexed and each polygon and annotation is looked up among them.
+  // Going over the polygons in order appends them to each clipped set
+  // in the same order as clipPoly() does.
+
+  using namespace dPoly_local_functions;
+
+  int numBoxes = clip_xll.size();
+  assert((int)clip_yll.size() == numBoxes && (int)clip_xur.size() == numBoxes &&
+         (int)clip_yur.size() == numBoxes);
+
+  clippedPolys.assign(numBoxes, dPoly());
+  for (int b = 0; b < numBoxes; b++) clippedPolys[b].set_isPointCloud(m_isPointCloud);
+  if (numBoxes == 0) return;
+
+  vector<BBoxN> boxes(numBoxes);
+  for (int b = 0; b < numBoxes; b++)
+    boxes[b] = closedBox(clip_xll[b], clip_yll[b], clip_xur[b], clip_yur[b]);
+  PackedRTree boxTree(boxes);
+
+  updateIndex();
+
+  vector<size_t> hits;
+  for (int pIter = 0; pIter < m_numPolys; pIter++){
+    const double * box = vecPtr(m_polyBoxes) + 4*pIter;
+    hits.clear();
+    boxTree.intersects(BBoxN(Vector2(box[0], box[1]), Vector2(box[2], box[3])), hits);
+    for (int h = 0; h < (int)hits.size(); h++){
+      int b = hits[h];
+      clipOnePoly(pIter, clip_xll[b], clip_yll[b], clip_xur[b], clip_yur[b],
+                  clippedPolys[b]);
+    }
+  }
+
+  vector<anno> annotations;
+  vector< vector<anno> > annoInBox(numBoxes);
+  for (int annoType = 0; annoType < 3; annoType++){
+
+    get_annoByType(annotations, annoType);
+
+    for (int b = 0; b < numBoxes; b++) annoInBox[b].clear();
+    for (int s = 0; s < (int)annotations.size(); s++){
+      const anno & A = annotations[s];
+      hits.clear();
+      boxTree.intersects(BBoxN(Vector2(A.x, A.y), Vector2(A.x, A.y)), hits);
+      for (int h = 0; h < (int)hits.size(); h++) annoInBox[hits[h]].push_back(A);
+    }
+
+    for (int b = 0; b < numBoxes; b++)
+      clippedPolys[b].set_annoByType(annoInBox[b], annoType);
+  }
+
+  return;
+}
+
 void dPoly::shift(double shift_x, double shift_y){
 
+  invalidateIndex();
+
   // To do: Need to integrate the several very similar transform functions
 
   for (int i = 0; i < (int)m_xv.size(); i++){
@@ -346,6 +683,8 @@ void dPoly::shift(double shift_x, double shift_y){
 
 void dPoly::rotate(double angle){ // The angle is given in degrees
 
+  invalidateIndex();
+
   // To do: Need to integrate the several very similar transform functions
 
   double a = angle*M_PI/180.0, c = cos(a), s= sin(a);
@@ -380,6 +719,8 @@ void dPoly::rotate(double angle){ // The angle is given in degrees
 
 void dPoly::scale(double scale){
 
+  invalidateIndex();
+
   // To do: Need to integrate the several very similar transform functions
 
   for (int i = 0; i < (int)m_xv.size(); i++){
@@ -485,8 +826,8 @@ void dPoly::compVertIndexAnno(){
 
   m_vertIndexAnno.clear();
 
-  const double * xv = get_xv();
-  const double * yv = get_yv();
+  const double * xv = vecPtr(m_xv);
+  const double * yv = vecPtr(m_yv);
 
   int start = 0;
   for (int pIter = 0; pIter < m_numPolys; pIter++){
@@ -511,8 +852,8 @@ void dPoly::compLayerAnno(){
 
   m_layerAnno.clear();
 
-  const double * xv = get_xv();
-  const double * yv = get_yv();
+  const double * xv = vecPtr(m_xv);
+  const double * yv = vecPtr(m_yv);
 
   int start = 0;
   for (int pIter = 0; pIter < m_numPolys; pIter++){
@@ -584,26 +925,19 @@ void dPoly::findClosestPolyVertex(// inputs
                                   double & min_dist
                                   ) const{
 
-  min_x = x0; min_y = y0; min_dist = DBL_MAX;
-  polyIndex = -1; vertIndex = -1;
+  // Only the polygons whose boxes are no farther than the closest
+  // vertex found so far are looked at.
+  updateIndex();
+  dPoly_local_functions::closestVertex closest(m_xv, m_yv, m_polyStarts, m_numVerts, x0, y0);
+  dPoly_local_functions::treeEntryVisitor<dPoly_local_functions::closestVertex>
+    entries(closest, m_treePolys, m_isPolyStale);
+  m_polyTree.closest(Vector2(x0, y0), entries);
+  for (int s = 0; s < (int)m_stalePolys.size(); s++) closest(m_stalePolys[s]);
+  for (int pIter = m_numIndexedPolys; pIter < m_numPolys; pIter++) closest(pIter);
 
-  int start = 0;
-  for (int pIter = 0; pIter < m_numPolys; pIter++){
-
-    if (pIter > 0) start += m_numVerts[pIter - 1];
-
-    for (int vIter = 0; vIter < m_numVerts[pIter]; vIter++){
-      double dist = distance(x0, y0, m_xv[start + vIter], m_yv[start + vIter]);
-      if (dist <= min_dist){
-        polyIndex = pIter;
-        vertIndex = vIter;
-        min_dist  = dist;
-        min_x     = m_xv[start + vIter];
-        min_y     = m_yv[start + vIter];
-      }
-    }
-
-  }
+  polyIndex = closest.polyIndex; vertIndex = closest.vertIndex;
+  min_x     = closest.minX;      min_y     = closest.minY;
+  min_dist  = closest.minDist;
 
   return;
 }
@@ -620,40 +954,17 @@ void dPoly::findClosestPolyEdge(//inputs
                                  double & minX, double & minY, double & minDist
                                  ) const{
 
-  polyIndex = -1;
-  vertIndex = -1;
-  minX     = DBL_MAX, minY = DBL_MAX;
-  minDist  = DBL_MAX;
-
-  int start = 0;
-  double xval, yval;
-  for (int pIter = 0; pIter < m_numPolys; pIter++){
-
-    if (pIter > 0) start += m_numVerts[pIter - 1];
-
-    for (int vIter = 0; vIter < m_numVerts[pIter]; vIter++){
+  updateIndex();
+  dPoly_local_functions::closestEdge closest(m_xv, m_yv, m_polyStarts, m_numVerts, x0, y0);
+  dPoly_local_functions::treeEntryVisitor<dPoly_local_functions::closestEdge>
+    entries(closest, m_treePolys, m_isPolyStale);
+  m_polyTree.closest(Vector2(x0, y0), entries);
+  for (int s = 0; s < (int)m_stalePolys.size(); s++) closest(m_stalePolys[s]);
+  for (int pIter = m_numIndexedPolys; pIter < m_numPolys; pIter++) closest(pIter);
 
-      int beg = start + vIter;
-      int end = start + (vIter + 1)%m_numVerts[pIter];
-
-      double dist = DBL_MAX;
-      minDistFromPtToSeg(// inputs
-                         x0, y0, m_xv[beg], m_yv[beg], m_xv[end], m_yv[end],
-                         // outputs
-                         xval, yval, dist
-                         );
-
-      if (dist <= minDist){
-        polyIndex = pIter;
-        vertIndex = vIter;
-        minX      = xval;
-        minY      = yval;
-        minDist   = dist;
-      }
-
-    }
-
-  }
+  polyIndex = closest.polyIndex; vertIndex = closest.vertIndex;
+  minX      = closest.minX;      minY      = closest.minY;
+  minDist   = closest.minDist;
 
   return;
 }
@@ -688,6 +999,7 @@ void dPoly::insertVertex(int polyIndex, int vertIndex,
   m_numVerts[polyIndex]++;
 
   m_vertIndexAnno.clear();
+  updatePolyIndex(polyIndex, 1);
 
   return;
 }
@@ -710,6 +1022,7 @@ void dPoly::eraseVertex(int polyIndex, int vertIndex){
   m_numVerts[polyIndex]--;
 
   m_vertIndexAnno.clear();
+  updatePolyIndex(polyIndex, -1);
 
   return;
 }
@@ -728,6 +1041,7 @@ void dPoly::changeVertexValue(int polyIndex, int vertIndex, double x, double y){
   m_yv[start + vertIndex] = y;
 
   m_vertIndexAnno.clear();
+  updatePolyIndex(polyIndex, 0);
 
   return;
 }
@@ -749,10 +1063,13 @@ void dPoly::shiftEdge(int polyIndex, int vertIndex, double shift_x, double shift
   m_vertIndexAnno.clear();
 
   // End point of the edge
-  if (m_numVerts[polyIndex] <= 1) return;
-  int vertIndexEnd = (vertIndex + 1)%m_numVerts[polyIndex];
-  m_xv[start + vertIndexEnd] += shift_x;
-  m_yv[start + vertIndexEnd] += shift_y;
+  if (m_numVerts[polyIndex] > 1){
+    int vertIndexEnd = (vertIndex + 1)%m_numVerts[polyIndex];
+    m_xv[start + vertIndexEnd] += shift_x;
+    m_yv[start + vertIndexEnd] += shift_y;
+  }
+
+  updatePolyIndex(polyIndex, 0);
 
   return;
 }
@@ -772,6 +1089,7 @@ void dPoly::shiftOnePoly(int polyIndex, double shift_x, double shift_y){
   }
 
   m_vertIndexAnno.clear();
+  updatePolyIndex(polyIndex, 0);
 
   return;
 }
@@ -934,6 +1252,7 @@ void dPoly::sortFromLargestToSmallest(){
 
   }
 
+  invalidateIndex();
 }
 
 void dPoly::sortBySizeAndMaybeAddBigContainingRect(// inputs
@@ -984,6 +1303,8 @@ void dPoly::sortBySizeAndMaybeAddBigContainingRect(// inputs
 
 void dPoly::enforce45(){
 
+  invalidateIndex();
+
   // Enforce that polygon vertices are integers and the angles are 45x.
 
   int start = 0;
@@ -1357,8 +1678,14 @@ void dPoly::markPolysIntersectingBox(// Inputs
 
   mark.clear();
 
+  vector<int> polyIndices;
+  polysIntersectingBox(xll, yll, xur, yur, // inputs
+                       polyIndices         // output
+                       );
+
   dPoly onePoly, clippedPoly;
-  for (int polyIndex = 0; polyIndex < m_numPolys; polyIndex++){
+  for (int s = 0; s < (int)polyIndices.size(); s++){
+    int polyIndex = polyIndices[s];
     extractOnePoly(polyIndex, // input
                    onePoly    // output
                    );
@@ -1385,11 +1712,13 @@ void dPoly::replaceOnePoly(int polyIndex, int numV, const double* x, const doubl
   m_xv.insert(m_xv.begin() + start, x, x + numV);
   m_yv.insert(m_yv.begin() + start, y, y + numV);
 
+  int numVertsAdded = numV - m_numVerts[polyIndex];
   m_numVerts[polyIndex] = numV;
   m_totalNumVerts = m_xv.size();
 
   m_vertIndexAnno.clear();
   m_layerAnno.clear();
+  updatePolyIndex(polyIndex, numVertsAdded);
 
   return;
 }
@@ -1429,6 +1758,40 @@ void dPoly::eraseMarkedPolys(// Inputs
   m_vertIndexAnno.clear();
   m_layerAnno.clear();
 
+  if (m_isIndexValid){
+    // The remaining polygons keep their boxes and their tree entries,
+    // which are renumbered. The entries of the erased ones are dropped.
+    vector<char> bmark;
+    vector<int>  newIndex(imark.size());
+    int numKept = 0;
+    for (int pIter = 0; pIter < (int)imark.size(); pIter++){
+      bmark.insert(bmark.end(), 4, imark[pIter]);
+      newIndex[pIter] = imark[pIter] ? -1 : numKept++;
+    }
+    eraseMarkedElements(m_polyBoxes, bmark);
+    m_polyStarts.resize(m_numPolys);
+    for (int pIter = 0; pIter < m_numPolys; pIter++)
+      m_polyStarts[pIter] = (pIter == 0) ? 0 : m_polyStarts[pIter - 1] + m_numVerts[pIter - 1];
+
+    for (int e = 0; e < (int)m_treePolys.size(); e++){
+      int pIter = m_treePolys[e];
+      if (pIter < 0) continue;
+      if (imark[pIter] && !m_isPolyStale[pIter]) m_numStaleEntries++;
+      m_treePolys[e] = newIndex[pIter];
+    }
+
+    vector<int> stalePolys;
+    for (int s = 0; s < (int)m_stalePolys.size(); s++){
+      int pIter = m_stalePolys[s];
+      if (!imark[pIter]) stalePolys.push_back(newIndex[pIter]);
+    }
+    m_stalePolys.swap(stalePolys);
+
+    vector<char> smark(imark.begin(), imark.begin() + m_numIndexedPolys);
+    eraseMarkedElements(m_isPolyStale, smark);
+    m_numIndexedPolys = m_isPolyStale.size();
+  }
+
   return;
 }
 
@@ -22,10 +22,19 @@
 #include <map>
 #include <vw/Geometry/baseUtils.h>
 #include <vw/Geometry/geomUtils.h>
+#include <vw/Geometry/PackedRTree.h>
 
 namespace vw { namespace geometry {
 
-// A class holding a set of polygons in double precision
+// A class holding a set of polygons in double precision.
+
+// The queries by location (clipping, marking polygons in a box, and
+// finding the closest vertex or edge) go through a spatial index of the
+// polygons' bounding boxes. The index is built by the first such query
+// and is then kept up to date as polygons are appended or erased; any
+// other edit drops it, to be rebuilt on the next query. Since the const
+// queries may build the index, they must not be called from several
+// threads at once.
 class dPoly{
 
 public:
@@ -74,7 +83,19 @@ public:
                 double clip_xll, double clip_yll,
                 double clip_xur, double clip_yur,
                 dPoly & clippedPoly // output
-                );
+                ) const;
+
+  // Clip the polygons to each of the given boxes, with the same result
+  // as calling clipPoly() for each box, but looking up each polygon
+  // only once among the boxes.
+  void clipPolyToBoxes(// inputs
+                       const std::vector<double> & clip_xll,
+                       const std::vector<double> & clip_yll,
+                       const std::vector<double> & clip_xur,
+                       const std::vector<double> & clip_yur,
+                       // output
+                       std::vector<dPoly> & clippedPolys
+                       ) const;
 
   void shift(double shift_x, double shift_y);
   void rotate(double angle);
@@ -83,8 +104,13 @@ public:
   const int    * get_numVerts         () const { return vecPtr(m_numVerts); }
   const double * get_xv               () const { return vecPtr(m_xv);       }
   const double * get_yv               () const { return vecPtr(m_yv);       }
-  double * get_xv                     () { return vecPtr(m_xv);             }  // non-const
-  double * get_yv                     () { return vecPtr(m_yv);             }
+  // The non-const accessors mark the vertex index as stale, since the
+  // caller may move vertices through the returned pointer. A pointer
+  // kept across a query (which rebuilds the index) must be followed by
+  // invalidateIndex() after writing through it again.
+  double * get_xv                     () { invalidateIndex(); return vecPtr(m_xv); }  // non-const
+  double * get_yv                     () { invalidateIndex(); return vecPtr(m_yv); }
+  void invalidateIndex                () { m_isIndexValid = false; }
   int get_numPolys                    () const { return m_numPolys;         }
   int get_totalNumVerts               () const { return m_totalNumVerts;    }
   std::vector<char> get_isPolyClosed  () const { return m_isPolyClosed;     }
@@ -194,7 +220,16 @@ public:
 private:
 
   bool getColorInCntFile(const std::string & line, std::string & color);
-  void get_annoByType(std::vector<anno> & annotations, int annoType);
+  void get_annoByType(std::vector<anno> & annotations, int annoType) const;
+
+  void updateIndex() const;
+  void updatePolyIndex(int polyIndex, int numVertsAdded);
+  void polysIntersectingBox(double xll, double yll, double xur, double yur,
+                            std::vector<int> & polyIndices) const;
+  void clipOnePoly(int polyIndex,
+                   double clip_xll, double clip_yll,
+                   double clip_xur, double clip_yur,
+                   dPoly & clippedPoly) const;
   void set_annoByType(const std::vector<anno> & annotations, int annoType);
 
   // If isPointCloud is true, treat each point as a set of unconnected points
@@ -212,6 +247,19 @@ private:
   std::vector<anno>        m_vertIndexAnno; // Anno showing vertex index
   std::vector<anno>        m_layerAnno;     // Anno showing layer number
 
+  // The spatial index. The tree covers the first m_numIndexedPolys
+  // polygons; those appended since, and those edited since, are looked
+  // at one by one.
+  mutable bool                m_isIndexValid;
+  mutable std::vector<int>    m_polyStarts; // index of the first vertex of each polygon
+  mutable std::vector<double> m_polyBoxes;  // xll, yll, xur, yur of each polygon
+  mutable PackedRTree         m_polyTree;
+  mutable std::vector<int>    m_treePolys;  // polygon of each tree entry, -1 once erased
+  mutable std::vector<char>   m_isPolyStale;// indexed polygons edited since the tree was built
+  mutable std::vector<int>    m_stalePolys; // the same, as a list
+  mutable int                 m_numIndexedPolys;
+  mutable int                 m_numStaleEntries; // tree entries for edited or erased polygons
+
 };
 
 }}
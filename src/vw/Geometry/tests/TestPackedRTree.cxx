@@ -0,0 +1,206 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/Geometry/PackedRTree.h>
+#include <vw/Math/Vector.h>
+#include <vw/Math/BBox.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+#include <utility>
+
+using namespace vw;
+using namespace vw::geometry;
+
+namespace {
+
+  double random_coordinate( double range ) {
+    return range * double( std::rand() ) / double( RAND_MAX );
+  }
+
+  // Boxes scattered over [0,100]^dim, a few of them large.
+  std::vector<BBoxN> random_boxes( size_t count, int32 dim ) {
+    std::vector<BBoxN> boxes;
+    for ( size_t i = 0; i < count; ++i ) {
+      Vector<double> min( dim ), max( dim );
+      double size = i % 20 == 0 ? 40 : 5;
+      for ( int32 d = 0; d < dim; ++d ) {
+        min[d] = random_coordinate( 100 );
+        max[d] = min[d] + random_coordinate( size );
+      }
+      boxes.push_back( BBoxN( min, max ) );
+    }
+    return boxes;
+  }
+
+  struct PairCollector {
+    std::vector<std::pair<size_t,size_t> > pairs;
+    bool operator()( size_t i, size_t j ) {
+      pairs.push_back( std::make_pair( i, j ) );
+      return true;
+    }
+  };
+
+  // Finds the box with the closest center, as an example of a search
+  // for primitives held within the boxes.
+  struct ClosestCenter {
+    std::vector<BBoxN> const& boxes;
+    Vector<double> point;
+    double best;
+    size_t index;
+    ClosestCenter( std::vector<BBoxN> const& boxes, Vector<double> const& point )
+      : boxes(boxes), point(point), best(std::numeric_limits<double>::max()), index(0) {}
+    double operator()( size_t i ) {
+      double dist = norm_2( boxes[i].center() - point );
+      if ( dist < best || ( dist == best && i < index ) ) {
+        best  = dist;
+        index = i;
+      }
+      return best;
+    }
+  };
+
+  struct FirstHits {
+    size_t limit;
+    std::vector<size_t> hits;
+    FirstHits( size_t limit ) : limit(limit) {}
+    bool operator()( size_t index ) {
+      hits.push_back( index );
+      return hits.size() < limit;
+    }
+  };
+}
+
+struct PackedRTreeTest : public ::testing::TestWithParam<int32> {};
+
+TEST_P( PackedRTreeTest, BruteForce ) {
+  const int32 dim = GetParam();
+  std::srand( 1234 + dim );
+  std::vector<BBoxN> boxes = random_boxes( 700, dim );
+
+  const int32 node_sizes[] = { 2, 5, 16 };
+  for ( int n = 0; n < 3; ++n ) {
+    PackedRTree tree( boxes, node_sizes[n] );
+    ASSERT_EQ( boxes.size(), tree.size() );
+    EXPECT_EQ( dim, tree.dim() );
+
+    BBoxN all = boxes[0];
+    for ( size_t i = 1; i < boxes.size(); ++i )
+      all.grow( boxes[i] );
+    EXPECT_VECTOR_EQ( all.min(), tree.bounding_box().min() );
+    EXPECT_VECTOR_EQ( all.max(), tree.bounding_box().max() );
+
+    for ( int q = 0; q < 50; ++q ) {
+      BBoxN query = random_boxes( 1, dim )[0];
+      std::vector<size_t> found, expected;
+      tree.intersects( query, found );
+      for ( size_t i = 0; i < boxes.size(); ++i )
+        if ( boxes[i].intersects( query ) )
+          expected.push_back( i );
+      std::sort( found.begin(), found.end() );
+      EXPECT_EQ( expected, found );
+
+      Vector<double> point = query.min();
+      found.clear();
+      expected.clear();
+      tree.contains( point, found );
+      for ( size_t i = 0; i < boxes.size(); ++i )
+        if ( boxes[i].contains( point ) )
+          expected.push_back( i );
+      std::sort( found.begin(), found.end() );
+      EXPECT_EQ( expected, found );
+    }
+
+    for ( int q = 0; q < 20; ++q ) {
+      // Some of the points lie outside all the boxes.
+      Vector<double> point( dim );
+      for ( int32 d = 0; d < dim; ++d )
+        point[d] = random_coordinate( 120 ) - 10;
+      ClosestCenter closest( boxes, point );
+      tree.closest( point, closest );
+      ClosestCenter expected( boxes, point );
+      for ( size_t i = 0; i < boxes.size(); ++i )
+        expected( i );
+      EXPECT_EQ( expected.index, closest.index );
+    }
+
+    PairCollector collector;
+    tree.overlap_pairs( collector );
+    std::vector<std::pair<size_t,size_t> > expected;
+    for ( size_t i = 0; i < boxes.size(); ++i )
+      for ( size_t j = i+1; j < boxes.size(); ++j )
+        if ( boxes[i].intersects( boxes[j] ) )
+          expected.push_back( std::make_pair( i, j ) );
+    std::sort( collector.pairs.begin(), collector.pairs.end() );
+    EXPECT_EQ( expected, collector.pairs );
+  }
+}
+
+INSTANTIATE_TEST_CASE_P( Dimensions, PackedRTreeTest, ::testing::Values( 1, 2, 3 ) );
+
+TEST( PackedRTree, Touching ) {
+  // Boxes that only share an edge do not intersect, and a box holds
+  // its minimum corner but not its maximum one.
+  std::vector<BBoxN> boxes;
+  for ( int i = 0; i < 4; ++i )
+    boxes.push_back( BBoxN( BBox2( i, 0, 1, 1 ) ) );
+  PackedRTree tree( boxes, 2 );
+
+  std::vector<size_t> found;
+  tree.intersects( BBoxN( BBox2( 1, 0, 1, 1 ) ), found );
+  ASSERT_EQ( 1u, found.size() );
+  EXPECT_EQ( 1u, found[0] );
+
+  found.clear();
+  tree.contains( Vector2( 2, 0.5 ), found );
+  ASSERT_EQ( 1u, found.size() );
+  EXPECT_EQ( 2u, found[0] );
+
+  PairCollector collector;
+  tree.overlap_pairs( collector );
+  EXPECT_TRUE( collector.pairs.empty() );
+}
+
+TEST( PackedRTree, EarlyStop ) {
+  std::vector<BBoxN> boxes;
+  for ( int i = 0; i < 100; ++i )
+    boxes.push_back( BBoxN( BBox2( i % 10, i / 10, 1, 1 ) ) );
+  PackedRTree tree( boxes, 4 );
+
+  FirstHits first( 3 );
+  tree.intersects( BBoxN( BBox2( 0, 0, 10, 10 ) ), first );
+  EXPECT_EQ( 3u, first.hits.size() );
+}
+
+TEST( PackedRTree, Empty ) {
+  PackedRTree tree;
+  EXPECT_EQ( 0u, tree.size() );
+  EXPECT_TRUE( tree.empty() );
+
+  PackedRTree built( std::vector<BBoxN>(), 8 );
+  std::vector<size_t> found;
+  built.intersects( BBoxN( BBox2( 0, 0, 1, 1 ) ), found );
+  built.contains( Vector2( 0, 0 ), found );
+  EXPECT_TRUE( found.empty() );
+
+  EXPECT_THROW( PackedRTree( std::vector<BBoxN>(), 1 ), ArgumentErr );
+}
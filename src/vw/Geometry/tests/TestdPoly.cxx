@@ -0,0 +1,235 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/Geometry/dPoly.h>
+#include <vw/Geometry/geomUtils.h>
+
+#include <cfloat>
+#include <cstdlib>
+
+using namespace vw;
+using namespace vw::geometry;
+
+namespace {
+
+  // Polygons and polylines on a half-unit grid, so that many of them
+  // share vertices and edges.
+  void append_random_polys( dPoly & poly, int count ) {
+    for ( int i = 0; i < count; ++i ) {
+      double cx = 0.5 * ( std::rand() % 400 ), cy = 0.5 * ( std::rand() % 400 );
+      int num_verts = 1 + std::rand() % 6;
+      double xv[6], yv[6];
+      for ( int k = 0; k < num_verts; ++k ) {
+        xv[k] = cx + 0.5 * ( std::rand() % 16 );
+        yv[k] = cy + 0.5 * ( std::rand() % 16 );
+      }
+      poly.appendPolygon( num_verts, xv, yv, i % 3 != 0, "yellow", "" );
+      if ( i % 10 == 0 ) {
+        anno annotation;
+        annotation.x = cx; annotation.y = cy; annotation.label = "a";
+        poly.addAnno( annotation );
+      }
+    }
+  }
+
+  void expect_same_polys( dPoly const& a, dPoly const& b ) {
+    ASSERT_EQ( a.get_numPolys(), b.get_numPolys() );
+    ASSERT_EQ( a.get_totalNumVerts(), b.get_totalNumVerts() );
+    for ( int i = 0; i < a.get_numPolys(); ++i )
+      EXPECT_EQ( a.get_numVerts()[i], b.get_numVerts()[i] );
+    for ( int i = 0; i < a.get_totalNumVerts(); ++i ) {
+      EXPECT_EQ( a.get_xv()[i], b.get_xv()[i] );
+      EXPECT_EQ( a.get_yv()[i], b.get_yv()[i] );
+    }
+    std::vector<anno> anno_a, anno_b;
+    a.get_annotations( anno_a );
+    b.get_annotations( anno_b );
+    EXPECT_EQ( anno_a.size(), anno_b.size() );
+  }
+
+  void expect_closest_vertex( dPoly const& poly, double x0, double y0 ) {
+    int poly_index, vert_index;
+    double min_x, min_y, min_dist;
+    poly.findClosestPolyVertex( x0, y0, poly_index, vert_index, min_x, min_y, min_dist );
+
+    // The last of the closest vertices, by plain scan.
+    int expected_poly = -1, expected_vert = -1, start = 0;
+    double expected_dist = DBL_MAX;
+    for ( int p = 0; p < poly.get_numPolys(); ++p ) {
+      for ( int v = 0; v < poly.get_numVerts()[p]; ++v ) {
+        double dist = distance( x0, y0, poly.get_xv()[start + v], poly.get_yv()[start + v] );
+        if ( dist <= expected_dist ) {
+          expected_poly = p; expected_vert = v; expected_dist = dist;
+        }
+      }
+      start += poly.get_numVerts()[p];
+    }
+    EXPECT_EQ( expected_poly, poly_index );
+    EXPECT_EQ( expected_vert, vert_index );
+    EXPECT_EQ( expected_dist, min_dist );
+  }
+}
+
+TEST( dPoly, ClipToBoxes ) {
+  std::srand( 42 );
+  dPoly poly;
+  append_random_polys( poly, 800 );
+
+  std::vector<double> xll, yll, xur, yur;
+  for ( int b = 0; b < 50; ++b ) {
+    xll.push_back( 0.5 * ( std::rand() % 400 ) );
+    yll.push_back( 0.5 * ( std::rand() % 400 ) );
+    xur.push_back( xll.back() + 0.5 * ( std::rand() % 60 ) );
+    yur.push_back( yll.back() + 0.5 * ( std::rand() % 60 ) );
+  }
+
+  std::vector<dPoly> clipped;
+  poly.clipPolyToBoxes( xll, yll, xur, yur, clipped );
+  ASSERT_EQ( xll.size(), clipped.size() );
+  int num_nonempty = 0;
+  for ( size_t b = 0; b < xll.size(); ++b ) {
+    dPoly expected;
+    poly.clipPoly( xll[b], yll[b], xur[b], yur[b], expected );
+    expect_same_polys( expected, clipped[b] );
+    num_nonempty += expected.get_numPolys() > 0;
+  }
+  EXPECT_GT( num_nonempty, 10 );
+}
+
+TEST( dPoly, MarkIntersecting ) {
+  dPoly poly;
+  poly.appendRectangle( 0, 0, 1, 1, true, "yellow", "" );
+  poly.appendRectangle( 2, 0, 3, 1, true, "yellow", "" );
+  poly.appendRectangle( 1, 0, 2, 1, true, "yellow", "" );
+
+  std::map<int, int> mark;
+  poly.markPolysIntersectingBox( 0.8, 0.2, 1.5, 0.5, mark );
+  ASSERT_EQ( 2u, mark.size() );
+  EXPECT_TRUE( mark.count(0) );
+  EXPECT_TRUE( mark.count(2) );
+
+  poly.erasePolysIntersectingBox( 2.5, 0.5, 2.6, 0.6 );
+  EXPECT_EQ( 2, poly.get_numPolys() );
+  poly.markPolysIntersectingBox( 1.5, 0.2, 1.6, 0.5, mark );
+  ASSERT_EQ( 1u, mark.size() );
+  EXPECT_TRUE( mark.count(1) );
+}
+
+TEST( dPoly, IndexFollowsEdits ) {
+  std::srand( 7 );
+  dPoly poly;
+  append_random_polys( poly, 500 );
+  for ( int q = 0; q < 50; ++q )
+    expect_closest_vertex( poly, 0.25 * ( std::rand() % 900 ) - 10, 0.25 * ( std::rand() % 900 ) - 10 );
+
+  // A few appended polygons and then many, after the index is built.
+  append_random_polys( poly, 5 );
+  expect_closest_vertex( poly, 100, 100 );
+  append_random_polys( poly, 300 );
+  expect_closest_vertex( poly, 150.25, 20 );
+
+  poly.erasePolysIntersectingBox( 50, 50, 120, 120 );
+  expect_closest_vertex( poly, 80, 80 );
+
+  poly.changeVertexValue( 7, 0, 1000, 1000 );
+  expect_closest_vertex( poly, 990, 1001 );
+
+  poly.get_xv()[0] = -500;
+  expect_closest_vertex( poly, -499, 3 );
+
+  // Writing through a pointer kept across a query needs an explicit invalidate.
+  double * xv = poly.get_xv();
+  expect_closest_vertex( poly, -499, 3 );
+  xv[0] = 2000;
+  poly.invalidateIndex();
+  expect_closest_vertex( poly, 1999, 3 );
+
+  int poly_index, vert_index;
+  double min_x, min_y, min_dist;
+  poly.findClosestPolyEdge( 1000, 990, poly_index, vert_index, min_x, min_y, min_dist );
+  EXPECT_EQ( 7, poly_index );
+
+  dPoly empty;
+  empty.findClosestPolyVertex( 0, 0, poly_index, vert_index, min_x, min_y, min_dist );
+  EXPECT_EQ( -1, poly_index );
+  EXPECT_EQ( DBL_MAX, min_dist );
+}
+
+TEST( dPoly, IndexFollowsSinglePolyEdits ) {
+  std::srand( 11 );
+  dPoly poly;
+  append_random_polys( poly, 600 );
+  expect_closest_vertex( poly, 100, 100 );
+
+  // Enough edits, with queries between them, for the tree to be kept
+  // for a while and then rebuilt.
+  for ( int i = 0; i < 300; ++i ) {
+    int p = std::rand() % poly.get_numPolys();
+    int n = poly.get_numVerts()[p];
+    double x = 0.25 * ( std::rand() % 900 ) - 10, y = 0.25 * ( std::rand() % 900 ) - 10;
+    switch ( i % 7 ) {
+    case 0: poly.insertVertex( p, std::rand() % ( n + 1 ), x, y ); break;
+    case 1: if ( n > 1 ) poly.eraseVertex( p, std::rand() % n ); break;
+    case 2: poly.changeVertexValue( p, std::rand() % n, x, y ); break;
+    case 3: poly.shiftEdge( p, std::rand() % n, 40, -30 ); break;
+    case 4: poly.shiftOnePoly( p, -60, 25 ); break;
+    case 5: { double xv[3] = { x, x + 2, x }, yv[3] = { y, y, y + 2 };
+              poly.replaceOnePoly( p, 3, xv, yv ); } break;
+    case 6: poly.eraseOnePoly( p ); break;
+    }
+    if ( i % 20 == 19 )
+      append_random_polys( poly, 3 );
+    expect_closest_vertex( poly, 0.25 * ( std::rand() % 900 ) - 10, 0.25 * ( std::rand() % 900 ) - 10 );
+  }
+
+  // The closest edge and the polygons in a box agree with a plain scan.
+  for ( int q = 0; q < 20; ++q ) {
+    double x0 = 0.25 * ( std::rand() % 900 ) - 10, y0 = 0.25 * ( std::rand() % 900 ) - 10;
+    int poly_index, vert_index;
+    double min_x, min_y, min_dist;
+    poly.findClosestPolyEdge( x0, y0, poly_index, vert_index, min_x, min_y, min_dist );
+    double expected_dist = DBL_MAX;
+    int start = 0;
+    for ( int p = 0; p < poly.get_numPolys(); ++p ) {
+      int n = poly.get_numVerts()[p];
+      for ( int v = 0; v < n; ++v ) {
+        double x, y, dist;
+        int b = start + v, e = start + ( v + 1 ) % n;
+        minDistFromPtToSeg( x0, y0, poly.get_xv()[b], poly.get_yv()[b],
+                            poly.get_xv()[e], poly.get_yv()[e], x, y, dist );
+        expected_dist = std::min( expected_dist, dist );
+      }
+      start += n;
+    }
+    EXPECT_EQ( expected_dist, min_dist );
+
+    std::map<int, int> mark;
+    poly.markPolysIntersectingBox( x0, y0, x0 + 20, y0 + 20, mark );
+    std::map<int, int> expected;
+    for ( int p = 0; p < poly.get_numPolys(); ++p ) {
+      dPoly one, clipped;
+      poly.extractOnePoly( p, one );
+      one.clipPoly( x0, y0, x0 + 20, y0 + 20, clipped );
+      if ( clipped.get_totalNumVerts() > 0 ) expected[p] = 1;
+    }
+    EXPECT_EQ( expected, mark );
+  }
+}
@@ -30,12 +30,86 @@
 #ifndef __VW_HDR_GLOBALTONEMAP_H__
 #define __VW_HDR_GLOBALTONEMAP_H__
 
+#include <vw/Core/Settings.h>
+#include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
+#include <vw/Image/AlgorithmFunctions.h>
 #include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
 #include <vw/Image/PerPixelViews.h>
+#include <vw/Image/PixelTypes.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <limits>
+#include <vector>
 
 namespace vw {
 namespace hdr {
 
+  namespace detail {
+
+    /// Folds the luminance range of one tile of an image into the
+    /// range shared by all the tiles.
+    template <class ViewT>
+    class LuminanceRangeTask : public Task {
+      ViewT const& m_image;
+      BBox2i m_bbox;
+      double &m_min, &m_max;
+      Mutex& m_mutex;
+
+    public:
+      LuminanceRangeTask( ViewT const& image, BBox2i const& bbox,
+                          double& L_min, double& L_max, Mutex& mutex )
+        : m_image(image), m_bbox(bbox), m_min(L_min), m_max(L_max), m_mutex(mutex) {}
+
+      virtual ~LuminanceRangeTask() {}
+
+      virtual void operator()() {
+        ImageView<PixelGray<double> > tile = pixel_cast<PixelGray<double> >( crop( m_image, m_bbox ) );
+        double L_min = std::numeric_limits<double>::max(), L_max = -L_min;
+        for ( int32 row = 0; row < tile.rows(); ++row )
+          for ( int32 col = 0; col < tile.cols(); ++col ) {
+            double L = tile(col,row).v();
+            if ( L < L_min ) L_min = L;
+            if ( L > L_max ) L_max = L;
+          }
+
+        Mutex::Lock lock( m_mutex );
+        if ( L_min < m_min ) m_min = L_min;
+        if ( L_max > m_max ) m_max = L_max;
+      }
+    };
+  }
+
+  /// Finds the smallest and largest luminance in an image, reading it
+  /// a tile at a time on num_threads threads (or the default number
+  /// of threads if zero).  This is the cheap first pass that the
+  /// streaming tone mapping operators need before they can start
+  /// writing tiles.
+  template <class ViewT>
+  void luminance_range( ImageViewBase<ViewT> const& hdr_image, double& L_wmin, double& L_wmax,
+                        int32 num_threads = 0 ) {
+    VW_ASSERT( hdr_image.impl().cols() > 0 && hdr_image.impl().rows() > 0,
+               ArgumentErr() << "luminance_range: the image is empty." );
+    if ( num_threads <= 0 )
+      num_threads = vw_settings().default_num_threads();
+    int32 tile_size = vw_settings().default_tile_size();
+
+    L_wmin = std::numeric_limits<double>::max();
+    L_wmax = -L_wmin;
+    Mutex mutex;
+    std::vector<BBox2i> tiles = subdivide_bbox( hdr_image, tile_size, tile_size );
+    FifoWorkQueue queue( num_threads );
+    for ( size_t i = 0; i < tiles.size(); ++i ) {
+      boost::shared_ptr<detail::LuminanceRangeTask<ViewT> >
+        task( new detail::LuminanceRangeTask<ViewT>( hdr_image.impl(), tiles[i], L_wmin, L_wmax, mutex ) );
+      queue.add_task( task );
+    }
+    queue.join_all();
+  }
+
   const float DRAGO_DEFAULT_BIAS = 0.85;
 
   template <class PixelT>
@@ -64,7 +138,7 @@ namespace hdr {
 
     // Compute range of luminances
     double L_wmax, L_wmin;
-    min_max_channel_values(pixel_cast<PixelGray<double> >(hdr_image), L_wmin, L_wmax);
+    luminance_range(hdr_image, L_wmin, L_wmax);
 
     // Create the tone mapping functor and return a UnaryPerPixelView
     //
@@ -23,15 +23,98 @@
 ///
 /// This file implements the following tone mapping operators.
 ///
+/// - Ashikhmin Local Tonemap Operator
 ///
 #ifndef __VW_HDR_LOCALTONEMAP_H__
 #define __VW_HDR_LOCALTONEMAP_H__
 
 #include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelTypes.h>
+#include <vw/HDR/GlobalToneMap.h>
 
 namespace vw {
 namespace hdr {
 
+  namespace detail {
+
+    /// How far, in pixels, the widest blur of the Ashikhmin operator
+    /// reaches from the pixel it is centered on.
+    const int32 ASHIKHMIN_HALO = 10;
+
+    /// Tone maps the pixels of hdr_image inside bbox, which must lie
+    /// at least ASHIKHMIN_HALO pixels away from its edges.
+    void ashikhmin_tone_map( ImageView<PixelRGB<double> > const& hdr_image, BBox2i const& bbox,
+                             double L_wmin, double L_wmax, double threshold,
+                             ImageView<PixelRGB<double> >& result );
+  }
+
+  /// Ashikhmin's local tone mapping operator, computed a tile at a
+  /// time so that it can be written with block_write_image().
+  /// - Each tile is read with a halo wide enough for the largest
+  ///   local adaptation blur, so the tiles agree exactly with a
+  ///   tone mapping of the whole image.
+  /// - L_wmin and L_wmax are the luminance range of the whole image,
+  ///   as found by luminance_range().
+  /// - The display luminances run from zero to one.  Unlike
+  ///   ashikhmin_tone_map() on an ImageView, the result is not
+  ///   rescaled to fill that range, which would need a second pass.
+  template <class ImageT>
+  class AshikhminToneMapView : public ImageViewBase<AshikhminToneMapView<ImageT> > {
+    ImageT m_image;
+    double m_L_wmin, m_L_wmax, m_threshold;
+
+  public:
+    typedef PixelRGB<double> pixel_type;
+    typedef pixel_type       result_type;
+    typedef ProceduralPixelAccessor<AshikhminToneMapView> pixel_accessor;
+
+    AshikhminToneMapView( ImageT const& image, double L_wmin, double L_wmax, double threshold )
+      : m_image(image), m_L_wmin(L_wmin), m_L_wmax(L_wmax), m_threshold(threshold) {}
+
+    inline int32 cols  () const { return m_image.cols(); }
+    inline int32 rows  () const { return m_image.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this, 0, 0); }
+    inline result_type operator()( int32 i, int32 j, int32 p=0 ) const {
+      return prerasterize(BBox2i(i,j,1,1))(i,j,p);
+    }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      BBox2i hdr_box = bbox;
+      hdr_box.expand( detail::ASHIKHMIN_HALO );
+      ImageView<pixel_type> hdr =
+        pixel_cast<pixel_type>( crop( edge_extend( m_image, ConstantEdgeExtension() ), hdr_box ) );
+
+      ImageView<pixel_type> output;
+      detail::ashikhmin_tone_map( hdr, BBox2i( detail::ASHIKHMIN_HALO, detail::ASHIKHMIN_HALO,
+                                               bbox.width(), bbox.height() ),
+                                  m_L_wmin, m_L_wmax, m_threshold, output );
+      return crop( output, -bbox.min().x(), -bbox.min().y(), cols(), rows() );
+    }
+
+    template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+  };
+
+  /// Ashikhmin's local tone mapping operator over an image of any size;
+  /// see AshikhminToneMapView.  The luminance range of the image is
+  /// found first, in parallel.
+  template <class ImageT>
+  AshikhminToneMapView<ImageT>
+  inline ashikhmin_tone_map_view( ImageViewBase<ImageT> const& hdr_image, double threshold = 0.5 ) {
+    double L_wmin, L_wmax;
+    luminance_range( hdr_image, L_wmin, L_wmax );
+    return AshikhminToneMapView<ImageT>( hdr_image.impl(), L_wmin, L_wmax, threshold );
+  }
+
+  /// Ashikhmin's local tone mapping operator, rescaled so that the
+  /// result fills the range from zero to one.
   ImageView<PixelRGB<double> > ashikhmin_tone_map(ImageView<PixelRGB<double> > hdr_image,
                                                   double threshold = 0.5);
 
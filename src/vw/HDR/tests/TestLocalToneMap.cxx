@@ -0,0 +1,92 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/HDR/LocalToneMap.h>
+#include <vw/HDR/GlobalToneMap.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/Statistics.h>
+
+using namespace vw;
+using namespace vw::hdr;
+
+namespace {
+
+  // A bright window next to a dark room, with some texture in both.
+  ImageView<PixelRGB<double> > hdr_scene( int32 cols, int32 rows ) {
+    ImageView<PixelRGB<double> > image( cols, rows );
+    for ( int32 y = 0; y < rows; ++y )
+      for ( int32 x = 0; x < cols; ++x ) {
+        double base    = ( x > cols/2 && y < rows/2 ) ? 500.0 : 0.05;
+        double texture = 1.0 + 0.5*sin(x*0.7)*cos(y*0.4);
+        image(x,y) = PixelRGB<double>( base*texture, 0.8*base*texture + 0.01*x, base*(2.0 - texture) );
+      }
+    return image;
+  }
+}
+
+TEST( LocalToneMap, LuminanceRange ) {
+  ImageView<PixelRGB<double> > image = hdr_scene( 53, 37 );
+  double expected_min, expected_max;
+  min_max_channel_values( pixel_cast<PixelGray<double> >(image), expected_min, expected_max );
+
+  double L_min, L_max;
+  for ( int32 threads = 1; threads <= 3; threads += 2 ) {
+    luminance_range( image, L_min, L_max, threads );
+    EXPECT_EQ( expected_min, L_min );
+    EXPECT_EQ( expected_max, L_max );
+  }
+
+  ImageView<PixelRGB<double> > empty;
+  EXPECT_THROW( luminance_range( empty, L_min, L_max ), ArgumentErr );
+}
+
+TEST( LocalToneMap, TilesMatchWhole ) {
+  ImageView<PixelRGB<double> > image = hdr_scene( 53, 37 );
+  double L_min, L_max;
+  luminance_range( image, L_min, L_max );
+
+  // A single tile covering the whole image is the untiled operator.
+  AshikhminToneMapView<ImageView<PixelRGB<double> > > view( image, L_min, L_max, 0.5 );
+  ImageView<PixelRGB<double> > whole = view;
+  ImageView<PixelRGB<double> > tiled = block_rasterize( view, Vector2i(8,8) );
+  for ( int32 y = 0; y < image.rows(); ++y )
+    for ( int32 x = 0; x < image.cols(); ++x )
+      for ( int32 c = 0; c < 3; ++c )
+        ASSERT_EQ( whole(x,y)[c], tiled(x,y)[c] ) << "at " << x << "," << y;
+
+  EXPECT_EQ( whole(20,30), view(20,30) );
+}
+
+TEST( LocalToneMap, Ashikhmin ) {
+  ImageView<PixelRGB<double> > image = hdr_scene( 53, 37 );
+  ImageView<PixelRGB<double> > mapped = ashikhmin_tone_map( image );
+  double low, high;
+  min_max_channel_values( mapped, low, high );
+  EXPECT_DOUBLE_EQ( 0, low );
+  EXPECT_DOUBLE_EQ( 1, high );
+
+  // The window is still brighter than the room, but by far less than
+  // its thousandfold difference in luminance.
+  double room   = PixelGray<double>( mapped(10,30) ).v();
+  double window = PixelGray<double>( mapped(40,10) ).v();
+  EXPECT_GT( window, room );
+  EXPECT_LT( window, 100*room );
+}
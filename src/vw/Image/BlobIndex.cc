@@ -24,77 +24,79 @@
 #include <vw/Core/ThreadPool.h>
 #include <vw/Image/BlobIndex.h>
 
-#include <math.h>
-
-#include <boost/foreach.hpp>
+#include <algorithm>
+#include <utility>
 
 namespace vw {
 
 namespace blob {
 
 void BlobCompressed::shift_x( int32 const& value ) {
-  for ( uint32 i = 0; i < m_row_end.size(); i++ )
-    for ( std::list<int32>::iterator iter_start = m_row_start[i].begin(),
-            iter_end = m_row_end[i].begin(); iter_start != m_row_start[i].end();
-          iter_start++, iter_end++ ) {
-      *iter_start -= value;
-      *iter_end -= value;
-    }
-  m_min[0] += value;
-}
-
-void BlobCompressed::refactor() {
-  for ( uint32 i = 0; i < m_row_end.size(); i++ ) {
-    std::list<int32>::iterator iter_n_start = m_row_start[i].begin(),
-      iter_end = m_row_end[i].begin();
-    iter_n_start++;
-    while ( iter_n_start != m_row_start[i].end() ) {
-      if ( *iter_n_start == *iter_end ) {
-        iter_n_start = m_row_start[i].erase( iter_n_start );
-        iter_end = m_row_end[i].erase( iter_end );
-      } else {
-        iter_n_start++;
-        iter_end++;
-      }
-    }
+  for ( size_t i = 0; i < m_start.size(); i++ ) {
+    m_start[i] -= value;
+    m_end[i]   -= value;
   }
+  m_min[0] += value;
+  m_width  -= value;
 }
 
 BlobCompressed::BlobCompressed( Vector2i const& top_left,
                                 std::vector<std::list<int32> > const& row_start,
                                 std::vector<std::list<int32> > const& row_end ) :
-  m_min(top_left), m_row_start(row_start), m_row_end(row_end) {
-  VW_DEBUG_ASSERT( row_start.size() == row_end.size(),
-                   InputErr() << "Input vectors do not have the same length." );
+  m_min(top_left), m_size(0), m_width(0) {
+  VW_ASSERT( row_start.size() == row_end.size(),
+             InputErr() << "Input vectors do not have the same length." );
+  m_row_offset.reserve( row_start.size()+1 );
+  m_row_offset.push_back( 0 );
   for ( size_t i = 0; i < row_start.size(); i++ ) {
-    VW_DEBUG_ASSERT( row_start[i].size() == row_end[i].size(),
-                     InputErr() << "List at row " << i << " doesn't have matched starts and ends." );
+    VW_ASSERT( row_start[i].size() == row_end[i].size(),
+               InputErr() << "List at row " << i << " doesn't have matched starts and ends." );
+    m_start.insert( m_start.end(), row_start[i].begin(), row_start[i].end() );
+    m_end.insert  ( m_end.end(),   row_end[i].begin(),   row_end[i].end()   );
+    m_row_offset.push_back( int32(m_start.size()) );
+  }
+  for ( size_t i = 0; i < m_start.size(); i++ ) {
+    m_size += m_end[i] - m_start[i];
+    m_width = std::max( m_width, m_end[i] );
   }
 }
 
-BlobCompressed::BlobCompressed() : m_min(-1,-1) {}
-
-int32 BlobCompressed::size() const {
-  int32 sum = 0;
-  for ( uint32 r = 0; r < m_row_end.size(); r++ )
-    for ( std::list<int32>::const_iterator iter_start = m_row_start[r].begin(),
-            iter_end = m_row_end[r].begin(); iter_start != m_row_start[r].end();
-          iter_start++, iter_end++ )
-      sum += *iter_end - *iter_start;
-  return sum;
+BlobCompressed::BlobCompressed() : m_min(-1,-1), m_size(0), m_width(0) {}
+
+void BlobCompressed::reset( BBox2i const& bbox, int32 num_runs ) {
+  m_min   = bbox.min();
+  m_size  = 0;
+  m_width = 0;
+  m_row_offset.clear();
+  m_row_offset.reserve( bbox.height()+1 );
+  m_row_offset.push_back( 0 );
+  m_start.clear();
+  m_end.clear();
+  m_start.reserve( num_runs );
+  m_end.reserve( num_runs );
 }
 
+int32 BlobCompressed::size() const { return m_size; }
+
 Vector2i const& BlobCompressed::min() const { return m_min; }
 
 Vector2i & BlobCompressed::min() { return m_min; }
 
-int32 BlobCompressed::num_rows() const { return m_row_start.size(); }
+int32 BlobCompressed::num_rows() const {
+  return m_row_offset.empty() ? 0 : int32(m_row_offset.size()) - 1;
+}
+
+int32 BlobCompressed::num_runs( int32 row ) const {
+  return m_row_offset[row+1] - m_row_offset[row];
+}
 
-std::list<int32> const&
-BlobCompressed::start( uint32 const& index ) const { return m_row_start[index]; }
+int32 BlobCompressed::run_start( int32 row, int32 run ) const {
+  return m_start[m_row_offset[row] + run];
+}
 
-std::list<int32> const&
-BlobCompressed::end( uint32 const& index ) const { return m_row_end[index]; }
+int32 BlobCompressed::run_end( int32 row, int32 run ) const {
+  return m_end[m_row_offset[row] + run];
+}
 
 // Access points to intersting information
 uint32 BlobIndex::num_blobs() const { return m_blob_count; }
@@ -104,457 +106,431 @@ BlobCompressed const&
 BlobIndex::blob( uint32 const& index ) const { return m_c_blob[index]; }
 
 BBox2i BlobCompressed::bounding_box() const {
-  BBox2i bbox;
-  bbox.min() = m_min;
-  int32 max_col = 0;
-  for ( uint32 i = 0; i < m_row_end.size(); i++ )
-    for ( std::list<int32>::const_iterator iter = m_row_end[i].begin();
-          iter != m_row_end[i].end(); iter++ )
-      if ( *iter > max_col )
-        max_col = *iter;
-  bbox.max() = Vector2i(m_min.x()+max_col,m_min.y()+m_row_start.size());
-  return bbox;
+  return BBox2i( m_min.x(), m_min.y(), m_width, num_rows() );
 }
 
 bool BlobCompressed::intersects( BBox2i const& input ) const {
   // Check if Y's overlap.
   if ( input.max().y() <= m_min.y() ||
-       input.min().y() >= m_min.y() + int32(m_row_start.size()) )
+       input.min().y() >= m_min.y() + num_rows() )
     return false;
 
   // Check X for each row.
-  for ( size_t i = 0; i < m_row_start.size(); i++ ) {
-    if ( !m_row_start[i].size() ||
-         m_min.y() + int32(i) < input.min().y() ||
-         m_min.y() + int32(i) >= input.max().y() )
-      continue;
-    if ( m_row_end[i].back() + m_min.x() > input.min().x() &&
-         m_row_start[i].front() + m_min.x() < input.max().x() ) {
-      return true;
-    }
-  }
-  return false;
-}
-
-bool BlobCompressed::is_on_right( BlobCompressed const& right ) const {
-  int32 y_offset = m_min.y()-right.min().y()-1;
-  // Starting r_i on the index above
-  for( int32 i = 0, r_i = y_offset;
-       (i < int32(m_row_end.size()))&&(r_i < right.num_rows());
-       i++, r_i++ ) {
-    if ( r_i >= 0 && r_i < int32(right.num_rows()) )
-      if ( m_row_end[i].back() + m_min.x() ==
-           right.m_row_start[r_i].front()+right.min().x() )
-        return true;
-    if ( r_i+1 >= 0 && r_i+1 < int32(right.num_rows()) )
-      if ( m_row_end[i].back() + m_min.x() ==
-           right.m_row_start[r_i+1].front()+right.min().x() )
-        return true;
-    if ( r_i+2 >= 0 && r_i+2 < int32(right.num_rows()) )
-      if ( m_row_end[i].back() + m_min.x() ==
-           right.m_row_start[r_i+2].front()+right.min().x() )
+  int32 first = std::max( input.min().y() - m_min.y(), 0 );
+  int32 last  = std::min( input.max().y() - m_min.y(), num_rows() );
+  for ( int32 r = first; r < last; r++ )
+    for ( int32 k = m_row_offset[r]; k < m_row_offset[r+1]; k++ )
+      if ( m_end[k] + m_min.x() > input.min().x() &&
+           m_start[k] + m_min.x() < input.max().x() )
         return true;
-  }
-  return false;
-}
-
-bool BlobCompressed::is_on_bottom( BlobCompressed const& bottom ) const {
-  if ( bottom.min().y() != m_min.y()+int32(m_row_start.size()) )
-    return false;
-  // Are the rows connected ?
-  for ( std::list<int32>::const_iterator top_start = m_row_start.back().begin(),
-          top_end = m_row_end.back().begin(); top_start != m_row_start.back().end();
-        top_start++, top_end++ )
-    for ( std::list<int32>::const_iterator bot_start = bottom.m_row_start[0].begin(),
-            bot_end = bottom.m_row_end[0].begin(); bot_start != bottom.m_row_start[0].end();
-          bot_start++, bot_end++ ) {
-      if ( (*top_end+m_min.x() >= *bot_start + bottom.min().x()) &&
-           (*top_start+m_min.x() <= *bot_end+bottom.min().x()) )
-        return true;
-    }
   return false;
 }
 
 void BlobCompressed::add_row( Vector2i const& start,
                               int const& width ) {
-  if ( m_min[0] == -1 ) {
+  if ( m_row_offset.empty() ) {
     // First insertion
     m_min = start;
-    m_row_start.resize(1);
-    m_row_end.resize(1);
-    m_row_start[0].push_back(0);
-    m_row_end[0].push_back(width);
-  } else { // If not first
-    if ( !( (start.y() == m_min.y()+int32(m_row_start.size()) ) ||
-            (start.y() == m_min.y()+int32(m_row_start.size())-1) ) )
-      vw_throw(NoImplErr() << "Add_row expects rows to be added in order.\n" );
-    if ( start.y() == m_min.y()+int32(m_row_start.size()) ) {
-      m_row_start.resize(m_row_start.size()+1);
-      m_row_end.resize(m_row_start.size());
-    } else if ( (start.x() < m_row_start.back().back()+m_min.x()) &&
-                !m_row_start.back().empty() ) {
-      // If we are not appending, check to see if were adding to this row in order
-      vw_out(ErrorMessage) << "start: " << start << " w: " << width << std::endl;
-      vw_out(ErrorMessage) << "front() = " <<  m_row_start.back().back() << std::endl;
-      vw_out(ErrorMessage) << "min.x() << " << m_min.x() << std::endl;
-      vw_throw(NoImplErr() << "It appears a segment is trying to be inserted out of order.\n" );
-    }
+    m_row_offset.push_back( 0 );
+  }
 
-    m_row_start.back().push_back(start.x()-m_min.x());
-    m_row_end.back().push_back(start.x()-m_min.x()+width);
-    if ( m_min.x() > start.x() ) {
-      int32 offset = start.x()-m_min.x();
-      this->shift_x(offset); // I guess this is really only need at the end
-    }
+  int32 row = start.y() - m_min.y();
+  if ( row == num_rows() ) {
+    m_row_offset.push_back( m_row_offset.back() );
+  } else if ( row != num_rows()-1 ) {
+    vw_throw(NoImplErr() << "Add_row expects rows to be added in order.\n" );
+  } else if ( m_row_offset[row+1] > m_row_offset[row] &&
+              start.x() < m_end.back() + m_min.x() ) {
+    vw_out(ErrorMessage) << "start: " << start << " w: " << width << std::endl;
+    vw_out(ErrorMessage) << "last end = " << m_end.back() << std::endl;
+    vw_out(ErrorMessage) << "min.x() << " << m_min.x() << std::endl;
+    vw_throw(NoImplErr() << "It appears a segment is trying to be inserted out of order.\n" );
+  }
 
+  if ( start.x() < m_min.x() )
+    this->shift_x( start.x() - m_min.x() );
+
+  int32 begin = start.x() - m_min.x();
+  if ( m_row_offset[row+1] > m_row_offset[row] && m_end.back() == begin ) {
+    // Touches the last run of the row
+    m_end.back() += width;
+  } else {
+    m_start.push_back( begin );
+    m_end.push_back( begin + width );
+    m_row_offset.back()++;
   }
+  m_size += width;
+  m_width = std::max( m_width, m_end.back() );
 }
 
 void BlobCompressed::absorb( BlobCompressed const& victim ) {
 
   // First check to see if I'm empty
-  if ( m_row_start.empty() ) {
-    m_min = victim.min();
-    for ( int i = 0; i < victim.num_rows(); i++ ) {
-      m_row_start.push_back( victim.m_row_start[i] );
-      m_row_end.push_back( victim.m_row_end[i] );
-    }
+  if ( victim.num_rows() == 0 )
+    return;
+  if ( num_rows() == 0 ) {
+    *this = victim;
     return;
   }
 
-  // Normal operations
-  int y_offset =- m_min.y() + victim.min().y();
-  for ( int i = 0; i < victim.num_rows(); i++ ) {
-    // Index i is in terms of the victim
-    // m_index is in terms of this
-    int m_index = y_offset+i;
-
-    // Checking if can insert
-    if ( m_index >= 0 && m_index < int32(m_row_start.size()) ) {
-
-      // Inserting victim's connected rows in singletons at a time
-      // become sometimes they connect like zippers.
-      for ( std::list<int32>::const_iterator v_singleton_start = victim.m_row_start[i].begin(),
-              v_singleton_end = victim.m_row_end[i].begin(); v_singleton_start != victim.m_row_start[i].end();
-            v_singleton_start++, v_singleton_end++ ) {
-
-        std::list<int32>::iterator start_insertion_point = m_row_start[m_index].begin(),
-          end_insertion_point = m_row_end[m_index].begin(),
-          start_lookahead = m_row_start[m_index].begin();
-        bool found_good_spot = false;
-        if ( m_row_start[m_index].empty()  )
-          found_good_spot = true;
-        else if ( *v_singleton_end+victim.min().x()-m_min.x() <=
-                  m_row_start[m_index].front() )
-          found_good_spot = true;
-        else {
-          start_lookahead++;
-        }
-        while ( start_lookahead != m_row_start[m_index].end() &&
-                !found_good_spot ) {
-          if ( (*v_singleton_start+victim.min().x()-m_min.x() >=
-                *end_insertion_point ) &&
-               (*v_singleton_end+victim.min().x()-m_min.x() <=
-                *start_lookahead ) ) {
-            found_good_spot = true;
-          }
-          start_insertion_point++;
-          end_insertion_point++;
-          start_lookahead++;
-        }
-        // If insert on end
-        if ( (start_lookahead == m_row_start[m_index].end()) &&
-             !found_good_spot ) {
-          if ( *v_singleton_start+victim.min().x()-m_min.x() >=
-               *end_insertion_point ) {
-            found_good_spot = true;
-            start_insertion_point++;
-            end_insertion_point++;
-          }
-        }
-        // Checking for error and debug
-        if ( !found_good_spot ) {
-          vw_out() << "index =  " << m_index << std::endl;
-          vw_out() << "Have: min[" << m_min << "] ";
-          for ( std::list<int32>::const_iterator m_i_str = m_row_start[m_index].begin(),
-                  m_i_end = m_row_end[m_index].begin();
-                m_i_str != m_row_start[m_index].end(); m_i_str++, m_i_end++ )
-            vw_out() << "(" << *m_i_str << "-" << *m_i_end << ")";
-          vw_out() << "\nTrying to insert singleton: (" << *v_singleton_start << "-"
-                   << *v_singleton_end << ")\n";
-
-          vw_throw( NoImplErr() << "BlobCompressed: Seems to be inserting an overlapping blob compressed object.\n" );
-        }
-        // Inserting ( but apply offset fix first)
-        // Is there a simpler way of inserting, without making an intermediate
-        { // Start
-          std::list<int32> temp;
-          temp.push_back( *v_singleton_start+victim.min().x()-m_min.x() );
-          m_row_start[m_index].insert(start_insertion_point,
-                                      temp.begin(),temp.end() );
-        }
-        { // End
-          std::list<int32> temp;
-          temp.push_back( *v_singleton_end+victim.min().x()-m_min.x() );
-          m_row_end[m_index].insert(end_insertion_point,
-                                    temp.begin(), temp.end() );
-        }
-      }
+  // Merge the runs of both blobs a row at a time, in image columns.
+  int32 top    = std::min( m_min.y(), victim.m_min.y() );
+  int32 bottom = std::max( m_min.y() + num_rows(), victim.m_min.y() + victim.num_rows() );
+  std::vector<int32> row_offset, starts, ends;
+  row_offset.reserve( bottom - top + 1 );
+  starts.reserve( m_start.size() + victim.m_start.size() );
+  ends.reserve  ( m_start.size() + victim.m_start.size() );
+  row_offset.push_back( 0 );
+  for ( int32 y = top; y < bottom; y++ ) {
+    int32 r = y - m_min.y(), v_r = y - victim.m_min.y();
+    int32 k = 0, k_end = 0, v_k = 0, v_k_end = 0;
+    if ( r >= 0 && r < num_rows() ) {
+      k     = m_row_offset[r];
+      k_end = m_row_offset[r+1];
     }
-  }
-  // Now handle the rows that didn't previously exist
-  // > Insert any on top?
-  if ( victim.min().y() < m_min.y() ) {
-    std::vector<std::list<int32> > temp_start;
-    std::vector<std::list<int32> > temp_end;
-    for ( int v_i = 0; v_i < m_min.y()-victim.min().y(); v_i++ ) {
-      if ( v_i < victim.num_rows() ) {
-        temp_start.push_back(victim.m_row_start[v_i]);
-        temp_end.push_back(victim.m_row_end[v_i]);
-        for ( std::list<int32>::iterator i_start = temp_start.back().begin(),
-                i_stop = temp_end.back().begin();
-              i_start != temp_start.back().end(); i_start++, i_stop++ ) {
-          *i_start += victim.min().x()-m_min.x();
-          *i_stop += victim.min().x()-m_min.x();
-        }
+    if ( v_r >= 0 && v_r < victim.num_rows() ) {
+      v_k     = victim.m_row_offset[v_r];
+      v_k_end = victim.m_row_offset[v_r+1];
+    }
+    int32 row_begin = int32(starts.size());
+    while ( k < k_end || v_k < v_k_end ) {
+      int32 s, e;
+      if ( v_k == v_k_end ||
+           ( k < k_end && m_start[k] + m_min.x() < victim.m_start[v_k] + victim.m_min.x() ) ) {
+        s = m_start[k] + m_min.x();
+        e = m_end[k]   + m_min.x();
+        k++;
       } else {
-        // Blank filling. This happens when building a blob from many
-        // that happen out of connection order. Think a U rotated 90
-        // to the left.
-        temp_start.push_back(std::list<int32>());
-        temp_end.push_back(std::list<int32>());
+        s = victim.m_start[v_k] + victim.m_min.x();
+        e = victim.m_end[v_k]   + victim.m_min.x();
+        v_k++;
       }
-    }
-    m_row_start.insert( m_row_start.begin(),
-                        temp_start.begin(),
-                        temp_start.end() );
-    m_row_end.insert( m_row_end.begin(),
-                      temp_end.begin(),
-                      temp_end.end() );
-    m_min.y()=victim.min().y();
-  }
-  // > Insert any on bottom?
-  if ( victim.num_rows()+victim.min().y() >
-       m_min.y() + int32(m_row_end.size()) ) {
-    std::vector<std::list<int32> > temp_start;
-    std::vector<std::list<int32> > temp_end;
-    for ( int v_i = m_row_end.size()+m_min.y()-victim.min().y();
-          v_i < victim.num_rows(); v_i++ ) {
-      if ( v_i < 0 ) {
-        // Blank filling
-        temp_start.push_back(std::list<int32>());
-        temp_end.push_back(std::list<int32>());
+      if ( int32(starts.size()) > row_begin && s < ends.back() ) {
+        vw_out() << "row =  " << y << std::endl;
+        vw_out() << "Trying to insert singleton: (" << s << "-" << e
+                 << ") after (" << starts.back() << "-" << ends.back() << ")\n";
+        vw_throw( NoImplErr() << "BlobCompressed: Seems to be inserting an overlapping blob compressed object.\n" );
+      }
+      if ( int32(starts.size()) > row_begin && s == ends.back() ) {
+        ends.back() = e;
       } else {
-        temp_start.push_back( victim.m_row_start[v_i] );
-        temp_end.push_back( victim.m_row_end[v_i] );
-        for ( std::list<int32>::iterator i_start = temp_start.back().begin(),
-                i_stop = temp_end.back().begin();
-              i_start != temp_start.back().end(); i_start++, i_stop++ ) {
-          *i_start += victim.min().x()-m_min.x();
-          *i_stop += victim.min().x()-m_min.x();
-        }
+        starts.push_back( s );
+        ends.push_back( e );
       }
     }
-    m_row_start.insert( m_row_start.end(),
-                        temp_start.begin(),
-                        temp_start.end() );
-    m_row_end.insert( m_row_end.end(),
-                      temp_end.begin(),
-                      temp_end.end() );
+    row_offset.push_back( int32(starts.size()) );
   }
-  // Recalculate min.x()
-  size_t valid_first = 0;
-  while ( valid_first < m_row_start.size() ) {
-    if ( m_row_start[valid_first].size() )
-      break;
-    valid_first++;
-  }
-  int32 lowest_value = m_row_start[valid_first].front();
-  for (size_t i = ++valid_first; i < m_row_start.size(); i++ ) {
-    if ( m_row_start[i].front() < lowest_value )
-      lowest_value = m_row_start[i].front();
+
+  // Back to columns relative to the leftmost pixel
+  int32 left = *std::min_element( starts.begin(), starts.end() );
+  m_width = 0;
+  for ( size_t i = 0; i < starts.size(); i++ ) {
+    starts[i] -= left;
+    ends[i]   -= left;
+    m_width = std::max( m_width, ends[i] );
   }
-  this->shift_x( lowest_value );
-  this->refactor();
+  m_min = Vector2i( left, top );
+  m_size += victim.m_size;
+  m_row_offset.swap( row_offset );
+  m_start.swap( starts );
+  m_end.swap( ends );
 }
 
-void BlobCompressed::decompress( std::list<Vector2i>& output ) const {
+void BlobCompressed::decompress( std::vector<Vector2i>& output ) const {
   output.clear();
-  for (int32 r = 0; r < int32(m_row_end.size()); r++ )
-    for ( std::list<int32>::const_iterator iter_start = m_row_start[r].begin(),
-            iter_end = m_row_end[r].begin(); iter_start != m_row_start[r].end();
-          iter_start++, iter_end++ )
-      for ( int c = *iter_start; c < *iter_end; c++ )
+  output.reserve( m_size );
+  for ( int32 r = 0; r < num_rows(); r++ )
+    for ( int32 k = m_row_offset[r]; k < m_row_offset[r+1]; k++ )
+      for ( int32 c = m_start[k]; c < m_end[k]; c++ )
         output.push_back( Vector2i(c,r)+m_min );
 }
 
 void BlobCompressed::print() const {
   vw_out() << "BlobCompressed | min: " << m_min << "\n";
-  for ( uint32 i = 0; i < m_row_start.size(); i++ ) {
+  for ( int32 i = 0; i < num_rows(); i++ ) {
     vw_out() << " " << i << "|";
-    for ( std::list<int32>::const_iterator s_iter = m_row_start[i].begin(),
-            e_iter = m_row_end[i].begin(); s_iter != m_row_start[i].end();
-          s_iter++, e_iter++ )
-      vw_out() << "(" << *s_iter << "<>" << *e_iter << ")";
+    for ( int32 k = m_row_offset[i]; k < m_row_offset[i+1]; k++ )
+      vw_out() << "(" << m_start[k] << "<>" << m_end[k] << ")";
     vw_out() <<"\n";
   }
 }
 
-class ConsolidateAbsorbTask : public Task, private boost::noncopyable {
-  std::deque<BlobCompressed> &m_src_c_blob, &m_dest_c_blob;
-  std::deque<BBox2i>& m_dest_blob_bbox;
-  std::vector<uint32>& m_lut;
-  int m_max_area;
-  uint32 m_start_index, m_end_index;
-  Mutex& m_append_mutex;
-public:
-  ConsolidateAbsorbTask( std::deque<BlobCompressed>& src_c_blob,
-                         std::deque<BlobCompressed>& dest_c_blob,
-                         std::deque<BBox2i>& dest_blob_bbox,
-                         std::vector<uint32>& lut, int max_area,
-                         uint32 start, uint32 end, Mutex& mutex ) :
-    m_src_c_blob(src_c_blob), m_dest_c_blob(dest_c_blob),
-    m_dest_blob_bbox(dest_blob_bbox), m_lut(lut),
-    m_max_area(max_area), m_start_index(start),
-    m_end_index(end), m_append_mutex(mutex) {}
-
-  void operator()() {
-    std::deque<BlobCompressed> result_blobs;
-    std::deque<BBox2i> result_bbox;
-
-    std::vector<std::list<uint32> > absorbtion_list( m_end_index - m_start_index );
-
-    // Build the absorbtion list so that we don't have to keep doing
-    // an exhaustive search over m_lut.x
-    for ( size_t i = 0; i < m_lut.size(); i++ ) {
-      if ( m_lut[i] >= m_start_index && m_lut[i] < m_end_index )
-        absorbtion_list[m_lut[i] - m_start_index].push_back(i);
-    }
+void stitch_runs( std::vector<RowRuns> const& chunks, RowRuns& runs ) {
+  runs.row_offset.clear();
+  runs.start.clear();
+  runs.end.clear();
+  if ( chunks.empty() )
+    return;
 
-    // Build the new consolidated blobs
-    for ( size_t i = 0; i < absorbtion_list.size(); i++ ) {
-      // 1: Check to see that the size is going to be less that the
-      // maximium allowed area. Early exit condition.
-      if ( m_max_area > 0 ) {
-        int32 total_size = 0;
-        BOOST_FOREACH( uint32 src_idx, absorbtion_list[i] ) {
-          total_size += m_src_c_blob[src_idx].size();
-          if ( total_size > m_max_area )
-            break;
+  runs.first_row = chunks[0].first_row;
+  size_t total = 0;
+  for ( size_t i = 0; i < chunks.size(); i++ )
+    total += chunks[i].start.size();
+  runs.start.reserve( total );
+  runs.end.reserve( total );
+  runs.row_offset.reserve( chunks[0].row_offset.size() );
+
+  runs.row_offset.push_back( 0 );
+  for ( int32 r = 0; r < chunks[0].num_rows(); r++ ) {
+    int32 row_begin = runs.num_runs();
+    for ( size_t i = 0; i < chunks.size(); i++ ) {
+      RowRuns const& chunk = chunks[i];
+      for ( int32 k = chunk.row_offset[r]; k < chunk.row_offset[r+1]; k++ ) {
+        // A run that crosses into the next chunk arrives in two pieces.
+        if ( runs.num_runs() > row_begin && runs.end.back() == chunk.start[k] ) {
+          runs.end.back() = chunk.end[k];
+        } else {
+          runs.start.push_back( chunk.start[k] );
+          runs.end.push_back( chunk.end[k] );
         }
-        if ( total_size > m_max_area )
-          continue;
       }
+    }
+    runs.row_offset.push_back( runs.num_runs() );
+  }
+}
 
-      // 2: Start absorbing!
-      BlobCompressed current_blob;
-      BOOST_FOREACH( uint32 src_idx, absorbtion_list[i] ) {
-        current_blob.absorb( m_src_c_blob[src_idx] );
-      }
+namespace {
 
-      // 3: Generate the new bounding bbox & Append the results
-      result_blobs.push_back( current_blob );
-      result_bbox.push_back( current_blob.bounding_box() );
+  // The root of a run, halving the path on the way.  Every run points
+  // to an earlier run or to itself.
+  inline int32 find_root( std::vector<int32>& parent, int32 i ) {
+    while ( parent[i] != i ) {
+      parent[i] = parent[parent[i]];
+      i = parent[i];
     }
+    return i;
+  }
 
-    // Finally append the complete results back to the master lists.
-    Mutex::Lock lock( m_append_mutex );
-    m_dest_c_blob.insert( m_dest_c_blob.end(), result_blobs.begin(), result_blobs.end() );
-    m_dest_blob_bbox.insert( m_dest_blob_bbox.end(), result_bbox.begin(), result_bbox.end() );
+  // Joins two sets by pointing the later root at the earlier one.
+  inline void join( std::vector<int32>& parent, int32 a, int32 b ) {
+    a = find_root( parent, a );
+    b = find_root( parent, b );
+    if ( a < b )
+      parent[b] = a;
+    else if ( b < a )
+      parent[a] = b;
   }
-};
 
-} // end namespace blob
+  // Calls join() on each pair of runs, from two consecutive rows, that
+  // touch each other, including diagonally.
+  template <class JoinT>
+  void join_rows( RowRuns const& upper, int32 upper_row, int32 upper_base,
+                  RowRuns const& lower, int32 lower_row, int32 lower_base,
+                  JoinT& joiner ) {
+    int32 a = upper.row_offset[upper_row], a_end = upper.row_offset[upper_row+1];
+    int32 b = lower.row_offset[lower_row], b_end = lower.row_offset[lower_row+1];
+    while ( a < a_end && b < b_end ) {
+      if ( upper.end[a] < lower.start[b] ) {
+        a++;
+      } else if ( lower.end[b] < upper.start[a] ) {
+        b++;
+      } else {
+        joiner( upper_base + a, lower_base + b );
+        // Keep the run that reaches further right, it may touch more.
+        if ( upper.end[a] < lower.end[b] )
+          a++;
+        else
+          b++;
+      }
+    }
+  }
 
-void BlobIndexThreaded::consolidate( Vector2i const& image_size,
-                                     Vector2i const& proc_block_size ) {
-  // Working out divisors
-  uint32 x_divisions = uint32(ceil( float(image_size[0])/float(proc_block_size[0]) ));
-  uint32 y_divisions = uint32(ceil( float(image_size[1])/float(proc_block_size[1]) ));
-  std::vector<uint32> x_div, y_div;
-  for ( uint32 i = 1; i < x_divisions; i++ )
-    x_div.push_back( proc_block_size[0]*i );
-  for ( uint32 i = 1; i < y_divisions; i++ )
-    y_div.push_back( proc_block_size[1]*i );
-
-  // Set up graph
-  typedef boost::adjacency_list<boost::vecS,boost::vecS,boost::undirectedS> Graph;
-  Graph connections;
-  add_edge(m_blob_bbox.size()-1,m_blob_bbox.size()-1,connections);
-
-  // Check for bbox on the division line
-  // --> x div
-  for ( uint32 i = 0; i < x_div.size(); i++ ) {
-    std::vector<uint32> left_side;
-    std::vector<uint32> right_side;
-    for ( uint32 b_i = 0; b_i < m_blob_bbox.size(); b_i++ )
-      if ( m_blob_bbox[b_i].max().x() == int32(x_div[i]) )
-        left_side.push_back( b_i );
-      else if ( m_blob_bbox[b_i].min().x() == int32(x_div[i]) )
-        right_side.push_back( b_i );
-
-    // Cool, work which boxes are side by side
-    for ( uint32 l_i = 0; l_i < left_side.size(); l_i++ )
-      for ( uint32 r_i = 0; r_i < right_side.size(); r_i++ ) {
-        uint32 l = left_side[l_i];
-        uint32 r = right_side[r_i];
-        if ( ( m_blob_bbox[l].max().y()+1 >= m_blob_bbox[r].min().y() ) &&
-             ( m_blob_bbox[r].max().y()+1 >= m_blob_bbox[l].min().y() ) )
-          if ( m_c_blob[l].is_on_right(m_c_blob[r]) )
-            add_edge(l,r,connections);
+  struct UnionJoiner {
+    std::vector<int32>& parent;
+    UnionJoiner( std::vector<int32>& parent ) : parent(parent) {}
+    void operator()( int32 a, int32 b ) { join( parent, a, b ); }
+  };
+
+  struct EdgeJoiner {
+    std::vector<int32> const& parent;
+    std::vector<std::pair<int32,int32> >& edges;
+    EdgeJoiner( std::vector<int32> const& parent, std::vector<std::pair<int32,int32> >& edges )
+      : parent(parent), edges(edges) {}
+    void operator()( int32 a, int32 b ) {
+      std::pair<int32,int32> edge( parent[a], parent[b] );
+      if ( edges.empty() || edges.back() != edge )
+        edges.push_back( edge );
+    }
+  };
+
+  // Labels the runs of one band, whose entries in parent start at
+  // base.  Afterwards every run points straight at its root.
+  class LabelBandTask : public Task, private boost::noncopyable {
+    RowRuns const& m_band;
+    int32 m_base;
+    std::vector<int32>& m_parent;
+  public:
+    LabelBandTask( RowRuns const& band, int32 base, std::vector<int32>& parent ) :
+      m_band(band), m_base(base), m_parent(parent) {}
+
+    void operator()() {
+      for ( int32 k = 0; k < m_band.num_runs(); k++ )
+        m_parent[m_base + k] = m_base + k;
+      UnionJoiner joiner( m_parent );
+      for ( int32 r = 1; r < m_band.num_rows(); r++ )
+        join_rows( m_band, r-1, m_base, m_band, r, m_base, joiner );
+      for ( int32 k = 0; k < m_band.num_runs(); k++ )
+        m_parent[m_base + k] = m_parent[m_parent[m_base + k]];
+    }
+  };
+
+  // Finds the pairs of band roots that touch across the boundary
+  // between two bands.
+  class BoundaryTask : public Task, private boost::noncopyable {
+    RowRuns const& m_upper;
+    RowRuns const& m_lower;
+    int32 m_upper_base, m_lower_base;
+    std::vector<int32> const& m_parent;
+    std::vector<std::pair<int32,int32> >& m_edges;
+  public:
+    BoundaryTask( RowRuns const& upper, int32 upper_base,
+                  RowRuns const& lower, int32 lower_base,
+                  std::vector<int32> const& parent,
+                  std::vector<std::pair<int32,int32> >& edges ) :
+      m_upper(upper), m_lower(lower), m_upper_base(upper_base), m_lower_base(lower_base),
+      m_parent(parent), m_edges(edges) {}
+
+    void operator()() {
+      if ( m_upper.num_rows() == 0 || m_lower.num_rows() == 0 ||
+           m_upper.first_row + m_upper.num_rows() != m_lower.first_row )
+        return;
+      EdgeJoiner joiner( m_parent, m_edges );
+      join_rows( m_upper, m_upper.num_rows()-1, m_upper_base,
+                 m_lower, 0, m_lower_base, joiner );
+    }
+  };
+
+  // Runs the tasks on a queue, or right here if there is only one
+  // thread or one task.
+  template <class TaskT>
+  void run_tasks( std::vector<boost::shared_ptr<TaskT> > const& tasks, int32 num_threads ) {
+    if ( num_threads > 1 && tasks.size() > 1 ) {
+      FifoWorkQueue queue( num_threads );
+      for ( size_t i = 0; i < tasks.size(); i++ )
+        queue.add_task( tasks[i] );
+      queue.join_all();
+    } else {
+      for ( size_t i = 0; i < tasks.size(); i++ )
+        (*tasks[i])();
+    }
+  }
+
+} // namespace
+
+void label_runs( std::vector<RowRuns> const& bands, int32 num_threads,
+                 std::vector<int32>& labels, std::vector<ComponentStats>& stats ) {
+  std::vector<int32> base( bands.size()+1, 0 );
+  for ( size_t i = 0; i < bands.size(); i++ )
+    base[i+1] = base[i] + bands[i].num_runs();
+  labels.resize( base.back() );
+  stats.clear();
+
+  // Each band owns its own range of labels.
+  std::vector<boost::shared_ptr<LabelBandTask> > band_tasks;
+  for ( size_t i = 0; i < bands.size(); i++ )
+    band_tasks.push_back( boost::shared_ptr<LabelBandTask>( new LabelBandTask( bands[i], base[i], labels ) ) );
+  run_tasks( band_tasks, num_threads );
+
+  // The boundaries only read the band roots.
+  std::vector<std::vector<std::pair<int32,int32> > > edges( bands.empty() ? 0 : bands.size()-1 );
+  std::vector<boost::shared_ptr<BoundaryTask> > boundary_tasks;
+  for ( size_t i = 0; i < edges.size(); i++ )
+    boundary_tasks.push_back( boost::shared_ptr<BoundaryTask>(
+      new BoundaryTask( bands[i], base[i], bands[i+1], base[i+1], labels, edges[i] ) ) );
+  run_tasks( boundary_tasks, num_threads );
+
+  // There are few band roots that touch, join them here.
+  for ( size_t i = 0; i < edges.size(); i++ )
+    for ( size_t j = 0; j < edges[i].size(); j++ )
+      join( labels, edges[i][j].first, edges[i][j].second );
+
+  // Every run points at an earlier run, so that a single pass in order
+  // turns the roots into component numbers and the rest into their
+  // root's number.
+  int32 num_components = 0;
+  for ( int32 k = 0; k < int32(labels.size()); k++ ) {
+    if ( labels[k] == k )
+      labels[k] = num_components++;
+    else
+      labels[k] = labels[labels[k]];
+  }
+
+  stats.resize( num_components );
+  for ( size_t i = 0; i < bands.size(); i++ ) {
+    RowRuns const& band = bands[i];
+    for ( int32 r = 0; r < band.num_rows(); r++ ) {
+      int32 y = band.first_row + r;
+      for ( int32 k = band.row_offset[r]; k < band.row_offset[r+1]; k++ ) {
+        ComponentStats& component = stats[labels[base[i] + k]];
+        component.area += band.end[k] - band.start[k];
+        if ( component.num_runs == 0 ) {
+          component.bbox = BBox2i( band.start[k], y, band.end[k] - band.start[k], 1 );
+        } else {
+          component.bbox.min().x() = std::min( component.bbox.min().x(), band.start[k] );
+          component.bbox.max().x() = std::max( component.bbox.max().x(), band.end[k] );
+          component.bbox.max().y() = y + 1;
+        }
+        component.num_runs++;
       }
+    }
   }
-  // --> y div
-  for ( uint32 i = 0; i < y_div.size(); i++ ) {
-    std::vector<uint32> up_side;
-    std::vector<uint32> down_side;
-    up_side.reserve( m_blob_bbox.size() );
-    down_side.reserve( m_blob_bbox.size() );
-    for ( uint32 b_i = 0; b_i < m_blob_bbox.size(); b_i++ )
-      if ( m_blob_bbox[b_i].max().y() == int32(y_div[i]) )
-        up_side.push_back( b_i );
-      else if ( m_blob_bbox[b_i].min().y() == int32(y_div[i]) )
-        down_side.push_back( b_i );
-
-    // Work out which line up
-    for ( uint32 u_i = 0; u_i < up_side.size(); u_i++ )
-      for ( uint32 d_i = 0; d_i < down_side.size(); d_i++ ) {
-        uint32 u = up_side[u_i];
-        uint32 d = down_side[d_i];
-        if ( ( m_blob_bbox[u].max().x()+1 >= m_blob_bbox[d].min().x() ) &&
-             ( m_blob_bbox[d].max().x()+1 >= m_blob_bbox[u].min().x() ) )
-          if ( m_c_blob[u].is_on_bottom(m_c_blob[d]) )
-            add_edge(u,d,connections);
+}
+
+void build_blobs( std::vector<RowRuns> const& bands, std::vector<int32> const& labels,
+                  std::vector<ComponentStats> const& stats, int32 max_area,
+                  std::vector<BlobCompressed>& blobs, std::vector<BBox2i>& bboxes ) {
+  std::vector<int32> blob_of( stats.size(), -1 );
+  int32 num_blobs = 0;
+  for ( size_t i = 0; i < stats.size(); i++ )
+    if ( max_area <= 0 || stats[i].area <= max_area )
+      blob_of[i] = num_blobs++;
+
+  blobs.clear();
+  blobs.resize( num_blobs );
+  bboxes.clear();
+  bboxes.reserve( num_blobs );
+  for ( size_t i = 0; i < stats.size(); i++ )
+    if ( blob_of[i] >= 0 ) {
+      blobs[blob_of[i]].reset( stats[i].bbox, stats[i].num_runs );
+      bboxes.push_back( stats[i].bbox );
+    }
+
+  // The runs come in raster order, just as add_row() wants them.
+  int32 base = 0;
+  for ( size_t i = 0; i < bands.size(); i++ ) {
+    RowRuns const& band = bands[i];
+    for ( int32 r = 0; r < band.num_rows(); r++ )
+      for ( int32 k = band.row_offset[r]; k < band.row_offset[r+1]; k++ ) {
+        int32 b = blob_of[labels[base + k]];
+        if ( b >= 0 )
+          blobs[b].add_row( Vector2i( band.start[k], band.first_row + r ),
+                            band.end[k] - band.start[k] );
       }
+    base += band.num_runs();
   }
+}
+
+} // end namespace blob
 
-  std::vector<uint32> component(boost::num_vertices(connections));
-  int final_num = boost::connected_components(connections,&component[0]);
-
-  // Spawn threads to coagulate blobs. Creating 2x max number threads
-  // jobs incase the individual jobs are not evenally distributed with
-  // short-circuit conditions like max_area.
-  FifoWorkQueue absorb_queue;
-  m_blob_bbox.clear();
-  std::deque<blob::BlobCompressed> new_c_blob;
-  int number_of_jobs = vw_settings().default_num_threads() * 2;
-  Mutex append_mutex;
-  for ( int j = 0; j < number_of_jobs; j++ ) {
-    int min = ( final_num * j ) / number_of_jobs;
-    int max = ( final_num * (j+1) ) / number_of_jobs;
-    boost::shared_ptr<Task> absorb_task(
-                                        new blob::ConsolidateAbsorbTask( m_c_blob, new_c_blob,
-                                                                         m_blob_bbox, component, m_max_area,
-                                                                         min, max, append_mutex ) );
-    absorb_queue.add_task( absorb_task );
+void BlobIndexThreaded::wipe_big_blobs(int max_size){
+  size_t kept = 0;
+  for ( size_t i = 0; i < m_c_blob.size(); i++ ) {
+    if ( m_blob_bbox[i].width() > max_size ||
+         m_blob_bbox[i].height() > max_size )
+      continue;
+    if ( kept != i ) {
+      m_c_blob[kept]    = m_c_blob[i];
+      m_blob_bbox[kept] = m_blob_bbox[i];
+    }
+    kept++;
   }
-  absorb_queue.join_all();
-  m_c_blob = new_c_blob;
+  m_c_blob.resize( kept );
+  m_blob_bbox.resize( kept );
 }
 
 uint32 BlobIndexThreaded::num_blobs() const { return m_c_blob.size(); }
 void BlobIndexThreaded::blob( uint32 const& index,
-           std::list<Vector2i>& output ) const {
+           std::vector<Vector2i>& output ) const {
   m_c_blob[index].decompress(output);
 }
 blob::BlobCompressed const&
@@ -24,7 +24,7 @@
 
 // VW
 #include <vw/Core/Log.h>
-#include <vw/Core/Thread.h>
+#include <vw/Core/Settings.h>
 #include <vw/Core/ThreadPool.h>
 #include <vw/Core/Stopwatch.h>
 #include <vw/Image/AlgorithmFunctions.h>
@@ -35,25 +35,21 @@
 
 // Standard
 #include <vector>
-#include <deque>
 #include <list>
 #include <ostream>
 
 // Boost
 #include <boost/noncopyable.hpp>
 #include <boost/smart_ptr/shared_ptr.hpp>
-#include <boost/graph/adjacency_list.hpp>
-#include <boost/graph/connected_components.hpp>
-#include <boost/graph/graph_selectors.hpp>
 
 // BlobIndex (Multi) Threaded
 ///////////////////////////////////////
 
-// This code is a custom write up of the blob_index function from VW. It has several
-// different features.
+// Blobs are the 8-connected components of the valid pixels of an image.
 // --> Multithread (as expected)
 // --> Lower Memory Impact
-//     via a new internal compressed format
+//     The image is read as runs of valid pixels a tile at a time, and
+//     the runs are labeled with a union-find over flat arrays.
 // --> Allows for limiting on size.
 
 namespace vw {
@@ -65,14 +61,16 @@ namespace blob {
   // A nice way to describe a blob,
   // but reducing our memory foot print
   class BlobCompressed {
-    // This describes a blob as lines of rows
-    // to reduce the memory foot print
+    // This describes a blob as runs of pixels on each row.  The runs
+    // of row r are [m_row_offset[r], m_row_offset[r+1]) in m_start and
+    // m_end, ordered by column and relative to m_min.
     Vector2i m_min;
-    std::vector< std::list<int32> > m_row_start; // assumed to be ordered
-    std::vector< std::list<int32> > m_row_end;
+    std::vector<int32> m_row_offset;
+    std::vector<int32> m_start, m_end;
+    int32 m_size;  // Number of pixels
+    int32 m_width; // Largest run end
 
     void shift_x ( int32 const& value );
-    void refactor();
 
   public:
     BlobCompressed( Vector2i const& top_left,
@@ -80,33 +78,118 @@ namespace blob {
                     std::vector<std::list<int32> > const& row_end );
     BlobCompressed();
 
+    /// Empty the blob and get it ready for num_runs calls to add_row()
+    /// with runs that all lie in bbox.
+    void reset( BBox2i const& bbox, int32 num_runs );
+
     // Standard Access point
     Vector2i const& min() const;
     Vector2i      & min();
 
-    std::list<int32> const& start( uint32 const& index ) const;
-    std::list<int32> const& end  ( uint32 const& index ) const;
-
     int32 num_rows() const;
-    int32 size    () const; // Please use sparingly
+    int32 num_runs( int32 row ) const;
+    /// The first column of a run, relative to min().
+    int32 run_start( int32 row, int32 run ) const;
+    /// One past the last column of a run, relative to min().
+    int32 run_end  ( int32 row, int32 run ) const;
+
+    int32 size    () const; // Number of pixels
 
     BBox2i bounding_box() const;
     bool intersects( BBox2i const& input ) const;
 
-    // Specific conditionals used by BlobIndexThreaded
-    bool is_on_right ( BlobCompressed const& right  ) const;
-    bool is_on_bottom( BlobCompressed const& bottom ) const;
-
     // Append a row (since these guys are built a row at a time )
     void add_row( Vector2i const& start, int const& width );
     // Use to expand this blob into a non overlapped area
     void absorb( BlobCompressed const& victim );
     // Dump listing of every pixel used
-    void decompress( std::list<Vector2i>& output ) const;
+    void decompress( std::vector<Vector2i>& output ) const;
     // Print internal data
     void print() const;
   };
 
+  /// The runs of valid pixels in a band of consecutive image rows.
+  struct RowRuns {
+    int32 first_row;
+    std::vector<int32> row_offset; ///< Runs of row first_row+r are [row_offset[r], row_offset[r+1]).
+    std::vector<int32> start, end; ///< Image columns of each run; end is one past the last pixel.
+
+    RowRuns() : first_row(0) {}
+    int32 num_rows() const { return row_offset.empty() ? 0 : int32(row_offset.size()) - 1; }
+    int32 num_runs() const { return int32(start.size()); }
+  };
+
+  /// Size and extent of a connected component.
+  struct ComponentStats {
+    int64  area;
+    BBox2i bbox;
+    int32  num_runs;
+
+    ComponentStats() : area(0), num_runs(0) {}
+  };
+
+  /// Joins the runs of bands that lie side by side, in order, into one
+  /// band covering all their columns.
+  void stitch_runs( std::vector<RowRuns> const& chunks, RowRuns& runs );
+
+  /// Labels the 8-connected components of the runs of bands that follow
+  /// each other down the image.
+  /// - labels receives the component of every run, bands in order.
+  ///   Components are numbered in raster order of their first pixel.
+  /// - stats receives the area and extent of each component.
+  /// - The bands, and then the boundaries between them, are joined in
+  ///   separate tasks.
+  void label_runs( std::vector<RowRuns> const& bands, int32 num_threads,
+                   std::vector<int32>& labels, std::vector<ComponentStats>& stats );
+
+  /// Gathers the runs of each component into a blob, skipping the
+  /// components with more than max_area pixels if max_area is positive.
+  void build_blobs( std::vector<RowRuns> const& bands, std::vector<int32> const& labels,
+                    std::vector<ComponentStats> const& stats, int32 max_area,
+                    std::vector<BlobCompressed>& blobs, std::vector<BBox2i>& bboxes );
+
+  /// Finds the runs of valid pixels in bbox, reading chunk_cols columns
+  /// of the source at a time.
+  template <class SourceT>
+  void find_runs( ImageViewBase<SourceT> const& src, BBox2i const& bbox,
+                  int32 chunk_cols, RowRuns& runs ) {
+    typedef typename SourceT::pixel_type pixel_type;
+    chunk_cols = std::max( chunk_cols, 1 );
+
+    std::vector<RowRuns> chunks;
+    chunks.reserve( (bbox.width() + chunk_cols - 1) / chunk_cols );
+    for ( int32 x = bbox.min().x(); x < bbox.max().x(); x += chunk_cols ) {
+      BBox2i chunk_box( x, bbox.min().y(), std::min( chunk_cols, bbox.max().x() - x ), bbox.height() );
+      ImageView<pixel_type> pixels = crop( src.impl(), chunk_box );
+
+      chunks.push_back( RowRuns() );
+      RowRuns& chunk = chunks.back();
+      chunk.first_row = bbox.min().y();
+      chunk.row_offset.reserve( pixels.rows() + 1 );
+      chunk.row_offset.push_back( 0 );
+      for ( int32 row = 0; row < pixels.rows(); ++row ) {
+        int32 col = 0;
+        while ( col < pixels.cols() ) {
+          if ( !is_valid( pixels(col,row) ) ) {
+            ++col;
+            continue;
+          }
+          int32 begin = col;
+          while ( col < pixels.cols() && is_valid( pixels(col,row) ) )
+            ++col;
+          chunk.start.push_back( x + begin );
+          chunk.end.push_back  ( x + col   );
+        }
+        chunk.row_offset.push_back( chunk.num_runs() );
+      }
+    }
+
+    stitch_runs( chunks, runs );
+    runs.first_row = bbox.min().y();
+    if ( runs.row_offset.empty() )
+      runs.row_offset.assign( bbox.height() + 1, 0 );
+  }
+
   // Blob Index Custom
   ////////////////////////////////////
   /// A different version of Blob index that uses the compressed format and the new options
@@ -128,181 +211,23 @@ namespace blob {
                     src.impl().rows() );
       fill(dst,0);
 
-      // Initialize Graph used to pair blobs
-      typedef boost::adjacency_list<boost::vecS,boost::vecS,boost::undirectedS> Graph;
-      Graph connections;
-      m_blob_count=1;
-
-      { // Initial Pass
-        // Leading and trailing iterators for the input and output images.
-        typename SourceT::pixel_accessor   s_acc = src.impl().origin();
-        typename SourceT::pixel_accessor p_s_acc = src.impl().origin(); // previous
-        typename ImageView<uint32>::pixel_accessor   d_acc = dst.origin();
-        typename ImageView<uint32>::pixel_accessor p_d_acc = dst.origin(); // previous
-
-        // Top Corner
-        if ( is_valid(*s_acc) ) {
-          *d_acc = m_blob_count;
-          m_blob_count++;
-        }
+      std::vector<RowRuns> bands(1);
+      find_runs( src, bounding_box(src.impl()), src.impl().cols(), bands[0] );
 
-        // Top Row
-        s_acc.next_col();
-        d_acc.next_col();
-        for ( int32 i = 1; i < dst.cols(); i++ ) {
-          if ( is_valid(*s_acc) ) {
-            if ( is_valid(*p_s_acc) ) { // Last pixel and this pixel valid
-              *d_acc = *p_d_acc; // Extend the current blob label.
-            } else { // Start of a new blob
-              *d_acc = m_blob_count;
-              m_blob_count++;
-            }
-          }
-          s_acc.next_col(); // Advance all iterators
-          d_acc.next_col();
-          p_s_acc.next_col();
-          p_d_acc.next_col();
-        }
-      }
+      std::vector<int32> labels;
+      std::vector<ComponentStats> stats;
+      label_runs( bands, 1, labels, stats );
 
-      { // Everything else (9 connected)
-        typename SourceT::pixel_accessor           s_acc_row = src.impl().origin();
-        typename ImageView<uint32>::pixel_accessor d_acc_row = dst.origin();
-        s_acc_row.advance(0,1); // We already did the first row, so go to the second.
-        d_acc_row.advance(0,1);
-
-        // Loop through the rows
-        for (int j = dst.rows()-1; j; --j ) {
-          // Leading and trailing iterators for the input and output images.
-          typename SourceT::pixel_accessor             s_acc = s_acc_row;
-          typename SourceT::pixel_accessor           p_s_acc = s_acc_row;
-          typename ImageView<uint32>::pixel_accessor   d_acc = d_acc_row;
-          typename ImageView<uint32>::pixel_accessor p_d_acc = d_acc_row;
-
-          // Process
-          
-          // Loop through columns
-          for ( int i = dst.cols(); i; --i ) {
-          
-            if ( is_valid(*s_acc) ) { // Current pixel is valid
-            
-              // TODO: Can we make this more efficient?
-            
-              if ( i != dst.cols() ) { // Not the first column
-                // Check the pixel to the left
-                p_s_acc.advance(-1,0);
-                p_d_acc.advance(-1,0);
-                if ( is_valid(*p_s_acc) ) { // It is valid...
-                  if ( (*d_acc != 0) && (*d_acc != *p_d_acc) ) // Will this case ever trigger? How is d_acc set here?
-                    boost::add_edge(*p_d_acc,*d_acc,connections);
-                  else
-                    *d_acc = *p_d_acc;
-                }
-                // Check the pixel to the upper left
-                p_s_acc.advance(0,-1);
-                p_d_acc.advance(0,-1);
-                if ( is_valid(*p_s_acc) ) { // If valid...
-                  if ( (*d_acc != 0) && (*d_acc != *p_d_acc) ) // If current pixel and prev pixel have different labels
-                    boost::add_edge(*p_d_acc,*d_acc,connections); // Add a connection between the labels in boost
-                  else
-                    *d_acc = *p_d_acc; // Copy the label from the previous pixel
-                }
-              } else { // This is the first column
-                p_s_acc.advance(-1,-1); // Move to the non-existant upper left location so that
-                p_d_acc.advance(-1,-1); //  the following commands to to the correct locations.
-              }
-              
-              // Check the upper pixel
-              p_s_acc.advance(1,0);
-              p_d_acc.advance(1,0);
-              if ( is_valid(*p_s_acc) ) {
-                if ( (*d_acc != 0) && (*d_acc != *p_d_acc) )
-                  boost::add_edge(*p_d_acc,*d_acc,connections);
-                else
-                  *d_acc = *p_d_acc;
-              }
-              
-              // Check the upper right pixel
-              p_s_acc.advance(1,0);
-              p_d_acc.advance(1,0);
-              if ( i != 1 ) { // If not on the last column
-                if ( is_valid(*p_s_acc) ) {
-                  if ( (*d_acc != 0) && (*d_acc != *p_d_acc) )
-                    boost::add_edge(*p_d_acc,*d_acc,connections);
-                  else
-                    *d_acc = *p_d_acc;
-                }
-              }
-              
-              // Move the trailing iterators up to the current pixel location.
-              p_s_acc.advance(-1,1);
-              p_d_acc.advance(-1,1);
-              if ( *d_acc == 0 ) { // If we have not yet assigned this pixel, start a new blob.
-                *d_acc = m_blob_count;
-                m_blob_count++;
-              }
-            } // End case where current pixel is valid
-            
-            // Advance to the next column
-            s_acc.next_col();
-            p_s_acc.next_col();
-            d_acc.next_col();
-            p_d_acc.next_col();
-          } // end column loop
-
-          // Anvance to the next row
-          s_acc_row.next_row();
-          d_acc_row.next_row();
-        } // End row loop
-      } // End phantom bracket
-
-      // Making sure connections has vertices for all indexes made
-      add_edge(m_blob_count-1,m_blob_count-1,connections);
-      std::vector<uint32> component(boost::num_vertices(connections));
-      m_blob_count = boost::connected_components(connections, &component[0])-1;
-      m_c_blob.resize(m_blob_count);
-      // component contains the true (consolidated) labels for each pixel
-      // m_c_blob will store the output blobs.
-
-      { // Update index map to optimal numbering
-        ImageView<uint32>::pixel_accessor p_d_acc = dst.origin(); // previous
-
-        // Loop through rows
-        for ( int32 r = 0; r < dst.rows(); r++ ) {
-          ImageView<uint32>::pixel_accessor d_acc = p_d_acc;
-          bool building_segment=false;
-           int32 start_col = 0;
-          uint32 index     = 0;
-          
-          // Loop through columns
-          // - In each column, build up a run-length-encoding for each blob.
-          for ( int32 c = 0; c < dst.cols(); c++ ) {
-            if ( (*d_acc) != 0 ) { // If labeled pixel...
-              if ( building_segment && (index != component[*d_acc]) ) {
-                vw_throw(LogicErr() << "Insert seems wrong.\n");
-                // I believe the way it's processed this shouldn't happen
-              } else if (!building_segment) {
-                // Start recording a new RLE segment
-                building_segment = true;
-                index     = component[*d_acc]; // Get the true label for this pixel
-                start_col = c;
-              }
-            } else if ( building_segment ) {
-              // Finished with this blob for now, add an RLE segment
-              building_segment = false;
-              m_c_blob[index-1].add_row( Vector2i(start_col,r), c-start_col );
-            }
-            d_acc.next_col();
-          }
-          
-          if ( building_segment ) { // Hit the end of a row building a blob, cut it off.
-            m_c_blob[index-1].add_row( Vector2i(start_col,r),
-                                       dst.cols()-start_col );
-          }
-          p_d_acc.next_row();
-        }
-      }
+      // Labels start from one, zero being the invalid pixels.
+      RowRuns const& runs = bands[0];
+      for ( int32 r = 0; r < runs.num_rows(); r++ )
+        for ( int32 k = runs.row_offset[r]; k < runs.row_offset[r+1]; k++ )
+          for ( int32 c = runs.start[k]; c < runs.end[k]; c++ )
+            dst( c, runs.first_row + r ) = labels[k] + 1;
 
+      std::vector<BBox2i> bboxes;
+      build_blobs( bands, labels, stats, 0, m_c_blob, bboxes );
+      m_blob_count = m_c_blob.size();
     }
 
     // Access points to intersting information
@@ -314,58 +239,23 @@ namespace blob {
 
 
 
-  // Blob Index Task
+  // Find Runs Task
   /////////////////////////////////////
   /// A task wrapper to allow threading
   template <class SourceT>
-  class BlobIndexTask : public Task, private boost::noncopyable {
+  class FindRunsTask : public Task, private boost::noncopyable {
 
     ImageViewBase<SourceT> const& m_view;
-    BBox2i const& m_bbox;
-    Mutex&        m_append_mutex;
-
-    std::deque<BlobCompressed> &m_c_blob; // reference to global
-    std::deque<BBox2i>     &m_blob_bbox;
-    int m_id;
-    int m_max_area;
+    BBox2i   m_bbox;
+    int32    m_chunk_cols;
+    RowRuns& m_runs;
   public:
-    BlobIndexTask( ImageViewBase<SourceT> const& view,
-                   BBox2i const& bbox, Mutex &mutex,
-                   std::deque<BlobCompressed> & blobs,
-                   std::deque<BBox2i> & blob_boxes,
-                   int const& id, int const& max_area ) :
-    m_view(view), m_bbox(bbox), m_append_mutex(mutex),
-      m_c_blob(blobs), m_blob_bbox(blob_boxes), m_id(id), m_max_area(max_area) {}
+    FindRunsTask( ImageViewBase<SourceT> const& view, BBox2i const& bbox,
+                  int32 chunk_cols, RowRuns& runs ) :
+      m_view(view), m_bbox(bbox), m_chunk_cols(chunk_cols), m_runs(runs) {}
 
     void operator()() {
-      Stopwatch sw;
-      sw.start();
-      ImageView<uint32> index_image(m_bbox.width(),
-                                            m_bbox.height() );
-
-      // Render so threads don't wait on each other
-      ImageView<typename SourceT::pixel_type> cropped_copy = crop(m_view,m_bbox);
-      // Decided only to do trimming in the global perspective. This
-      // avoids weird edge effects.
-      BlobIndex bindex( cropped_copy, index_image);
-
-      // Build local bboxes
-      std::vector<BBox2i> local_bboxes( bindex.num_blobs() );
-      for ( uint32 i = 0; i < bindex.num_blobs(); i++ ) {
-        local_bboxes[i] = bindex.blob(i).bounding_box() + m_bbox.min();
-      }
-
-      { // Append results (single thread)
-        Mutex::Lock lock(m_append_mutex);
-        for ( uint i = 0; i < local_bboxes.size(); i++ ) {
-          m_c_blob.push_back( bindex.blob(i) );
-          m_c_blob.back().min() += m_bbox.min(); // Fix offset
-          m_blob_bbox.push_back( local_bboxes[i] );
-        }
-      }
-
-      sw.stop();
-      vw_out(VerboseDebugMessage,"inpaint") << "Task " << m_id << ": finished, " << sw.elapsed_seconds() << "s\n";
+      find_runs( m_view, m_bbox, m_chunk_cols, m_runs );
     }
   };
 } // end namespace blob
@@ -384,23 +274,21 @@ namespace blob {
 /// Performs Blob Index using all threads and a minimal amount of memory
 class BlobIndexThreaded {
 
-  std::deque<BBox2i>           m_blob_bbox;
-  std::deque<blob::BlobCompressed> m_c_blob;
+  std::vector<BBox2i>               m_blob_bbox;
+  std::vector<blob::BlobCompressed> m_c_blob;
 
-  Mutex m_insert_mutex;
   int m_max_area;
   int m_tile_size;
 
-  // Tasks might section a blob in half.
-  // This will match them
-  void consolidate( Vector2i const& image_size,
-                    Vector2i const& proc_block_size );
-
  public:
  
   /// Constructor does most of the processing work
   /// - This is the function to call to detect blobs!
   /// - Blobs larger than max_area (if > zero) are discarded.
+  /// - The image is read in tiles of tile_size, a band of tile_size
+  ///   rows per task.  The runs of valid pixels of the bands are then
+  ///   labeled, and the labels joined across the band boundaries.
+  /// - The blobs are ordered by their first pixel in raster order.
   template <class SourceT>
   BlobIndexThreaded( ImageViewBase<SourceT> const& src,
                      int32 const& max_area    = 0,
@@ -408,92 +296,62 @@ class BlobIndexThreaded {
                      int32 const& num_threads = vw_settings().default_num_threads()
                      )
     : m_max_area(max_area), m_tile_size(tile_size) {
-    
-    std::vector<BBox2i> bboxes = subdivide_bbox( src.impl(), m_tile_size, m_tile_size );
+
+    Stopwatch sw;
+    sw.start();
+
     // User needs to remember to give a pixel mask'd input
-    typedef blob::BlobIndexTask<SourceT> task_type;
-    if (bboxes.size() > 1){
-      Stopwatch sw;
-      sw.start();
+    int32 cols = src.impl().cols(), rows = src.impl().rows();
+    int32 band_rows = std::max( m_tile_size, 1 );
+    std::vector<blob::RowRuns> bands( (rows + band_rows - 1) / band_rows );
+    if ( bands.size() > 1 && num_threads > 1 ) {
+      typedef blob::FindRunsTask<SourceT> task_type;
       FifoWorkQueue queue(num_threads);
-      
-      for ( size_t i = 0; i < bboxes.size(); ++i ) {
-        boost::shared_ptr<task_type> task(new task_type(src, bboxes[i],
-                                                        m_insert_mutex,
-                                                        m_c_blob, m_blob_bbox,
-                                                        i, m_max_area ));
+      for ( size_t i = 0; i < bands.size(); ++i ) {
+        BBox2i bbox( 0, int32(i)*band_rows, cols, std::min( band_rows, rows - int32(i)*band_rows ) );
+        boost::shared_ptr<task_type> task(new task_type(src, bbox, m_tile_size, bands[i]));
         queue.add_task(task);
       }
       queue.join_all();
-      
-      sw.stop();
-      vw_out(DebugMessage,"inpaint") << "Blob detection took " << sw.elapsed_seconds() << "s\n";
-      consolidate( Vector2i( src.impl().cols(), src.impl().rows() ),
-                   Vector2i( m_tile_size, m_tile_size ) );
-    }else if (bboxes.size() == 1){
-      // This is a special case when we want to fill in holes
-      // in a single small image.
-      boost::shared_ptr<task_type> task(new task_type(src, bboxes[0],
-                                                      m_insert_mutex,
-                                                      m_c_blob, m_blob_bbox,
-                                                      0, m_max_area ));
-      (*task.get())();
-    }
-    
-
-    // Cull blobs that are too big.
-    if ( m_max_area > 0 ) {
-      for ( std::deque<blob::BlobCompressed>::iterator iter = m_c_blob.begin();
-            iter != m_c_blob.end(); iter++ ) {
-        if ( iter->size() > m_max_area ) {
-          iter = m_c_blob.erase( iter );
-          iter--;
-        }
+    } else {
+      for ( size_t i = 0; i < bands.size(); ++i ) {
+        BBox2i bbox( 0, int32(i)*band_rows, cols, std::min( band_rows, rows - int32(i)*band_rows ) );
+        blob::find_runs( src, bbox, m_tile_size, bands[i] );
       }
     }
-  }
 
-  /// Wipe blobs bigger than this size.
-  void wipe_big_blobs(int max_size){
+    std::vector<int32> labels;
+    std::vector<blob::ComponentStats> stats;
+    blob::label_runs( bands, num_threads, labels, stats );
 
-    // Keep the bounding boxes up-to-date.
-    m_blob_bbox.clear();
-    
-    for ( std::deque<blob::BlobCompressed>::iterator iter = m_c_blob.begin();
-          iter != m_c_blob.end(); iter++ ) {
+    // Blobs that are too big are never built.
+    blob::build_blobs( bands, labels, stats, m_max_area, m_c_blob, m_blob_bbox );
 
-      BBox2i blob_bbox = iter->bounding_box();
-      
-      if ( blob_bbox.width() > max_size ||
-           blob_bbox.height() > max_size) {
-        iter = m_c_blob.erase( iter );
-        iter--;
-      }else{
-        m_blob_bbox.push_back(blob_bbox);
-      }
-      
-    }
-    
+    sw.stop();
+    vw_out(DebugMessage,"inpaint") << "Blob detection took " << sw.elapsed_seconds() << "s\n";
   }
+
+  /// Wipe blobs bigger than this size.
+  void wipe_big_blobs(int max_size);
   
   // Access for the users
   uint32 num_blobs() const;
-  /// ?
+  /// Every pixel of a blob
   void blob( uint32 const& index,
-             std::list<Vector2i>& output ) const;
-  /// ?
+             std::vector<Vector2i>& output ) const;
+  /// The runs of a blob
   blob::BlobCompressed const& compressed_blob( uint32 const& index ) const;
 
-  typedef std::deque<blob::BlobCompressed>::iterator             blob_iterator;
-  typedef std::deque<blob::BlobCompressed>::const_iterator const_blob_iterator;
+  typedef std::vector<blob::BlobCompressed>::iterator             blob_iterator;
+  typedef std::vector<blob::BlobCompressed>::const_iterator const_blob_iterator;
         blob_iterator begin();
   const_blob_iterator begin() const;
         blob_iterator end();
   const_blob_iterator end() const;
 
   BBox2i const& blob_bbox( uint32 const& index ) const;
-  typedef std::deque<BBox2i>::iterator             bbox_iterator;
-  typedef std::deque<BBox2i>::const_iterator const_bbox_iterator;
+  typedef std::vector<BBox2i>::iterator             bbox_iterator;
+  typedef std::vector<BBox2i>::const_iterator const_bbox_iterator;
         bbox_iterator bbox_begin();
   const_bbox_iterator bbox_begin() const;
         bbox_iterator bbox_end();
@@ -563,33 +421,23 @@ public:
         
       // Loop through rows in blobs
       int num_rows = blob_iter->num_rows();
-      //std::cout << "num_rows = " << num_rows << std::endl;
-      std::list<int32>::const_iterator start_iter, stop_iter;
       for (int r=0; r<num_rows; ++r) {
       
-        // Loop through sections in row
+        // Loop through runs in row
         int row = r + blob_iter->min()[1] + big_bbox.min()[1]; // Absolute row
-        start_iter = blob_iter->start(r).begin();
-        stop_iter  = blob_iter->end(r).begin();
-        while (start_iter != blob_iter->start(r).end()) { 
-          //std::cout << "start = " << *start_iter << ", stop = " << *stop_iter << std::endl;
+        for (int k=0; k<blob_iter->num_runs(r); ++k) {
           
-          // Loop through pixels in section
-          for (int c=*start_iter; c<*stop_iter; ++c) { 
+          // Loop through pixels in run
+          for (int c=blob_iter->run_start(r,k); c<blob_iter->run_end(r,k); ++c) {
             int col = c + blob_iter->min()[0] + big_bbox.min()[0]; // Absolute col
             Vector2i pixel(col,row);
-            //std::cout << "Searching for blobs in " << big_bbox << std::endl;
-            //std::cout << "Pixel = " << pixel << ", raw = " << Vector2i(c,r) << std::endl;
             if (!bbox.contains(pixel))
               continue; // Skip blob pixels outside the current tile
             Vector2i tile_pixel = pixel - bbox.min();
-            //std::cout << "Pixel = " << pixel << ", tile_pixel = " << tile_pixel << ", raw = " << Vector2i(c,r) << std::endl;
             output_tile(tile_pixel[0], tile_pixel[1]) = blob_size; // Set the size of the pixel!
           } // End loop through pixels
           
-          ++start_iter;
-          ++stop_iter;
-        } // End loop through sections
+        } // End loop through runs
         
       } // End loop through rows
       
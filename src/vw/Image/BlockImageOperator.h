@@ -58,7 +58,7 @@ namespace vw {
         m_cache_ptr       ( cache )
     {
       if( m_block_size.x() <= 0 || m_block_size.y() <= 0 )
-        m_block_size = image_block::get_default_block_size<pixel_type>(image.rows(), image.cols(), image.planes());
+        m_block_size = image_block::get_image_block_size(image, num_threads);
 
       if (m_cache_ptr) // Manager is not needed if not using a cache.
         m_block_manager.initialize(m_cache_ptr, m_block_size, m_child);
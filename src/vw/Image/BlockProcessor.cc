@@ -0,0 +1,251 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/config.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/BlockProcessor.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#ifdef VW_HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+namespace {
+
+  using vw::uint32;
+  using vw::uint64;
+
+  // Position of (x,y) along a Hilbert curve filling an n x n grid,
+  // where n is a power of two.
+  uint64 hilbert_index( uint32 n, uint32 x, uint32 y ) {
+    uint64 d = 0;
+    for ( uint32 s = n/2; s > 0; s /= 2 ) {
+      uint32 rx = (x & s) > 0;
+      uint32 ry = (y & s) > 0;
+      d += uint64(s) * uint64(s) * ((3 * rx) ^ ry);
+      // Rotate the quadrant so the curve stays continuous.
+      if ( ry == 0 ) {
+        if ( rx == 1 ) {
+          x = n-1 - x;
+          y = n-1 - y;
+        }
+        std::swap( x, y );
+      }
+    }
+    return d;
+  }
+
+  // Position of (x,y) along a Morton curve.
+  uint64 z_index( uint32 x, uint32 y ) {
+    uint64 d = 0;
+    for ( uint32 bit = 0; bit < 32; ++bit ) {
+      d |= uint64((x >> bit) & 1) << (2*bit);
+      d |= uint64((y >> bit) & 1) << (2*bit + 1);
+    }
+    return d;
+  }
+
+  struct KeyedBlock {
+    uint64 key;
+    vw::Vector2i index;
+    bool operator<( KeyedBlock const& other ) const { return key < other.key; }
+  };
+
+  size_t system_cache_size( int name ) {
+#if defined(VW_HAVE_UNISTD_H) && defined(_SC_LEVEL2_CACHE_SIZE)
+    long size = sysconf( name );
+    return size > 0 ? size_t(size) : 0;
+#else
+    return 0;
+#endif
+  }
+
+  vw::int32 round_up( vw::int32 val, vw::int32 mod ) {
+    return ((val + mod - 1) / mod) * mod;
+  }
+
+} // namespace
+
+namespace vw {
+namespace image_block {
+
+  std::vector<Vector2i> block_grid_order( int32 cols, int32 rows, BlockOrder order ) {
+    std::vector<Vector2i> result;
+    if ( cols <= 0 || rows <= 0 )
+      return result;
+    result.reserve( size_t(cols) * size_t(rows) );
+
+    // A single row or column of blocks is already in curve order.
+    if ( order == RowMajorBlockOrder || cols == 1 || rows == 1 ) {
+      for ( int32 j = 0; j < rows; ++j )
+        for ( int32 i = 0; i < cols; ++i )
+          result.push_back( Vector2i(i,j) );
+      return result;
+    }
+
+    uint32 n = 1;
+    while ( n < uint32(std::max(cols, rows)) )
+      n *= 2;
+
+    std::vector<KeyedBlock> blocks( size_t(cols) * size_t(rows) );
+    size_t k = 0;
+    for ( int32 j = 0; j < rows; ++j )
+      for ( int32 i = 0; i < cols; ++i, ++k ) {
+        blocks[k].index = Vector2i(i,j);
+        blocks[k].key   = (order == HilbertBlockOrder) ? hilbert_index(n, i, j) : z_index(i, j);
+      }
+    std::sort( blocks.begin(), blocks.end() );
+    for ( k = 0; k < blocks.size(); ++k )
+      result.push_back( blocks[k].index );
+    return result;
+  }
+
+  size_t cache_bytes_per_thread( uint32 num_threads ) {
+    static const size_t min_bytes     = 256*1024;
+    static const size_t max_bytes     = 8*1024*1024;
+    static const size_t default_bytes = 2*1024*1024; // The old fixed block size
+#if defined(_SC_LEVEL2_CACHE_SIZE) && defined(_SC_LEVEL3_CACHE_SIZE)
+    size_t l2 = system_cache_size( _SC_LEVEL2_CACHE_SIZE );
+    size_t l3 = system_cache_size( _SC_LEVEL3_CACHE_SIZE );
+#else
+    size_t l2 = 0, l3 = 0;
+#endif
+    if ( num_threads < 1 )
+      num_threads = 1;
+    // L2 is private to a core; L3 is shared, so only a slice of it counts.
+    size_t bytes = std::max( l2, l3 / num_threads );
+    if ( bytes == 0 )
+      bytes = default_bytes;
+    return std::min( std::max( bytes, min_bytes ), max_bytes );
+  }
+
+  Vector2i choose_block_size( int32 rows, int32 cols, size_t pixel_bytes,
+                              Vector2i const& preferred_size, uint32 num_threads ) {
+    if ( rows < 1 || cols < 1 )
+      return Vector2i( std::max(cols,1), std::max(rows,1) );
+    if ( pixel_bytes < 1 )
+      pixel_bytes = 1;
+    if ( num_threads < 1 )
+      num_threads = 1;
+
+    int64 max_pixels = std::max( int64(cache_bytes_per_thread(num_threads) / pixel_bytes), int64(1) );
+
+    // Blocks are built from whole units.  A resource that wants the whole
+    // image in one read has no real preference.
+    Vector2i unit( 16, 16 );
+    if ( preferred_size.x() > 0 && preferred_size.y() > 0 &&
+         ( preferred_size.x() < cols || preferred_size.y() < rows ) )
+      unit = preferred_size;
+    unit.x() = std::min( unit.x(), cols );
+    unit.y() = std::min( unit.y(), rows );
+
+    int32 width, height;
+    if ( unit.x() >= cols ) {
+      // Strips: use as many whole strips as fit.
+      width  = cols;
+      height = int32( std::max( max_pixels / cols / unit.y(), int64(1) ) ) * unit.y();
+    } else {
+      // Tiles: the squarest arrangement of whole units that fits.
+      int64 units  = std::max( max_pixels / (int64(unit.x()) * unit.y()), int64(1) );
+      int64 across = std::max( int64(std::sqrt( double(units) * unit.y() / unit.x() )), int64(1) );
+      int64 down   = std::max( units / across, int64(1) );
+      width  = int32( std::min( across * unit.x(), int64(round_up(cols, unit.x())) ) );
+      height = int32( std::min( down   * unit.y(), int64(round_up(rows, unit.y())) ) );
+    }
+    width  = std::min( width,  cols );
+    height = std::min( height, rows );
+
+    // Split further until every thread has a few blocks to work on,
+    // but never below a single unit.
+    const int64 min_blocks = 4 * int64(num_threads);
+    while ( int64((cols + width - 1) / width) * ((rows + height - 1) / height) < min_blocks ) {
+      if ( width >= height && width > unit.x() )
+        width = std::max( round_up( (width + 1) / 2, unit.x() ), unit.x() );
+      else if ( height > unit.y() )
+        height = std::max( round_up( (height + 1) / 2, unit.y() ), unit.y() );
+      else if ( width > unit.x() )
+        width = std::max( round_up( (width + 1) / 2, unit.x() ), unit.x() );
+      else
+        break;
+    }
+    return Vector2i( width, height );
+  }
+
+  BlockAccessPredictor::BlockAccessPredictor( int32 cols, int32 rows, int32 depth )
+    : m_cols(cols), m_rows(rows), m_depth(depth), m_run(0), m_started(false) {}
+
+  bool BlockAccessPredictor::observe( Vector2i const& block, std::vector<Vector2i>& predictions ) {
+    predictions.clear();
+    if ( !m_started ) {
+      m_started = true;
+      m_last    = block;
+      return false;
+    }
+    if ( block == m_last )
+      return false;
+
+    Vector2i step = block - m_last;
+    // Wrapping onto the next row (or column) continues a raster scan.
+    if ( m_step == Vector2i(1,0) && step.y() == 1 && block.x() == 0 && m_last.x() == m_cols-1 )
+      step = m_step;
+    if ( m_step == Vector2i(0,1) && step.x() == 1 && block.y() == 0 && m_last.y() == m_rows-1 )
+      step = m_step;
+
+    bool was_sweep = m_run > 0;
+    if ( step == m_step ) {
+      m_run++;
+    } else {
+      m_step = step;
+      m_run  = 0;
+    }
+    m_last = block;
+
+    bool neighbour = std::abs(step.x()) <= 1 && std::abs(step.y()) <= 1;
+    if ( !neighbour )
+      return true;
+
+    if ( m_run > 0 && ( step.x() == 0 || step.y() == 0 ) ) {
+      Vector2i next = block;
+      for ( int32 i = 0; i < m_depth; ++i ) {
+        next += step;
+        if ( step == Vector2i(1,0) && next.x() >= m_cols )
+          next = Vector2i( 0, next.y() + 1 );
+        else if ( step == Vector2i(0,1) && next.y() >= m_rows )
+          next = Vector2i( next.x() + 1, 0 );
+        if ( next.x() < 0 || next.y() < 0 || next.x() >= m_cols || next.y() >= m_rows )
+          break;
+        predictions.push_back( next );
+      }
+      return false;
+    }
+
+    static const int32 offsets[4][2] = { {1,0}, {0,1}, {-1,0}, {0,-1} };
+    for ( int32 i = 0; i < 4 && int32(predictions.size()) < m_depth; ++i ) {
+      Vector2i next = block + Vector2i( offsets[i][0], offsets[i][1] );
+      if ( next == block - step ||
+           next.x() < 0 || next.y() < 0 || next.x() >= m_cols || next.y() >= m_rows )
+        continue;
+      predictions.push_back( next );
+    }
+    return was_sweep;
+  }
+
+}} // namespace vw::image_block
@@ -34,9 +34,16 @@
 #ifndef __VW_IMAGE_BLOCKPROCESSOR_H__
 #define __VW_IMAGE_BLOCKPROCESSOR_H__
 
+#include <vw/Core/Cache.h>
 #include <vw/Core/Settings.h>
 #include <vw/Core/Thread.h>
+#include <vw/Core/Prefetcher.h>
 #include <vw/Math/BBox.h>
+#include <vw/Image/ImageViewBase.h>
+
+#include <algorithm>
+#include <set>
+#include <vector>
 
 namespace vw {
 
@@ -44,13 +51,37 @@ namespace vw {
 ///  them from being accidentally used.
 namespace image_block {
   
+  /// The order in which a BlockProcessor hands out blocks.
+  /// - Along a space-filling curve, blocks that are processed close
+  ///   together in time are also close together in the image, so they
+  ///   share more of their source tiles, halos and cache lines.
+  enum BlockOrder {
+    RowMajorBlockOrder, ///< Left to right, then top to bottom.
+    ZBlockOrder,        ///< Morton (Z-order) curve.
+    HilbertBlockOrder   ///< Hilbert curve.  The default.
+  };
+
+  /// Returns the (column,row) indices of a grid of blocks in the given order.
+  std::vector<Vector2i> block_grid_order( int32 cols, int32 rows, BlockOrder order );
+
+  /// The number of bytes of CPU cache available to each of the given
+  /// number of threads.  Derived from the L2 and L3 sizes where the
+  /// system reports them.
+  size_t cache_bytes_per_thread( uint32 num_threads );
+
+  /// Picks a block size for an image of the given size.  See
+  /// get_cache_block_size() below.
+  Vector2i choose_block_size( int32 rows, int32 cols, size_t pixel_bytes,
+                              Vector2i const& preferred_size, uint32 num_threads );
+
   /// Class to call m_func(BBox2i) in parallel.  It is up to the FuncT
   ///  type to handle what that should do.
   template <class FuncT>
   class BlockProcessor {
-    FuncT    m_func;
-    Vector2i m_block_size;
-    uint32   m_num_threads;
+    FuncT      m_func;
+    Vector2i   m_block_size;
+    uint32     m_num_threads;
+    BlockOrder m_order;
   public:
 
     /// Create a BlockProcessor object with the specified parameters.
@@ -58,9 +89,13 @@ namespace image_block {
     ///   by the specified number of threads.
     /// - The func object must have an operator(BBox2i) function that does whatever
     ///   it is you want done.
-    BlockProcessor( FuncT const& func, Vector2i const& block_size, uint32 threads = 0 )
+    /// - Blocks are handed out in the given order.  There is no guarantee
+    ///   about the order in which they finish.
+    BlockProcessor( FuncT const& func, Vector2i const& block_size, uint32 threads = 0,
+                    BlockOrder order = HilbertBlockOrder )
       : m_func(func), m_block_size(block_size),
-        m_num_threads(threads?threads:(vw_settings().default_num_threads())) {}
+        m_num_threads(threads?threads:(vw_settings().default_num_threads())),
+        m_order(order) {}
 
     /// We will construct and call one BlockThread per thread.
     class BlockThread {
@@ -69,14 +104,23 @@ namespace image_block {
       // which stores information about what block should be processed next.
       class Info {
       public:
-        Info( FuncT const& func, BBox2i const& total_bbox, Vector2i const& block_size )
+        Info( FuncT const& func, BBox2i const& total_bbox, Vector2i const& block_size, BlockOrder order )
           : m_func(func), m_total_bbox(total_bbox),
-            m_block_bbox(round_down(total_bbox.min().x(),block_size.x()),round_down(total_bbox.min().y(),block_size.y()),block_size.x(),block_size.y()),
-            m_block_size(block_size) {}
+            m_origin(round_down(total_bbox.min().x(),block_size.x()),round_down(total_bbox.min().y(),block_size.y())),
+            m_block_size(block_size), m_next(0) {
+          if( !total_bbox.empty() ) {
+            int32 cols = (total_bbox.max().x() - m_origin.x() + block_size.x() - 1) / block_size.x();
+            int32 rows = (total_bbox.max().y() - m_origin.y() + block_size.y() - 1) / block_size.y();
+            m_blocks = block_grid_order( cols, rows, order );
+          }
+        }
 
         // Return the next block bbox to process.
         BBox2i bbox() const {
-          BBox2i block_bbox = m_block_bbox;
+          Vector2i const& index = m_blocks[m_next];
+          BBox2i block_bbox( m_origin.x() + index.x()*m_block_size.x(),
+                             m_origin.y() + index.y()*m_block_size.y(),
+                             m_block_size.x(), m_block_size.y() );
           block_bbox.crop( m_total_bbox );
           return block_bbox;
         }
@@ -88,7 +132,7 @@ namespace image_block {
 
         // Are we finished?
         bool complete() const {
-          return ( m_block_bbox.min().y() >= m_total_bbox.max().y() );
+          return ( m_next >= m_blocks.size() );
         }
 
         // Returns the info mutex, for locking.
@@ -96,15 +140,9 @@ namespace image_block {
           return m_mutex;
         }
 
-        // Advance the block_bbox to point to the next block to process.
+        // Advance to the next block to process.
         void advance() {
-          m_block_bbox.min().x() += m_block_size.x();
-          if( m_block_bbox.min().x() >= m_total_bbox.max().x() ) {
-            m_block_bbox.min().x() = round_down(m_total_bbox.min().x(),m_block_size.x());
-            m_block_bbox.min().y() += m_block_size.y();
-            m_block_bbox.max().y() = m_block_bbox.min().y() + m_block_size.y();
-          }
-          m_block_bbox.max().x() = m_block_bbox.min().x() + m_block_size.x();
+          ++m_next;
         }
 
       private:
@@ -117,8 +155,10 @@ namespace image_block {
         }
 
         FuncT const& m_func;
-        BBox2i   m_total_bbox, m_block_bbox;
-        Vector2i m_block_size;
+        BBox2i   m_total_bbox;
+        Vector2i m_origin, m_block_size;
+        std::vector<Vector2i> m_blocks;
+        size_t   m_next;
         Mutex    m_mutex;
       }; // End class Info
 
@@ -147,7 +187,7 @@ namespace image_block {
     /// Break bbox into sections of block_size, then call
     ///  func(sub_bbox) for each of them.
     inline void operator()( BBox2i bbox ) const {
-      typename BlockThread::Info info( m_func, bbox, m_block_size );
+      typename BlockThread::Info info( m_func, bbox, m_block_size, m_order );
 
       // Avoid threads altogether in the single-threaded case.
       // Annoyingly, this still creates an unnecessary Mutex.
@@ -192,6 +232,61 @@ namespace image_block {
     return Vector2i( cols, block_rows );
   }
 
+  /// Get a block size that lines up with the tiles of the source.
+  /// - Blocks are whole multiples of preferred_size (usually the tile
+  ///   size of the underlying resource, see preferred_block_size()), so
+  ///   no source tile is split between blocks.
+  /// - Blocks are sized to fill the per-thread share of the CPU cache.
+  /// - Blocks are made smaller if needed so that each of num_threads
+  ///   threads gets several of them.
+  template<typename PixelT>
+  Vector2i get_cache_block_size(int rows, int cols, int planes,
+                                Vector2i const& preferred_size,
+                                uint32 num_threads = 0) {
+    if( planes < 1 ) planes = 1;
+    return choose_block_size( rows, cols, planes*sizeof(PixelT), preferred_size,
+                              num_threads ? num_threads : vw_settings().default_num_threads() );
+  }
+
+  /// Get the block size to process an image in when none was requested.
+  /// Images that report a preferred_block_size() get the tile aligned
+  /// blocks of get_cache_block_size(), all others the strips of
+  /// get_default_block_size().
+  template <class ImageT>
+  Vector2i get_image_block_size( ImageT const& image, uint32 num_threads = 0 ) {
+    typedef typename ImageT::pixel_type pixel_type;
+    Vector2i preferred = preferred_block_size( image );
+    if( preferred.x() <= 0 || preferred.y() <= 0 )
+      return get_default_block_size<pixel_type>( image.rows(), image.cols(), image.planes() );
+    return get_cache_block_size<pixel_type>( image.rows(), image.cols(), image.planes(),
+                                             preferred, num_threads );
+  }
+
+
+  /// Guesses which blocks of a grid will be read next from the order
+  /// in which they have been read so far.
+  ///
+  /// Straight sweeps, where the same step has been taken at least
+  /// twice running (a raster scan wrapping onto the next row counts),
+  /// predict the next few blocks along the sweep.  Spatially coherent
+  /// walks, such as Hilbert order or the footprint of a transform,
+  /// where each block is a neighbour of the previous one, predict the
+  /// 4-neighbours of the current block.  Jumps predict nothing.
+  class BlockAccessPredictor {
+    int32    m_cols, m_rows, m_depth;
+    Vector2i m_last, m_step;
+    int32    m_run;
+    bool     m_started;
+  public:
+    /// Set up for a grid of cols x rows blocks, predicting at most
+    /// depth blocks at a time.
+    BlockAccessPredictor( int32 cols = 0, int32 rows = 0, int32 depth = 0 );
+
+    /// Record a read of a block and fill in the blocks expected next.
+    /// Returns true if this read broke the pattern that earlier
+    /// predictions were based on, so those are no longer wanted.
+    bool observe( Vector2i const& block, std::vector<Vector2i>& predictions );
+  };
 
   /// These objects rasterize a full block of image data to be stored in the cache.
   /// - Set up with a source image and an ROI.  When generate() is called, and
@@ -222,6 +317,89 @@ namespace image_block {
     }
   }; // End class BlockGenerator
 
+  /// Reads the blocks of a BlockGeneratorManager into the cache ahead
+  /// of time, on a Prefetcher's I/O threads, following the order in
+  /// which the blocks are being requested.  Requests that are no longer
+  /// wanted are cancelled when the access pattern changes, and all of
+  /// them are cancelled (and any running ones waited for) when the
+  /// last manager sharing this object goes away.
+  ///
+  /// Each rasterize request reports all of its blocks at once, in the
+  /// order they are processed in, so the threads working on the blocks
+  /// of one request do not interleave in the pattern.
+  template <class ImageT>
+  class BlockReadAhead : private boost::noncopyable {
+    typedef Cache::Handle<BlockGenerator<ImageT> > handle_type;
+
+    class Request : public PrefetchRequest {
+      handle_type m_handle;
+    public:
+      Request( handle_type const& handle ) : m_handle(handle) {}
+      virtual size_t size() const { return m_handle.size(); }
+      virtual void operator()() {
+        if ( m_handle.valid() )
+          return;
+        m_handle.operator->(); // Generates the block
+        m_handle.release();
+      }
+    };
+
+    Prefetcher&                       m_prefetcher;
+    boost::shared_ptr<PrefetchStream> m_stream;
+    boost::shared_array<handle_type>  m_table;
+    int32                             m_table_width;
+    size_t                            m_max_issued;
+    Mutex                             m_mutex;
+    BlockAccessPredictor              m_predictor;
+    std::vector<Vector2i>             m_predictions;
+    std::set<int32>                   m_issued; ///< Blocks requested since the last cancel
+    int32                             m_last;
+
+  public:
+    BlockReadAhead( Prefetcher& prefetcher, boost::shared_array<handle_type> const& table,
+                    int32 table_width, int32 table_height, int32 depth )
+      : m_prefetcher(prefetcher), m_stream(new PrefetchStream()), m_table(table),
+        m_table_width(table_width), m_max_issued(16*depth),
+        m_predictor(table_width, table_height, depth), m_last(-1) {}
+
+    ~BlockReadAhead() { m_stream->cancel_and_wait(); }
+
+    /// Record that a request is about to use these blocks, in order,
+    /// and read ahead of the last of them.
+    void observe( std::vector<Vector2i> const& blocks ) {
+      Mutex::Lock lock(m_mutex);
+      bool moved = false, broken = false;
+      for ( size_t i = 0; i < blocks.size(); ++i ) {
+        int32 index = blocks[i].x() + blocks[i].y()*m_table_width;
+        if ( index == m_last ) // Still in the same block
+          continue;
+        m_last = index;
+        moved  = true;
+        if ( m_predictor.observe( blocks[i], m_predictions ) )
+          broken = true;
+      }
+      if ( !moved )
+        return;
+
+      if ( broken || m_issued.size() > m_max_issued ) {
+        m_stream->cancel();
+        m_issued.clear();
+      }
+      for ( size_t i = 0; i < m_predictions.size(); ++i ) {
+        int32 next = m_predictions[i].x() + m_predictions[i].y()*m_table_width;
+        if ( !m_issued.insert(next).second )
+          continue;
+        boost::shared_ptr<PrefetchRequest> request( new Request( m_table[next] ) );
+        if ( !m_prefetcher.submit( m_stream, request ) ) {
+          m_issued.erase(next); // Out of budget, try again later
+          break;
+        }
+      }
+    }
+
+    PrefetchStream const& stream() const { return *m_stream; }
+  };
+
   /// Manages a table of BlockGenerator objects spanning an entire image.
   template <class ImageT>
   class BlockGeneratorManager {
@@ -231,6 +409,7 @@ namespace image_block {
     int      m_table_width, m_table_height;
     size_t   m_block_table_size;
     boost::shared_array<Cache::Handle<BlockGenerator<ImageT> > > m_block_table;
+    boost::shared_ptr<BlockReadAhead<ImageT> > m_read_ahead;
 
   public:
 
@@ -269,6 +448,39 @@ namespace image_block {
 
     } // End initialize()
 
+    /// Start reading blocks ahead of time on the prefetcher's threads.
+    /// Read-ahead is limited to a quarter of the cache, so it does not
+    /// evict the blocks that are still in use.
+    void enable_read_ahead( Prefetcher& prefetcher ) {
+      static const size_t max_depth = 8;
+      if ( !m_cache_ptr || m_block_table_size < 2 || !prefetcher.enabled() )
+        return;
+      size_t block_bytes = std::max( m_block_table[0].size(), size_t(1) );
+      size_t budget      = std::min( prefetcher.max_bytes(), m_cache_ptr->max_size() / 4 );
+      size_t depth       = std::min( budget / block_bytes, max_depth );
+      if ( depth == 0 )
+        return;
+      m_read_ahead.reset( new BlockReadAhead<ImageT>( prefetcher, m_block_table, m_table_width,
+                                                      m_table_height, int32(depth) ) );
+    }
+
+    /// The read-ahead state, or null if read-ahead is off.
+    BlockReadAhead<ImageT> const* read_ahead() const { return m_read_ahead.get(); }
+
+    /// Tell the read-ahead, if any, that the blocks under bbox are
+    /// about to be rasterized by a BlockProcessor, in its block order.
+    void note_request( BBox2i const& bbox ) const {
+      if ( !m_read_ahead || bbox.empty() )
+        return;
+      Vector2i first = get_block_index( bbox.min() );
+      Vector2i last  = get_block_index( bbox.max() - Vector2i(1,1) );
+      std::vector<Vector2i> blocks = block_grid_order( last.x() - first.x() + 1,
+                                                       last.y() - first.y() + 1, HilbertBlockOrder );
+      for ( size_t i = 0; i < blocks.size(); ++i )
+        blocks[i] += first;
+      m_read_ahead->observe( blocks );
+    }
+
     /// Return the block index for a given input pixel.
     Vector2i get_block_index( Vector2i pixel ) const {
       return Vector2i(pixel.x()/m_block_size.x(), pixel.y()/m_block_size.y());
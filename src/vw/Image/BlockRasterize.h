@@ -52,7 +52,7 @@ namespace vw {
         m_cache_ptr       ( cache )
     {
       if( m_block_size.x() <= 0 || m_block_size.y() <= 0 )
-        m_block_size = image_block::get_default_block_size<pixel_type>(image.rows(), image.cols(), image.planes());
+        m_block_size = image_block::get_image_block_size(image, num_threads);
 
       if (m_cache_ptr) // Manager is not needed if not using a cache.
         m_block_manager.initialize(m_cache_ptr, m_block_size, m_child);
@@ -94,6 +94,21 @@ namespace vw {
     ImageT      & child()       { return *m_child; }
     ImageT const& child() const { return *m_child; }
 
+    /// The size of the blocks the child is rasterized in.
+    Vector2i block_size() const { return m_block_size; }
+
+    /// Read blocks into the cache ahead of time, following the order
+    /// in which rasterize() requests them.  Single pixel reads are not
+    /// followed.  Does nothing without a cache.
+    void enable_read_ahead( Prefetcher& prefetcher ) {
+      m_block_manager.enable_read_ahead( prefetcher );
+    }
+
+    /// The read-ahead state, or null if read-ahead is off.
+    image_block::BlockReadAhead<ImageT> const* read_ahead() const {
+      return m_block_manager.read_ahead();
+    }
+
     typedef CropView<ImageView<pixel_type> > prerasterize_type;
     inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
       // Init output data
@@ -105,6 +120,9 @@ namespace vw {
     }
 
     template <class DestT> inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      // Read ahead, if enabled, once per request rather than per block
+      if ( m_cache_ptr )
+        m_block_manager.note_request(bbox);
       // Create functor to rasterize this image into the destination image
       RasterizeFunctor<DestT> rasterizer( *this, dest, bbox.min() );
       // Set up block processor to call the functor in parallel blocks.
@@ -160,6 +178,12 @@ namespace vw {
     image_block::BlockGeneratorManager<ImageT> m_block_manager;
   };
 
+  /// Block processing of a BlockRasterizeView should line up with its blocks.
+  template <class ImageT>
+  inline Vector2i preferred_block_size( BlockRasterizeView<ImageT> const& view ) {
+    return view.block_size();
+  }
+
   /// Create a BlockRasterizeView with no caching.
   template <class ImageT>
   inline BlockRasterizeView<ImageT> block_rasterize( ImageViewBase<ImageT> const& image,
@@ -0,0 +1,200 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Image/DistanceTransform.h>
+#include <vw/Core/ThreadPool.h>
+
+#include <boost/shared_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using namespace vw;
+
+namespace {
+
+  // Below this many pixels the passes are not worth handing to threads.
+  const int64 MIN_THREADED_PIXELS = 256*256;
+
+  // Distance down each column, in pixels, to the nearest background
+  // pixel in that column, for the columns [begin,end).  The rows are
+  // walked in order so that every access is contiguous.
+  class ColumnPassTask : public Task {
+    ImageView<uint8> const& m_foreground;
+    ImageView<float>& m_dst;
+    int32 m_begin, m_end;
+    bool m_ignore_borders;
+    float m_infinity;
+
+  public:
+    ColumnPassTask( ImageView<uint8> const& foreground, ImageView<float>& dst,
+                    int32 begin, int32 end, bool ignore_borders, float infinity )
+      : m_foreground(foreground), m_dst(dst), m_begin(begin), m_end(end),
+        m_ignore_borders(ignore_borders), m_infinity(infinity) {}
+
+    virtual ~ColumnPassTask() {}
+
+    virtual void operator()() {
+      const int32 rows  = m_dst.rows();
+      const int32 width = m_end - m_begin;
+      // The rows just outside the image are background unless the
+      // borders are ignored.
+      const float outside = m_ignore_borders ? m_infinity : 0.0f;
+
+      // Downwards.
+      for ( int32 row = 0; row < rows; ++row ) {
+        const uint8* fg  = &m_foreground(m_begin,row);
+        float*       out = &m_dst(m_begin,row);
+        const float* above = row > 0 ? &m_dst(m_begin,row-1) : 0;
+        for ( int32 i = 0; i < width; ++i ) {
+          float previous = above ? above[i] : outside;
+          out[i] = fg[i] ? std::min( previous + 1, m_infinity ) : 0.0f;
+        }
+      }
+
+      // Upwards.
+      if ( rows > 0 && !m_ignore_borders ) {
+        float* last = &m_dst(m_begin,rows-1);
+        for ( int32 i = 0; i < width; ++i )
+          last[i] = std::min( last[i], 1.0f );
+      }
+      for ( int32 row = rows-2; row >= 0; --row ) {
+        float*       out   = &m_dst(m_begin,row);
+        const float* below = &m_dst(m_begin,row+1);
+        for ( int32 i = 0; i < width; ++i )
+          out[i] = std::min( out[i], below[i] + 1 );
+      }
+    }
+  };
+
+  // Where the parabola rooted at q overtakes the one rooted at p < q.
+  inline double intersection( std::vector<double> const& f, int32 p, int32 q ) {
+    return ( (f[q] + double(q)*q) - (f[p] + double(p)*p) ) / ( 2.0*(q - p) );
+  }
+
+  // Replaces the column distances of the rows [begin,end) with the
+  // Euclidean distances, as the lower envelope of the parabolas
+  // (x-q)^2 + g(q)^2 (Felzenszwalb & Huttenlocher, 2004).
+  class RowPassTask : public Task {
+    ImageView<float>& m_dst;
+    int32 m_begin, m_end;
+    bool m_ignore_borders;
+    float m_infinity;
+
+  public:
+    RowPassTask( ImageView<float>& dst, int32 begin, int32 end,
+                 bool ignore_borders, float infinity )
+      : m_dst(dst), m_begin(begin), m_end(end),
+        m_ignore_borders(ignore_borders), m_infinity(infinity) {}
+
+    virtual ~RowPassTask() {}
+
+    virtual void operator()() {
+      const int32 cols = m_dst.cols();
+      std::vector<double> f( cols ), z( cols+1 );
+      std::vector<int32>  v( cols );
+
+      for ( int32 row = m_begin; row < m_end; ++row ) {
+        float* line = &m_dst(0,row);
+        for ( int32 q = 0; q < cols; ++q )
+          f[q] = double(line[q]) * line[q];
+
+        // The parabolas that make up the lower envelope, and the
+        // boundaries between them.
+        int32 k = 0;
+        v[0] = 0;
+        z[0] = -std::numeric_limits<double>::infinity();
+        z[1] =  std::numeric_limits<double>::infinity();
+        for ( int32 q = 1; q < cols; ++q ) {
+          double s = intersection( f, v[k], q );
+          while ( s <= z[k] ) {
+            --k;
+            s = intersection( f, v[k], q );
+          }
+          ++k;
+          v[k]   = q;
+          z[k]   = s;
+          z[k+1] = std::numeric_limits<double>::infinity();
+        }
+
+        k = 0;
+        for ( int32 q = 0; q < cols; ++q ) {
+          while ( z[k+1] < q )
+            ++k;
+          double dx = q - v[k];
+          double d  = dx*dx + f[v[k]];
+          if ( !m_ignore_borders ) {
+            // The columns just outside the image are background.
+            double left = q + 1, right = cols - q;
+            d = std::min( d, std::min( left*left, right*right ) );
+          }
+          line[q] = float( std::min( std::sqrt(d), double(m_infinity) ) );
+        }
+      }
+    }
+  };
+
+} // namespace
+
+void vw::detail::euclidean_distance( ImageView<uint8> const& foreground, ImageView<float>& dst,
+                                     bool ignore_borders, int32 num_threads ) {
+  const int32 cols = foreground.cols(), rows = foreground.rows();
+  dst.set_size( cols, rows );
+  if ( cols == 0 || rows == 0 )
+    return;
+
+  // Same cap as grassfire() uses for pixels with no background in sight.
+  const float infinity = float( cols + rows );
+
+  if ( num_threads <= 0 )
+    num_threads = vw_settings().default_num_threads();
+  if ( num_threads < 2 || int64(cols)*rows < MIN_THREADED_PIXELS ) {
+    ColumnPassTask( foreground, dst, 0, cols, ignore_borders, infinity )();
+    RowPassTask( dst, 0, rows, ignore_borders, infinity )();
+    return;
+  }
+
+  // A few strips per thread keeps the threads busy to the end.
+  const int32 num_strips = 4*num_threads;
+  const int32 col_strip  = std::max( 1, (cols + num_strips - 1) / num_strips );
+  const int32 row_strip  = std::max( 1, (rows + num_strips - 1) / num_strips );
+
+  {
+    FifoWorkQueue queue( num_threads );
+    for ( int32 begin = 0; begin < cols; begin += col_strip ) {
+      boost::shared_ptr<ColumnPassTask>
+        task( new ColumnPassTask( foreground, dst, begin, std::min( begin + col_strip, cols ),
+                                  ignore_borders, infinity ) );
+      queue.add_task( task );
+    }
+    queue.join_all();
+  }
+
+  {
+    FifoWorkQueue queue( num_threads );
+    for ( int32 begin = 0; begin < rows; begin += row_strip ) {
+      boost::shared_ptr<RowPassTask>
+        task( new RowPassTask( dst, begin, std::min( begin + row_strip, rows ),
+                               ignore_borders, infinity ) );
+      queue.add_task( task );
+    }
+    queue.join_all();
+  }
+}
@@ -0,0 +1,102 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+/// \file DistanceTransform.h
+///
+/// Exact Euclidean distance transform.
+///
+#ifndef __VW_IMAGE_DISTANCETRANSFORM_H__
+#define __VW_IMAGE_DISTANCETRANSFORM_H__
+
+#include <vw/Core/Settings.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelTypeInfo.h>
+
+#include <cmath>
+#include <limits>
+
+namespace vw {
+
+  namespace detail {
+
+    /// Computes euclidean_distance() of a binary image, where nonzero
+    /// marks the pixels that are away from the background.
+    void euclidean_distance( ImageView<uint8> const& foreground, ImageView<float>& dst,
+                             bool ignore_borders, int32 num_threads );
+  }
+
+  // *******************************************************************
+  // euclidean_distance()
+  // *******************************************************************
+
+  /// Computes the exact Euclidean distance from each pixel to the
+  /// nearest pixel with zero value, assuming the pixels just outside
+  /// the image are zero.  This is the round counterpart of grassfire(),
+  /// and is what should be used to feather an alpha channel.
+  /// - If ignore_borders is set, the outside of the image is not
+  ///   treated as zero.  An image with no zero pixels is then
+  ///   everywhere at distance cols+rows.
+  /// - The source is read a strip of rows at a time, and only a byte
+  ///   per pixel is kept of it.
+  /// - Both separable passes (Felzenszwalb & Huttenlocher) are split
+  ///   into strips of columns or rows and run on num_threads threads,
+  ///   or the default number of threads if zero.
+  /// - Integer outputs are rounded to the nearest integer.
+  template <class SourceT, class OutputT>
+  void euclidean_distance( ImageViewBase<SourceT> const& src, ImageView<OutputT>& dst,
+                           bool ignore_borders = false, int32 num_threads = 0 ) {
+    typedef typename SourceT::pixel_type pixel_type;
+    const pixel_type zero = pixel_type();
+    int32 cols = src.impl().cols(), rows = src.impl().rows();
+
+    ImageView<uint8> foreground( cols, rows );
+    int32 strip_rows = std::max( 1, int32(vw_settings().default_tile_size()) );
+    for ( int32 row0 = 0; row0 < rows; row0 += strip_rows ) {
+      BBox2i strip( 0, row0, cols, std::min( strip_rows, rows - row0 ) );
+      ImageView<pixel_type> pixels = crop( src.impl(), strip );
+      for ( int32 row = 0; row < pixels.rows(); ++row )
+        for ( int32 col = 0; col < cols; ++col )
+          foreground( col, row0 + row ) = !( pixels(col,row) == zero );
+    }
+
+    ImageView<float> distance;
+    detail::euclidean_distance( foreground, distance, ignore_borders, num_threads );
+    foreground.reset();
+
+    dst.set_size( cols, rows );
+    const bool round = std::numeric_limits<typename CompoundChannelType<OutputT>::type>::is_integer;
+    for ( int32 row = 0; row < rows; ++row )
+      for ( int32 col = 0; col < cols; ++col )
+        dst(col,row) = round ? OutputT( std::floor( distance(col,row) + 0.5f ) )
+                             : OutputT( distance(col,row) );
+  }
+
+  /// Without destination given, return in a newly-created ImageView<float>
+  template <class SourceT>
+  ImageView<float> euclidean_distance( ImageViewBase<SourceT> const& src,
+                                       bool ignore_borders = false, int32 num_threads = 0 ) {
+    ImageView<float> result;
+    euclidean_distance( src, result, ignore_borders, num_threads );
+    return result;
+  }
+
+} // namespace vw
+
+#endif // __VW_IMAGE_DISTANCETRANSFORM_H__
@@ -144,6 +144,9 @@ namespace vw {
 
     ImageT     const& child() const { return m_image;          }
     ExtensionT const& func () const { return m_extension_func; }
+    /// The position of this view's origin in the child's coordinates.
+    int32 xoffset() const { return m_xoffset; }
+    int32 yoffset() const { return m_yoffset; }
     BBox2i source_bbox( BBox2i const& bbox ) const {
       return m_extension_func.source_bbox( m_image, bbox + Vector2i( m_xoffset, m_yoffset ) );
     }
@@ -240,16 +240,14 @@ void ErodeView<ImageT>::absorb(blob::BlobCompressed const& newBlob)
     }
 
     // Loop through all segments for this row
-    std::list<int32>::const_iterator iterStart, iterEnd;
-    for (iterStart =  newBlob.start(row).begin(), iterEnd = newBlob.end(row).begin();
-         iterStart != newBlob.start(row).end();
-         ++iterStart, ++iterEnd)
+    const int numRuns = newBlob.num_runs(row);
+    for (int run=0; run<numRuns; ++run)
     {
       //TODO: Existing blob code lists the end as ONE AFTER the blob
       //     ---> Need to modify this code so that it stores them the same way!
       // These are the starting and stopping columns of the current segment
-      int segmentStart = *iterStart + xOffset;
-      int segmentEnd   = *iterEnd   + xOffset - 1;
+      int segmentStart = newBlob.run_start(row, run) + xOffset;
+      int segmentEnd   = newBlob.run_end  (row, run) + xOffset - 1;
 
       // Find the first segment ending after the start of this segment.
       // - Need to use start-1 to catch any segment ending adjacent to the new start.
@@ -199,6 +199,10 @@ namespace vw {
   /// needed.  Specifying a zero value of x_dim or y_dim causes the
   /// corresponding dimension to be chose automatically as appropriate
   /// for the requested standard deviation.
+  ///
+  /// Floating point images are filtered along flat rows.  See
+  /// vw::recursive_gaussian_filter for a faster approximation at
+  /// large standard deviations.
   template <class SrcT, class EdgeT>
   SeparableConvolutionView<SrcT, typename DefaultKernelT<typename SrcT::pixel_type>::type, EdgeT>
   inline gaussian_filter( ImageViewBase<SrcT> const& src, double x_sigma, double y_sigma, int32 x_dim, int32 y_dim, EdgeT edge ) {
@@ -257,6 +261,40 @@ namespace vw {
     return gaussian_filter( src, sigma, sigma, 0, 0, ConstantEdgeExtension() );
   }
 
+  /// Like vw::gaussian_filter with default kernel dimensions, except
+  /// that when rasterizing floating point images, large standard
+  /// deviations (kernels of convolution::recursive_gaussian_min_size
+  /// taps or more) are applied with Deriche's recursive approximation
+  /// of the Gaussian.  Its cost does not grow with sigma, but its
+  /// results differ from the sampled kernel by up to about 1e-3.
+  template <class SrcT, class EdgeT>
+  SeparableConvolutionView<SrcT, typename DefaultKernelT<typename SrcT::pixel_type>::type, EdgeT>
+  inline recursive_gaussian_filter( ImageViewBase<SrcT> const& src, double x_sigma, double y_sigma, EdgeT edge ) {
+    SeparableConvolutionView<SrcT, typename DefaultKernelT<typename SrcT::pixel_type>::type, EdgeT> result =
+      gaussian_filter( src, x_sigma, y_sigma, 0, 0, edge );
+    result.set_gaussian_sigma( x_sigma, y_sigma );
+    return result;
+  }
+
+  /// This is an overloaded function provided for convenience; see
+  /// vw::recursive_gaussian_filter. It uses the default
+  /// vw::ConstantEdgeExtension mode.
+  template <class SrcT>
+  SeparableConvolutionView<SrcT, typename DefaultKernelT<typename SrcT::pixel_type>::type, ConstantEdgeExtension>
+  inline recursive_gaussian_filter( ImageViewBase<SrcT> const& src, double x_sigma, double y_sigma ) {
+    return recursive_gaussian_filter( src, x_sigma, y_sigma, ConstantEdgeExtension() );
+  }
+
+  /// This is an overloaded function provided for convenience; see
+  /// vw::recursive_gaussian_filter. It uses the same standard
+  /// deviation in both directions and the default
+  /// vw::ConstantEdgeExtension mode.
+  template <class SrcT>
+  SeparableConvolutionView<SrcT, typename DefaultKernelT<typename SrcT::pixel_type>::type, ConstantEdgeExtension>
+  inline recursive_gaussian_filter( ImageViewBase<SrcT> const& src, double sigma ) {
+    return recursive_gaussian_filter( src, sigma, sigma, ConstantEdgeExtension() );
+  }
+
 
   // Image differentiation functions
 
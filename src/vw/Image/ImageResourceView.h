@@ -117,6 +117,12 @@ namespace vw {
     boost::shared_ptr<Mutex> m_rsrc_mutex;
   };
 
+  /// Resources are cheapest to read in their native blocks.
+  template <class PixelT>
+  inline Vector2i preferred_block_size( ImageResourceView<PixelT> const& view ) {
+    return view.resource()->block_read_size();
+  }
+
 } // namespace vw
 
 #endif // __VW_IMAGE_IMAGERESOURCEVIEW_H__
@@ -28,12 +28,47 @@
 #include <boost/smart_ptr.hpp>
 #include <boost/type_traits.hpp>
 
+#include <vw/Core/MemoryPool.h>
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/ImageResource.h>
 #include <vw/Image/PixelAccessors.h>
 
 namespace vw {
 
+  namespace detail {
+
+    /// Releases an ImageView buffer that was obtained from vw_memory_pool().
+    template <class PixelT>
+    class PooledBufferDeleter {
+      size_t m_size;
+    public:
+      PooledBufferDeleter( size_t size ) : m_size(size) {}
+      void operator()( PixelT* ptr ) const {
+        if (!ptr)
+          return;
+        if (!boost::has_trivial_destructor<PixelT>::value)
+          for (size_t i = 0; i < m_size; ++i)
+            ptr[i].~PixelT();
+        image_buffer_deallocate(ptr, m_size*sizeof(PixelT));
+      }
+    };
+
+    /// Allocates an array of pixels from vw_memory_pool().  Returns an
+    /// empty array if the allocation failed.
+    template <class PixelT>
+    boost::shared_array<PixelT> pooled_pixel_buffer( size_t size ) {
+      PixelT* ptr = static_cast<PixelT*>(image_buffer_allocate(size*sizeof(PixelT)));
+      if (!ptr)
+        return boost::shared_array<PixelT>();
+      // Match the default-initialization done by new[].
+      if (!boost::has_trivial_constructor<PixelT>::value)
+        for (size_t i = 0; i < size; ++i)
+          new (ptr + i) PixelT;
+      return boost::shared_array<PixelT>(ptr, PooledBufferDeleter<PixelT>(size));
+    }
+
+  } // namespace detail
+
   /// The standard image container for in-memory image data.
   ///
   /// This class represents an image stored in memory or, more
@@ -203,7 +238,13 @@ namespace vw {
       if( size==0 )
         m_data.reset();
       else {
-        boost::shared_array<PixelT> data( new (std::nothrow) PixelT[size] );
+        // Tile-sized buffers come and go constantly, so reuse them through
+        // the pool when the user has enabled it in vw_settings().
+        boost::shared_array<PixelT> data;
+        if (detail::image_buffer_pool_enabled())
+          data = detail::pooled_pixel_buffer<PixelT>(size);
+        else
+          data.reset( new (std::nothrow) PixelT[size] );
         if (!data) {
           // print it and throw it for the benefit of OSX, which doesn't print the exception what() on terminate()
           VW_OUT(ErrorMessage)   << "Cannot allocate enough memory for a " 
@@ -341,6 +341,15 @@ namespace vw {
     rasterize( src, const_cast<DestT const&>(dest), BBox2i(0,0,src.cols(),src.rows()) );
   }
 
+  /// Returns the block size a view would like to be read in, or a
+  /// zero vector if it has no preference.  Views backed by a tiled
+  /// resource overload this to report their tile size, so that block
+  /// processing can line its blocks up with the tiles.
+  template <class ViewT>
+  inline Vector2i preferred_block_size( ImageViewBase<ViewT> const& /*view*/ ) {
+    return Vector2i();
+  }
+
   template <class Image1T, class Image2T>
   inline bool equal( ImageViewBase<Image1T> const& m1, ImageViewBase<Image2T> const& m2) {
     if (m1.impl().cols()!=m2.impl().cols() || m1.impl().rows()!=m2.impl().rows() || m1.impl().planes()!=m2.impl().planes())
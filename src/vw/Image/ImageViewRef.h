@@ -38,95 +38,22 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/scoped_ptr.hpp>
 
+#include <algorithm>
+
 #include <vw/Image/ImageView.h>
 #include <vw/Image/Manipulation.h>
+#include <vw/Image/EdgeExtension.h>
+#include <vw/Image/Interpolation.h>
 #include <vw/Image/SparseImageCheck.h>
 
 namespace vw {
 
-  /// \cond INTERNAL
-  template <class PixelT>
-  class ImageViewRefAccessorBase {
-  public:
-    virtual ~ImageViewRefAccessorBase() {}
-    virtual ImageViewRefAccessorBase* copy() const = 0;
-    virtual void next_col  () = 0;
-    virtual void prev_col  () = 0;
-    virtual void next_row  () = 0;
-    virtual void prev_row  () = 0;
-    virtual void next_plane() = 0;
-    virtual void prev_plane() = 0;
-    virtual void advance( ssize_t di, ssize_t dj, ssize_t dp=0 ) = 0;
-    virtual PixelT operator*() const = 0;
-  };
-
-  template <class IterT>
-  class ImageViewRefAccessorImpl : public ImageViewRefAccessorBase<typename IterT::pixel_type> {
-  private:
-    IterT m_iter;
-    // We know what this is, but the base class doesn't. Just cast...
-    typedef typename IterT::offset_type iter_offset_type;
-  public:
-    typedef typename IterT::pixel_type pixel_type;
-
-    ImageViewRefAccessorImpl( IterT const& iter ) : m_iter(iter) {}
-    virtual ~ImageViewRefAccessorImpl() {}
-
-    virtual ImageViewRefAccessorBase<pixel_type>* copy() const { return new ImageViewRefAccessorImpl(m_iter); }
-
-    virtual void next_col  () { m_iter.next_col();   }
-    virtual void prev_col  () { m_iter.prev_col();   }
-    virtual void next_row  () { m_iter.next_row();   }
-    virtual void prev_row  () { m_iter.prev_row();   }
-    virtual void next_plane() { m_iter.next_plane(); }
-    virtual void prev_plane() { m_iter.prev_plane(); }
-    virtual void advance( ssize_t di, ssize_t dj, ssize_t dp=0 ) {
-      m_iter.advance((iter_offset_type)di,(iter_offset_type)dj,dp);
-    }
-    virtual pixel_type operator*() const { return *m_iter; }
-  };
-  /// \endcond
-
-  /// A special virtualized accessor adaptor.
-  ///
-  /// This accessor adaptor is used by the \ref vw::ImageViewRef class.
-  template <class PixelT>
-  class ImageViewRefAccessor {
-  private:
-    boost::scoped_ptr< ImageViewRefAccessorBase<PixelT> > m_iter;
-  public:
-    typedef PixelT  pixel_type;
-    typedef PixelT  result_type;
-    typedef ssize_t offset_type;
-
-    template <class IterT> ImageViewRefAccessor( IterT const& iter ) : m_iter( new ImageViewRefAccessorImpl<IterT>(iter) ) {}
-    ~ImageViewRefAccessor() {}
-
-    ImageViewRefAccessor( ImageViewRefAccessor const& other ) : m_iter( other.m_iter->copy() ) {}
-    ImageViewRefAccessor& operator=( ImageViewRefAccessor const& other ) { 
-      m_iter = other.m_iter->copy(); return *this; 
-    }
-
-    inline ImageViewRefAccessor& next_col  () { m_iter->next_col();   return *this; }
-    inline ImageViewRefAccessor& prev_col  () { m_iter->prev_col();   return *this; }
-    inline ImageViewRefAccessor& next_row  () { m_iter->next_row();   return *this; }
-    inline ImageViewRefAccessor& prev_row  () { m_iter->prev_row();   return *this; }
-    inline ImageViewRefAccessor& next_plane() { m_iter->next_plane(); return *this; }
-    inline ImageViewRefAccessor& prev_plane() { m_iter->prev_plane(); return *this; }
-    inline ImageViewRefAccessor& advance( ssize_t di, ssize_t dj, ssize_t dp=0 ) { 
-      m_iter->advance(di,dj,dp=0); return *this; 
-    }
-    inline pixel_type operator*() const { return *(*m_iter); }
-  };
-
-
   /// \cond INTERNAL
   // Base class definition
   template <class PixelT>
   class ImageViewRefBase {
   public:
     typedef PixelT pixel_type;
-    typedef ImageViewRefAccessor<PixelT> pixel_accessor;
 
     virtual ~ImageViewRefBase() {}
 
@@ -135,7 +62,10 @@ namespace vw {
     virtual int32 planes() const = 0;
     virtual pixel_type operator()( int32 i,  int32 j,  int32 p ) const = 0;
     virtual pixel_type operator()( double i, double j, int32 p ) const = 0;
-    virtual pixel_accessor origin() const = 0;
+
+    /// Copies the cols x rows block of pixels whose top-left corner is
+    /// (col,row) into dest, in row-major order.
+    virtual void fetch( int32 col, int32 row, int32 plane, int32 cols, int32 rows, pixel_type* dest ) const = 0;
 
     virtual bool sparse_check( BBox2i const& bbox ) const = 0;
     virtual void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const = 0;
@@ -148,7 +78,6 @@ namespace vw {
     ViewT m_view;
   public:
     typedef typename ViewT::pixel_type pixel_type;
-    typedef ImageViewRefAccessor<typename ViewT::pixel_type> pixel_accessor;
 
     ImageViewRefImpl( ImageViewBase<ViewT> const& view ) : m_view(view.impl()) {}
     virtual ~ImageViewRefImpl() {}
@@ -156,11 +85,23 @@ namespace vw {
     virtual int32          cols  () const { return m_view.cols();   }
     virtual int32          rows  () const { return m_view.rows();   }
     virtual int32          planes() const { return m_view.planes(); }
-    virtual pixel_accessor origin() const { return m_view.origin(); }
     
     virtual pixel_type     operator()( int32  i, int32  j, int32 p ) const { return m_view(i,j,p); }
     virtual pixel_type     operator()( double i, double j, int32 p ) const { return m_view(i,j,p); }
 
+    virtual void fetch( int32 col, int32 row, int32 plane, int32 cols, int32 rows, pixel_type* dest ) const {
+      typedef typename ViewT::pixel_accessor acc_type;
+      acc_type racc = m_view.origin().advance(col,row,plane);
+      for ( int32 j = 0; j < rows; ++j ) {
+        acc_type cacc = racc;
+        for ( int32 i = 0; i < cols; ++i ) {
+          *dest++ = *cacc;
+          cacc.next_col();
+        }
+        racc.next_row();
+      }
+    }
+
     virtual bool sparse_check( BBox2i const& bbox ) const { return vw::sparse_check( m_view, bbox ); }
     virtual void rasterize( ImageView<pixel_type> const& dest, BBox2i const& bbox ) const { m_view.rasterize( dest, bbox ); }
 
@@ -168,6 +109,94 @@ namespace vw {
   };
   /// \endcond
 
+  /// A special virtualized accessor adaptor.
+  ///
+  /// This accessor adaptor is used by the \ref vw::ImageViewRef class.
+  /// Rather than wrapping the child view's own accessor, which would
+  /// cost a virtual call for every step and every dereference, it
+  /// tracks its position itself and pulls pixels out of the view in
+  /// runs.  Stepping is free, and a dereference only goes through
+  /// the virtual interface when it leaves the current run.  Runs
+  /// start at a single pixel and double in length while the access
+  /// pattern stays sequential along a row, so column-wise or random
+  /// access never evaluates more than it needs to.
+  template <class PixelT>
+  class ImageViewRefAccessor {
+  public:
+    typedef PixelT  pixel_type;
+    typedef PixelT  result_type;
+    typedef ssize_t offset_type;
+
+  private:
+    static const int32 max_run = 32;
+
+    boost::shared_ptr<const ImageViewRefBase<PixelT> > m_view;
+    ssize_t m_col, m_row, m_plane;
+    int32   m_cols, m_rows;
+
+    // The cached run of pixels [m_run_col, m_run_col+m_run_size) on m_run_row.
+    mutable ssize_t m_run_col, m_run_row, m_run_plane;
+    mutable int32   m_run_size;
+    mutable pixel_type m_run[max_run];
+
+    pixel_type fetch() const {
+      int32 size = 1;
+      if ( m_run_size > 0 && m_row == m_run_row && m_plane == m_run_plane &&
+           m_col == m_run_col + m_run_size )
+        size = std::min( 2*m_run_size, int32(max_run) );
+      // Never read ahead past the edge of the image.
+      if ( m_col < 0 || m_row < 0 || m_row >= m_rows || m_col >= m_cols )
+        size = 1;
+      else
+        size = std::min( size, int32(m_cols - m_col) );
+
+      if ( size == 1 )
+        m_run[0] = (*m_view)( int32(m_col), int32(m_row), int32(m_plane) );
+      else
+        m_view->fetch( int32(m_col), int32(m_row), int32(m_plane), size, 1, m_run );
+      m_run_col   = m_col;
+      m_run_row   = m_row;
+      m_run_plane = m_plane;
+      m_run_size  = size;
+      return m_run[0];
+    }
+
+  public:
+    ImageViewRefAccessor( boost::shared_ptr<const ImageViewRefBase<PixelT> > const& view )
+      : m_view(view), m_col(0), m_row(0), m_plane(0),
+        m_cols(view->cols()), m_rows(view->rows()),
+        m_run_col(0), m_run_row(0), m_run_plane(0), m_run_size(0) {}
+
+    // The cached run is deliberately not copied; copies are usually
+    // made to step along a different row.
+    ImageViewRefAccessor( ImageViewRefAccessor const& other )
+      : m_view(other.m_view), m_col(other.m_col), m_row(other.m_row), m_plane(other.m_plane),
+        m_cols(other.m_cols), m_rows(other.m_rows),
+        m_run_col(0), m_run_row(0), m_run_plane(0), m_run_size(0) {}
+    ImageViewRefAccessor& operator=( ImageViewRefAccessor const& other ) { 
+      m_view  = other.m_view;
+      m_col   = other.m_col;   m_row  = other.m_row;  m_plane = other.m_plane;
+      m_cols  = other.m_cols;  m_rows = other.m_rows;
+      m_run_size = 0;
+      return *this;
+    }
+
+    inline ImageViewRefAccessor& next_col  () { ++m_col;   return *this; }
+    inline ImageViewRefAccessor& prev_col  () { --m_col;   return *this; }
+    inline ImageViewRefAccessor& next_row  () { ++m_row;   return *this; }
+    inline ImageViewRefAccessor& prev_row  () { --m_row;   return *this; }
+    inline ImageViewRefAccessor& next_plane() { ++m_plane; return *this; }
+    inline ImageViewRefAccessor& prev_plane() { --m_plane; return *this; }
+    inline ImageViewRefAccessor& advance( ssize_t di, ssize_t dj, ssize_t dp=0 ) { 
+      m_col += di; m_row += dj; m_plane += dp; return *this; 
+    }
+    inline pixel_type operator*() const {
+      ssize_t offset = m_col - m_run_col;
+      if ( offset >= 0 && offset < m_run_size && m_row == m_run_row && m_plane == m_run_plane )
+        return m_run[offset];
+      return fetch();
+    }
+  };
 
   /// A virtualized image view reference object.
   ///
@@ -227,10 +256,17 @@ namespace vw {
       return m_view->operator()(double(i),double(j),p);
     }
 
-    inline pixel_accessor origin() const { return m_view->origin(); }
+    inline pixel_accessor origin() const { return pixel_accessor( m_view ); }
 
     inline bool sparse_check( BBox2i const& bbox ) const { return m_view->sparse_check(bbox); }
 
+    /// Copies the cols x rows block of pixels whose top-left corner is
+    /// (col,row) into dest, in row-major order, using a single virtual
+    /// call.  This is much cheaper than reading the pixels one at a time.
+    inline void fetch( int32 col, int32 row, int32 plane, int32 cols, int32 rows, pixel_type* dest ) const {
+      m_view->fetch( col, row, plane, cols, rows, dest );
+    }
+
     /// \cond INTERNAL
     typedef CropView<ImageView<PixelT> > prerasterize_type;
 
@@ -267,6 +303,31 @@ namespace vw {
     }
   };
 
+  /// \cond INTERNAL
+  // Interpolation window fetches for type-erased views.  These let the
+  // interpolators read their whole neighborhood with one virtual call
+  // instead of one per pixel.
+  template <class PixelT>
+  inline void fetch_pixel_window( ImageViewRef<PixelT> const& view, int32 x, int32 y, int32 p,
+                                  int32 cols, int32 rows, PixelT* dest ) {
+    view.fetch( x, y, p, cols, rows, dest );
+  }
+
+  template <class PixelT, class ExtensionT>
+  inline void fetch_pixel_window( EdgeExtensionView<ImageViewRef<PixelT>, ExtensionT> const& view,
+                                  int32 x, int32 y, int32 p, int32 cols, int32 rows, PixelT* dest ) {
+    ImageViewRef<PixelT> const& child = view.child();
+    int32 cx = x + view.xoffset(), cy = y + view.yoffset();
+    if ( cx >= 0 && cy >= 0 && cx + cols <= child.cols() && cy + rows <= child.rows() ) {
+      child.fetch( cx, cy, p, cols, rows, dest );
+      return;
+    }
+    // Part of the window needs edge extension.
+    for ( int32 j = 0; j < rows; ++j )
+      for ( int32 i = 0; i < cols; ++i )
+        *dest++ = view( x+i, y+j, p );
+  }
+  /// \endcond
 
 } // namespace vw
 
@@ -77,12 +77,6 @@ namespace vw {
           return;
         }
 
-        std::list<Vector2i> blob;
-        m_c_blob.decompress( blob );
-        for ( std::list<Vector2i>::iterator iter = blob.begin();
-              iter != blob.end(); iter++ )
-          *iter -= bbox.min();
-
         // Building a cropped copy for my patch
         ImageView<pixel_type> cropped_copy =
           crop( m_view, bbox );
@@ -90,9 +84,11 @@ namespace vw {
         // Creating binary image to highlight hole
         ImageView<uint8> mask( bbox.width(), bbox.height() );
         fill( mask, 0 );
-        for ( std::list<Vector2i>::const_iterator iter = blob.begin();
-              iter != blob.end(); iter++ )
-          mask( iter->x(), iter->y() ) = 255;
+        Vector2i offset = m_c_blob.min() - bbox.min();
+        for ( int32 r = 0; r < m_c_blob.num_rows(); r++ )
+          for ( int32 k = 0; k < m_c_blob.num_runs(r); k++ )
+            for ( int32 c = m_c_blob.run_start(r,k); c < m_c_blob.run_end(r,k); c++ )
+              mask( c + offset.x(), r + offset.y() ) = 255;
 
         if (m_use_grassfire){
           ImageView<int32> distance = grassfire(mask);
@@ -136,9 +132,10 @@ namespace vw {
               cropped_copy(l.x(),l.y()) = sum;
             }
         }else{
-          for ( std::list<Vector2i>::const_iterator iter = blob.begin();
-                iter != blob.end(); iter++ )
-            cropped_copy( iter->x(), iter->y() ) = m_default_inpaint_val;
+          for ( int32 j = 0; j < bbox.height(); j++ )
+            for ( int32 i = 0; i < bbox.width(); i++ )
+              if ( mask(i,j) )
+                cropped_copy( i, j ) = m_default_inpaint_val;
         }
 
         // Insert results into sparse view
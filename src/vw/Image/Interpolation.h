@@ -69,6 +69,24 @@ namespace vw {
     };
   };
 
+  /// Copies the cols x rows window of pixels whose top-left corner is
+  /// (x,y) into dest, in row-major order.  The interpolators read their
+  /// neighborhoods through this function so that views with expensive
+  /// per-pixel access can overload it with a bulk fetch (see
+  /// ImageViewRef.h).
+  template <class ViewT>
+  inline void fetch_pixel_window( ViewT const& view, int32 x, int32 y, int32 p,
+                                  int32 cols, int32 rows, typename ViewT::pixel_type* dest ) {
+    typename ViewT::pixel_accessor acc = view.origin().advance(x,y,p);
+    for ( int32 j = 0; j < rows; ++j ) {
+      for ( int32 i = 0; i < cols; ++i ) {
+        *dest++ = *acc;
+        acc.next_col();
+      }
+      acc.advance(-cols,1);
+    }
+  }
+
   // This is broken out so that the implementation can be overridden
   // by pixel type.  Optimized versions go at the bottom of the file
   // for clarity.
@@ -85,23 +103,21 @@ namespace vw {
       // Stop evaluation here if we are at an integer pixel.
       // Otherwise, if the current pixel is valid, but one of the
       // neighbors is invalid, we'll get an invalid output.
+      pixel_type w[4];
       if (x == i && y == j){
         // Linear interpolation is, well, linear, so there's no need to clamp.
-        return channel_cast_round_if_int<channel_type>
-        ( *view.origin().advance(x,y,p) );
+        fetch_pixel_window( view, x, y, p, 1, 1, w );
+        return channel_cast_round_if_int<channel_type>( w[0] );
       }
 
       real_type normx = real_type(i)-real_type(x), normy = real_type(j)-real_type(y), norm1mx = 1-normx, norm1my = 1-normy;
 
-      typename ViewT::pixel_accessor acc = view.origin().advance(x,y,p);
-      result_type result = (*acc) * norm1mx;
-      acc.next_col();
-      result += (*acc) * normx;
+      fetch_pixel_window( view, x, y, p, 2, 2, w );
+      result_type result = w[0] * norm1mx;
+      result += w[1] * normx;
       result *= norm1my;
-      acc.advance(-1,1);
-      result_type row = (*acc) * norm1mx;
-      acc.next_col();
-      row += (*acc) * normx;
+      result_type row = w[2] * norm1mx;
+      row += w[3] * normx;
       result += row * normy;
 
       // Linear interpolation is, well, linear, so there's no need to clamp.
@@ -145,9 +161,10 @@ namespace vw {
       // Stop evaluation here if we are at an integer pixel.
       // Otherwise, if the current pixel is valid, but one of the
       // neighbors is invalid, we'll get an invalid output.
+      typename ViewT::pixel_type w[16];
       if (x == i && y == j){
-        return channel_cast_round_and_clamp_if_int<channel_type>
-          ( *view.origin().advance(x,y,p) );
+        fetch_pixel_window( view, x, y, p, 1, 1, w );
+        return channel_cast_round_and_clamp_if_int<channel_type>( w[0] );
       }
 
       double normx = i-x, normy = j-y;
@@ -157,27 +174,27 @@ namespace vw {
       double s2 = ((4-3*normx)*normx+1)*normx;    double t2 = ((4-3*normy)*normy+1)*normy;
       double s3 = (normx-1)*normx*normx;          double t3 = (normy-1)*normy*normy;
 
-      typename ViewT::pixel_accessor acc = view.origin().advance(x-1,y-1,p);
-      result_type row =         s0*(*acc);
-      acc.next_col();    row += s1*(*acc);
-      acc.next_col();    row += s2*(*acc);
-      acc.next_col();    row += s3*(*acc);
-      result_type result =      t0*row;
-      acc.advance(-3,1); row =  s0*(*acc);
-      acc.next_col();    row += s1*(*acc);
-      acc.next_col();    row += s2*(*acc);
-      acc.next_col();    row += s3*(*acc);
-      result +=                 t1*row;
-      acc.advance(-3,1); row =  s0*(*acc);
-      acc.next_col();    row += s1*(*acc);
-      acc.next_col();    row += s2*(*acc);
-      acc.next_col();    row += s3*(*acc);
-      result +=                 t2*row;
-      acc.advance(-3,1); row =  s0*(*acc);
-      acc.next_col();    row += s1*(*acc);
-      acc.next_col();    row += s2*(*acc);
-      acc.next_col();    row += s3*(*acc);
-      result +=                 t3*row;
+      fetch_pixel_window( view, x-1, y-1, p, 4, 4, w );
+      result_type row =  s0*w[0];
+      row +=             s1*w[1];
+      row +=             s2*w[2];
+      row +=             s3*w[3];
+      result_type result = t0*row;
+      row =              s0*w[4];
+      row +=             s1*w[5];
+      row +=             s2*w[6];
+      row +=             s3*w[7];
+      result +=          t1*row;
+      row =              s0*w[8];
+      row +=             s1*w[9];
+      row +=             s2*w[10];
+      row +=             s3*w[11];
+      result +=          t2*row;
+      row =              s0*w[12];
+      row +=             s1*w[13];
+      row +=             s2*w[14];
+      row +=             s3*w[15];
+      result +=          t3*row;
       result *= 0.25;
 
       // Bicubic interpolation is non-convex, so we must clamp if integer
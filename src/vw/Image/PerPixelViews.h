@@ -118,6 +118,8 @@ namespace vw {
     inline pixel_accessor origin() const { return pixel_accessor(m_image.origin(),m_func); }
     inline result_type operator()( int32 i, int32 j, int32 p=0 ) const { return m_func(m_image(i,j,p)); }
 
+    ImageT const& child() const { return m_image; }
+
     template <class ViewT>
     UnaryPerPixelView& operator=( ImageViewBase<ViewT> const& view ) {
       view.impl().rasterize( *this, BBox2i(0,0,view.impl().cols(),view.impl().rows()) );
@@ -137,6 +139,13 @@ namespace vw {
   template <class ImageT, class FuncT>
   struct IsMultiplyAccessible<UnaryPerPixelView<ImageT,FuncT> > : 
       boost::is_reference<typename UnaryPerPixelView<ImageT,FuncT>::result_type>::type {};
+
+  // Per-pixel operations read their child in the same blocks, so they
+  // inherit its preferred block size (see BlockProcessor.h).
+  template <class ImageT, class FuncT>
+  inline Vector2i preferred_block_size( UnaryPerPixelView<ImageT,FuncT> const& view ) {
+    return preferred_block_size( view.child() );
+  }
   /// \endcond
 
 
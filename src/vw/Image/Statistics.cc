@@ -0,0 +1,185 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <vw/Image/Statistics.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace vw;
+
+namespace {
+
+  // Below this exponent 2^-exponent is not a finite double.
+  const int32 MIN_BIN_EXPONENT = -1000;
+
+  // The bin of width 2^exponent that holds value.
+  inline int64 bin_index( double value, int32 exponent ) {
+    return int64( std::floor( std::ldexp( value, -exponent ) ) );
+  }
+
+  // The bin that holds the bin index at an exponent larger by steps.
+  inline int64 coarser_bin( int64 index, int32 steps ) {
+    if ( steps >= 63 )
+      return index < 0 ? -1 : 0;
+    int64 width = int64(1) << steps;
+    return index >= 0 ? index / width : -( (-index - 1) / width ) - 1;
+  }
+
+  // The smallest exponent at which the bin indices of values up to
+  // max_abs in magnitude stay well inside an int64.
+  inline int32 smallest_exponent( double max_abs ) {
+    if ( max_abs == 0 )
+      return MIN_BIN_EXPONENT;
+    return std::max( MIN_BIN_EXPONENT, int32( std::ilogb( max_abs ) ) - 60 );
+  }
+}
+
+ChannelStatistics::ChannelStatistics( int32 num_bins )
+  : m_num_bins(num_bins), m_count(0), m_min(0), m_max(0), m_mean(0), m_m2(0),
+    m_exponent(MIN_BIN_EXPONENT), m_first_bin(0) {
+  VW_ASSERT( num_bins > 0, ArgumentErr() << "ChannelStatistics: number of bins must be positive." );
+}
+
+void ChannelStatistics::rebin( double min_value, double max_value, int32 min_exponent ) {
+  int32 exponent = std::max( std::max( m_exponent, min_exponent ),
+                             smallest_exponent( std::max( std::fabs(min_value), std::fabs(max_value) ) ) );
+  while ( bin_index( max_value, exponent ) - bin_index( min_value, exponent ) >= m_num_bins )
+    ++exponent;
+
+  std::vector<uint64> bins( m_num_bins, 0 );
+  int64 first_bin = bin_index( min_value, exponent );
+  for ( size_t i = 0; i < m_bins.size(); ++i )
+    if ( m_bins[i] )
+      bins[ coarser_bin( m_first_bin + int64(i), exponent - m_exponent ) - first_bin ] += m_bins[i];
+
+  m_bins.swap( bins );
+  m_exponent  = exponent;
+  m_first_bin = first_bin;
+}
+
+void ChannelStatistics::add( std::vector<double> const& values ) {
+  if ( m_count != 0 ) {
+    ChannelStatistics batch( m_num_bins );
+    batch.add( values );
+    merge( batch );
+    return;
+  }
+
+  double low = 0, high = 0, sum = 0;
+  for ( size_t i = 0; i < values.size(); ++i ) {
+    double value = values[i];
+    if ( !std::isfinite( value ) )
+      continue;
+    if ( m_count == 0 || value < low  ) low  = value;
+    if ( m_count == 0 || value > high ) high = value;
+    sum += value;
+    ++m_count;
+  }
+  if ( m_count == 0 )
+    return;
+
+  m_min  = low;
+  m_max  = high;
+  m_mean = sum / double(m_count);
+  m_m2   = 0;
+  rebin( low, high, MIN_BIN_EXPONENT );
+
+  double scale = std::ldexp( 1.0, -m_exponent );
+  for ( size_t i = 0; i < values.size(); ++i ) {
+    double value = values[i];
+    if ( !std::isfinite( value ) )
+      continue;
+    m_m2 += ( value - m_mean ) * ( value - m_mean );
+    ++m_bins[ int64( std::floor( value * scale ) ) - m_first_bin ];
+  }
+}
+
+void ChannelStatistics::merge( ChannelStatistics const& other ) {
+  VW_ASSERT( other.m_num_bins == m_num_bins,
+             ArgumentErr() << "ChannelStatistics: cannot merge histograms with different numbers of bins." );
+  if ( other.m_count == 0 )
+    return;
+  if ( m_count == 0 ) {
+    *this = other;
+    return;
+  }
+
+  // Chan et al.'s update of the mean and the sum of squared deviations.
+  double count = double(m_count) + double(other.m_count);
+  double delta = other.m_mean - m_mean;
+  m_m2   += other.m_m2 + delta * delta * ( double(m_count) * double(other.m_count) / count );
+  m_mean += delta * ( double(other.m_count) / count );
+
+  // Both histograms are coarsened to the wider of their bins, and to
+  // whatever more it takes to span both ranges.
+  rebin( std::min( m_min, other.m_min ), std::max( m_max, other.m_max ), other.m_exponent );
+  for ( size_t i = 0; i < other.m_bins.size(); ++i )
+    if ( other.m_bins[i] )
+      m_bins[ coarser_bin( other.m_first_bin + int64(i), m_exponent - other.m_exponent ) - m_first_bin ]
+        += other.m_bins[i];
+
+  m_min    = std::min( m_min, other.m_min );
+  m_max    = std::max( m_max, other.m_max );
+  m_count += other.m_count;
+}
+
+double ChannelStatistics::minimum() const {
+  VW_ASSERT( m_count, ArgumentErr() << "ChannelStatistics: no valid samples" );
+  return m_min;
+}
+
+double ChannelStatistics::maximum() const {
+  VW_ASSERT( m_count, ArgumentErr() << "ChannelStatistics: no valid samples" );
+  return m_max;
+}
+
+double ChannelStatistics::mean() const {
+  VW_ASSERT( m_count, ArgumentErr() << "ChannelStatistics: no valid samples" );
+  return m_mean;
+}
+
+double ChannelStatistics::stddev() const {
+  VW_ASSERT( m_count, ArgumentErr() << "ChannelStatistics: no valid samples" );
+  return std::sqrt( m_m2 / double(m_count) );
+}
+
+double ChannelStatistics::quantile( double fraction ) const {
+  VW_ASSERT( m_count, ArgumentErr() << "ChannelStatistics: no valid samples" );
+  if ( fraction <= 0 ) return m_min;
+  if ( fraction >= 1 ) return m_max;
+
+  double target = fraction * double(m_count), below = 0;
+  for ( int32 bin = 0; bin < m_num_bins; ++bin ) {
+    double count = double(m_bins[bin]);
+    if ( count > 0 && below + count >= target ) {
+      double value = bin_start(bin) + bin_width() * ( target - below ) / count;
+      return std::min( std::max( value, m_min ), m_max );
+    }
+    below += count;
+  }
+  return m_max;
+}
+
+double ChannelStatistics::bin_width() const {
+  return std::ldexp( 1.0, m_exponent );
+}
+
+double ChannelStatistics::bin_start( int32 bin ) const {
+  return std::ldexp( double( m_first_bin + bin ), m_exponent );
+}
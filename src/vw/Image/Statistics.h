@@ -30,6 +30,7 @@
 /// - stddev_channel_value
 /// - median_channel_value
 /// - weighted_mean_channel_value
+/// - channel_statistics
 ///
 /// - min_pixel_value
 /// - max_pixel_value
@@ -44,6 +45,8 @@
 #define __VW_IMAGE_STATISTICS_H__
 
 #include <boost/type_traits.hpp>
+#include <vw/Core/Settings.h>
+#include <vw/Core/Thread.h>
 #include <vw/Math/Statistics.h>
 #include <vw/Image/ImageViewBase.h>
 #include <vw/Image/ImageView.h>
@@ -51,6 +54,8 @@
 #include <vw/Image/BlockImageOperator.h>
 #include <vw/Image/EdgeExtension.h>
 
+#include <vector>
+
 namespace vw {
 
   // CHANNEL operations
@@ -559,6 +564,122 @@ namespace vw {
   }
 
 
+  // FUSED statistics
+  //////////////////////////////////
+
+  /// A mergeable summary of a set of channel values: their count,
+  /// range, mean and standard deviation, and a histogram from which
+  /// quantiles are estimated.  This is what channel_statistics()
+  /// gathers in one pass over an image.
+  /// - The histogram has num_bins equal bins whose width is a power of
+  ///   two.  Pairs of bins are merged as the range of the values grows,
+  ///   so summaries with the same number of bins merge exactly.
+  /// - Quantiles are interpolated within a bin, and are off by at most
+  ///   one bin width, which is no more than 2*(max-min)/(num_bins-1).
+  /// - Values that are not finite are skipped.
+  class ChannelStatistics {
+  public:
+    ChannelStatistics( int32 num_bins = 1024 );
+
+    /// Adds a batch of values.
+    void add( std::vector<double> const& values );
+
+    /// Folds the values summarized by another object into this one.
+    void merge( ChannelStatistics const& other );
+
+    /// The number of values added.
+    uint64 num_valid() const { return m_count; }
+
+    double minimum() const;
+    double maximum() const;
+    double mean   () const;
+
+    /// The total (not sample) standard deviation, as computed by
+    /// stddev_channel_value().
+    double stddev () const;
+
+    /// The value below which the given fraction of the values lie.
+    double quantile( double fraction ) const;
+    double median  () const { return quantile( 0.5 ); }
+
+    /// The histogram, whose first bin starts at or below minimum()
+    /// and whose last occupied bin ends above maximum().
+    int32  num_bins () const { return m_num_bins; }
+    double bin_width() const;
+    double bin_start( int32 bin ) const;
+    uint64 bin_count( int32 bin ) const { return m_bins[bin]; }
+
+  private:
+    /// Coarsens the bins to at least 2^min_exponent and until
+    /// [min_value,max_value] fits in them, and moves the first bin to
+    /// min_value's.
+    void rebin( double min_value, double max_value, int32 min_exponent );
+
+    int32  m_num_bins;
+    uint64 m_count;
+    double m_min, m_max, m_mean, m_m2;
+    int32  m_exponent;  ///< The bins are 2^m_exponent wide.
+    int64  m_first_bin; ///< The first bin starts at m_first_bin*2^m_exponent.
+    std::vector<uint64> m_bins;
+  };
+
+  /// Gathers the ChannelStatistics of each tile it is given and merges
+  /// them into a shared one; see channel_statistics().
+  template <class PixelT>
+  class ChannelStatisticsFunctor {
+    ChannelStatistics& m_stats;
+    Mutex m_mutex;
+
+  public:
+    ChannelStatisticsFunctor( ChannelStatistics& stats ) : m_stats(stats) {}
+
+    void operator()( ImageView<PixelT> const& image, BBox2i const& /*bbox*/ ) {
+      typedef typename UnmaskedPixelType<PixelT>::type child_type;
+      typedef typename PixelChannelType<child_type>::type channel_type;
+      const size_t num_channels = PixelNumChannels<child_type>::value;
+
+      std::vector<double> values;
+      values.reserve( size_t(image.cols()) * image.rows() * image.planes() * num_channels );
+      for ( int32 p = 0; p < image.planes(); ++p )
+        for ( int32 row = 0; row < image.rows(); ++row ) {
+          PixelT const* pix = &image(0,row,p);
+          for ( int32 col = 0; col < image.cols(); ++col, ++pix ) {
+            if ( !is_valid(*pix) )
+              continue;
+            for ( size_t c = 0; c < num_channels; ++c )
+              values.push_back( compound_select_channel<channel_type const&>( remove_mask(*pix), c ) );
+          }
+        }
+
+      ChannelStatistics tile( m_stats.num_bins() );
+      tile.add( values );
+      Mutex::Lock lock( m_mutex );
+      m_stats.merge( tile );
+    }
+  };
+
+  /// Computes the count, range, mean, standard deviation, histogram
+  /// and quantiles of all the channels of all the valid pixels of an
+  /// image, in one pass.  Use this rather than several of the
+  /// functions above in a row on an image that is costly to read.
+  /// - The image is read a tile at a time on num_threads threads (or
+  ///   the default number if zero), and the tiles are summarized
+  ///   separately and merged.
+  /// - Invalid pixels of a PixelMask image are skipped; to skip a
+  ///   nodata value, pass create_mask(view, nodata).
+  template <class ViewT>
+  ChannelStatistics channel_statistics( ImageViewBase<ViewT> const& view,
+                                        int32 num_bins = 1024, int32 num_threads = 0 ) {
+    ChannelStatistics stats( num_bins );
+    if ( view.impl().cols() == 0 || view.impl().rows() == 0 )
+      return stats;
+    ChannelStatisticsFunctor<typename ViewT::pixel_type> functor( stats );
+    int32 tile_size = vw_settings().default_tile_size();
+    block_op( view, functor, Vector2i( tile_size, tile_size ), num_threads );
+    return stats;
+  }
+
+
 #include <vw/Image/Statistics.tcc>
 
 }  // namespace vw
@@ -123,3 +123,128 @@ TEST( BlobIndex, BlobSizesView ) {
 
 
 
+
+namespace {
+
+  // A mask with blobs of all shapes: diagonal chains, spirals of runs
+  // that join far below, and blobs that cross many tiles.
+  ImageView<PixelMask<uint8> > tangled_mask( int32 cols, int32 rows ) {
+    ImageView<PixelMask<uint8> > image( cols, rows );
+    for ( int32 y = 0; y < rows; ++y )
+      for ( int32 x = 0; x < cols; ++x )
+        if ( (x*x*7 + y*13 + x*y) % 11 < 4 || x == y || x == cols/2 )
+          image(x,y) = PixelMask<uint8>(1);
+    return image;
+  }
+
+  // Labels the 8-connected components with a flood fill, numbering
+  // them from one in raster order.
+  ImageView<int32> flood_labels( ImageView<PixelMask<uint8> > const& image, int32& count ) {
+    ImageView<int32> labels( image.cols(), image.rows() );
+    fill( labels, 0 );
+    count = 0;
+    std::vector<Vector2i> stack;
+    for ( int32 y = 0; y < image.rows(); ++y )
+      for ( int32 x = 0; x < image.cols(); ++x ) {
+        if ( !is_valid(image(x,y)) || labels(x,y) )
+          continue;
+        labels(x,y) = ++count;
+        stack.push_back( Vector2i(x,y) );
+        while ( !stack.empty() ) {
+          Vector2i p = stack.back();
+          stack.pop_back();
+          for ( int32 j = p.y()-1; j <= p.y()+1; ++j )
+            for ( int32 i = p.x()-1; i <= p.x()+1; ++i )
+              if ( i >= 0 && j >= 0 && i < image.cols() && j < image.rows() &&
+                   is_valid(image(i,j)) && !labels(i,j) ) {
+                labels(i,j) = count;
+                stack.push_back( Vector2i(i,j) );
+              }
+        }
+      }
+    return labels;
+  }
+}
+
+TEST( BlobIndexThreaded, MatchesFloodFill ) {
+  ImageView<PixelMask<uint8> > image = tangled_mask( 53, 47 );
+  int32 count;
+  ImageView<int32> expected = flood_labels( image, count );
+  ASSERT_GT( count, 10 );
+
+  ImageView<uint32> whole = blob_index( image );
+  for ( int32 y = 0; y < image.rows(); ++y )
+    for ( int32 x = 0; x < image.cols(); ++x )
+      ASSERT_EQ( uint32(expected(x,y)), whole(x,y) );
+
+  // Any tiling and number of threads finds the same blobs, in raster order.
+  int32 tile_sizes[] = { 1, 5, 16, 100 };
+  for ( int t = 0; t < 4; ++t )
+    for ( int32 threads = 1; threads <= 3; threads += 2 ) {
+      BlobIndexThreaded bindex( image, 0, tile_sizes[t], threads );
+      ASSERT_EQ( uint32(count), bindex.num_blobs() );
+      for ( uint32 b = 0; b < bindex.num_blobs(); ++b ) {
+        std::vector<Vector2i> pixels;
+        bindex.blob( b, pixels );
+        BBox2i bbox;
+        for ( size_t i = 0; i < pixels.size(); ++i ) {
+          EXPECT_EQ( int32(b+1), expected( pixels[i].x(), pixels[i].y() ) );
+          bbox.grow( pixels[i] );
+        }
+        EXPECT_EQ( int32(pixels.size()), bindex.compressed_blob(b).size() );
+        EXPECT_EQ( bbox.min(), bindex.blob_bbox(b).min() );
+        EXPECT_EQ( bbox.max() + Vector2i(1,1), bindex.blob_bbox(b).max() );
+        EXPECT_EQ( bindex.blob_bbox(b), bindex.compressed_blob(b).bounding_box() );
+      }
+    }
+}
+
+TEST( BlobIndexThreaded, MaxArea ) {
+  ImageView<PixelMask<uint8> > image(12,6);
+  fill( crop(image,0,0,2,2), PixelMask<uint8>(1) ); // 4 pixels
+  fill( crop(image,5,1,6,4), PixelMask<uint8>(1) ); // 24 pixels
+  image(3,4) = PixelMask<uint8>(1);                 // 1 pixel
+
+  BlobIndexThreaded all( image, 0, 3, 2 );
+  EXPECT_EQ( 3u, all.num_blobs() );
+
+  BlobIndexThreaded small( image, 10, 3, 2 );
+  ASSERT_EQ( 2u, small.num_blobs() );
+  EXPECT_EQ( 4, small.compressed_blob(0).size() );
+  EXPECT_EQ( 1, small.compressed_blob(1).size() );
+
+  all.wipe_big_blobs( 2 );
+  ASSERT_EQ( 2u, all.num_blobs() );
+  EXPECT_EQ( BBox2i(3,4,1,1), all.blob_bbox(1) );
+}
+
+TEST( BlobIndex, BlobCompressedAbsorb ) {
+  // A U on its side, built from its two arms and its back.
+  blob::BlobCompressed top, bottom, back;
+  top.add_row( Vector2i(2,0), 4 );
+  bottom.add_row( Vector2i(2,4), 4 );
+  back.add_row( Vector2i(1,1), 1 );
+  back.add_row( Vector2i(0,2), 1 );
+  back.add_row( Vector2i(1,3), 1 );
+  EXPECT_EQ( BBox2i(0,1,2,3), back.bounding_box() );
+
+  top.absorb( bottom );
+  EXPECT_EQ( 5, top.num_rows() );
+  EXPECT_EQ( 0, top.num_runs(2) );
+  top.absorb( back );
+  EXPECT_EQ( BBox2i(0,0,6,5), top.bounding_box() );
+  EXPECT_EQ( 11, top.size() );
+  EXPECT_EQ( 2, top.run_start(0,0) );
+  EXPECT_EQ( 6, top.run_end(0,0) );
+  EXPECT_TRUE ( top.intersects( BBox2i(0,2,1,1) ) );
+  EXPECT_FALSE( top.intersects( BBox2i(1,2,4,1) ) );
+
+  // Runs that touch are joined.
+  blob::BlobCompressed right;
+  right.add_row( Vector2i(6,0), 2 );
+  top.absorb( right );
+  EXPECT_EQ( 1, top.num_runs(0) );
+  EXPECT_EQ( 8, top.run_end(0,0) );
+
+  EXPECT_THROW( top.absorb( back ), NoImplErr );
+}
@@ -20,6 +20,8 @@
 #include <vw/Image/BlockRasterize.h>
 #include <vw/Image/BlockImageOperator.h>
 
+#include <set>
+
 using namespace vw;
 using namespace std;
 
@@ -114,3 +116,254 @@ TEST(BlockImageOperator, Basic) {
   result = threshold_functor.get_count();
   EXPECT_EQ(real_count, result);
 }
+
+TEST(BlockProcessor, GridOrder) {
+  using namespace image_block;
+  BlockOrder orders[] = { RowMajorBlockOrder, ZBlockOrder, HilbertBlockOrder };
+  for (int o = 0; o < 3; ++o) {
+    std::vector<Vector2i> grid = block_grid_order(7, 5, orders[o]);
+    ASSERT_EQ(35u, grid.size());
+    std::set<std::pair<int,int> > seen;
+    for (size_t i = 0; i < grid.size(); ++i) {
+      EXPECT_TRUE(grid[i].x() >= 0 && grid[i].x() < 7 && grid[i].y() >= 0 && grid[i].y() < 5);
+      seen.insert(std::make_pair(grid[i].x(), grid[i].y()));
+    }
+    EXPECT_EQ(35u, seen.size());
+  }
+
+  // On a square power-of-two grid, each Hilbert step moves to a neighbor.
+  std::vector<Vector2i> hilbert = block_grid_order(8, 8, HilbertBlockOrder);
+  for (size_t i = 1; i < hilbert.size(); ++i)
+    EXPECT_EQ(1, abs(hilbert[i].x()-hilbert[i-1].x()) + abs(hilbert[i].y()-hilbert[i-1].y()));
+
+  EXPECT_TRUE(block_grid_order(0, 5, HilbertBlockOrder).empty());
+}
+
+TEST(BlockProcessor, BlockSize) {
+  using namespace image_block;
+
+  // The default is full width strips of about 2MB.
+  Vector2i size = get_default_block_size<float>(10000, 10000);
+  EXPECT_EQ(Vector2i(10000, 2*1024*1024/(10000*4)), size);
+  size = get_default_block_size<double>(3, 2);
+  EXPECT_EQ(Vector2i(2, 3), size);
+
+  // Tiled sources get whole multiples of their tiles.
+  size = get_cache_block_size<float>(10000, 10000, 1, Vector2i(256,256), 4);
+  EXPECT_EQ(0, size.x() % 256);
+  EXPECT_EQ(0, size.y() % 256);
+  EXPECT_LE(size.x()*size.y()*4, int(cache_bytes_per_thread(4)));
+
+  // Striped sources get whole strips across the image.
+  size = get_cache_block_size<float>(10000, 3000, 1, Vector2i(3000,16), 4);
+  EXPECT_EQ(3000, size.x());
+  EXPECT_EQ(0, size.y() % 16);
+
+  // Every thread gets a few blocks.
+  size = get_cache_block_size<uint8>(512, 512, 1, Vector2i(), 8);
+  EXPECT_GE(((512+size.x()-1)/size.x()) * ((512+size.y()-1)/size.y()), 32);
+
+  // Tiny images are never split below one pixel, and empty ones don't crash.
+  size = get_cache_block_size<double>(3, 2, 1, Vector2i(), 16);
+  EXPECT_TRUE(size.x() >= 1 && size.x() <= 2 && size.y() >= 1 && size.y() <= 3);
+  size = get_cache_block_size<double>(0, 0, 1, Vector2i());
+  EXPECT_TRUE(size.x() >= 1 && size.y() >= 1);
+}
+
+namespace {
+  // Counts how often each pixel is visited.
+  struct CoverageFunctor {
+    ImageView<int> *counts;
+    BBox2i total;
+    Mutex *mutex;
+    void operator()(BBox2i const& bbox) const {
+      Mutex::Lock lock(*mutex);
+      for (int r = bbox.min().y(); r < bbox.max().y(); ++r)
+        for (int c = bbox.min().x(); c < bbox.max().x(); ++c)
+          (*counts)(c - total.min().x(), r - total.min().y()) += 1;
+    }
+  };
+}
+
+TEST(BlockProcessor, Coverage) {
+  using namespace image_block;
+  BBox2i total(-13, 7, 101, 57);
+  BlockOrder orders[] = { RowMajorBlockOrder, ZBlockOrder, HilbertBlockOrder };
+  for (int o = 0; o < 3; ++o) {
+    ImageView<int> counts(total.width(), total.height());
+    Mutex mutex;
+    CoverageFunctor func;
+    func.counts = &counts; func.total = total; func.mutex = &mutex;
+    BlockProcessor<CoverageFunctor> process(func, Vector2i(16,24), 3, orders[o]);
+    process(total);
+    for (int r = 0; r < counts.rows(); ++r)
+      for (int c = 0; c < counts.cols(); ++c)
+        EXPECT_EQ(1, counts(c,r));
+  }
+}
+
+TEST(BlockRasterize, DefaultBlockSize) {
+  ImageView<float> image(300, 200);
+  for (int r = 0; r < image.rows(); ++r)
+    for (int c = 0; c < image.cols(); ++c)
+      image(c,r) = float(r*image.cols() + c);
+
+  // Without a preferred block size the view is processed in strips.
+  BlockRasterizeView<ImageView<float> > block = block_rasterize(image, Vector2i(), 2);
+  EXPECT_EQ(Vector2i(300, 200), block.block_size());
+  ImageView<float> result = block;
+  EXPECT_RANGE_EQ(image.begin(), image.end(), result.begin(), result.end());
+
+  // A tiled child is processed in whole tiles, with the same result.
+  BlockRasterizeView<BlockRasterizeView<ImageView<float> > > tiled =
+    block_rasterize(block_rasterize(image, Vector2i(64,64), 2), Vector2i(), 2);
+  EXPECT_TRUE(tiled.block_size().x() % 64 == 0 || tiled.block_size().x() == image.cols());
+  EXPECT_TRUE(tiled.block_size().y() % 64 == 0 || tiled.block_size().y() == image.rows());
+  result = tiled;
+  EXPECT_RANGE_EQ(image.begin(), image.end(), result.begin(), result.end());
+}
+
+TEST(BlockAccessPredictor, RasterSweep) {
+  image_block::BlockAccessPredictor predictor(4, 3, 3);
+  std::vector<Vector2i> next;
+  EXPECT_FALSE( predictor.observe( Vector2i(0,0), next ) );
+  EXPECT_TRUE( next.empty() );
+  predictor.observe( Vector2i(1,0), next );
+  predictor.observe( Vector2i(2,0), next );
+  ASSERT_EQ( 3u, next.size() );
+  EXPECT_VECTOR_EQ( Vector2i(3,0), next[0] );
+  EXPECT_VECTOR_EQ( Vector2i(0,1), next[1] ); // Wraps onto the next row
+  EXPECT_VECTOR_EQ( Vector2i(1,1), next[2] );
+
+  // The wrap itself continues the sweep.
+  predictor.observe( Vector2i(3,0), next );
+  EXPECT_FALSE( predictor.observe( Vector2i(0,1), next ) );
+  ASSERT_EQ( 3u, next.size() );
+  EXPECT_VECTOR_EQ( Vector2i(1,1), next[0] );
+
+  // Nothing beyond the last block.
+  predictor.observe( Vector2i(1,1), next );
+  predictor.observe( Vector2i(2,1), next );
+  predictor.observe( Vector2i(3,1), next );
+  predictor.observe( Vector2i(0,2), next );
+  predictor.observe( Vector2i(1,2), next );
+  predictor.observe( Vector2i(2,2), next );
+  ASSERT_EQ( 1u, next.size() );
+  EXPECT_VECTOR_EQ( Vector2i(3,2), next[0] );
+
+  // A jump breaks the pattern.
+  EXPECT_TRUE( predictor.observe( Vector2i(0,0), next ) );
+  EXPECT_TRUE( next.empty() );
+}
+
+TEST(BlockAccessPredictor, Walk) {
+  image_block::BlockAccessPredictor predictor(4, 4, 4);
+  std::vector<Vector2i> next;
+  predictor.observe( Vector2i(1,1), next );
+  EXPECT_FALSE( predictor.observe( Vector2i(1,2), next ) );
+
+  // The neighbours, other than the block we came from.
+  std::set<std::pair<int,int> > expected, found;
+  expected.insert( std::make_pair(2,2) );
+  expected.insert( std::make_pair(0,2) );
+  expected.insert( std::make_pair(1,3) );
+  for ( size_t i = 0; i < next.size(); ++i )
+    found.insert( std::make_pair(next[i].x(), next[i].y()) );
+  EXPECT_TRUE( expected == found );
+}
+
+namespace {
+  // Records which rows of an image have been read.
+  class RowCountingView : public ImageViewBase<RowCountingView> {
+    boost::shared_ptr<std::vector<int> > m_reads;
+    boost::shared_ptr<Mutex> m_mutex;
+  public:
+    typedef float pixel_type;
+    typedef float result_type;
+    typedef ProceduralPixelAccessor<RowCountingView> pixel_accessor;
+
+    RowCountingView() : m_reads( new std::vector<int>(64) ), m_mutex( new Mutex ) {}
+    int32 cols  () const { return 64; }
+    int32 rows  () const { return 64; }
+    int32 planes() const { return 1;  }
+    pixel_accessor origin() const { return pixel_accessor(*this, 0, 0); }
+    result_type operator()( int32 i, int32 j, int32 = 0 ) const { return float(i + 64*j); }
+
+    typedef ImageView<float> prerasterize_type;
+    prerasterize_type prerasterize( BBox2i const& bbox ) const {
+      {
+        Mutex::Lock lock(*m_mutex);
+        for ( int32 j = bbox.min().y(); j < bbox.max().y(); ++j )
+          (*m_reads)[j]++;
+      }
+      ImageView<float> result( cols(), rows() );
+      for ( int32 j = bbox.min().y(); j < bbox.max().y(); ++j )
+        for ( int32 i = bbox.min().x(); i < bbox.max().x(); ++i )
+          result(i,j) = (*this)(i,j);
+      return result;
+    }
+    template <class DestT> void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+      vw::rasterize( prerasterize(bbox), dest, bbox );
+    }
+    int reads( int32 row ) const {
+      Mutex::Lock lock(*m_mutex);
+      return (*m_reads)[row];
+    }
+  };
+}
+
+TEST(BlockRasterize, ReadAhead) {
+  Cache cache( 1024*1024 );
+  Prefetcher prefetcher( 1, 1024*1024 );
+  RowCountingView source;
+  BlockRasterizeView<RowCountingView> view( source, Vector2i(64,8), 1, &cache );
+  view.enable_read_ahead( prefetcher );
+  ASSERT_TRUE( view.read_ahead() != 0 );
+
+  // Single pixel reads are not followed.
+  EXPECT_EQ( 0.0f, view(0,0)  );
+  EXPECT_EQ( 64.0f*8, view(0,8) );
+  prefetcher.join();
+  EXPECT_EQ( 0, source.reads(16) );
+  EXPECT_EQ( 0u, prefetcher.stats().submitted );
+
+  // Walking down the strips reads the ones below ahead of time.
+  ImageView<float> strip = crop( view, BBox2i(0,0,64,8) );
+  strip = crop( view, BBox2i(0,8,64,8) );
+  prefetcher.join();
+  EXPECT_EQ( 1, source.reads(16) );
+  EXPECT_GT( prefetcher.stats().completed, 0u );
+
+  // A request over several strips, rasterized on several threads,
+  // reads ahead of its last strip.
+  RowCountingView other;
+  BlockRasterizeView<RowCountingView> threaded( other, Vector2i(64,8), 4, &cache );
+  threaded.enable_read_ahead( prefetcher );
+  strip = crop( threaded, BBox2i(0,24,64,8) );
+  strip = crop( threaded, BBox2i(0,32,64,16) );
+  prefetcher.join();
+  EXPECT_EQ( 1, other.reads(48) );
+  EXPECT_EQ( 0u, prefetcher.stats().cancelled );
+
+  // Each strip is still only read once, and the results are unchanged.
+  ImageView<float> result = view;
+  for ( int32 j = 0; j < 64; ++j )
+    EXPECT_EQ( 1, source.reads(j) );
+  EXPECT_EQ( float(5 + 64*40), result(5,40) );
+  prefetcher.join();
+}
+
+TEST(BlockRasterize, ReadAheadOff) {
+  Prefetcher prefetcher; // Disabled
+  RowCountingView source;
+  Cache cache( 1024*1024 );
+  BlockRasterizeView<RowCountingView> view( source, Vector2i(64,8), 1, &cache );
+  view.enable_read_ahead( prefetcher );
+  EXPECT_TRUE( view.read_ahead() == 0 );
+
+  // Without a cache there is nowhere to read ahead into.
+  Prefetcher enabled( 1, 1024*1024 );
+  BlockRasterizeView<RowCountingView> uncached( source, Vector2i(64,8), 1 );
+  uncached.enable_read_ahead( enabled );
+  EXPECT_TRUE( uncached.read_ahead() == 0 );
+}
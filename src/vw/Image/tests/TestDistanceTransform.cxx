@@ -0,0 +1,131 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/Image/DistanceTransform.h>
+#include <vw/Image/PixelMask.h>
+#include <vw/Image/PixelTypes.h>
+#include <vw/Image/UtilityViews.h>
+
+using namespace vw;
+
+namespace {
+
+  // A sparse, irregular scattering of zero pixels.
+  ImageView<uint8> scattered( int32 cols, int32 rows ) {
+    ImageView<uint8> image( cols, rows );
+    for ( int32 y = 0; y < rows; ++y )
+      for ( int32 x = 0; x < cols; ++x )
+        image(x,y) = ( (x*7 + y*13) % 97 == 0 || (x*x + 3*y) % 151 == 0 ) ? 0 : 255;
+    return image;
+  }
+
+  // Distance to the nearest zero pixel by brute force.
+  float brute_distance( ImageView<uint8> const& image, int32 x, int32 y, bool ignore_borders ) {
+    double best = std::numeric_limits<double>::max();
+    if ( !ignore_borders )
+      best = std::min( std::min( x+1, image.cols()-x ), std::min( y+1, image.rows()-y ) );
+    for ( int32 j = 0; j < image.rows(); ++j )
+      for ( int32 i = 0; i < image.cols(); ++i )
+        if ( image(i,j) == 0 )
+          best = std::min( best, sqrt( double(i-x)*(i-x) + double(j-y)*(j-y) ) );
+    return float( std::min( best, double(image.cols() + image.rows()) ) );
+  }
+}
+
+TEST( DistanceTransform, Simple ) {
+  ImageView<uint8> im(5,5);
+  fill(crop(im,1,1,3,3), 255);
+  ImageView<float> d = euclidean_distance(im);
+  EXPECT_EQ( 0, d(0,0) );
+  EXPECT_EQ( 1, d(1,1) );
+  EXPECT_EQ( 2, d(2,2) );
+  EXPECT_EQ( 1, d(3,3) );
+  EXPECT_EQ( 1, d(1,2) );
+
+  // The outside of the image counts as zero.
+  fill(im, 255);
+  d = euclidean_distance(im);
+  EXPECT_EQ( 1, d(0,0) );
+  EXPECT_EQ( 1, d(4,2) );
+  EXPECT_EQ( 3, d(2,2) );
+}
+
+TEST( DistanceTransform, NoBorder ) {
+  ImageView<uint16> im(7,5);
+  fill(im, 255);
+  im(2,2) = 0;
+  ImageView<float> d = euclidean_distance(im, true);
+  for ( int32 r = 0; r < im.rows(); ++r )
+    for ( int32 c = 0; c < im.cols(); ++c )
+      EXPECT_FLOAT_EQ( sqrt( double(c-2)*(c-2) + double(r-2)*(r-2) ), d(c,r) );
+
+  // Without any zero pixel the distance is capped.
+  fill(im, 1);
+  d = euclidean_distance(im, true);
+  EXPECT_EQ( 12, d(0,0) );
+  EXPECT_EQ( 12, d(3,2) );
+}
+
+TEST( DistanceTransform, BruteForce ) {
+  ImageView<uint8> im = scattered( 67, 41 );
+  for ( int border = 0; border < 2; ++border ) {
+    ImageView<float> d = euclidean_distance(im, border == 1);
+    for ( int32 y = 0; y < im.rows(); ++y )
+      for ( int32 x = 0; x < im.cols(); ++x )
+        EXPECT_NEAR( brute_distance(im, x, y, border == 1), d(x,y), 1e-4 ) << "at " << x << "," << y;
+  }
+}
+
+TEST( DistanceTransform, Threads ) {
+  // Large enough to be split into strips.
+  ImageView<uint8> im = scattered( 331, 297 );
+  for ( int border = 0; border < 2; ++border ) {
+    ImageView<float> single, threaded;
+    euclidean_distance( im, single,   border == 1, 1 );
+    euclidean_distance( im, threaded, border == 1, 4 );
+    for ( int32 y = 0; y < im.rows(); ++y )
+      for ( int32 x = 0; x < im.cols(); ++x )
+        ASSERT_EQ( single(x,y), threaded(x,y) );
+  }
+}
+
+TEST( DistanceTransform, Types ) {
+  ImageView<PixelMask<PixelGray<float> > > im(6,6);
+  fill( im, PixelMask<PixelGray<float> >(3.0) );
+  im(0,0) = PixelMask<PixelGray<float> >();
+
+  // Integer outputs are rounded.
+  ImageView<uint8> rounded;
+  euclidean_distance( im, rounded, true );
+  EXPECT_EQ( 0, rounded(0,0) );
+  EXPECT_EQ( 1, rounded(1,1) ); // sqrt(2)
+  EXPECT_EQ( 2, rounded(1,2) ); // sqrt(5)
+  EXPECT_EQ( 7, rounded(5,5) ); // sqrt(50)
+
+  ImageView<PixelGray<float> > gray;
+  euclidean_distance( im, gray, true );
+  EXPECT_FLOAT_EQ( sqrt(50.0), gray(5,5).v() );
+
+  // A source that is not an ImageView, larger than a strip of rows.
+  ImageView<float> constant = euclidean_distance( constant_view( uint8(1), 10, 600 ) );
+  EXPECT_EQ( 5, constant(4,300) );
+  EXPECT_EQ( 1, constant(4,599) );
+}
@@ -280,3 +280,96 @@ TEST( Filter, SepConv22Box ) {
     EXPECT_EQ( dst(1,1), 1 );
   }
 }
+
+namespace {
+  // A smooth test image with some structure in every channel
+  template <class PixelT>
+  ImageView<PixelT> pattern_image( int cols, int rows ) {
+    ImageView<PixelT> image( cols, rows );
+    for ( int y = 0; y < rows; ++y )
+      for ( int x = 0; x < cols; ++x )
+        for ( size_t c = 0; c < PixelNumChannels<PixelT>::value; ++c )
+          compound_select_channel<typename PixelChannelType<PixelT>::type&>( image(x,y), c ) =
+            0.5 + 0.4*sin( 0.31*x + 0.7*c ) * cos( 0.17*y - 0.2*c ) + ((x*7+y*13+c) % 5)*0.02;
+    return image;
+  }
+
+  // Rasterizing takes the fast paths, operator() always evaluates
+  // the kernel directly.
+  template <class ViewT>
+  double max_rasterize_difference( ViewT const& view ) {
+    typedef typename ViewT::pixel_type pixel_type;
+    ImageView<pixel_type> raster = view;
+    double result = 0;
+    for ( int y = 0; y < view.rows(); ++y )
+      for ( int x = 0; x < view.cols(); ++x )
+        for ( size_t c = 0; c < PixelNumChannels<pixel_type>::value; ++c )
+          result = std::max( result, fabs( double( compound_select_channel<typename PixelChannelType<pixel_type>::type>( raster(x,y), c ) ) -
+                                           double( compound_select_channel<typename PixelChannelType<pixel_type>::type>( view(x,y), c ) ) ) );
+    return result;
+  }
+}
+
+TEST( Filter, SepConvolutionFastPath ) {
+  ImageView<float> src = pattern_image<float>( 37, 29 );
+  std::vector<float> x_kernel(5), y_kernel(3);
+  x_kernel[0] = 0.1f; x_kernel[1] = -0.3f; x_kernel[2] = 0.9f; x_kernel[3] = 0.2f; x_kernel[4] = 0.1f;
+  y_kernel[0] = 0.25f; y_kernel[1] = 0.5f; y_kernel[2] = 0.25f;
+  EXPECT_LT( max_rasterize_difference( separable_convolution_filter( src, x_kernel, y_kernel ) ), 1e-5 );
+  EXPECT_LT( max_rasterize_difference( separable_convolution_filter( src, x_kernel, y_kernel, 1, 2, ZeroEdgeExtension() ) ), 1e-5 );
+  EXPECT_LT( max_rasterize_difference( separable_convolution_filter( src, x_kernel, std::vector<float>() ) ), 1e-5 );
+  EXPECT_LT( max_rasterize_difference( separable_convolution_filter( src, std::vector<float>(), y_kernel ) ), 1e-5 );
+
+  ImageView<PixelRGB<float> > rgb = pattern_image<PixelRGB<float> >( 23, 31 );
+  EXPECT_LT( max_rasterize_difference( separable_convolution_filter( rgb, x_kernel, y_kernel, PeriodicEdgeExtension() ) ), 1e-5 );
+}
+
+TEST( Filter, SepConvolutionBox ) {
+  ImageView<double> src = pattern_image<double>( 41, 33 );
+  std::vector<double> x_kernel( 9, 1.0/9 ), y_kernel( 6, 1.0/6 );
+  EXPECT_EQ( convolution::BoxLines, convolution::choose_line_strategy( x_kernel, 4, 0 ) );
+  EXPECT_LT( max_rasterize_difference( separable_convolution_filter( src, x_kernel, y_kernel ) ), 1e-12 );
+
+  ImageView<PixelRGBA<float> > rgba = pattern_image<PixelRGBA<float> >( 40, 20 );
+  std::vector<float> box( 7, 1.0f/7 );
+  EXPECT_LT( max_rasterize_difference( separable_convolution_filter( rgba, box, box, ZeroEdgeExtension() ) ), 1e-5 );
+}
+
+TEST( Filter, GaussianRecursive ) {
+  // The recursive filter is only used when asked for, and then only
+  // approximates the sampled kernel at large sigmas.
+  ImageView<float> src = pattern_image<float>( 120, 90 );
+  std::vector<float> kernel;
+  generate_gaussian_kernel( kernel, 8.0 );
+  EXPECT_EQ( convolution::RecursiveGaussianLines,
+             convolution::choose_line_strategy( kernel, kernel.size()/2, 8.0 ) );
+  EXPECT_EQ( convolution::DirectLines,
+             convolution::choose_line_strategy( kernel, kernel.size()/2, 0.0 ) );
+  EXPECT_LT( max_rasterize_difference( gaussian_filter( src, 8.0 ) ), 1e-5 );
+  EXPECT_LT( max_rasterize_difference( recursive_gaussian_filter( src, 8.0 ) ), 1e-3 );
+  EXPECT_LT( max_rasterize_difference( recursive_gaussian_filter( src, 12.0, 6.0, ZeroEdgeExtension() ) ), 1e-3 );
+
+  // A constant image stays constant
+  ImageView<float> flat( 80, 70 );
+  fill( flat, 3.0f );
+  ImageView<float> smooth = recursive_gaussian_filter( flat, 10.0 );
+  for ( int y = 0; y < smooth.rows(); ++y )
+    for ( int x = 0; x < smooth.cols(); ++x )
+      EXPECT_NEAR( 3.0, smooth(x,y), 1e-4 );
+
+  // Small sigmas are unchanged
+  EXPECT_LT( max_rasterize_difference( recursive_gaussian_filter( src, 1.5 ) ), 1e-5 );
+}
+
+TEST( Filter, ConvolutionFastPath ) {
+  ImageView<double> src = pattern_image<double>( 31, 27 );
+  ImageView<double> kernel(5,4);
+  for ( int y = 0; y < kernel.rows(); ++y )
+    for ( int x = 0; x < kernel.cols(); ++x )
+      kernel(x,y) = (x == 2 && y == 1) ? 0 : 0.1*(x+1) - 0.05*y*y;
+  EXPECT_LT( max_rasterize_difference( convolution_filter( src, kernel ) ), 1e-12 );
+  EXPECT_LT( max_rasterize_difference( convolution_filter( src, kernel, 0, 3, ReflectEdgeExtension() ) ), 1e-12 );
+
+  ImageView<PixelRGB<double> > rgb = pattern_image<PixelRGB<double> >( 17, 19 );
+  EXPECT_LT( max_rasterize_difference( convolution_filter( rgb, kernel ) ), 1e-12 );
+}
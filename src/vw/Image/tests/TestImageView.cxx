@@ -22,6 +22,8 @@
 #include <vw/Image/ViewImageResource.h>
 #include <vw/Image/PixelTypes.h>
 #include <vw/Image/ImageIO.h>
+#include <vw/Core/MemoryPool.h>
+#include <vw/Core/Settings.h>
 
 using namespace vw;
 
@@ -120,6 +122,38 @@ TEST( ImageView, SetSize ) {
   EXPECT_THROW(test_rgba.set_size(0,std::numeric_limits<int32>::max()), ArgumentErr);
 }
 
+TEST( ImageView, PooledBuffers ) {
+  vw_settings().set_image_buffer_pool_size(16*1024*1024);
+  MemoryPoolStats before = vw_memory_pool().stats();
+
+  const void* first_data = 0;
+  {
+    ImageView<PixelRGB<float> > tile(100,50);
+    first_data = tile.data();
+    EXPECT_EQ( 0u, size_t(tile.data()) % MemoryPool::ALIGNMENT );
+    // Class pixel types are still default constructed.
+    EXPECT_EQ( PixelRGB<float>(), tile(99,49) );
+    tile(99,49) = PixelRGB<float>(1,2,3);
+  }
+  {
+    // A tile of the same size reuses the buffer, which is cleared.
+    ImageView<PixelRGB<float> > tile(100,50);
+    EXPECT_EQ( first_data, (const void*)tile.data() );
+    EXPECT_EQ( PixelRGB<float>(), tile(99,49) );
+
+    ImageView<float> gray(100,150);
+    EXPECT_EQ( 0.0f, gray(99,149) );
+  }
+
+  MemoryPoolStats after = vw_memory_pool().stats();
+  EXPECT_EQ( 3u, after.allocations - before.allocations );
+  EXPECT_EQ( 1u, after.cache_hits  - before.cache_hits );
+  EXPECT_EQ( before.bytes_in_use, after.bytes_in_use );
+
+  vw_settings().set_image_buffer_pool_size(0);
+  vw_memory_pool().purge();
+}
+
 TEST( ImageView, Reset ) {
   ImageView<double> test_double(3,4);
   ASSERT_TRUE( test_double.is_valid_image() );
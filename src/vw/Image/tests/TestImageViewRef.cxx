@@ -22,6 +22,7 @@
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/Interpolation.h>
+#include <vw/Image/ImageMath.h>
 
 using namespace vw;
 
@@ -93,3 +94,75 @@ TEST( ImageViewRef, FloatAccess ) {
   EXPECT_EQ( ref(char(0),int32(0)), 0 );
   EXPECT_EQ( ref(char(0),int32(0),0), 0 );
 }
+
+TEST( ImageViewRef, AccessorRuns ) {
+  const int cols=70, rows=5;
+  ImageView<float> image(cols,rows,2);
+  for( int p=0; p<2; ++p )
+    for( int r=0; r<rows; ++r )
+      for( int c=0; c<cols; ++c )
+        image(c,r,p) = (float)(p*1000+r*cols+c);
+  ImageViewRef<float> ref = image*2;
+
+  // Row-major traversal, long enough to use several runs
+  ImageViewRef<float>::pixel_accessor racc = ref.origin();
+  for( int r=0; r<rows; ++r ) {
+    ImageViewRef<float>::pixel_accessor cacc = racc;
+    for( int c=0; c<cols; ++c ) {
+      EXPECT_EQ( 2*image(c,r), *cacc );
+      cacc.next_col();
+    }
+    racc.next_row();
+  }
+
+  // Stepping along a column after a run has been cached
+  ImageViewRef<float>::pixel_accessor acc = ref.origin();
+  EXPECT_EQ( 0, *acc );
+  acc.next_col(); EXPECT_EQ( 2, *acc );
+  acc.next_col(); EXPECT_EQ( 4, *acc );
+  acc.next_row(); EXPECT_EQ( 2*image(2,1), *acc );
+  acc.prev_col(); EXPECT_EQ( 2*image(1,1), *acc );
+  acc.next_plane(); EXPECT_EQ( 2*image(1,1,1), *acc );
+  acc.advance(60,2,-1); EXPECT_EQ( 2*image(61,3), *acc );
+  acc.advance(-61,1,1); EXPECT_EQ( 2*image(0,4,1), *acc );
+
+  // A copy starts from the same position
+  ImageViewRef<float>::pixel_accessor copy = acc;
+  copy.next_col();
+  EXPECT_EQ( 2*image(1,4,1), *copy );
+  EXPECT_EQ( 2*image(0,4,1), *acc );
+
+  // Block fetch
+  float block[6];
+  ref.fetch( 68, 2, 1, 2, 3, block );
+  for( int r=0; r<3; ++r )
+    for( int c=0; c<2; ++c )
+      EXPECT_EQ( 2*image(68+c,2+r,1), block[r*2+c] );
+}
+
+TEST( ImageViewRef, InterpolationMatchesTemplated ) {
+  const int cols=9, rows=7;
+  ImageView<float> image(cols,rows);
+  for( int r=0; r<rows; ++r )
+    for( int c=0; c<cols; ++c )
+      image(c,r) = (float)((r*7+c*3)%11);
+  ImageViewRef<float> ref = image + 1;
+
+  for( double y=-1.5; y<rows+1; y+=0.35 )
+    for( double x=-1.5; x<cols+1; x+=0.45 ) {
+      EXPECT_EQ( interpolate(image+1, BilinearInterpolation())(x,y),
+                 interpolate(ref,     BilinearInterpolation())(x,y) );
+      EXPECT_EQ( interpolate(image+1, BicubicInterpolation())(x,y),
+                 interpolate(ref,     BicubicInterpolation())(x,y) );
+      EXPECT_EQ( interpolate(image+1, BicubicInterpolation(), ZeroEdgeExtension())(x,y),
+                 interpolate(ref,     BicubicInterpolation(), ZeroEdgeExtension())(x,y) );
+    }
+
+  // Without edge extension, inside the image
+  BicubicInterpolationImpl<ImageViewRef<float> > bicubic;
+  BicubicInterpolationImpl<ImageView<float> >    bicubic_image;
+  ImageView<float> image1 = image + 1;
+  for( double y=1; y<rows-2; y+=0.3 )
+    for( double x=1; x<cols-2; x+=0.4 )
+      EXPECT_EQ( bicubic_image(image1,x,y,0), bicubic(ref,x,y,0) );
+}
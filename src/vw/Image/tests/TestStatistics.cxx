@@ -26,6 +26,8 @@
 
 #include <test/Helpers.h>
 
+#include <algorithm>
+
 using namespace vw;
 
 ImageView<vw::uint8> im8(2,1), im8b(3,2);
@@ -527,6 +529,96 @@ TEST( Statistics, OptimalThreshold ) {
   EXPECT_NEAR(t, t0, 1e-15);
 }
 
+TEST( Statistics, ChannelStatistics ) {
+  // Several tiles of masked values spread over a wide range.
+  ImageView<PixelMask<PixelGray<float> > > image( 600, 300 );
+  std::vector<double> values;
+  for ( int32 y = 0; y < image.rows(); ++y )
+    for ( int32 x = 0; x < image.cols(); ++x ) {
+      float value = 1000*sin(x*0.013)*cos(y*0.021) + 0.01*x*y;
+      image(x,y) = PixelGray<float>( value );
+      if ( (x + 3*y) % 17 == 0 )
+        image(x,y).invalidate();
+      else
+        values.push_back( value );
+    }
+  std::sort( values.begin(), values.end() );
+
+  ChannelStatistics stats = channel_statistics( image );
+  ASSERT_EQ( values.size(), stats.num_valid() );
+  EXPECT_EQ( values.front(), stats.minimum() );
+  EXPECT_EQ( values.back(),  stats.maximum() );
+  EXPECT_NEAR( mean_channel_value  ( image ), stats.mean  (), 1e-6 );
+  EXPECT_NEAR( stddev_channel_value( image ), stats.stddev(), 1e-6 );
+
+  double tolerance = 2*( values.back() - values.front() ) / ( stats.num_bins() - 1 );
+  EXPECT_GE( tolerance, stats.bin_width() );
+  for ( int i = 1; i < 10; ++i )
+    EXPECT_NEAR( values[ size_t( i*0.1*values.size() ) ], stats.quantile( i*0.1 ), tolerance );
+  EXPECT_NEAR( median_channel_value( image ), stats.median(), tolerance );
+
+  // The histogram holds every value, and does not depend on how the
+  // tiles were split between threads.
+  ChannelStatistics single = channel_statistics( image, 1024, 1 );
+  uint64 total = 0;
+  for ( int32 bin = 0; bin < stats.num_bins(); ++bin ) {
+    total += stats.bin_count( bin );
+    EXPECT_EQ( single.bin_count( bin ), stats.bin_count( bin ) );
+  }
+  EXPECT_EQ( stats.num_valid(), total );
+  EXPECT_LE( stats.bin_start( 0 ), stats.minimum() );
+
+  // Pixels masked by a nodata value are not counted either.
+  ImageView<uint8> digits( 300, 200 );
+  uint64 num_nonzero = 0;
+  for ( int32 y = 0; y < digits.rows(); ++y )
+    for ( int32 x = 0; x < digits.cols(); ++x ) {
+      digits(x,y) = x % 10;
+      if ( digits(x,y) != 0 )
+        ++num_nonzero;
+    }
+  EXPECT_EQ( num_nonzero, channel_statistics( create_mask( digits, uint8(0) ) ).num_valid() );
+}
+
+TEST( Statistics, ChannelStatisticsMerge ) {
+  std::vector<double> low, high, all;
+  for ( int i = 0; i < 500; ++i ) {
+    low.push_back( 0.001*i );
+    high.push_back( 1e4 + 7.0*i );
+  }
+  all = low;
+  all.insert( all.end(), high.begin(), high.end() );
+  all.push_back( std::numeric_limits<double>::quiet_NaN() );
+
+  ChannelStatistics merged( 64 ), together( 64 );
+  merged.add( low );
+  merged.add( high );
+  together.add( all );
+  EXPECT_EQ( 1000u, merged.num_valid() );
+  EXPECT_EQ( together.num_valid(), merged.num_valid() );
+  EXPECT_EQ( together.bin_width(), merged.bin_width() );
+  for ( int32 bin = 0; bin < 64; ++bin )
+    EXPECT_EQ( together.bin_count( bin ), merged.bin_count( bin ) );
+  EXPECT_NEAR( together.mean(),   merged.mean(),   1e-9 );
+  EXPECT_NEAR( together.stddev(), merged.stddev(), 1e-9 );
+  EXPECT_EQ( 0, merged.minimum() );
+  EXPECT_EQ( 1e4 + 7*499, merged.maximum() );
+
+  // Channels of every valid pixel count; an empty image has no values.
+  ImageView<PixelRGB<uint8> > rgb( 2, 1 );
+  rgb(0,0) = PixelRGB<uint8>( 1, 2, 3 );
+  rgb(1,0) = PixelRGB<uint8>( 4, 5, 6 );
+  ChannelStatistics rgb_stats = channel_statistics( rgb );
+  EXPECT_EQ( 6u, rgb_stats.num_valid() );
+  EXPECT_EQ( 3.5, rgb_stats.mean() );
+  EXPECT_EQ( 1, rgb_stats.quantile( 0 ) );
+  EXPECT_EQ( 6, rgb_stats.quantile( 1 ) );
+
+  ChannelStatistics empty = channel_statistics( ImageView<float>() );
+  EXPECT_EQ( 0u, empty.num_valid() );
+  EXPECT_THROW( empty.mean(), ArgumentErr );
+}
+
 TEST(BlockOperations, DISABLED_CDF) {
 
   const Vector2i block_size(128, 128);
@@ -77,8 +77,37 @@ namespace ip {
     template <class ViewT>
     InterestPointList operator() (vw::ImageViewBase<ViewT> const& image,
                                   int desired_num_ip=0);
+
+    /// Find the interest points in an image, only returning those located inside roi.
+    /// - The pixels outside of roi are only used as context (a halo) for the detector.
+    /// - desired_num_ip is applied to the points inside roi.
+    template <class ViewT>
+    InterestPointList operator() (vw::ImageViewBase<ViewT> const& image,
+                                  BBox2i const& roi, int desired_num_ip=0);
+
+    /// The number of pixels of context needed around a tile so that the points
+    /// found near the tile edge match those found in the full image.
+    /// - Detectors which don't override this are run on tiles with no halo.
+    int tile_halo() const { return 0; }
+
+    /// Default implementation for detectors which are not halo aware.  The whole
+    /// image is processed and then the points outside of roi are discarded.
+    template <class ViewT>
+    InterestPointList process_tile(ImageViewBase<ViewT> const& image,
+                                   BBox2i const& roi, int desired_num_ip=0) const;
   };
 
+  /// Remove all of the interest points whose pixel location is not inside roi.
+  inline void crop_interest_points(InterestPointList& points, BBox2i const& roi) {
+    InterestPointList::iterator pos = points.begin();
+    while (pos != points.end()) {
+      if (!roi.contains(Vector2i(pos->ix, pos->iy)))
+        pos = points.erase(pos);
+      else
+        pos++;
+    }
+  }
+
   /// Get the orientation of the point at (i0,j0,k0).  This is done by
   /// computing a gaussian weighted average orientations in a region
   /// around the detected point.  This is not the most sophisticated
@@ -379,6 +408,8 @@ namespace ip {
   /// This function implements a multithreaded interest point detector using
   /// the passed-in detector object.
   /// - Threads are spun off to process the image in 1024x1024 pixel blocks.
+  /// - If the detector requests a tile_halo(), each block is padded by that
+  ///   many pixels and only the points inside the unpadded block are kept.
   /// - Pass in desired_num_ip to enforce this limit proportional to the tile size,
   ///   otherwise each tile will use the same number regardless of size.
   template <class ViewT, class DetectorT>
@@ -40,6 +40,33 @@ InterestPointList InterestDetectorBase<ImplT>::operator() (vw::ImageViewBase<Vie
   return interest_points;
 }
 
+// Find the interest points in an image, only returning those inside roi.
+template <class ImplT>
+template <class ViewT>
+InterestPointList InterestDetectorBase<ImplT>::operator() (vw::ImageViewBase<ViewT> const& image,
+                                                           BBox2i const& roi, int desired_num_ip) {
+
+  InterestPointList interest_points;
+  vw_out(DebugMessage, "interest_point") << "Finding interest points in block: [ " << image.impl().cols()
+                                         << " x " << image.impl().rows() << " ] with region "
+                                         << roi << "\n";
+
+  interest_points = impl().process_tile(image.impl(), roi, desired_num_ip);
+
+  vw_out(DebugMessage, "interest_point") << "Finished processing block. Found " << interest_points.size()
+                                         << " interest points.\n";
+  return interest_points;
+}
+
+template <class ImplT>
+template <class ViewT>
+InterestPointList InterestDetectorBase<ImplT>::process_tile(ImageViewBase<ViewT> const& image,
+                                                            BBox2i const& roi, int desired_num_ip) const {
+  InterestPointList interest_points = impl().process_image(image.impl(), desired_num_ip);
+  crop_interest_points(interest_points, roi);
+  return interest_points;
+}
+
 
 
 //-------------------------------------------------------------------
@@ -53,13 +80,25 @@ void InterestPointDetectionTask<ViewT, DetectorT>::operator()() {
                                         " ] with " << m_desired_num_ip << " ip.\n";
 
   // Use the m_detector object to find a set of image points in the cropped section of the image.
-  InterestPointList new_ip_list = m_detector(crop(m_view.impl(), m_bbox), m_desired_num_ip);
+  // - If the detector needs a halo, pad the block with it and only keep the points inside
+  //   the original block.  The blocks don't overlap so each point is found by only one task.
+  InterestPointList new_ip_list;
+  BBox2i read_bbox = m_bbox;
+  const int halo = m_detector.tile_halo();
+  if (halo > 0) {
+    read_bbox.expand(halo);
+    read_bbox.crop(bounding_box(m_view.impl()));
+    new_ip_list = m_detector(crop(m_view.impl(), read_bbox), m_bbox - read_bbox.min(),
+                             m_desired_num_ip);
+  } else {
+    new_ip_list = m_detector(crop(m_view.impl(), m_bbox), m_desired_num_ip);
+  }
 
   for (InterestPointList::iterator pt = new_ip_list.begin(); pt != new_ip_list.end(); ++pt) {
-    (*pt).x  += m_bbox.min().x();
-    (*pt).ix += m_bbox.min().x();
-    (*pt).y  += m_bbox.min().y();
-    (*pt).iy += m_bbox.min().y();
+    (*pt).x  += read_bbox.min().x();
+    (*pt).ix += read_bbox.min().x();
+    (*pt).y  += read_bbox.min().y();
+    (*pt).iy += read_bbox.min().y();
   }
 
   // Append these interest points to the master list
@@ -127,6 +127,23 @@ namespace ip {
     template <class ViewT>
     InterestPointList process_image(ImageViewBase<ViewT> const& image,
                                     int desired_num_ip=0 ) const {
+      return process_tile( image, bounding_box(image.impl()), desired_num_ip );
+    }
+
+    /// Pixels of context needed around a tile: the largest box filter
+    /// plus the Harris and orientation windows at the coarsest reported scale.
+    int tile_halo() const {
+      int   top   = std::max( m_scales - 1, 1 );
+      float sigma = m_interest.float_scale( top - 1 );
+      return m_interest.support_radius( top ) + int(ceil( 8*sigma )) + 1;
+    }
+
+    /// Detect Interest Points in the source image, only keeping those inside roi.
+    /// - The integral image covers the whole input so the pixels outside of
+    ///   roi provide filter support for the points near its edge.
+    template <class ViewT>
+    InterestPointList process_tile(ImageViewBase<ViewT> const& image,
+                                   BBox2i const& roi, int desired_num_ip=0 ) const {
       typedef ImageView<typename PixelChannelType<PixelGray<float> >::type> ImageT;
       typedef ImageInterestData<ImageT,InterestT> DataT;
 
@@ -173,21 +190,24 @@ namespace ip {
         InterestPointList scale_points;
 
         // Detecting interest points in middle
-        int32 cols = original_image.cols() - 2;
-        int32 rows = original_image.rows() - 2;
+        BBox2i scan = scan_region( original_image, roi );
+        int32 cols = scan.width();
+        int32 rows = scan.height();
         typedef typename DataT::interest_type::pixel_accessor AccessT;
 
         AccessT l_row = interest_data[0].interest().origin();
         AccessT m_row = interest_data[1].interest().origin();
         AccessT h_row = interest_data[2].interest().origin();
-        l_row.advance(1,1); m_row.advance(1,1); h_row.advance(1,1);
+        l_row.advance(scan.min().x(),scan.min().y());
+        m_row.advance(scan.min().x(),scan.min().y());
+        h_row.advance(scan.min().x(),scan.min().y());
         for ( int32 r=0; r < rows; r++ ) {
           AccessT l_col = l_row;
           AccessT m_col = m_row;
           AccessT h_col = h_row;
           for ( int32 c=0; c < cols; c++ ) {
             if ( is_extrema( l_col, m_col, h_col ) )
-              scale_points.push_back(InterestPoint(c+2,r+2,
+              scale_points.push_back(InterestPoint(scan.min().x()+c+1,scan.min().y()+r+1,
                                                    m_interest.float_scale(scale-1),
                                                    *m_col) );
             l_col.next_col();
@@ -242,6 +262,17 @@ namespace ip {
     InterestT m_interest;
     int m_scales, m_max_points;
 
+    /// The pixels of roi at which the 3x3 extrema test fits inside the image.
+    template <class ImageT>
+    inline BBox2i scan_region( ImageViewBase<ImageT> const& image,
+                               BBox2i const& roi ) const {
+      BBox2i scan = roi;
+      scan.crop( BBox2i( 1, 1, image.impl().cols()-2, image.impl().rows()-2 ) );
+      if ( scan.empty() )
+        return BBox2i( 1, 1, 0, 0 );
+      return scan;
+    }
+
     template <class AccessT>
     bool inline is_extrema( AccessT const& low,
                             AccessT const& mid,
@@ -299,6 +330,7 @@ namespace ip {
     // Clear ambiguity of which impl to use. Scope doesn't work.
     using InterestDetectorBase<IntegralAutoGainDetector>::impl;
     using InterestDetectorBase<IntegralAutoGainDetector>::operator();
+    using IntegralInterestPointDetector<OBALoGInterestOperator>::tile_halo;
 
     IntegralAutoGainDetector( size_t max_points = 200, size_t scales = IP_DEFAULT_SCALES )
       : IntegralInterestPointDetector<OBALoGInterestOperator>( OBALoGInterestOperator(0), scales, max_points ) {}
@@ -307,6 +339,13 @@ namespace ip {
     template <class ViewT>
     InterestPointList process_image(vw::ImageViewBase<ViewT> const& image,
                                     int desired_num_ip=0 ) const {
+      return process_tile( image, bounding_box(image.impl()), desired_num_ip );
+    }
+
+    /// Detect Interest Points in the source image, only keeping those inside roi.
+    template <class ViewT>
+    InterestPointList process_tile(vw::ImageViewBase<ViewT> const& image,
+                                   BBox2i const& roi, int desired_num_ip=0 ) const {
       using namespace vw;
       typedef ImageView<typename PixelChannelType<typename ViewT::pixel_type>::type> ImageT;
       typedef ip::ImageInterestData<ImageT,ip::OBALoGInterestOperator> DataT;
@@ -361,21 +400,24 @@ namespace ip {
         ip::InterestPointList scale_points;
 
         // Detecting interest points in middle
-        int32 cols = original_image.cols() - 2;
-        int32 rows = original_image.rows() - 2;
+        BBox2i scan = scan_region( original_image, roi );
+        int32 cols = scan.width();
+        int32 rows = scan.height();
         typedef typename DataT::interest_type::pixel_accessor AccessT;
 
         AccessT l_row = interest_data[0].interest().origin();
         AccessT m_row = interest_data[1].interest().origin();
         AccessT h_row = interest_data[2].interest().origin();
-        l_row.advance(1,1); m_row.advance(1,1); h_row.advance(1,1);
+        l_row.advance(scan.min().x(),scan.min().y());
+        m_row.advance(scan.min().x(),scan.min().y());
+        h_row.advance(scan.min().x(),scan.min().y());
         for ( int32 r=0; r < rows; r++ ) {
           AccessT l_col = l_row;
           AccessT m_col = m_row;
           AccessT h_col = h_row;
           for ( int32 c=0; c < cols; c++ ) {
             if ( is_extrema( l_col, m_col, h_col ) ) {
-              scale_points.push_back(ip::InterestPoint(c+1,r+1,
+              scale_points.push_back(ip::InterestPoint(scan.min().x()+c,scan.min().y()+r,
                                                        m_interest.float_scale(scale-1),
                                                        *m_col) );
             }
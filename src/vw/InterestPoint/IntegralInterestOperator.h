@@ -25,6 +25,7 @@
 
 // STL
 #include <vector>
+#include <algorithm>
 
 #include <vw/Image/ImageViewRef.h>
 #include <vw/Image/Filter.h>
@@ -156,6 +157,14 @@ namespace ip {
       return SCALE_LOG_SIGMA[scale];
     }
 
+    /// Half width of the largest box used by the filter at this scale.
+    inline int support_radius( int const& scale ) const {
+      int size = 0;
+      for ( uint8 b = 0; b < 6; b++ )
+        size = std::max( size, std::max( SCALE_BOX_WIDTH[scale][b], SCALE_BOX_HEIGHT[scale][b] ) );
+      return size / 2;
+    }
+
   };
 
   // Type traits for OBALoG Interest
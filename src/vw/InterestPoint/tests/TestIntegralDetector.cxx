@@ -0,0 +1,141 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// TestIntegralDetector.cxx
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+#include <vw/InterestPoint/IntegralDetector.h>
+
+#include <set>
+
+using namespace vw;
+using namespace vw::ip;
+
+namespace {
+
+  // An image full of gaussian blobs of different sizes
+  ImageView<PixelGray<float> > blob_image( int cols, int rows ) {
+    ImageView<PixelGray<float> > image( cols, rows );
+    for ( int row = 0; row < rows; row++ ) {
+      for ( int col = 0; col < cols; col++ ) {
+        float value = 0;
+        for ( int by = 10; by < rows; by += 37 ) {
+          for ( int bx = 10; bx < cols; bx += 41 ) {
+            float sigma = 2 + (bx + by) % 5;
+            float d2 = (col-bx)*(col-bx) + (row-by)*(row-by);
+            value += exp( -d2 / (2*sigma*sigma) );
+          }
+        }
+        image(col,row) = value;
+      }
+    }
+    return image;
+  }
+
+  // The location and scale of each point, shifted by offset.
+  typedef std::multiset<std::pair<std::pair<int,int>,float> > PointSet;
+  PointSet locations( InterestPointList const& points,
+                      Vector2i const& offset = Vector2i() ) {
+    PointSet result;
+    for ( InterestPointList::const_iterator it = points.begin(); it != points.end(); ++it )
+      result.insert( std::make_pair( std::make_pair( it->ix + offset.x(), it->iy + offset.y() ),
+                                    it->scale ) );
+    return result;
+  }
+
+  // Running a detector on a tile padded by its halo should find the same
+  // points in the tile as running it on the full image.
+  template <class DetectorT>
+  void check_tile_matches_full( DetectorT& detector ) {
+    ImageView<PixelGray<float> > image = blob_image( 300, 260 );
+    BBox2i roi( 100, 90, 110, 100 );
+
+    BBox2i read_bbox = roi;
+    read_bbox.expand( detector.tile_halo() );
+    read_bbox.crop( bounding_box(image) );
+
+    InterestPointList full = detector( image, roi );
+    InterestPointList tile = detector( crop(image, read_bbox), roi - read_bbox.min() );
+
+    EXPECT_GT( full.size(), 0u );
+    EXPECT_EQ( full.size(), tile.size() );
+    EXPECT_TRUE( locations(full) == locations(tile, read_bbox.min()) );
+  }
+}
+
+TEST( IntegralDetector, TileHalo ) {
+  IntegralInterestPointDetector<OBALoGInterestOperator> detector( 0 );
+  // Must cover at least the largest box filter
+  EXPECT_GT( detector.tile_halo(), OBALoGInterestOperator().support_radius(7) );
+
+  IntegralAutoGainDetector autogain( 0 );
+  EXPECT_EQ( detector.tile_halo(), autogain.tile_halo() );
+}
+
+TEST( IntegralDetector, TileMatchesFull ) {
+  IntegralInterestPointDetector<OBALoGInterestOperator> detector( OBALoGInterestOperator(0.01), 0 );
+  check_tile_matches_full( detector );
+}
+
+TEST( IntegralDetector, AutoGainTileMatchesFull ) {
+  IntegralAutoGainDetector detector( 0 );
+  check_tile_matches_full( detector );
+}
+
+TEST( IntegralDetector, TilesPartitionImage ) {
+  // Splitting the image into tiles must neither lose nor duplicate points.
+  IntegralInterestPointDetector<OBALoGInterestOperator> detector( OBALoGInterestOperator(0.01), 0 );
+  ImageView<PixelGray<float> > image = blob_image( 300, 260 );
+
+  PointSet expected = locations( detector( image ) );
+
+  PointSet found;
+  std::vector<BBox2i> tiles = subdivide_bbox( image, 128, 128 );
+  for ( size_t i = 0; i < tiles.size(); i++ ) {
+    BBox2i read_bbox = tiles[i];
+    read_bbox.expand( detector.tile_halo() );
+    read_bbox.crop( bounding_box(image) );
+    InterestPointList points = detector( crop(image, read_bbox), tiles[i] - read_bbox.min() );
+    PointSet tile_found = locations( points, read_bbox.min() );
+    found.insert( tile_found.begin(), tile_found.end() );
+  }
+
+  // No point may be reported by two tiles
+  std::set<PointSet::value_type> unique( found.begin(), found.end() );
+  EXPECT_EQ( unique.size(), found.size() );
+
+  // The smaller tile integral images are not rounded the same way as the
+  // full image one, so a few weak points may move by a pixel.
+  EXPECT_NEAR( double(expected.size()), double(found.size()), 0.02*expected.size() );
+  size_t matched = 0;
+  for ( PointSet::const_iterator it = expected.begin(); it != expected.end(); ++it )
+    matched += found.count( *it );
+  EXPECT_GT( matched, size_t(0.95*expected.size()) );
+}
+
+TEST( IntegralDetector, TileBudget ) {
+  // The point budget applies to the points inside the tile.
+  IntegralInterestPointDetector<OBALoGInterestOperator> detector( OBALoGInterestOperator(0.01), 0 );
+  ImageView<PixelGray<float> > image = blob_image( 300, 260 );
+  BBox2i roi( 100, 90, 110, 100 );
+
+  InterestPointList all     = detector( image, roi );
+  InterestPointList limited = detector( image, roi, 3 );
+  ASSERT_GT( all.size(), 3u );
+  EXPECT_EQ( 3u, limited.size() );
+}
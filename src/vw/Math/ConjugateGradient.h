@@ -69,11 +69,17 @@
 /// which may be buggy and certainly is underperforming Armijo
 /// for me at the moment.  I also provide a steepest_descent()
 /// method for comparison to conjugate_gradient().
+///
+/// For symmetric positive definite linear systems there is also
+/// preconditioned_conjugate_gradient(), which only needs a functor
+/// that computes the matrix-vector product, so the matrix never has
+/// to be formed.
 
 #ifndef __VW_MATH_CONJUGATEGRADIENT_H__
 #define __VW_MATH_CONJUGATEGRADIENT_H__
 
 #include <vw/Core/Log.h>
+#include <vw/Math/Vector.h>
 
 #define VW_CONJGRAD_MAX_ITERS_BETWEEN_SPACER_STEPS 20
 
@@ -240,6 +246,66 @@ namespace math{
     return pos;
   }
 
+
+  /// Preconditioner that does nothing, for unpreconditioned linear CG.
+  struct IdentityPreconditioner {
+    void operator()( Vector<double> const& r, Vector<double>& z ) const { z = r; }
+  };
+
+  /// Solves A*x = b for a symmetric positive definite A with the linear
+  /// preconditioned conjugate gradient method. The product functor
+  /// computes y = A*x and the preconditioner computes z = M^-1*r, both
+  /// with the signature
+  ///   void operator()( Vector<double> const& in, Vector<double>& out ) const;
+  /// x holds the initial guess on entry and the solution on exit. The
+  /// iteration stops once the residual norm falls below tolerance times
+  /// the norm of b, or after max_iterations. Returns the number of
+  /// iterations taken.
+  template <class ProductT, class PreconditionerT>
+  int preconditioned_conjugate_gradient( ProductT const& product,
+                                         PreconditionerT const& preconditioner,
+                                         Vector<double> const& b,
+                                         Vector<double>& x,
+                                         int max_iterations,
+                                         double tolerance = 1e-10 ) {
+    if ( x.size() != b.size() ) {
+      x.set_size( b.size() );
+      fill( x, 0.0 );
+    }
+    double b_norm = norm_2(b);
+    if ( b_norm == 0 ) {
+      fill( x, 0.0 );
+      return 0;
+    }
+
+    Vector<double> Ap( b.size() ), z( b.size() );
+    product( x, Ap );
+    Vector<double> r = b - Ap;
+    preconditioner( r, z );
+    Vector<double> p = z;
+    double rz = dot_prod( r, z );
+
+    int i = 0;
+    for ( ; i < max_iterations; ++i ) {
+      double r_norm = norm_2(r);
+      VW_OUT(VerboseDebugMessage, "math") << "PCG step " << i << ": " << r_norm/b_norm << std::endl;
+      if ( r_norm <= tolerance * b_norm )
+        break;
+      product( p, Ap );
+      double pAp = dot_prod( p, Ap );
+      if ( pAp <= 0 ) // A is not positive definite along p
+        break;
+      double alpha = rz / pAp;
+      x += alpha * p;
+      r -= alpha * Ap;
+      preconditioner( r, z );
+      double rz_next = dot_prod( r, z );
+      p = z + (rz_next / rz) * p;
+      rz = rz_next;
+    }
+    return i;
+  }
+
 } } // namespace vw::math
 
 #endif // #ifndef __VW_MATH_CONJUGATEGRADIENT_H__
@@ -19,7 +19,9 @@
 // TestConjugateGradient.h
 #include <gtest/gtest_VW.h>
 #include <vw/Math/Vector.h>
+#include <vw/Math/Matrix.h>
 #include <vw/Math/ConjugateGradient.h>
+#include <test/Helpers.h>
 
 using namespace vw;
 using namespace vw::math;
@@ -62,3 +64,48 @@ TEST( ConjugateGradient, ConjugateGradient ) {
   EXPECT_NEAR(result[0], 0.1962, 1e-3);
   EXPECT_NEAR(result[1], 0.4846, 1e-3);
 }
+
+// Products with a small dense symmetric positive definite matrix.
+struct DenseProduct {
+  Matrix<double> m_A;
+  DenseProduct( Matrix<double> const& A ) : m_A(A) {}
+  void operator()( Vector<double> const& x, Vector<double>& y ) const { y = m_A * x; }
+};
+
+struct JacobiPreconditioner {
+  Matrix<double> m_A;
+  JacobiPreconditioner( Matrix<double> const& A ) : m_A(A) {}
+  void operator()( Vector<double> const& r, Vector<double>& z ) const {
+    z.set_size( r.size() );
+    for ( size_t i = 0; i < r.size(); i++ )
+      z[i] = r[i] / m_A(i,i);
+  }
+};
+
+TEST( ConjugateGradient, PreconditionedLinear ) {
+  Matrix<double> A(4,4);
+  A(0,0) = 40; A(0,1) = 1;   A(0,2) = 2;   A(0,3) = 0;
+  A(1,0) = 1;  A(1,1) = 3;   A(1,2) = 0.5; A(1,3) = 0.2;
+  A(2,0) = 2;  A(2,1) = 0.5; A(2,2) = 9;   A(2,3) = 1;
+  A(3,0) = 0;  A(3,1) = 0.2; A(3,2) = 1;   A(3,3) = 0.7;
+  Vector<double> expected(4);
+  expected[0] = 1; expected[1] = -2; expected[2] = 0.5; expected[3] = 3;
+  Vector<double> b = A * expected;
+
+  Vector<double> x;
+  int iterations = preconditioned_conjugate_gradient( DenseProduct(A), IdentityPreconditioner(),
+                                                      b, x, 20 );
+  EXPECT_LE( iterations, 20 );
+  EXPECT_VECTOR_NEAR( expected, x, 1e-8 );
+
+  Vector<double> y;
+  preconditioned_conjugate_gradient( DenseProduct(A), JacobiPreconditioner(A), b, y, 20 );
+  EXPECT_VECTOR_NEAR( expected, y, 1e-8 );
+
+  // A zero right hand side gives the zero solution immediately
+  Vector<double> z(4);
+  fill( z, 1.0 );
+  EXPECT_EQ( 0, preconditioned_conjugate_gradient( DenseProduct(A), IdentityPreconditioner(),
+                                                   Vector<double>(4), z, 20 ) );
+  EXPECT_VECTOR_NEAR( Vector<double>(4), z, 1e-15 );
+}
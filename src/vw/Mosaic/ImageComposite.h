@@ -34,6 +34,7 @@
 #include <vw/Image/ImageMath.h>
 #include <vw/Image/EdgeExtension.h>
 #include <vw/Image/Algorithms.h>
+#include <vw/Image/DistanceTransform.h>
 #include <vw/Image/Transform.h>
 #include <vw/Image/Filter.h>
 #include <vw/Image/SparseImageCheck.h>
@@ -177,8 +178,8 @@ namespace mosaic {
         return m_source.cols() * m_source.rows() * sizeof(float32);
       }
       boost::shared_ptr<value_type> generate() const {
-        ImageView<float32> alpha = channel_cast<float32>( select_alpha_channel( copy( m_source ) ) );
-        return boost::shared_ptr<value_type>( new value_type( grassfire( alpha ) ) );
+        // The alpha channel is streamed a strip at a time.
+        return boost::shared_ptr<value_type>( new value_type( euclidean_distance( select_alpha_channel( m_source ) ) ) );
       }
     };
 
@@ -29,6 +29,7 @@
 
 #include <vector>
 #include <algorithm>
+#include <numeric>
 #include <utility>
 
 #include <boost/type_traits/is_integral.hpp>
@@ -39,6 +40,12 @@ namespace stereo {
   /// Lower level implementation function for calc_disparity.
   /// - The inputs must already be rasterized to safe sizes!
   /// - Since the inputs are rasterized, the input images must not be too big.
+  ///
+  /// The cost, its box sum and the update of the best and worst
+  /// disparity are fused into one pass over each row. The output is
+  /// processed in strips of rows small enough to stay in cache while
+  /// every disparity is searched, and no buffers are allocated inside
+  /// the search.
   template <template<class,bool> class CostFuncT, class PixelT>
   ImageView<PixelMask<Vector2i> >
   best_of_search_convolution(ImageView<PixelT> const& left_raster,
@@ -48,15 +55,16 @@ namespace stereo {
                              Vector2i          const& kernel_size) {
 
     typedef ImageView<PixelT> ImageType;
-    typedef typename CostFuncT<ImageType,
-      boost::is_integral<typename PixelChannelType<PixelT>::type>::value>::accumulator_type AccumChannelT;
+    typedef CostFuncT<ImageType,
+      boost::is_integral<typename PixelChannelType<PixelT>::type>::value> CostT;
+    typedef typename CostT::accumulator_type AccumChannelT;
     typedef typename PixelChannelCast<PixelT,AccumChannelT>::type AccumT;
     typedef typename std::pair<AccumT,AccumT> QualT;
-
+    typedef typename CostT::functor_type FunctorT;
 
     // Build cost function which sometimes has side car data
-    CostFuncT<ImageType,boost::is_integral<typename PixelChannelType<PixelT>::type>::value> 
-          cost_function( left_raster, right_raster, kernel_size);
+    CostT cost_function( left_raster, right_raster, kernel_size);
+    FunctorT cost;
 
     // Result buffers
     Vector2i result_size = bounding_box(left_raster).size() - kernel_size + Vector2i(1,1);
@@ -65,70 +73,94 @@ namespace stereo {
                PixelMask<Vector2i>(Vector2i()) );
     // First channel is best, second is worst.
     ImageView<QualT > quality_map( result_size[0], result_size[1] );
-    
-    // Storage buffers
-    ImageView<AccumT> cost_metric      ( result_size[0], result_size[1] );
-    ImageView<AccumT> cost_applied     ( left_raster.cols(), left_raster.rows() );
-    ImageView<PixelT> right_raster_crop( left_raster.cols(), left_raster.rows() );
-
-    // Loop across the disparity range we are searching over.
-    Vector2i disparity(0,0);
-    for ( ; disparity.y() != search_volume[1]; ++disparity.y() ) {
-      for ( disparity.x() = 0; disparity.x() != search_volume[0]; ++disparity.x() ) {
-      
-        // Compute correlations quickly by shifting the right image by the
-        //  current disparity, computing the pixel difference at each location,
-        //  and using fast_box_sum/cost_function to get the final convolution
-        //  value at each location in "cost_metric"
-      
-        // There's only one raster here. Fast box sum calls each pixel
-        // individually by pixel accessor. It only calls each pixel
-        // once so there's no reason to copy/rasterize the cost result before hand.
-        //
-        // The cost function should also not be applying an edge
-        // extension as we've already over cropped the input.
-        
-        right_raster_crop = crop(right_raster, bounding_box(left_raster)+disparity);
-        cost_applied      = cost_function( left_raster, right_raster_crop);
-        cost_metric       = fast_box_sum<AccumChannelT>(cost_applied, kernel_size );
-        cost_function.cost_modification( cost_metric, disparity );
-
-        // Loop across the region we want to compute disparities for.
-        // - The correlation score for each pixel is located in "cost_metric"
-        // - We update the best and worst disparity for each pixel in "quality_map"
-
-        // These conditionals might be served outside of the iteration
-        // of dx and dy. It would make the code slightly longer but
-        // would avoid a conditional inside a double loop.
-        const AccumT* cost_ptr     = cost_metric.data();
-        const AccumT* cost_ptr_end = cost_metric.data() + prod(result_size);
-        QualT* quality_ptr         = quality_map.data();
-        PixelMask<Vector2i>* disparity_ptr = disparity_map.data();
-        if ( disparity != Vector2i(0,0) ) {
-          // Normal comparison operations
-          while ( cost_ptr != cost_ptr_end ) {
-            if ( cost_function.quality_comparison( *cost_ptr, quality_ptr->first ) ) {
-              // Better than best?
-              quality_ptr->first = *cost_ptr;
-              disparity_ptr->child() = disparity;
-            } else if ( !cost_function.quality_comparison( *cost_ptr, quality_ptr->second ) ) {
-              // Worse than worse
-              quality_ptr->second = *cost_ptr;
-            }
-            ++cost_ptr;
-            ++quality_ptr;
-            ++disparity_ptr;
-          }
-        } else {
-          // Initializing quality_map and disparity_map with first result
-          while ( cost_ptr != cost_ptr_end ) {
-            quality_ptr->first = quality_ptr->second = *cost_ptr;
-            ++cost_ptr;
-            ++quality_ptr;
+
+    // Storage buffers. col_sum holds the costs summed down the kernel
+    // height for every input column of the current row.
+    const int32 in_cols  = left_raster.cols(),  out_cols = result_size[0];
+    const int32 right_cols = right_raster.cols();
+    std::vector<AccumT> col_sum ( in_cols  );
+    std::vector<AccumT> cost_row( out_cols );
+
+    // Pick the strip height so that the results and the input rows of a
+    // strip share about 256 KB of cache.
+    const size_t cache_bytes = 256 * 1024;
+    const size_t row_bytes   = out_cols * ( sizeof(QualT) + sizeof(PixelMask<Vector2i>) ) +
+                               ( in_cols + right_cols ) * sizeof(PixelT);
+    const int32 strip_rows   = std::max( kernel_size[1], int32( cache_bytes / row_bytes ) );
+
+    for ( int32 strip = 0; strip < result_size[1]; strip += strip_rows ) {
+      const int32 strip_end = std::min( strip + strip_rows, result_size[1] );
+
+      // Loop across the disparity range we are searching over.
+      Vector2i disparity(0,0);
+      for ( ; disparity.y() != search_volume[1]; ++disparity.y() ) {
+        for ( disparity.x() = 0; disparity.x() != search_volume[0]; ++disparity.x() ) {
+
+          // Seed the column sums with the first kernel height of rows
+          std::fill( col_sum.begin(), col_sum.end(), AccumT() );
+          for ( int32 ky = 0; ky < kernel_size[1]; ++ky ) {
+            const PixelT* left  = &left_raster ( 0, strip + ky );
+            const PixelT* right = &right_raster( disparity.x(), strip + ky + disparity.y() );
+            for ( int32 i = 0; i < in_cols; ++i )
+              col_sum[i] += AccumT( cost( left[i], right[i] ) );
           }
-        }
-      } // End x loop
-    } // End y loop
+
+          for ( int32 y = strip; y < strip_end; ++y ) {
+            // Slide the kernel width along the column sums
+            AccumT row_sum(0);
+            row_sum = std::accumulate( &col_sum[0], &col_sum[0] + kernel_size[0], row_sum );
+            const AccumT *cback = &col_sum[0], *cfront = &col_sum[0] + kernel_size[0];
+            for ( int32 x = 0; x < out_cols - 1; ++x ) {
+              cost_row[x] = row_sum;
+              row_sum += *cfront++ - *cback++;
+            }
+            cost_row[out_cols-1] = row_sum;
+            cost_function.cost_modification( &cost_row[0], y, out_cols, disparity );
+
+            // Update the best and worst disparity for each pixel
+            const AccumT* cost_ptr     = &cost_row[0];
+            const AccumT* cost_ptr_end = &cost_row[0] + out_cols;
+            QualT* quality_ptr         = &quality_map( 0, y );
+            PixelMask<Vector2i>* disparity_ptr = &disparity_map( 0, y );
+            if ( disparity != Vector2i(0,0) ) {
+              // Normal comparison operations
+              while ( cost_ptr != cost_ptr_end ) {
+                if ( cost_function.quality_comparison( *cost_ptr, quality_ptr->first ) ) {
+                  // Better than best?
+                  quality_ptr->first = *cost_ptr;
+                  disparity_ptr->child() = disparity;
+                } else if ( !cost_function.quality_comparison( *cost_ptr, quality_ptr->second ) ) {
+                  // Worse than worse
+                  quality_ptr->second = *cost_ptr;
+                }
+                ++cost_ptr;
+                ++quality_ptr;
+                ++disparity_ptr;
+              }
+            } else {
+              // Initializing quality_map and disparity_map with first result
+              while ( cost_ptr != cost_ptr_end ) {
+                quality_ptr->first = quality_ptr->second = *cost_ptr;
+                ++cost_ptr;
+                ++quality_ptr;
+              }
+            }
+
+            // Move the column sums down a row
+            if ( y + 1 < strip_end ) {
+              const PixelT* left_back   = &left_raster ( 0, y );
+              const PixelT* left_front  = &left_raster ( 0, y + kernel_size[1] );
+              const PixelT* right_back  = &right_raster( disparity.x(), y + disparity.y() );
+              const PixelT* right_front = &right_raster( disparity.x(), y + kernel_size[1] + disparity.y() );
+              for ( int32 i = 0; i < in_cols; ++i ) {
+                col_sum[i] += AccumT( cost( left_front[i], right_front[i] ) );
+                col_sum[i] -= AccumT( cost( left_back [i], right_back [i] ) );
+              }
+            }
+          } // End row loop
+        } // End x loop
+      } // End y loop
+    } // End strip loop
 
 
     // Determine validity of result (detects rare invalid cases)
@@ -22,7 +22,10 @@
 #include <vw/Core/Exception.h>
 #include <vw/Core/Stopwatch.h>
 #include <vw/Core/Thread.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image/Algorithms.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/ImageViewRef.h>
 #include <vw/Image/ErodeView.h>
 #include <vw/Image/PerPixelAccessorViews.h>
 #include <vw/Image/ImageIO.h>
@@ -32,6 +35,7 @@
 #include <vw/Stereo/DisparityMap.h>
 #include <vw/Stereo/PreFilter.h>
 #include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
 #include <ctime>
 
 #include <vw/Stereo/SGM.h>
@@ -52,6 +56,13 @@ namespace stereo {
     Vector2i         m_kernel_size;
     CostFunctionType m_cost_type;
     float            m_consistency_threshold; // 0 = means don't do a consistency check
+    ImageView<Vector4i> m_search_ranges; ///< Optional per-block search ranges, see set_search_ranges()
+    int32            m_range_block_size;
+
+    /// Search region of a tile, from m_search_ranges if it was set.
+    BBox2i tile_search_region(BBox2i const& bbox) const {
+      return seeded_search_region(m_search_ranges, m_range_block_size, bbox, m_search_region);
+    }
 
   public:
     typedef PixelMask<Vector2i> pixel_type;
@@ -66,7 +77,17 @@ namespace stereo {
                      float            consistency_threshold = -1 ) :
       m_left_image(left.impl()), m_right_image(right.impl()),
       m_prefilter(prefilter.impl()), m_search_region(search_region), m_kernel_size(kernel_size),
-      m_cost_type(cost_type), m_consistency_threshold(consistency_threshold) {}
+      m_cost_type(cost_type), m_consistency_threshold(consistency_threshold),
+      m_range_block_size(0) {}
+
+    /// Search each tile over the union of the ranges of the blocks it
+    /// covers instead of over the whole search region, as in
+    /// PyramidCorrelationView::set_search_ranges().
+    void set_search_ranges(ImageView<Vector4i> const& ranges, int32 block_size) {
+      VW_ASSERT( block_size > 0, ArgumentErr() << "CorrelationView: Invalid range block size." );
+      m_search_ranges     = ranges;
+      m_range_block_size  = block_size;
+    }
 
     // Standard required ImageView interfaces
     inline int32 cols  () const { return m_left_image.cols(); }
@@ -162,7 +183,9 @@ namespace stereo {
       m_sgm_subpixel_mode(sgm_subpixel_mode),
       m_sgm_search_buffer(sgm_search_buffer),
       m_memory_limit_mb(memory_limit_mb),
-      m_write_debug_images(write_debug_images){
+      m_write_debug_images(write_debug_images),
+      m_shared_pyramids(new SharedPyramids()),
+      m_use_shared_pyramids(false), m_zone_threads(1), m_range_block_size(0) {
 
       // Quit if an invalid area was passed in
       double area = search_region.area();
@@ -175,10 +198,7 @@ namespace stereo {
         m_prefilter_mode = PREFILTER_NONE; // SGM/MGM works best with no prefilter
       
       // Calculating max pyramid levels according to the supplied search region.
-      int32 largest_search = max( search_region.size() );
-      m_max_level_by_search = std::floor(std::log(float(largest_search))/std::log(2.0f)) - 1;
-      if ( m_max_level_by_search > max_pyramid_levels )
-        m_max_level_by_search = max_pyramid_levels;
+      m_max_level_by_search = std::min(levels_for_search(search_region), max_pyramid_levels);
       if ( m_max_level_by_search < 0 )
         m_max_level_by_search = 0;
     } // End constructor
@@ -210,6 +230,36 @@ namespace stereo {
       vw::rasterize(prerasterize(proc_bbox), dest, bbox);
     }
 
+    /// Build the image pyramids once for all tiles instead of once per
+    /// tile. Tiles whose corner is not a multiple of the pyramid
+    /// subsampling, which happens with a collar, still build their own.
+    /// Disabled by default: nodata is filled with the mean of the whole
+    /// image rather than of the tile, and the smoothing and prefilter see
+    /// the real neighbours at tile edges instead of an edge extension, so
+    /// the disparities near tile edges and nodata can differ.
+    void set_shared_pyramids(bool use_shared) { m_use_shared_pyramids = use_shared; }
+
+    /// Number of threads that search the zones of the full resolution
+    /// level of a tile in parallel. Defaults to 1: tiles are normally
+    /// rasterized in parallel on the block processing thread pool, and a
+    /// second queue per tile would oversubscribe the cores. Raise it when
+    /// few tiles are processed at a time, e.g. with a single block thread.
+    void set_zone_threads(int num_threads) { m_zone_threads = std::max(num_threads, 1); }
+
+    /// Search each tile over the union of the ranges of the blocks it
+    /// covers instead of over the whole search region. Each pixel of
+    /// ranges is an inclusive (min_x, min_y, max_x, max_y) disparity range
+    /// for block_size x block_size pixels of the left image, normally made
+    /// by disparity_search_ranges() from a low resolution correlation.
+    /// - The ranges are clipped to the search region.
+    /// - Blocks with an empty range are skipped, and tiles without any
+    ///   range search the whole region.
+    void set_search_ranges(ImageView<Vector4i> const& ranges, int32 block_size) {
+      VW_ASSERT( block_size > 0, ArgumentErr() << "PyramidCorrelationView: Invalid range block size." );
+      m_search_ranges     = ranges;
+      m_range_block_size  = block_size;
+    }
+
 
 
   private: // Variables
@@ -246,8 +296,48 @@ namespace stereo {
 
     bool m_write_debug_images; ///< If true, write out a bunch of intermediate images.
 
+    /// Pyramids of the whole input images, generated on demand as tiles
+    /// request them and kept in the system cache.
+    /// - The right pyramid is on the grid of the left image shifted by the
+    ///   start of the search region, so both line up with the tiles.
+    /// - The images start at origin, which leaves room for the kernel
+    ///   margin of the coarsest level around the image.
+    struct SharedPyramids {
+      Mutex mutex;
+      bool  built, valid;
+      Vector2i origin;
+      std::vector<ImageViewRef<typename Image1T::pixel_type> > left,      left_filtered;
+      std::vector<ImageViewRef<typename Image2T::pixel_type> > right,     right_filtered;
+      std::vector<ImageViewRef<typename Mask1T::pixel_type > > left_mask;
+      std::vector<ImageViewRef<typename Mask2T::pixel_type > > right_mask;
+      SharedPyramids() : built(false), valid(false) {}
+    };
+    boost::shared_ptr<SharedPyramids> m_shared_pyramids; ///< Shared between copies of this view
+    bool m_use_shared_pyramids;
+    int  m_zone_threads;
+
+    ImageView<Vector4i> m_search_ranges; ///< Optional per-block search ranges, see set_search_ranges()
+    int32 m_range_block_size;
+
   private: // Functions
 
+    /// Number of pyramid levels worth using for a search region.
+    static int32 levels_for_search(BBox2i const& search_region) {
+      int32 largest_search = max( search_region.size() );
+      if ( largest_search < 1 )
+        return 0;
+      return std::floor(std::log(float(largest_search))/std::log(2.0f)) - 1;
+    }
+
+    /// Search region of a tile, from m_search_ranges if it was set.
+    BBox2i tile_search_region(BBox2i const& bbox) const;
+
+    /// Region covered by a region of the level above it in a pyramid.
+    static BBox2i half_region(BBox2i const& region) {
+      Vector2i size = (region.size() + Vector2i(1,1)) / 2;
+      return BBox2i(region.min().x()/2, region.min().y()/2, size.x(), size.y());
+    }
+
     /// Downsample a mask by two.
     /// - If at least two mask pixels in a 2x2 region are on, the output pixel is on.
     struct SubsampleMaskByTwoFunc : public ReturnFixedType<uint8> {
@@ -282,11 +372,65 @@ namespace stereo {
     /// Create the image pyramids needed by the prerasterize function.
     /// - Most of this function is spent figuring out the correct ROIs to use.
     bool build_image_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
+                              BBox2i const& search_region,
                               std::vector<ImageView<typename Image1T::pixel_type> > & left_pyramid,
                               std::vector<ImageView<typename Image2T::pixel_type> > & right_pyramid,
                               std::vector<ImageView<typename Mask1T::pixel_type > > & left_mask_pyramid,
                               std::vector<ImageView<typename Mask2T::pixel_type > > & right_mask_pyramid) const;
 
+    /// Returns true if any pixel of a mask is on.
+    template <class PixelT>
+    static bool has_nonzero_pixel(ImageView<PixelT> const& image) {
+      const PixelT* ptr = image.data();
+      const PixelT* end = ptr + image.cols()*image.rows();
+      for ( ; ptr != end; ++ptr )
+        if ( *ptr != PixelT() )
+          return true;
+      return false;
+    }
+
+    /// Build the shared pyramids if that has not been done yet.
+    void build_shared_pyramids() const;
+
+    /// Fill the pyramids needed by the prerasterize function by cropping
+    /// the shared pyramids. Returns false if the tile has no valid data.
+    bool crop_shared_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
+                              BBox2i const& search_region,
+                              std::vector<ImageView<typename Image1T::pixel_type> > & left_pyramid,
+                              std::vector<ImageView<typename Image2T::pixel_type> > & right_pyramid,
+                              std::vector<ImageView<typename Mask1T::pixel_type > > & left_mask_pyramid,
+                              std::vector<ImageView<typename Mask2T::pixel_type > > & right_mask_pyramid) const;
+
+    /// Block match one zone of a pyramid level and optionally check it
+    /// against the right to left result. Writes only inside the zone.
+    void correlate_zone(SearchParam const& zone, Vector2i const& region_offset, bool check_rl,
+                        ImageView<typename Image1T::pixel_type> const& left,
+                        ImageView<typename Image2T::pixel_type> const& right,
+                        ImageView<pixel_typeI> & disparity) const;
+
+    /// Runs correlate_zone() on a thread pool.
+    class ZoneTask : public Task, private boost::noncopyable {
+      PyramidCorrelationView const& m_view;
+      SearchParam m_zone;
+      Vector2i    m_region_offset;
+      bool        m_check_rl;
+      ImageView<typename Image1T::pixel_type> const& m_left;
+      ImageView<typename Image2T::pixel_type> const& m_right;
+      ImageView<pixel_typeI> & m_disparity;
+    public:
+      ZoneTask(PyramidCorrelationView const& view, SearchParam const& zone,
+               Vector2i const& region_offset, bool check_rl,
+               ImageView<typename Image1T::pixel_type> const& left,
+               ImageView<typename Image2T::pixel_type> const& right,
+               ImageView<pixel_typeI> & disparity)
+        : m_view(view), m_zone(zone), m_region_offset(region_offset), m_check_rl(check_rl),
+          m_left(left), m_right(right), m_disparity(disparity) {}
+      virtual ~ZoneTask() {}
+      virtual void operator()() {
+        m_view.correlate_zone(m_zone, m_region_offset, m_check_rl, m_left, m_right, m_disparity);
+      }
+    };
+
     /// Filter out isolated blobs of valid disparity regions which are usually wrong.
     /// - Using this can decrease run time in images with lots of little disparity islands.
     void disparity_blob_filter(ImageView<pixel_typeI > &disparity, int level,
@@ -22,8 +22,9 @@ prerasterize(BBox2i const& bbox) const {
     left_region.max() += half_kernel;
 
     // 2.) Calculate the region of the right image that we're using.
-    BBox2i right_region = left_region + m_search_region.min();
-    right_region.max() += m_search_region.size();
+    BBox2i search_region = tile_search_region(bbox);
+    BBox2i right_region = left_region + search_region.min();
+    right_region.max() += search_region.size();
 
     // 3.) Calculate the disparity
     ImageView<pixel_type> result
@@ -31,7 +32,7 @@ prerasterize(BBox2i const& bbox) const {
                        crop(m_prefilter.filter(m_left_image),left_region),
                        crop(m_prefilter.filter(m_right_image),right_region),
                        left_region - left_region.min(),
-                       m_search_region.size() + Vector2i(1,1),
+                       search_region.size() + Vector2i(1,1),
                        m_kernel_size);
 
     // 4.0 ) Consistency check
@@ -42,11 +43,11 @@ prerasterize(BBox2i const& bbox) const {
         = calc_disparity(m_cost_type,
                          crop(m_prefilter.filter(m_right_image),right_region),
                          crop(m_prefilter.filter(m_left_image),
-                              left_region - (m_search_region.size()+Vector2i(1,1))),
+                              left_region - (search_region.size()+Vector2i(1,1))),
                          right_region - right_region.min(),
-                         m_search_region.size() + Vector2i(1,1),
+                         search_region.size() + Vector2i(1,1),
                          m_kernel_size) -
-        pixel_type(m_search_region.size()+Vector2i(1,1));
+        pixel_type(search_region.size()+Vector2i(1,1));
 
       stereo::cross_corr_consistency_check( result, disparity_rl,
                                             m_consistency_threshold, false );
@@ -55,7 +56,7 @@ prerasterize(BBox2i const& bbox) const {
                MathErr() << "CorrelationView::prerasterize got a bad return from best_of_search_convolution." );
 
     // 5.) Convert back to original coordinates
-    result += pixel_type(m_search_region.min());
+    result += pixel_type(search_region.min());
 
 #if VW_DEBUG_LEVEL > 0
     watch.stop();
@@ -75,6 +76,7 @@ prerasterize(BBox2i const& bbox) const {
 template <class Image1T, class Image2T, class Mask1T, class Mask2T>
 bool PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::
 build_image_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
+                     BBox2i const& search_region,
                      std::vector<ImageView<typename Image1T::pixel_type> > & left_pyramid,
                      std::vector<ImageView<typename Image2T::pixel_type> > & right_pyramid,
                      std::vector<ImageView<typename Mask1T::pixel_type > > & left_mask_pyramid,
@@ -102,8 +104,8 @@ build_image_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
   left_global_region.expand(region_offset);
   // Region in the right image is the left region plus search range offsets
   // - What is the last upscaling term for?
-  right_global_region = left_global_region + m_search_region.min();
-  right_global_region.max() += m_search_region.size();// + Vector2i(max_upscaling,max_upscaling); 
+  right_global_region = left_global_region + search_region.min();
+  right_global_region.max() += search_region.size();// + Vector2i(max_upscaling,max_upscaling); 
   // Total increase in right size = 2*region_offset + search_region_size + max_upscaling
   
   vw_out(VerboseDebugMessage, "stereo") << "Left pyramid base bbox:  " << left_global_region  << std::endl;
@@ -149,8 +151,8 @@ build_image_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
   // - The larger mask size before is used to compute the mean color values.
   // - Zero edge extension is used here so we don't treat the edge extended pixels as valid.
   //   Currently this mainly affects the SGM algorithm which needs to know not to solve for those pixels.
-  BBox2i right_mask = bbox + m_search_region.min();
-  right_mask.max() += m_search_region.size();
+  BBox2i right_mask = bbox + search_region.min();
+  right_mask.max() += search_region.size();
   left_mask_pyramid [0] = crop(edge_extend(m_left_mask, ZeroEdgeExtension()), bbox );
   right_mask_pyramid[0] = crop(edge_extend(m_right_mask,ZeroEdgeExtension()), right_mask);
 
@@ -175,7 +177,7 @@ build_image_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
     vw_out(DebugMessage, "stereo") << "Right pyramid size = "      << bounding_box(right_pyramid[i]     ) << std::endl;
     vw_out(DebugMessage, "stereo") << "Left  pyramid mask size = " << bounding_box(left_mask_pyramid[i] ) << std::endl;
     vw_out(DebugMessage, "stereo") << "Right pyramid mask size = " << bounding_box(right_mask_pyramid[i]) << std::endl;
-    vw_out(DebugMessage, "stereo") << "Level search size = "       << (m_search_region.size() / (1 << i)) << std::endl;
+    vw_out(DebugMessage, "stereo") << "Level search size = "       << (search_region.size() / (1 << i)) << std::endl;
   }
 
   // Apply the prefilter to each pyramid level
@@ -188,6 +190,209 @@ build_image_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
 }
 
 
+template <class Image1T, class Image2T, class Mask1T, class Mask2T>
+void PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::
+build_shared_pyramids() const {
+
+  SharedPyramids& shared = *m_shared_pyramids;
+  Mutex::Lock lock(shared.mutex);
+  // The pyramids are only marked as built once their state is known, so
+  // that if building them throws the next tile tries again.
+  if (shared.built)
+    return;
+
+  typedef typename Image1T::pixel_type Pixel1T;
+  typedef typename Image2T::pixel_type Pixel2T;
+
+  // The nodata pixels are filled with the mean of the whole image. About
+  // a million samples are enough to estimate it.
+  int32 stride = std::max(2, int32(std::sqrt(double(m_left_image.cols())*m_left_image.rows()/1e6)));
+  Pixel1T left_mean;
+  Pixel2T right_mean;
+  try {
+    left_mean  = mean_pixel_value(subsample(copy_mask(m_left_image,  create_mask(m_left_mask, 0)),stride));
+    right_mean = mean_pixel_value(subsample(copy_mask(m_right_image, create_mask(m_right_mask,0)),stride));
+  } catch ( const ArgumentErr& err ) {
+    shared.built = true; // One of the images is fully masked
+    return;
+  }
+
+  // The left pyramid covers the image plus the kernel margin of the coarsest
+  // level, the right one also covers the search range. Pixels outside the
+  // image are edge extended before smoothing, as build_image_pyramids() does.
+  const int32 levels = m_max_level_by_search;
+  BBox2i left_domain = bounding_box(m_left_image);
+  left_domain.expand((m_kernel_size/2) * (1 << levels));
+  BBox2i right_domain = left_domain + m_search_region.min();
+  right_domain.max() += m_search_region.size() + Vector2i(1,1);
+  shared.origin = left_domain.min();
+
+  const Vector2i block_size(256,256);
+  shared.left.resize          (levels + 1);
+  shared.right.resize         (levels + 1);
+  shared.left_mask.resize     (levels + 1);
+  shared.right_mask.resize    (levels + 1);
+  shared.left_filtered.resize (levels + 1);
+  shared.right_filtered.resize(levels + 1);
+
+  shared.left [0] = block_cache(crop(edge_extend(apply_mask(copy_mask(m_left_image,
+                                                                     create_mask(m_left_mask,0)),
+                                                           left_mean),
+                                                ConstantEdgeExtension()),
+                                    left_domain), block_size, 1);
+  shared.right[0] = block_cache(crop(edge_extend(apply_mask(copy_mask(m_right_image,
+                                                                      create_mask(m_right_mask,0)),
+                                                            right_mean),
+                                                 ConstantEdgeExtension()),
+                                     right_domain), block_size, 1);
+  // The masks are only used inside the tiles and start at the image corner.
+  BBox2i right_mask_domain = bounding_box(m_left_image) + m_search_region.min();
+  right_mask_domain.max() += m_search_region.size() + Vector2i(1,1);
+  shared.left_mask [0] = m_left_mask;
+  shared.right_mask[0] = crop(edge_extend(m_right_mask, ZeroEdgeExtension()), right_mask_domain);
+
+  // Each level reads the cached blocks of the one below it
+  std::vector<typename DefaultKernelT<Pixel1T>::type > kernel = generate_pyramid_smoothing_kernel();
+  for ( int32 i = 1; i <= levels; ++i ) {
+    shared.left [i] = block_cache(subsample(separable_convolution_filter(shared.left [i-1],kernel,kernel),2),
+                                  block_size, 1);
+    shared.right[i] = block_cache(subsample(separable_convolution_filter(shared.right[i-1],kernel,kernel),2),
+                                  block_size, 1);
+    shared.left_mask [i] = block_cache(subsample_mask_by_two(shared.left_mask [i-1]), block_size, 1);
+    shared.right_mask[i] = block_cache(subsample_mask_by_two(shared.right_mask[i-1]), block_size, 1);
+  }
+
+  // The prefilter is applied to each level, but the next level is built
+  // from the unfiltered one.
+  for ( int32 i = 0; i <= levels; ++i ) {
+    if (m_prefilter_mode == PREFILTER_NONE) {
+      shared.left_filtered [i] = shared.left [i];
+      shared.right_filtered[i] = shared.right[i];
+    } else {
+      shared.left_filtered [i] = block_cache(prefilter_view(shared.left [i], m_prefilter_mode, m_prefilter_width),
+                                             block_size, 1);
+      shared.right_filtered[i] = block_cache(prefilter_view(shared.right[i], m_prefilter_mode, m_prefilter_width),
+                                             block_size, 1);
+    }
+  }
+  shared.valid = true;
+  shared.built = true;
+  vw_out(DebugMessage, "stereo") << "Built shared pyramids with " << levels << " levels.\n";
+}
+
+
+template <class Image1T, class Image2T, class Mask1T, class Mask2T>
+bool PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::
+crop_shared_pyramids(BBox2i const& bbox, int32 const max_pyramid_levels,
+                     BBox2i const& search_region,
+                     std::vector<ImageView<typename Image1T::pixel_type> > & left_pyramid,
+                     std::vector<ImageView<typename Image2T::pixel_type> > & right_pyramid,
+                     std::vector<ImageView<typename Mask1T::pixel_type > > & left_mask_pyramid,
+                     std::vector<ImageView<typename Mask2T::pixel_type > > & right_mask_pyramid) const {
+
+  build_shared_pyramids();
+  SharedPyramids const& shared = *m_shared_pyramids;
+  if (!shared.valid)
+    return false;
+
+  left_pyramid.resize      (max_pyramid_levels + 1);
+  right_pyramid.resize     (max_pyramid_levels + 1);
+  left_mask_pyramid.resize (max_pyramid_levels + 1);
+  right_mask_pyramid.resize(max_pyramid_levels + 1);
+
+  // These are the same regions that build_image_pyramids() uses, with the
+  // right ones moved to the grid of the shared right pyramid. The image
+  // regions are relative to the origin of the shared images.
+  // - The start of the tile search region is a multiple of the
+  //   subsampling away from the start of the whole search region.
+  Vector2i half_kernel = m_kernel_size/2;
+  Vector2i search_shift = search_region.min() - m_search_region.min();
+  BBox2i left_region = bbox;
+  left_region.expand(half_kernel * (1 << max_pyramid_levels));
+  left_region -= shared.origin;
+  BBox2i right_region = left_region + search_shift;
+  right_region.max() += search_region.size();
+  BBox2i left_mask_region  = bbox;
+  BBox2i right_mask_region = bbox + search_shift;
+  right_mask_region.max() += search_region.size();
+
+  // The tile corner and the origin are multiples of the subsampling, so
+  // the corners divide exactly. The sizes are rounded up as subsample() does.
+  for ( int32 i = 0; i <= max_pyramid_levels; ++i ) {
+    if (i > 0) {
+      left_region       = half_region(left_region);
+      right_region      = half_region(right_region);
+      left_mask_region  = half_region(left_mask_region);
+      right_mask_region = half_region(right_mask_region);
+    }
+    left_pyramid      [i] = crop(edge_extend(shared.left_filtered [i], ConstantEdgeExtension()), left_region );
+    right_pyramid     [i] = crop(edge_extend(shared.right_filtered[i], ConstantEdgeExtension()), right_region);
+    left_mask_pyramid [i] = crop(edge_extend(shared.left_mask [i], ZeroEdgeExtension()), left_mask_region );
+    right_mask_pyramid[i] = crop(edge_extend(shared.right_mask[i], ZeroEdgeExtension()), right_mask_region);
+
+    if (i == 0 && !(has_nonzero_pixel(left_mask_pyramid[0]) && has_nonzero_pixel(right_mask_pyramid[0])))
+      return false; // Either side of the tile has no valid pixels
+  }
+  return true;
+}
+
+
+template <class Image1T, class Image2T, class Mask1T, class Mask2T>
+void PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::
+correlate_zone(SearchParam const& zone, Vector2i const& region_offset, bool check_rl,
+               ImageView<typename Image1T::pixel_type> const& left,
+               ImageView<typename Image2T::pixel_type> const& right,
+               ImageView<pixel_typeI> & disparity) const {
+
+  // The input zone is in the normal pixel coordinates for this  level.
+  // We need to convert it to a bbox in the expanded base of support image at this level.
+  Vector2i half_kernel = m_kernel_size/2;
+  BBox2i left_region = zone.image_region() + region_offset; // Kernel width offset
+  left_region.expand(half_kernel);
+  BBox2i right_region = left_region + zone.disparity_range().min(); // Make right region contain all of
+  right_region.max() += zone.disparity_range().size();              //  the needed match area.
+  // Setting up the ROIs in this way means that the range of disparities calculated is always >=0
+
+  // Compute left to right disparity vectors in this zone.
+  // - The cropped regions we pass in have padding for the kernel.
+  crop(disparity, zone.image_region())
+    = calc_disparity(m_cost_type,
+                     crop(left,  left_region),
+                     crop(right, right_region),
+                     left_region - left_region.min(), // Specify that the whole cropped region is valid
+                     zone.disparity_range().size(),
+                     m_kernel_size);
+
+  if (check_rl) {
+    // Compute right to left disparity in this zone
+    ImageView<pixel_typeI> disparity_rl
+      = calc_disparity(m_cost_type,
+                       crop(edge_extend(right), right_region),
+                       crop(edge_extend(left),
+                            left_region - zone.disparity_range().size()),
+                       right_region - right_region.min(),
+                       zone.disparity_range().size(), m_kernel_size)
+      - pixel_typeI(zone.disparity_range().size());
+
+    // Find pixels where the disparity distance is greater than m_consistency_threshold
+    const bool verbose = true;
+    stereo::cross_corr_consistency_check(crop(disparity,zone.image_region()),
+                                         disparity_rl,
+                                         m_consistency_threshold, verbose);
+  }
+
+  // Fix the offsets to account for cropping.
+  crop(disparity, zone.image_region()) += pixel_typeI(zone.disparity_range().min());
+}
+
+
+template <class Image1T, class Image2T, class Mask1T, class Mask2T>
+BBox2i PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::
+tile_search_region(BBox2i const& bbox) const {
+  return seeded_search_region(m_search_ranges, m_range_block_size, bbox, m_search_region);
+}
+
+
 /// Filter out small blobs of valid pixels (they are usually bad)
 template <class Image1T, class Image2T, class Mask1T, class Mask2T>
 void PyramidCorrelationView<Image1T, Image2T, Mask1T, Mask2T>::
@@ -245,16 +450,26 @@ prerasterize(BBox2i const& bbox) const {
     //      the maximum based on kernel size and current bbox.
     // - max_pyramid_levels is the number of levels not including the original resolution level.
     // - Each pyramid level is shrunk by the (reduced size) kernel size on that level.
+    // - A tile with its own search range may need fewer levels.
+    BBox2i search_region = tile_search_region(bbox);
     int32 smallest_bbox      = math::min(bbox.size()); // Get smallest/largest of height/width
     int32 largest_kernel     = math::max(m_kernel_size);
     int32 max_pyramid_levels = std::floor(log(smallest_bbox)/log(2.0f) - log(largest_kernel)/log(2.0f));
     if ( m_max_level_by_search < max_pyramid_levels )
       max_pyramid_levels = m_max_level_by_search;
+    if ( levels_for_search(search_region) < max_pyramid_levels )
+      max_pyramid_levels = levels_for_search(search_region);
     if ( max_pyramid_levels < 1 )
       max_pyramid_levels = 0;
     Vector2i half_kernel = m_kernel_size/2;
     int32 max_upscaling = 1 << max_pyramid_levels;
 
+    // Move the start of a tile search range back to a multiple of the
+    // subsampling from the start of the whole range, so that the tile
+    // lines up with every level of the shared pyramids.
+    Vector2i search_shift = search_region.min() - m_search_region.min();
+    search_region.min() -= Vector2i(search_shift.x() % max_upscaling, search_shift.y() % max_upscaling);
+
 
     // 2.0) Build the pyramids
     //      - Highest resolution image is stored at index zero.
@@ -264,8 +479,15 @@ prerasterize(BBox2i const& bbox) const {
     std::vector<ImageView<typename Mask1T::pixel_type > > left_mask_pyramid;
     std::vector<ImageView<typename Mask2T::pixel_type > > right_mask_pyramid;
 
-    if (!build_image_pyramids(bbox, max_pyramid_levels, left_pyramid, right_pyramid, 
-                              left_mask_pyramid, right_mask_pyramid)){
+    // - The shared pyramids can only be used if the tile corner lands on
+    //   a pixel of every level.
+    const bool aligned = (bbox.min().x() % max_upscaling == 0) && (bbox.min().y() % max_upscaling == 0);
+    const bool have_data = (m_use_shared_pyramids && aligned) ?
+      crop_shared_pyramids(bbox, max_pyramid_levels, search_region, left_pyramid, right_pyramid,
+                           left_mask_pyramid, right_mask_pyramid) :
+      build_image_pyramids(bbox, max_pyramid_levels, search_region, left_pyramid, right_pyramid,
+                           left_mask_pyramid, right_mask_pyramid);
+    if (!have_data){
 #if VW_DEBUG_LEVEL > 0
       watch.stop();
       double elapsed = watch.elapsed_seconds();
@@ -281,8 +503,8 @@ prerasterize(BBox2i const& bbox) const {
     std::vector<stereo::SearchParam> zones; 
     // Start off the search at the lowest resolution pyramid level.  This zone covers
     // the entire image and uses the disparity range that was loaded into the class.
-    BBox2i initial_disparity_range = BBox2i(0,0,m_search_region.width ()/max_upscaling+1,
-                                                m_search_region.height()/max_upscaling+1);
+    BBox2i initial_disparity_range = BBox2i(0,0,search_region.width ()/max_upscaling+1,
+                                                search_region.height()/max_upscaling+1);
     zones.push_back( SearchParam(bounding_box(left_mask_pyramid[max_pyramid_levels]),
                                  initial_disparity_range) );
     vw_out(DebugMessage,"stereo") << "initial_disparity_range = " << initial_disparity_range << std::endl;
@@ -335,8 +557,8 @@ prerasterize(BBox2i const& bbox) const {
       if (use_sgm) {
 
         // Mimic processing in normal case with a single zone
-        BBox2i disparity_range = BBox2i(0,0,m_search_region.width()/scaling,
-                                            m_search_region.height()/scaling);
+        BBox2i disparity_range = BBox2i(0,0,search_region.width()/scaling,
+                                            search_region.height()/scaling);
         SearchParam zone(bounding_box(left_mask_pyramid[level]), // Non-padded size
                          disparity_range);
         
@@ -391,8 +613,8 @@ prerasterize(BBox2i const& bbox) const {
 
           check_rl = true;
 
-          // Update m_search_region for this level
-          BBox2i search_region_level = m_search_region;
+          // Update the search region for this level
+          BBox2i search_region_level = search_region;
           search_region_level /= scaling;
           
           // To properly perform the reverse correlation, we need to fix the ROIs
@@ -413,7 +635,7 @@ prerasterize(BBox2i const& bbox) const {
             std::cout << "region_offset = " << region_offset << std::endl;
             std::cout << "right_reverse_region  = " << right_reverse_region << std::endl;
             std::cout << "left_reverse_region   = " << left_reverse_region << std::endl;
-            std::cout << "m_search_region     = " << m_search_region << std::endl;
+            std::cout << "search_region       = " << search_region << std::endl;
             std::cout << "search_region_level = " << search_region_level << std::endl;
             std::cout << "search_region_level.max() = " << search_region_level.max() << std::endl;
             std::cout << "zone.image_region() = " << zone.image_region() << std::endl;
@@ -509,19 +731,30 @@ prerasterize(BBox2i const& bbox) const {
         // - Prioritize the zones which take less time so we don't miss
         //   a bunch of tiles because we spent all our time on a slow one.
         std::sort(zones.begin(), zones.end(), SearchParamLessThan()); // Sort the zones, smallest to largest.
-        BOOST_FOREACH( SearchParam const& zone, zones ) {
 
-          // The input zone is in the normal pixel coordinates for this  level.
-          // We need to convert it to a bbox in the expanded base of support image at this level.
-          BBox2i left_region = zone.image_region() + region_offset; // Kernel width offset
-          left_region.expand(half_kernel);
-          BBox2i right_region = left_region + zone.disparity_range().min(); // Make right region contain all of
-          right_region.max() += zone.disparity_range().size();              //  the needed match area.
-          // Setting up the ROIs in this way means that the range of disparities calculated is always >=0
+        // If at the last level and the user requested a left<->right consistency check,
+        //   compute right to left disparity too.
+        // TODO: Support checks at higher levels like with SGM!
+        check_rl = ( m_consistency_threshold >= 0 && level == 0 );
+
+        // The zones do not overlap, so at the last level they can be searched in parallel.
+        boost::shared_ptr<FifoWorkQueue> queue;
+        if ( on_last_level && m_zone_threads > 1 && zones.size() > 1 )
+          queue.reset( new FifoWorkQueue( m_zone_threads ) );
+
+        BOOST_FOREACH( SearchParam const& zone, zones ) {
 
           // Check timing estimate to see if we should go ahead with this zone or quit.
+          BBox2i left_region = zone.image_region() + region_offset;
+          left_region.expand(half_kernel);
+          BBox2i right_region = left_region + zone.disparity_range().min();
+          right_region.max() += zone.disparity_range().size();
           SearchParam params(left_region, zone.disparity_range());
           double next_elapsed = m_seconds_per_op * params.search_volume();
+          if ( check_rl ) {
+            SearchParam params2(right_region, zone.disparity_range());
+            next_elapsed += m_seconds_per_op * params2.search_volume();
+          }
           if (m_corr_timeout > 0.0 && estim_elapsed + next_elapsed > m_corr_timeout){
             vw_out() << "Tile: " << bbox << " reached timeout: "
                      << m_corr_timeout << " s" << std::endl;
@@ -537,54 +770,18 @@ prerasterize(BBox2i const& bbox) const {
             prev_estim = estim_elapsed;
           }
 
-          // Compute left to right disparity vectors in this zone.
-          // - The cropped regions we pass in have padding for the kernel.
-          crop(disparity, zone.image_region())
-            = calc_disparity(m_cost_type,
-                             crop(left_pyramid [level], left_region), 
-                             crop(right_pyramid[level], right_region),
-                             left_region - left_region.min(), // Specify that the whole cropped region is valid
-                             zone.disparity_range().size(), 
-                             m_kernel_size);
-
-
-          // TODO: Support checks at higher levels like with SGM!
-          // If at the last level and the user requested a left<->right consistency check,
-          //   compute right to left disparity.
-          if ( m_consistency_threshold >= 0 && level == 0 ) {
-            check_rl = true;
-
-            // Check the time again before moving on with this
-            SearchParam params2(right_region, zone.disparity_range());
-            double next_elapsed = m_seconds_per_op * params2.search_volume();
-            if (m_corr_timeout > 0.0 && estim_elapsed + next_elapsed > m_corr_timeout){
-              vw_out() << "Tile: " << bbox << " reached timeout: "
-                       << m_corr_timeout << " s" << std::endl;
-              break;
-            }else{
-              estim_elapsed += next_elapsed;
-            }
-            // Compute right to left disparity in this zone       
-            
-            disparity_rl = calc_disparity(m_cost_type,
-                             crop(edge_extend(right_pyramid[level]), right_region),
-                             crop(edge_extend(left_pyramid [level]),
-                                  left_region - zone.disparity_range().size()),
-                             right_region - right_region.min(),
-                             zone.disparity_range().size(), m_kernel_size)
-            - pixel_typeI(zone.disparity_range().size());
-
-
-            // Find pixels where the disparity distance is greater than m_consistency_threshold
-            const bool verbose = true;
-            stereo::cross_corr_consistency_check(crop(disparity,zone.image_region()),
-                                                  disparity_rl,
-                                                 m_consistency_threshold, verbose);
-          } // End of last level right to left disparity check
-
-          // Fix the offsets to account for cropping.
-          crop(disparity, zone.image_region()) += pixel_typeI(zone.disparity_range().min());
+          if ( queue ) {
+            boost::shared_ptr<Task> task( new ZoneTask( *this, zone, region_offset, check_rl,
+                                                        left_pyramid[level], right_pyramid[level],
+                                                        disparity ) );
+            queue->add_task( task );
+          } else {
+            correlate_zone( zone, region_offset, check_rl,
+                            left_pyramid[level], right_pyramid[level], disparity );
+          }
         } // End of zone loop
+        if ( queue )
+          queue->join_all();
       } // End non-SGM case
 
       // 3.2a) Filter the disparity so we are not processing more than we need to.
@@ -598,33 +795,26 @@ prerasterize(BBox2i const& bbox) const {
       //  to initialize the search range of the following pyramid level.
 
       if (m_filter_half_kernel > 0) { // Skip filtering if zero radius passed in
+        DisparityCleanupParams rm_params(m_filter_half_kernel, m_filter_half_kernel);
+        rm_params.use_thresh                 = true;
+        rm_params.thresh_pixel_threshold     = rm_threshold;
+        rm_params.thresh_rejection_threshold = rm_min_matches_percent;
         if ( !on_last_level ) {
-          disparity = disparity_mask(disparity_cleanup_using_thresh
-                                       (disparity,
-                                        m_filter_half_kernel, m_filter_half_kernel,
-                                        rm_threshold,
-                                        rm_min_matches_percent),
-                                       left_mask_pyramid [level],
-                                       right_mask_pyramid[level]);
+          rm_params.remove_isolated_pixels = true;
+          disparity = disparity_mask(disparity_cleanup(disparity, rm_params),
+                                     left_mask_pyramid [level],
+                                     right_mask_pyramid[level]);
           if (check_rl && use_sgm) {
-            disparity_rl = disparity_mask(disparity_cleanup_using_thresh
-                                           (disparity_rl,
-                                            m_filter_half_kernel, m_filter_half_kernel,
-                                            rm_threshold,
-                                            rm_min_matches_percent),
-                                           right_rl_mask, 
-                                           left_rl_mask);
+            disparity_rl = disparity_mask(disparity_cleanup(disparity_rl, rm_params),
+                                          right_rl_mask, 
+                                          left_rl_mask);
           }
         } else { // On the last level
         
           // We don't do a single hot pixel check on the final level as it leaves a border.
-          disparity = disparity_mask(rm_outliers_using_thresh
-                                       (disparity,
-                                        m_filter_half_kernel, m_filter_half_kernel,
-                                        rm_threshold,
-                                        rm_min_matches_percent),
-                                       left_mask_pyramid [level],
-                                       right_mask_pyramid[level]);
+          disparity = disparity_mask(disparity_cleanup(disparity, rm_params),
+                                     left_mask_pyramid [level],
+                                     right_mask_pyramid[level]);
 
           // No need to filter R-L disparity with SGM on the last level.
         }
@@ -662,8 +852,8 @@ prerasterize(BBox2i const& bbox) const {
                                    right_pyramid[next_level].rows() - left_pyramid[next_level].rows() );
         BBox2i next_zone_size = bounding_box( left_mask_pyramid[level-1] );
         
-        BBox2i default_disparity_range = BBox2i(0,0,m_search_region.width(),
-                                                    m_search_region.height());
+        BBox2i default_disparity_range = BBox2i(0,0,search_region.width(),
+                                                    search_region.height());
         
         BOOST_FOREACH( SearchParam& zone, zones ) {
         
@@ -745,12 +935,12 @@ prerasterize(BBox2i const& bbox) const {
       }
     
       // For SGM, subpixel correlation is performed here, not in stereo_rfne.     
-      return prerasterize_type(subpixel_disparity + result_type(m_search_region.min()),
+      return prerasterize_type(subpixel_disparity + result_type(search_region.min()),
                                -bbox.min().x(), -bbox.min().y(),
                                cols(), rows() );      
     } else {
       // TODO CLEANUP
-      ImageView<pixel_typeI> temp = disparity + pixel_typeI(m_search_region.min());
+      ImageView<pixel_typeI> temp = disparity + pixel_typeI(search_region.min());
       ImageView<result_type> float_type = pixel_cast<result_type, ImageView<pixel_typeI> >(temp);
       return prerasterize_type(float_type,
                                -bbox.min().x(), -bbox.min().y(),
@@ -190,6 +190,7 @@ namespace stereo {
   struct AbsoluteCost {
     typedef typename AbsAccumulatorType<ImageT>::type accumulator_type;
     typedef typename PixelChannelCast<typename ImageT::pixel_type, accumulator_type>::type pixel_accumulator_type;
+    typedef AbsDifferenceFunctor functor_type;
 
     // Does nothing
     template <class ImageT1, class ImageT2>
@@ -208,6 +209,8 @@ namespace stereo {
     // Does nothing
     inline void cost_modification( ImageView<pixel_accumulator_type>& /*cost_metric*/,
                                    Vector2i const& /*disparity*/ ) const {}
+    inline void cost_modification( pixel_accumulator_type* /*cost_row*/, int32 /*row*/,
+                                   int32 /*cols*/, Vector2i const& /*disparity*/ ) const {}
 
     inline bool quality_comparison( accumulator_type cost,
                                     accumulator_type quality ) const {
@@ -219,6 +222,7 @@ namespace stereo {
   struct SquaredCost {
     typedef typename SqrDiffAccumulatorType<ImageT>::type accumulator_type;
     typedef typename PixelChannelCast<typename ImageT::pixel_type, accumulator_type>::type pixel_accumulator_type;
+    typedef SquaredDifferenceFunctor functor_type;
 
     // Does nothing
     template <class ImageT1, class ImageT2>
@@ -237,6 +241,8 @@ namespace stereo {
     // Does nothing
     inline void cost_modification( ImageView<pixel_accumulator_type>& /*cost_metric*/,
                                    Vector2i const& /*disparity*/ ) const {}
+    inline void cost_modification( pixel_accumulator_type* /*cost_row*/, int32 /*row*/,
+                                   int32 /*cols*/, Vector2i const& /*disparity*/ ) const {}
 
     inline bool quality_comparison( accumulator_type cost,
                                     accumulator_type quality ) const {
@@ -249,6 +255,7 @@ namespace stereo {
   struct NCCCost {
     typedef typename SqrDiffAccumulatorType<ImageT>::type accumulator_type;
     typedef typename PixelChannelCast<typename ImageT::pixel_type, accumulator_type>::type pixel_accumulator_type;
+    typedef CrossCorrelationFunctor functor_type;
     ImageView<pixel_accumulator_type> left_precision, right_precision;
 
     template <class ImageT1, class ImageT2>
@@ -275,6 +282,15 @@ namespace stereo {
                                                  bounding_box(left_precision)+disparity) );
     }
 
+    /// The same as above for one row of cost_metric.
+    inline void cost_modification( pixel_accumulator_type* cost_row, int32 row, int32 cols,
+                                   Vector2i const& disparity ) const {
+      const pixel_accumulator_type* left  = &left_precision( 0, row );
+      const pixel_accumulator_type* right = &right_precision( disparity[0], row + disparity[1] );
+      for ( int32 i = 0; i < cols; ++i )
+        cost_row[i] *= sqrt( left[i] * right[i] );
+    }
+
     inline bool quality_comparison( accumulator_type cost,
                                     accumulator_type quality ) const {
       return cost > quality;
@@ -287,6 +303,7 @@ namespace stereo {
   struct NCCCost<ImageT, true> {
     typedef typename SqrDiffAccumulatorType<ImageT>::type accumulator_type;
     typedef typename PixelChannelCast<typename ImageT::pixel_type, accumulator_type>::type pixel_accumulator_type;
+    typedef CrossCorrelationFunctor functor_type;
     ImageView<pixel_accumulator_type> left_variance, right_variance;
 
     template <class ImageT1, class ImageT2>
@@ -314,6 +331,15 @@ namespace stereo {
                                                           bounding_box(left_variance)+disparity) ) / 64 );
     }
 
+    /// The same as above for one row of cost_metric.
+    inline void cost_modification( pixel_accumulator_type* cost_row, int32 row, int32 cols,
+                                   Vector2i const& disparity ) const {
+      const pixel_accumulator_type* left  = &left_variance( 0, row );
+      const pixel_accumulator_type* right = &right_variance( disparity[0], row + disparity[1] );
+      for ( int32 i = 0; i < cols; ++i )
+        cost_row[i] = (64 * cost_row[i]) / ( sqrt( left[i] * right[i] ) / 64 );
+    }
+
     inline bool quality_comparison( accumulator_type cost,
                                     accumulator_type quality ) const {
       return cost > quality;
@@ -34,6 +34,42 @@ namespace stereo {
   }
 
 
+  BBox2i seeded_search_region(ImageView<Vector4i> const& ranges, int32 block_size,
+                              BBox2i const& bbox, BBox2i const& search_region) {
+    if (block_size <= 0 || ranges.cols() == 0 || ranges.rows() == 0)
+      return search_region;
+
+    // Blocks of the range image touched by bbox
+    BBox2i blocks(bbox.min() / block_size,
+                  (bbox.max() - Vector2i(1,1)) / block_size + Vector2i(1,1));
+    blocks.crop(bounding_box(ranges));
+
+    Vector2i range_min(ScalarTypeLimits<int32>::highest(), ScalarTypeLimits<int32>::highest());
+    Vector2i range_max(-range_min);
+    bool found = false;
+    for ( int32 r = blocks.min().y(); r < blocks.max().y(); ++r ) {
+      for ( int32 c = blocks.min().x(); c < blocks.max().x(); ++c ) {
+        Vector4i const& range = ranges(c,r);
+        if ( range[0] > range[2] || range[1] > range[3] )
+          continue; // No seed for this block
+        range_min = Vector2i(std::min(range_min.x(), range[0]), std::min(range_min.y(), range[1]));
+        range_max = Vector2i(std::max(range_max.x(), range[2]), std::max(range_max.y(), range[3]));
+        found = true;
+      }
+    }
+    if (!found)
+      return search_region;
+
+    BBox2i seeded(range_min, range_max);
+    seeded.crop(search_region);
+    if (seeded.min().x() > seeded.max().x() ||
+        seeded.min().y() > seeded.max().y())
+      return search_region; // The seed is outside of the search region
+    vw_out(VerboseDebugMessage, "stereo") << "Tile " << bbox << " search region: " << seeded << std::endl;
+    return seeded;
+  }
+
+
   // Compute the plane that best fits a set of 3D points.
   // - The plane is described as z = ax + by + c
   //( the output vector contains [a, b, c]
@@ -117,4 +153,130 @@ namespace stereo {
     return true;
   }
   
+  // The sums kept for each input column, in addition to those weighted by the column.
+  namespace {
+    enum { SUM_N, SUM_Y, SUM_YY, SUM_Z, SUM_ZZ=SUM_Z+2, SUM_YZ=SUM_ZZ+2,
+           SUM_XN=SUM_YZ+2, SUM_XXN, SUM_XY, SUM_XZ, NUM_WINDOW_SUMS=SUM_XZ+2 };
+  }
+
+  DisparityWindowSums::DisparityWindowSums(ImageView<uint8> const& valid,
+                                           ImageView<Vector2> const& disparity,
+                                           int32 half_h_kernel, int32 half_v_kernel) :
+    m_valid(valid), m_disparity(disparity),
+    m_half_h_kernel(half_h_kernel), m_half_v_kernel(half_v_kernel),
+    m_prefix_sums((valid.cols()+1)*NUM_WINDOW_SUMS, 0.0) {}
+
+  void DisparityWindowSums::set_row(int32 row) {
+    const int32 center_row = row + m_half_v_kernel;
+    double column[NUM_WINDOW_SUMS];
+    for (int32 col=0; col<m_valid.cols(); ++col) {
+      // Sum this column over the window height
+      for (int i=0; i<SUM_XN; ++i)
+        column[i] = 0;
+      for (int32 r=row; r<=row+2*m_half_v_kernel; ++r) {
+        if (!m_valid(col, r))
+          continue;
+        const double   y = r - center_row;
+        Vector2 const& z = m_disparity(col, r);
+        column[SUM_N ] += 1;
+        column[SUM_Y ] += y;
+        column[SUM_YY] += y*y;
+        for (int k=0; k<2; ++k) {
+          column[SUM_Z +k] += z[k];
+          column[SUM_ZZ+k] += z[k]*z[k];
+          column[SUM_YZ+k] += y*z[k];
+        }
+      }
+      // The sums needing x are taken relative to the tile and shifted in get_moments().
+      const double x = col;
+      column[SUM_XN ] = x*column[SUM_N];
+      column[SUM_XXN] = x*x*column[SUM_N];
+      column[SUM_XY ] = x*column[SUM_Y];
+      for (int k=0; k<2; ++k)
+        column[SUM_XZ+k] = x*column[SUM_Z+k];
+
+      double const* prev = &m_prefix_sums[col*NUM_WINDOW_SUMS];
+      double      * next = &m_prefix_sums[(col+1)*NUM_WINDOW_SUMS];
+      for (int i=0; i<NUM_WINDOW_SUMS; ++i)
+        next[i] = prev[i] + column[i];
+    }
+  }
+
+  void DisparityWindowSums::get_moments(int32 col, DisparityWindowMoments &moments) const {
+    double s[NUM_WINDOW_SUMS];
+    double const* first = &m_prefix_sums[col*NUM_WINDOW_SUMS];
+    double const* last  = &m_prefix_sums[(col+2*m_half_h_kernel+1)*NUM_WINDOW_SUMS];
+    for (int i=0; i<NUM_WINDOW_SUMS; ++i)
+      s[i] = last[i] - first[i];
+
+    const double cx = col + m_half_h_kernel;
+    moments.n   = s[SUM_N];
+    moments.sx  = s[SUM_XN] - cx*s[SUM_N];
+    moments.sy  = s[SUM_Y];
+    moments.sxx = s[SUM_XXN] - 2*cx*s[SUM_XN] + cx*cx*s[SUM_N];
+    moments.sxy = s[SUM_XY] - cx*s[SUM_Y];
+    moments.syy = s[SUM_YY];
+    for (int k=0; k<2; ++k) {
+      moments.sz [k] = s[SUM_Z +k];
+      moments.szz[k] = s[SUM_ZZ+k];
+      moments.syz[k] = s[SUM_YZ+k];
+      moments.sxz[k] = s[SUM_XZ+k] - cx*s[SUM_Z+k];
+    }
+  }
+
+  bool passes_stddev_check(DisparityWindowMoments const& moments, Vector2 const& disparity,
+                           double pixel_threshold, double rejection_threshold) {
+    if (moments.n == 0) // Reject pixel if there are no valid neighbors
+      return false;
+    for (int k=0; k<2; ++k) {
+      // Compute standard deviation but enforce minimum value
+      double mean     = moments.sz[k] / moments.n;
+      double variance = moments.szz[k] / moments.n - mean*mean;
+      double std_dev  = sqrt(std::max(variance, 0.0));
+      if (std_dev < rejection_threshold)
+        std_dev = rejection_threshold;
+      if (fabs(disparity[k] - mean) > pixel_threshold*std_dev)
+        return false;
+    }
+    return true;
+  }
+
+  bool passes_plane_check(DisparityWindowMoments const& moments, Vector2 const& disparity,
+                          double pixel_threshold, double rejection_threshold) {
+    if (moments.n == 0) // Reject pixel if there are no valid neighbors
+      return false;
+
+    // Same system as fitPlaneToPoints()
+    Matrix3x3 matA(moments.sxx, moments.sxy, moments.sx,
+                   moments.sxy, moments.syy, moments.sy,
+                   moments.sx,  moments.sy,  moments.n);
+    Vector3 planes[2];
+    try {
+      for (int k=0; k<2; ++k)
+        planes[k] = vw::math::solve(matA, Vector3(moments.sxz[k], moments.syz[k], moments.sz[k]));
+    }
+    catch(...) { // Failed to solve, probably because points were in a line
+      return true;
+    }
+
+    for (int k=0; k<2; ++k) {
+      const double a = planes[k][0], b = planes[k][1], c = planes[k][2];
+      const double norm = sqrt(a*a + b*b + 1.0);
+
+      // Root mean square distance to the plane, as in checkPointToPlaneFit()
+      double sum_sq = moments.szz[k] - 2*(a*moments.sxz[k] + b*moments.syz[k] + c*moments.sz[k])
+                      + a*a*moments.sxx + b*b*moments.syy + c*c*moments.n
+                      + 2*(a*b*moments.sxy + a*c*moments.sx + b*c*moments.sy);
+      double std_dev = sqrt(std::max(sum_sq, 0.0) / moments.n) / norm;
+      if (std_dev < rejection_threshold)
+        std_dev = rejection_threshold;
+
+      // Distance of the test pixel from the plane
+      double error = fabs(c - disparity[k]) / norm;
+      if (error > pixel_threshold*std_dev)
+        return false;
+    }
+    return true;
+  }
+
 }}    // namespace vw::stereo
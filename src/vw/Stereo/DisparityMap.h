@@ -60,6 +60,77 @@ namespace stereo {
                   accumulator.maximum());
   }
 
+  //  disparity_search_ranges()
+  //
+  /// Turn a low resolution disparity map into an image of search
+  /// ranges for correlating at full resolution. Each output pixel covers
+  /// block_size x block_size full resolution pixels and holds the range
+  /// (min_x, min_y, max_x, max_y) of the valid seed disparities over that
+  /// block. The range is scaled by seed_scale and then expanded by
+  /// seed_scale, to cover the rounding of the seed, plus margin. Blocks
+  /// without a valid seed disparity get an empty range (min > max).
+  template <class ViewT>
+  ImageView<Vector4i>
+  disparity_search_ranges(ImageViewBase<ViewT> const& seed_disparity,
+                          int32 seed_scale, int32 block_size,
+                          Vector2i const& margin = Vector2i(2,2)) {
+    VW_ASSERT( seed_scale > 0 && block_size > 0,
+               ArgumentErr() << "disparity_search_ranges: scale and block size must be positive." );
+    ImageView<typename ViewT::pixel_type> seed = seed_disparity.impl();
+    const int32 cols = (seed.cols()*seed_scale + block_size - 1) / block_size;
+    const int32 rows = (seed.rows()*seed_scale + block_size - 1) / block_size;
+
+    const int32 big = ScalarTypeLimits<int32>::highest();
+    ImageView<Vector4i> ranges(cols, rows);
+    fill(ranges, Vector4i(big, big, -big, -big));
+
+    for ( int32 j = 0; j < seed.rows(); ++j ) {
+      // A seed pixel can straddle two blocks when the block size is not
+      // a multiple of the scale.
+      const int32 row_begin = (j*seed_scale) / block_size;
+      const int32 row_end   = ((j+1)*seed_scale - 1) / block_size;
+      for ( int32 i = 0; i < seed.cols(); ++i ) {
+        if ( !is_valid(seed(i,j)) )
+          continue;
+        const int32 dx = int32(std::floor(double(remove_mask(seed(i,j))[0])*seed_scale));
+        const int32 dy = int32(std::floor(double(remove_mask(seed(i,j))[1])*seed_scale));
+        const int32 col_begin = (i*seed_scale) / block_size;
+        const int32 col_end   = ((i+1)*seed_scale - 1) / block_size;
+        for ( int32 r = row_begin; r <= row_end; ++r )
+          for ( int32 c = col_begin; c <= col_end; ++c ) {
+            Vector4i& range = ranges(c,r);
+            range[0] = std::min(range[0], dx);
+            range[1] = std::min(range[1], dy);
+            range[2] = std::max(range[2], dx);
+            range[3] = std::max(range[3], dy);
+          }
+      }
+    }
+
+    const Vector2i pad = margin + Vector2i(seed_scale, seed_scale);
+    for ( int32 r = 0; r < rows; ++r )
+      for ( int32 c = 0; c < cols; ++c ) {
+        Vector4i& range = ranges(c,r);
+        if ( range[0] > range[2] )
+          continue;
+        range[0] -= pad[0];
+        range[1] -= pad[1];
+        range[2] += pad[0];
+        range[3] += pad[1];
+      }
+    return ranges;
+  }
+
+  //  seeded_search_region()
+  //
+  /// Search region for the left image region bbox from the ranges made
+  /// by disparity_search_ranges(): the union of the non-empty ranges of
+  /// the blocks that bbox covers, clipped to search_region. Returns
+  /// search_region when there are no ranges, no seed covers bbox, or the
+  /// seed lies entirely outside of search_region.
+  BBox2i seeded_search_region(ImageView<Vector4i> const& ranges, int32 block_size,
+                              BBox2i const& bbox, BBox2i const& search_region);
+
   //  missing_pixel_image()
   //
   /// Produce a colorized image depicting which pixels in the disparity
@@ -941,6 +1012,236 @@ namespace stereo {
                       func_type_thresh( 1, 1, 3.0, 0.2 ) );
   }
 
+  // Method 5: Evaluate several of the above criteria in one pass over each tile.
+
+  /// Settings for disparity_cleanup().
+  /// - Each enabled criterion is the same test as the matching rm_outliers_using_*()
+  ///   function, they all share the kernel size.
+  /// - All criteria are evaluated on the input disparities, a pixel is rejected
+  ///   if any one of them rejects it.
+  struct DisparityCleanupParams {
+    int32  half_h_kernel, half_v_kernel;
+    bool   use_thresh; ///< See rm_outliers_using_thresh()
+    double thresh_pixel_threshold, thresh_rejection_threshold;
+    bool   use_stddev; ///< See rm_outliers_using_stddev()
+    double stddev_pixel_threshold, stddev_rejection_threshold;
+    bool   use_plane;  ///< See rm_outliers_using_plane()
+    double plane_pixel_threshold,  plane_rejection_threshold;
+    /// Follow up with the isolated pixel check of the disparity_cleanup_using_*() functions.
+    bool   remove_isolated_pixels;
+
+    DisparityCleanupParams(int32 half_h_kernel_in=1, int32 half_v_kernel_in=1) :
+      half_h_kernel(half_h_kernel_in), half_v_kernel(half_v_kernel_in),
+      use_thresh(false), thresh_pixel_threshold(0), thresh_rejection_threshold(0),
+      use_stddev(false), stddev_pixel_threshold(0), stddev_rejection_threshold(0),
+      use_plane (false), plane_pixel_threshold (0), plane_rejection_threshold (0),
+      remove_isolated_pixels(false) {}
+  };
+
+  /// Sums over a window of the valid disparities, see DisparityWindowSums.
+  /// - Window coordinates are relative to the window center, z is the disparity.
+  struct DisparityWindowMoments {
+    double  n, sx, sy, sxx, sxy, syy;
+    Vector2 sz, sxz, syz, szz;
+  };
+
+  /// Computes the moments of every window in one row of a tile at a time.
+  /// - Column sums are taken over the window height and turned into prefix
+  ///   sums along the row, so each window costs one subtraction per moment.
+  /// - The input covers the output plus the half kernel on each side.
+  class DisparityWindowSums {
+  public:
+    DisparityWindowSums(ImageView<uint8> const& valid, ImageView<Vector2> const& disparity,
+                        int32 half_h_kernel, int32 half_v_kernel);
+
+    /// Compute the sums of the windows centered on this output row.
+    void set_row(int32 row);
+
+    /// Moments of the window centered on this output column of the current row.
+    void get_moments(int32 col, DisparityWindowMoments &moments) const;
+
+  private:
+    ImageView<uint8  > const& m_valid;
+    ImageView<Vector2> const& m_disparity;
+    int32 m_half_h_kernel, m_half_v_kernel;
+    std::vector<double> m_prefix_sums; ///< One set of sums per input column plus one
+  };
+
+  /// The rm_outliers_using_stddev() test computed from the window moments.
+  bool passes_stddev_check(DisparityWindowMoments const& moments, Vector2 const& disparity,
+                           double pixel_threshold, double rejection_threshold);
+
+  /// The rm_outliers_using_plane() test computed from the window moments.
+  bool passes_plane_check(DisparityWindowMoments const& moments, Vector2 const& disparity,
+                          double pixel_threshold, double rejection_threshold);
+
+  /// Applies the criteria in DisparityCleanupParams to a disparity image.
+  /// - Each tile reads the input with its halo once, the window statistics
+  ///   are computed with sliding sums instead of per pixel.
+  /// - Tiles are independent so block rasterization runs them in parallel.
+  template <class ViewT>
+  class DisparityCleanupView : public ImageViewBase<DisparityCleanupView<ViewT> > {
+    ViewT                  m_child;
+    DisparityCleanupParams m_params;
+
+  public:
+    typedef typename ViewT::pixel_type pixel_type;
+    typedef pixel_type                 result_type;
+    typedef ProceduralPixelAccessor<DisparityCleanupView> pixel_accessor;
+
+    DisparityCleanupView(ViewT const& child, DisparityCleanupParams const& params) :
+      m_child(child), m_params(params) {
+      VW_ASSERT(params.half_h_kernel > 0 && params.half_v_kernel > 0,
+                ArgumentErr() << "DisparityCleanupView: half kernel sizes must be non-zero.");
+    }
+
+    inline int32 cols  () const { return m_child.cols(); }
+    inline int32 rows  () const { return m_child.rows(); }
+    inline int32 planes() const { return 1; }
+
+    inline pixel_accessor origin() const { return pixel_accessor(*this, 0, 0); }
+    inline result_type operator()(int32 i, int32 j, int32 p=0) const {
+      return prerasterize(BBox2i(i,j,1,1))(i,j,p);
+    }
+
+    typedef CropView<ImageView<pixel_type> > prerasterize_type;
+    inline prerasterize_type prerasterize(BBox2i const& bbox) const {
+      const int32 margin = m_params.remove_isolated_pixels ? 1 : 0;
+
+      // The criteria are evaluated around bbox plus the margin of the isolated
+      //  pixel check, which reads the input out to the half kernel size.
+      BBox2i stage_box = bbox;
+      stage_box.expand(margin);
+      BBox2i input_box = stage_box;
+      input_box.min() -= Vector2i(m_params.half_h_kernel, m_params.half_v_kernel);
+      input_box.max() += Vector2i(m_params.half_h_kernel, m_params.half_v_kernel);
+      ImageView<pixel_type> input = crop(edge_extend(m_child, ConstantEdgeExtension()), input_box);
+
+      ImageView<pixel_type> stage(stage_box.width(), stage_box.height());
+      apply_criteria(input, stage);
+      if (margin == 0)
+        return crop(stage, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+
+      // At least one neighbor must be within 3 pixels
+      const int32 isolated_min_matches = min_thresh_matches(1, 1, 0.2);
+      ImageView<pixel_type> output(bbox.width(), bbox.height());
+      for (int32 row=0; row<output.rows(); ++row) {
+        for (int32 col=0; col<output.cols(); ++col) {
+          output(col,row) = stage(col+1, row+1);
+          if (is_valid(output(col,row)) &&
+              !passes_thresh_check(stage, col+1, row+1, 1, 1, 3.0, isolated_min_matches))
+            output(col,row) = pixel_type();
+        }
+      }
+      return crop(output, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+    }
+
+    template <class DestT> inline void rasterize(DestT const& dest, BBox2i const& bbox) const {
+      vw::rasterize(prerasterize(bbox), dest, bbox);
+    }
+
+  private:
+
+    /// The smallest number of matches that passes the rm_outliers_using_thresh() test.
+    static int32 min_thresh_matches(int32 half_h_kernel, int32 half_v_kernel,
+                                    double rejection_threshold) {
+      const int32 total = (2*half_h_kernel+1)*(2*half_v_kernel+1);
+      int32 matched = 0;
+      while ((matched <= total) && ((double)matched/(double)total < rejection_threshold))
+        ++matched;
+      return matched;
+    }
+
+    /// The rm_outliers_using_thresh() test on a valid pixel.
+    /// - Stops counting as soon as the result is known.
+    static bool passes_thresh_check(ImageView<pixel_type> const& image, int32 col, int32 row,
+                                    int32 half_h_kernel, int32 half_v_kernel,
+                                    double pixel_threshold, int32 min_matches) {
+      pixel_type const& center = image(col, row);
+      const int32 width = 2*half_h_kernel+1;
+      int32 matched   = 0;
+      int32 remaining = width*(2*half_v_kernel+1);
+      for (int32 r=row-half_v_kernel; r<=row+half_v_kernel; ++r) {
+        pixel_type const* other = &image(col-half_h_kernel, r);
+        for (int32 i=0; i<width; ++i) {
+          if (is_valid(other[i]) &&
+              fabs(center[0]-other[i][0]) <= pixel_threshold &&
+              fabs(center[1]-other[i][1]) <= pixel_threshold)
+            matched++;
+        }
+        remaining -= width;
+        if (matched >= min_matches)
+          return true;
+        if (matched + remaining < min_matches)
+          return false;
+      }
+      return matched >= min_matches;
+    }
+
+    /// Evaluate the enabled criteria at every output pixel.
+    void apply_criteria(ImageView<pixel_type> const& input, ImageView<pixel_type> & output) const {
+      const int32 half_h = m_params.half_h_kernel;
+      const int32 half_v = m_params.half_v_kernel;
+
+      // Only the standard deviation and the plane checks need the window sums.
+      const bool use_sums = m_params.use_stddev || m_params.use_plane;
+      ImageView<uint8  > valid;
+      ImageView<Vector2> values;
+      if (use_sums) {
+        valid .set_size(input.cols(), input.rows());
+        values.set_size(input.cols(), input.rows());
+        for (int32 row=0; row<input.rows(); ++row) {
+          for (int32 col=0; col<input.cols(); ++col) {
+            valid (col,row) = is_valid(input(col,row));
+            values(col,row) = Vector2(input(col,row)[0], input(col,row)[1]);
+          }
+        }
+      }
+      DisparityWindowSums sums(valid, values, half_h, half_v);
+      DisparityWindowMoments moments;
+      const int32 thresh_min_matches = min_thresh_matches(half_h, half_v,
+                                                          m_params.thresh_rejection_threshold);
+
+      for (int32 row=0; row<output.rows(); ++row) {
+        if (use_sums)
+          sums.set_row(row);
+        for (int32 col=0; col<output.cols(); ++col) {
+          pixel_type const& center = input(col+half_h, row+half_v);
+          output(col,row) = center;
+          if (!is_valid(center))
+            continue;
+
+          bool keep = true;
+          if (m_params.use_thresh)
+            keep = passes_thresh_check(input, col+half_h, row+half_v, half_h, half_v,
+                                       m_params.thresh_pixel_threshold, thresh_min_matches);
+          if (keep && use_sums) {
+            sums.get_moments(col, moments);
+            Vector2 disparity(center[0], center[1]);
+            if (keep && m_params.use_stddev)
+              keep = passes_stddev_check(moments, disparity, m_params.stddev_pixel_threshold,
+                                         m_params.stddev_rejection_threshold);
+            if (keep && m_params.use_plane)
+              keep = passes_plane_check(moments, disparity, m_params.plane_pixel_threshold,
+                                        m_params.plane_rejection_threshold);
+          }
+          if (!keep)
+            output(col,row) = pixel_type(); // Invalid pixel
+        }
+      }
+    }
+  }; // End class DisparityCleanupView
+
+  /// Apply several outlier criteria to a disparity image in one pass, see DisparityCleanupParams.
+  /// - With use_thresh and remove_isolated_pixels set this gives the same result as
+  ///   disparity_cleanup_using_thresh(), and likewise for the other criteria.
+  template <class ViewT>
+  DisparityCleanupView<ViewT>
+  disparity_cleanup(ImageViewBase<ViewT> const& disparity_map,
+                    DisparityCleanupParams const& params) {
+    return DisparityCleanupView<ViewT>(disparity_map.impl(), params);
+  }
+
   //  std_dev_image()
   //
   /// Remove pixels from the disparity map that correspond to low
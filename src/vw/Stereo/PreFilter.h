@@ -20,6 +20,7 @@
 #define __VW_STEREO_PREFILTER_H__
 
 #include <vw/Image/Filter.h>
+#include <vw/Image/ImageViewRef.h>
 
 namespace vw {
 namespace stereo {
@@ -91,6 +92,20 @@ prefilter_image(ImageViewBase<ImageT> const& image,
   return prefilter.filter(image);
 }
 
+/// Apply the selected prefilter without rasterizing, for images that
+/// are too large to hold in memory. The filter is evaluated on demand.
+template <class ImageT>
+ImageViewRef<typename ImageT::pixel_type>
+prefilter_view(ImageViewBase<ImageT> const& image,
+               PrefilterModeType prefilter_mode,
+               float             prefilter_width) {
+
+  if (prefilter_mode == PREFILTER_LOG)
+    return stereo::LaplacianOfGaussian(prefilter_width).filter(image);
+  if (prefilter_mode == PREFILTER_MEANSUB)
+    return stereo::SubtractedMean(prefilter_width).filter(image);
+  return stereo::NullOperation().filter(image);
+}
 
 }} // end namespace vw::stereo
 
@@ -9,9 +9,14 @@
 #include <vw/Image/PixelMask.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
 
-#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
-  #include <emmintrin.h>
-  #include <smmintrin.h> // SSE4.1
+// The vector versions of the path accumulation are compiled for their own
+// instruction sets and selected when the matcher is set up, so they do not
+// depend on the compiler flags.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 6))
+  #define VW_SGM_SIMD_DISPATCH 1
+  #include <immintrin.h>
+#else
+  #define VW_SGM_SIMD_DISPATCH 0
 #endif
 
 namespace vw {
@@ -43,6 +48,8 @@ void SemiGlobalMatcher::set_parameters(CostFunctionType cost_type,
   m_subpixel_type   = subpixel;
   m_search_buffer   = search_buffer;
   m_memory_limit_mb = memory_limit_mb;
+  m_low_memory_mode = false;
+  m_use_low_memory  = false;
 
   m_num_disp_x = m_max_disp_x - m_min_disp_x + 1;
   m_num_disp_y = m_max_disp_y - m_min_disp_y + 1;
@@ -51,6 +58,10 @@ void SemiGlobalMatcher::set_parameters(CostFunctionType cost_type,
     vw_throw( NoImplErr() << "Number of disparities is too large for data type!\n" );
   m_num_disp   = m_num_disp_x * m_num_disp_y;
 
+  m_prior_grid_width = m_num_disp_x + 2;
+  m_prior_grid_size  = m_prior_grid_width * (m_num_disp_y + 2);
+  set_simd_level(max_simd_level());
+
   if (p1 > 0) // User provided
     m_p1 = p1; 
   else { // Choose based on the kernel size and cost type
@@ -599,6 +610,16 @@ size_t SemiGlobalMatcher::compute_buffer_length() {
                                  << small_buffer_size_bytes/BYTES_PER_MB << " MB\n";
 
   size_t total_num_bytes = main_buffer_bytes + small_buffer_size_bytes;
+
+  // Fall back to the low memory accumulation if the full buffers do not fit.
+  m_use_low_memory = false;
+  if (!m_use_mgm && (m_low_memory_mode || (total_num_bytes/BYTES_PER_MB > m_memory_limit_mb))) {
+    m_use_low_memory = true;
+    total_num_bytes  = get_low_memory_usage_bytes();
+    vw_out(DebugMessage, "stereo") << "SGM: Using low memory accumulation, estimated size: " 
+                                   << total_num_bytes/BYTES_PER_MB << " MB\n";
+  }
+
   if (total_num_bytes/BYTES_PER_MB > m_memory_limit_mb) {
     vw_throw( ArgumentErr() << "SGM: Required memory usage is "<< total_num_bytes 
                             << " MB which is greater than the cap of "<< m_memory_limit_mb <<" MB!\n" );
@@ -608,12 +629,38 @@ size_t SemiGlobalMatcher::compute_buffer_length() {
   return total_offset;
 }
 
+size_t SemiGlobalMatcher::get_low_memory_usage_bytes() const {
+
+  size_t max_row_length = 0;
+  for (int r=0; r<m_num_output_rows; ++r)
+    max_row_length = std::max(max_row_length, get_row_buffer_length(r));
+
+  const size_t block_rows   = get_low_memory_block_rows();
+  const size_t num_blocks   = (m_num_output_rows + block_rows - 1) / block_rows;
+  const size_t num_pixels   = m_num_output_rows * m_num_output_cols;
+  const size_t accum_size   = sizeof(AccumCostType);
+
+  // The stored downward paths, one block of costs and sums, the row path buffers,
+  //  the census images and the output disparities and subpixel neighbors.
+  return num_blocks*3*max_row_length*accum_size
+         + block_rows*max_row_length*(sizeof(CostType) + accum_size)
+         + 4*4*max_row_length*accum_size
+         + num_pixels*(2*sizeof(uint64) + sizeof(PixelMask<Vector2i>) + 9*accum_size);
+}
+
 void SemiGlobalMatcher::allocate_large_buffers() {
 
   //Timer timer_total("Memory allocation");
 
   const size_t BYTES_PER_MB = 1024*1024;  
   const size_t total_offset           = compute_buffer_length();
+  if (m_use_low_memory) {
+    // Only small buffers are used, release any left from a previous call.
+    m_cost_buffer.reset();
+    m_accum_buffer.reset();
+    return;
+  }
+  m_subpixel_neighbors.reset();
   const size_t cost_buffer_num_bytes  = total_offset * sizeof(CostType);  
   const size_t accum_buffer_num_bytes = total_offset * sizeof(AccumCostType);
 
@@ -630,57 +677,136 @@ void SemiGlobalMatcher::allocate_large_buffers() {
 
 
 
-void SemiGlobalMatcher::populate_adjacent_disp_lookup_table() {
+//=========================================================================
+// Path accumulation kernels
+
+namespace {
+
+typedef SemiGlobalMatcher::AccumCostType AccumCostType;
+
+/// Operation = min( min(eight adjacent)+p1, same, jump ) - min_prior
+/// - The prior grid has a border, so the adjacent disparities of the
+///   entries we visit are always inside it.
+void path_costs_scalar(AccumCostType const* prior, int w, int count,
+                       AccumCostType jump, AccumCostType min_prior,
+                       AccumCostType p1, AccumCostType* result) {
+  for (int i=0; i<count; ++i) {
+    AccumCostType const* p = prior + i;
+    AccumCostType min_adj = std::min(std::min(std::min(p[-w  ], p[-1   ]), std::min(p[1    ], p[w  ])),
+                                     std::min(std::min(p[-w-1], p[-w+1 ]), std::min(p[w-1  ], p[w+1])));
+    AccumCostType lowest = std::min(AccumCostType(min_adj + p1), p[0]);
+    lowest = std::min(lowest, jump);
+    result[i] = lowest - min_prior;
+  }
+}
 
-  const int TABLE_WIDTH = 8;
-  m_adjacent_disp_lookup.resize(m_num_disp*TABLE_WIDTH);
+#if VW_SGM_SIMD_DISPATCH
+
+// The three vector versions are the same code on different register widths.
+
+__attribute__((target("sse4.1")))
+void path_costs_sse41(AccumCostType const* prior, int w, int count,
+                      AccumCostType jump, AccumCostType min_prior,
+                      AccumCostType p1, AccumCostType* result) {
+  const __m128i _jump = _mm_set1_epi16(static_cast<int16>(jump     ));
+  const __m128i _minp = _mm_set1_epi16(static_cast<int16>(min_prior));
+  const __m128i _p1   = _mm_set1_epi16(static_cast<int16>(p1       ));
+  const int N = 8;
+  int i = 0;
+  for (; i+N <= count; i += N) {
+    AccumCostType const* p = prior + i;
+    #define LOAD(offset) _mm_loadu_si128((__m128i const*)(p + (offset)))
+    __m128i _adj = _mm_min_epu16(_mm_min_epu16(LOAD(-w  ), LOAD(-1  )), _mm_min_epu16(LOAD(1  ), LOAD(w  )));
+    __m128i _dia = _mm_min_epu16(_mm_min_epu16(LOAD(-w-1), LOAD(-w+1)), _mm_min_epu16(LOAD(w-1), LOAD(w+1)));
+    __m128i _res = _mm_adds_epu16(_mm_min_epu16(_adj, _dia), _p1);
+    _res = _mm_min_epu16(_res, _mm_min_epu16(LOAD(0), _jump));
+    #undef LOAD
+    _mm_storeu_si128((__m128i*)(result + i), _mm_subs_epu16(_res, _minp));
+  }
+  path_costs_scalar(prior+i, w, count-i, jump, min_prior, p1, result+i);
+}
 
-  // Loop through the disparities
-  int d = 0;
-  for (int dy=m_min_disp_y; dy<=m_max_disp_y; ++dy) {
-    // Figure out above and below disparities with bounds checking
-    int y_less = dy - 1;
-    int y_more = dy + 1;
-    if (y_less < m_min_disp_y) y_less = dy;
-    if (y_more > m_max_disp_y) y_more = dy;
-
-    int y_less_o = y_less - m_min_disp_y; // Offset from min y disparity
-    int y_o      = dy     - m_min_disp_y;
-    int y_more_o = y_more - m_min_disp_y;
-
-    for (int dx=m_min_disp_x; dx<=m_max_disp_x; ++dx) {
-
-      // Figure out left and right disparities with bounds checking
-      int x_less = dx - 1;
-      int x_more = dx + 1;
-      if (x_less < m_min_disp_x) x_less = dx;
-      if (x_more > m_max_disp_x) x_more = dx;
-
-      int x_less_o = x_less - m_min_disp_x; // Offset from min x disparity
-      int x_o      = dx     - m_min_disp_x;
-      int x_more_o = x_more - m_min_disp_x;
-
-      // Record the disparity indices of each of the adjacent pixels
-      int table_pos = d*TABLE_WIDTH;
-      m_adjacent_disp_lookup[table_pos+0] = y_less_o*m_num_disp_x + x_o;      // The four adjacent pixels
-      m_adjacent_disp_lookup[table_pos+1] = y_o     *m_num_disp_x + x_less_o;
-      m_adjacent_disp_lookup[table_pos+2] = y_o     *m_num_disp_x + x_more_o;
-      m_adjacent_disp_lookup[table_pos+3] = y_more_o*m_num_disp_x + x_o;
-      m_adjacent_disp_lookup[table_pos+4] = y_less_o*m_num_disp_x + x_less_o; // The four diagonal pixels
-      m_adjacent_disp_lookup[table_pos+5] = y_less_o*m_num_disp_x + x_more_o;
-      m_adjacent_disp_lookup[table_pos+6] = y_more_o*m_num_disp_x + x_less_o;
-      m_adjacent_disp_lookup[table_pos+7] = y_more_o*m_num_disp_x + x_more_o;
+__attribute__((target("avx2")))
+void path_costs_avx2(AccumCostType const* prior, int w, int count,
+                     AccumCostType jump, AccumCostType min_prior,
+                     AccumCostType p1, AccumCostType* result) {
+  const __m256i _jump = _mm256_set1_epi16(static_cast<int16>(jump     ));
+  const __m256i _minp = _mm256_set1_epi16(static_cast<int16>(min_prior));
+  const __m256i _p1   = _mm256_set1_epi16(static_cast<int16>(p1       ));
+  const int N = 16;
+  int i = 0;
+  for (; i+N <= count; i += N) {
+    AccumCostType const* p = prior + i;
+    #define LOAD(offset) _mm256_loadu_si256((__m256i const*)(p + (offset)))
+    __m256i _adj = _mm256_min_epu16(_mm256_min_epu16(LOAD(-w  ), LOAD(-1  )), _mm256_min_epu16(LOAD(1  ), LOAD(w  )));
+    __m256i _dia = _mm256_min_epu16(_mm256_min_epu16(LOAD(-w-1), LOAD(-w+1)), _mm256_min_epu16(LOAD(w-1), LOAD(w+1)));
+    __m256i _res = _mm256_adds_epu16(_mm256_min_epu16(_adj, _dia), _p1);
+    _res = _mm256_min_epu16(_res, _mm256_min_epu16(LOAD(0), _jump));
+    #undef LOAD
+    _mm256_storeu_si256((__m256i*)(result + i), _mm256_subs_epu16(_res, _minp));
+  }
+  path_costs_sse41(prior+i, w, count-i, jump, min_prior, p1, result+i);
+}
 
-      ++d;
-    }
+__attribute__((target("avx512f,avx512bw")))
+void path_costs_avx512(AccumCostType const* prior, int w, int count,
+                       AccumCostType jump, AccumCostType min_prior,
+                       AccumCostType p1, AccumCostType* result) {
+  const __m512i _jump = _mm512_set1_epi16(static_cast<int16>(jump     ));
+  const __m512i _minp = _mm512_set1_epi16(static_cast<int16>(min_prior));
+  const __m512i _p1   = _mm512_set1_epi16(static_cast<int16>(p1       ));
+  const int N = 32;
+  int i = 0;
+  for (; i+N <= count; i += N) {
+    AccumCostType const* p = prior + i;
+    #define LOAD(offset) _mm512_loadu_si512((void const*)(p + (offset)))
+    __m512i _adj = _mm512_min_epu16(_mm512_min_epu16(LOAD(-w  ), LOAD(-1  )), _mm512_min_epu16(LOAD(1  ), LOAD(w  )));
+    __m512i _dia = _mm512_min_epu16(_mm512_min_epu16(LOAD(-w-1), LOAD(-w+1)), _mm512_min_epu16(LOAD(w-1), LOAD(w+1)));
+    __m512i _res = _mm512_adds_epu16(_mm512_min_epu16(_adj, _dia), _p1);
+    _res = _mm512_min_epu16(_res, _mm512_min_epu16(LOAD(0), _jump));
+    #undef LOAD
+    _mm512_storeu_si512((void*)(result + i), _mm512_subs_epu16(_res, _minp));
   }
-} // End function populate_adjacent_disp_lookup_table
+  path_costs_avx2(prior+i, w, count-i, jump, min_prior, p1, result+i);
+}
+
+#endif // VW_SGM_SIMD_DISPATCH
+
+} // end anonymous namespace
+
+
+SemiGlobalMatcher::SimdLevel SemiGlobalMatcher::max_simd_level() {
+#if VW_SGM_SIMD_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512bw") && __builtin_cpu_supports("avx512f"))
+    return SIMD_AVX512;
+  if (__builtin_cpu_supports("avx2"))
+    return SIMD_AVX2;
+  if (__builtin_cpu_supports("sse4.1"))
+    return SIMD_SSE41;
+#endif
+  return SIMD_NONE;
+}
+
+void SemiGlobalMatcher::set_simd_level(SimdLevel level) {
+  level = std::min(level, max_simd_level());
+  m_path_cost_function = &path_costs_scalar;
+#if VW_SGM_SIMD_DISPATCH
+  switch (level) {
+    case SIMD_AVX512: m_path_cost_function = &path_costs_avx512; break;
+    case SIMD_AVX2:   m_path_cost_function = &path_costs_avx2;   break;
+    case SIMD_SSE41:  m_path_cost_function = &path_costs_sse41;  break;
+    default: break;
+  };
+#endif
+  vw_out(DebugMessage, "stereo") << "SGM: Path accumulation SIMD level = " << level << std::endl;
+}
 
 
-#if not defined(VW_ENABLE_SSE) || (VW_ENABLE_SSE==0)
 // Note: local and output are the same size.
-// full_prior_buffer is always length m_num_disps and comes in initialized to a
-//  large flag value.  When the function quits the buffer must be returned to this state.
+// full_prior_buffer comes in filled with the bad accumulation value, see
+//  get_full_prior_buffer_size().  When the function quits the grid part of
+//  the buffer must be returned to this state.
 void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
                        AccumCostType* const prior,
                        AccumCostType*       full_prior_buffer,
@@ -695,9 +821,6 @@ void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
   if (p2_mod < m_p1)
     p2_mod = m_p1;
 
-  //int num_disparities   = get_num_disparities(col,   row  ); // Can be input arg
-  //int num_disparities_p = get_num_disparities(col_p, row_p);
-
   Vector4i pixel_disp_bounds   = m_disp_bound_image(col, row);
   Vector4i pixel_disp_bounds_p = m_disp_bound_image(col_p, row_p);
 
@@ -705,13 +828,13 @@ void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
   AccumCostType BAD_VAL = get_bad_accum_val();
   AccumCostType min_prior = BAD_VAL;
 
-  // Insert the valid disparity scores into full_prior buffer so they are
-  //  easy to access quickly within the pixel loop below.
+  // Insert the valid disparity scores into the prior grid so the adjacent
+  //  disparities of every disparity are at fixed offsets.
   int d = 0;
   for (int dy=pixel_disp_bounds_p[1]; dy<=pixel_disp_bounds_p[3]; ++dy) {
 
     // Get initial fill linear storage index for this dy row
-    int full_index = xy_to_disp(pixel_disp_bounds_p[0], dy);
+    int grid_index = prior_grid_index(pixel_disp_bounds_p[0], dy);
 
     for (int dx=pixel_disp_bounds_p[0]; dx<=pixel_disp_bounds_p[2]; ++dx) {
 
@@ -720,288 +843,67 @@ void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
         min_prior  = prior[d];
       }
 
-      full_prior_buffer[full_index] = prior[d];
-      ++full_index;
+      full_prior_buffer[grid_index] = prior[d];
+      ++grid_index;
       ++d;
     }
   }
   AccumCostType min_prev_disparity_cost = min_prior + p2_mod;
+
+  // Compute the combined prior cost of every grid entry from the first to
+  //  the last disparity of this pixel in one run. This also visits the
+  //  entries between the rows, which are thrown away, but it keeps the
+  //  vector registers full when the pixel only searches a few disparities.
+  const int first_index = prior_grid_index(pixel_disp_bounds[0], pixel_disp_bounds[1]);
+  const int last_index  = prior_grid_index(pixel_disp_bounds[2], pixel_disp_bounds[3]);
+  AccumCostType* lowest_costs = full_prior_buffer + m_prior_grid_size; // Scratch space
+  m_path_cost_function(full_prior_buffer + first_index, m_prior_grid_width,
+                       last_index - first_index + 1,
+                       min_prev_disparity_cost, min_prior, m_p1, lowest_costs);
+
+  // The output cost = local cost + lowest combined cost - min_prior
+  // - Subtracting out min_prior avoids overflow.
+  const int num_disp_x = pixel_disp_bounds[2] - pixel_disp_bounds[0] + 1;
+  int packed_d = 0; // Index for cost and output vectors
+  for (int dy=pixel_disp_bounds[1]; dy<=pixel_disp_bounds[3]; ++dy) {
+    AccumCostType const* lowest = lowest_costs + prior_grid_index(pixel_disp_bounds[0], dy) - first_index;
+    for (int i=0; i<num_disp_x; ++i)
+      output[packed_d+i] = local[packed_d+i] + lowest[i];
+    packed_d += num_disp_x;
+  }
+
   if (debug) {
     std::cout << "Prior pixel = ("<<col_p<<","<<row_p<<")\n";
-    std::cout << "m_p2  : " << m_p2 << std::endl;
-    std::cout << "path_intensity_gradient  : " << path_intensity_gradient << std::endl;
     std::cout << "p2_mod  : " << p2_mod << std::endl;
     std::cout << "Bounds  : " << pixel_disp_bounds << std::endl;
     std::cout << "Bounds_P: " << pixel_disp_bounds_p << std::endl;
-
     std::cout << "min_prior = " <<  min_prior << std::endl;
-    std::cout << "min_prev_disparity_cost = " <<  min_prev_disparity_cost << std::endl;
-
-    std::cout << "Priors: \n";
-    int i=0;    
-    for (int dy=pixel_disp_bounds_p[1]; dy<=pixel_disp_bounds_p[3]; ++dy) {
-      for (int dx=pixel_disp_bounds_p[0]; dx<=pixel_disp_bounds_p[2]; ++dx) {
-        std::cout << prior[i] << " ";
-        ++i;
-      }
-      std::cout << std::endl;
-    }
-    std::cout << std::endl;
-
-    std::cout << "Costs: \n";
-    i=0;
-    for (int dy=pixel_disp_bounds[1]; dy<=pixel_disp_bounds[3]; ++dy) {
-      for (int dx=pixel_disp_bounds[0]; dx<=pixel_disp_bounds[2]; ++dx) {
-        std::cout << int(local[i]) << " ";
-        ++i;
-      }
-      std::cout << std::endl;
-    }
-    std::cout << std::endl;
-
-    std::cout << "Full prior buffer: \n";
-    i = 0;
-    for (int r=0; r<m_num_disp_y; ++r) {
-      for (int c=0; c<m_num_disp_x; ++c) {
-        std::cout << full_prior_buffer[i] << " ";
-        ++i;
-      }
-      std::cout << std::endl;
-    }
-    std::cout << std::endl;
-  }
-  const int LOOKUP_TABLE_WIDTH = 8;
-
-  // Loop through disparities for this pixel
-  int packed_d = 0; // Index for cost and output vectors
-  for (int dy=pixel_disp_bounds[1]; dy<=pixel_disp_bounds[3]; ++dy) {
-
-    // Need the disparity index from all of m_num_disp for proper indexing into full_prior_buffer
-    int full_d = xy_to_disp(pixel_disp_bounds[0], dy);
-
-    for (int dx=pixel_disp_bounds[0]; dx<=pixel_disp_bounds[2]; ++dx) {
-
-      // Start with the cost for the same disparity in the previous pixel
-      AccumCostType lowest_combined_cost = full_prior_buffer[full_d];
-
-      // Compare to the eight adjacent disparities using the lookup table
-      const int lookup_index = full_d*LOOKUP_TABLE_WIDTH;
-
-      // TODO: This is the slowest part of the algorithm!
-      // Note that the lookup table indexes into a full size buffer of disparities, not the compressed
-      //  buffers that are stored for each pixel.  This allows us to use a single lookup table for every pixel
-      //  and avoid any bounds checking logic inside this loop.
-      AccumCostType lowest_adjacent_cost =                  full_prior_buffer[m_adjacent_disp_lookup[lookup_index  ]];
-      lowest_adjacent_cost = std::min(lowest_adjacent_cost, full_prior_buffer[m_adjacent_disp_lookup[lookup_index+1]]);
-      lowest_adjacent_cost = std::min(lowest_adjacent_cost, full_prior_buffer[m_adjacent_disp_lookup[lookup_index+2]]);
-      lowest_adjacent_cost = std::min(lowest_adjacent_cost, full_prior_buffer[m_adjacent_disp_lookup[lookup_index+3]]);
-      lowest_adjacent_cost = std::min(lowest_adjacent_cost, full_prior_buffer[m_adjacent_disp_lookup[lookup_index+4]]);
-      lowest_adjacent_cost = std::min(lowest_adjacent_cost, full_prior_buffer[m_adjacent_disp_lookup[lookup_index+5]]);
-      lowest_adjacent_cost = std::min(lowest_adjacent_cost, full_prior_buffer[m_adjacent_disp_lookup[lookup_index+6]]);
-      lowest_adjacent_cost = std::min(lowest_adjacent_cost, full_prior_buffer[m_adjacent_disp_lookup[lookup_index+7]]);
-
-      // Now add the adjacent penalty cost and compare to the local cost
-      lowest_adjacent_cost += m_p1;
-      lowest_combined_cost = std::min(lowest_combined_cost, lowest_adjacent_cost);
-
-      // Compare to the lowest prev disparity cost regardless of location
-      lowest_combined_cost = std::min(lowest_combined_cost, min_prev_disparity_cost);
-
-      // The output cost = local cost + lowest combined cost - min_prior
-      // - Subtracting out min_prior avoids overflow.
-      output[packed_d] = local[packed_d] + lowest_combined_cost - min_prior;
-
-      //if (debug) {
-      //  printf("Details %d: local = %d, lowest_adjacent_cost = %d, prev_cost = %d, lowest_combined_cost = %d, output = %d\n", 
-      //        packed_d, local[packed_d], lowest_adjacent_cost, full_prior_buffer[full_d], lowest_combined_cost, output[packed_d]);
-      //}
-
-      ++packed_d;
-      ++full_d;
-    }
-  } // End loop through this disparity  
-
-  if(debug) {
-    int min_val   = 99999;
-    int min_index = 0;
-
     std::cout << "Output: \n";
     int i=0;
     for (int dy=pixel_disp_bounds[1]; dy<=pixel_disp_bounds[3]; ++dy) {
       for (int dx=pixel_disp_bounds[0]; dx<=pixel_disp_bounds[2]; ++dx) {
         std::cout << output[i] << " ";
-        if (output[i] < min_val) {
-          min_val   = output[i];
-          min_index = i;
-        }
         ++i;
       }
       std::cout << std::endl;
     }
     std::cout << std::endl;
-
-    DisparityType dx, dy;
-    disp_to_xy(min_index, dx, dy);
-    std::cout << "Min value = " << min_val << std::endl;
-    std::cout << "Disp = " << dx-4 <<", " << dy-4 << std::endl;
-    std::cout << "Min index = " << min_index << std::endl<< std::endl;
-    std::cout << "========================================\n\n";
-  }
-  // Remove the valid disparity scores from full_prior buffer.
-  for (int dy=pixel_disp_bounds_p[1]; dy<=pixel_disp_bounds_p[3]; ++dy) {
-
-    // Get initial fill linear storage index for this dy row
-    int full_index = xy_to_disp(pixel_disp_bounds_p[0], dy);
-
-    for (int dx=pixel_disp_bounds_p[0]; dx<=pixel_disp_bounds_p[2]; ++dx) {
-
-      full_prior_buffer[full_index] = BAD_VAL;
-      ++full_index;
-    }
-  }
-
-}
-#endif
-
-#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
-void SemiGlobalMatcher::evaluate_path( int col, int row, int col_p, int row_p,
-                       AccumCostType* const prior,
-                       AccumCostType*       full_prior_buffer,
-                       CostType     * const local,
-                       AccumCostType*       output,
-                       int path_intensity_gradient, bool debug ) {
-
-  // Decrease p2 (jump cost) with increasing disparity along the path
-  AccumCostType p2_mod = m_p2;
-  if (path_intensity_gradient > 0)
-    p2_mod /= path_intensity_gradient;
-  if (p2_mod < m_p1)
-    p2_mod = m_p1;
-
-  Vector4i pixel_disp_bounds   = m_disp_bound_image(col, row);
-  Vector4i pixel_disp_bounds_p = m_disp_bound_image(col_p, row_p);
-
-  // Init the min prior in case the previous pixel is invalid.
-  AccumCostType BAD_VAL = get_bad_accum_val();
-  AccumCostType min_prior = BAD_VAL;
-
-  // Insert the valid disparity scores into full_prior buffer so they are
-  //  easy to access quickly within the pixel loop below.
-  // - If we don't use a full sized buffer, our adjacent disparity lookup
-  //   table could not be used!
-  int d = 0;
-  for (int dy=pixel_disp_bounds_p[1]; dy<=pixel_disp_bounds_p[3]; ++dy) {
-
-    // Get initial fill linear storage index for this dy row
-    int full_index = xy_to_disp(pixel_disp_bounds_p[0], dy);
-
-    for (int dx=pixel_disp_bounds_p[0]; dx<=pixel_disp_bounds_p[2]; ++dx) {
-    
-      // Get the min prior while we are at it.
-      if (prior[d] < min_prior) {
-        min_prior  = prior[d];
-      }
-    
-      full_prior_buffer[full_index] = prior[d];
-      ++full_index;
-      ++d;
-    }
   }
-  AccumCostType min_prev_disparity_cost = min_prior + p2_mod;
 
-  const int LOOKUP_TABLE_WIDTH = 8;
-  
-  // Allocate linear storage for data to pass to SSE instructions
-  const int SSE_BUFF_LEN = 8;
-  uint16 d_packed[SSE_BUFF_LEN*11] __attribute__ ((aligned (16))); // TODO: Could be passed in!
-  uint16* dL   = &(d_packed[0*SSE_BUFF_LEN]);
-  uint16* d0   = &(d_packed[1*SSE_BUFF_LEN]);
-  uint16* d1   = &(d_packed[2*SSE_BUFF_LEN]);
-  uint16* d2   = &(d_packed[3*SSE_BUFF_LEN]);
-  uint16* d3   = &(d_packed[4*SSE_BUFF_LEN]);
-  uint16* d4   = &(d_packed[5*SSE_BUFF_LEN]);
-  uint16* d5   = &(d_packed[6*SSE_BUFF_LEN]);
-  uint16* d6   = &(d_packed[7*SSE_BUFF_LEN]);
-  uint16* d7   = &(d_packed[8*SSE_BUFF_LEN]);
-  uint16* d8   = &(d_packed[9*SSE_BUFF_LEN]);
-  uint16* dRes = &(d_packed[10*SSE_BUFF_LEN]); // The results
-  
-  // Set up constant SSE registers that never change
-  __m128i _dJ  = _mm_set1_epi16(static_cast<int16>(min_prev_disparity_cost));
-  __m128i _dP  = _mm_set1_epi16(static_cast<int16>(min_prior));
-  __m128i _dp1 = _mm_set1_epi16(static_cast<int16>(m_p1));
-  
-  //printf("dJ = %d, dP = %d, dp1 = %d\n", min_prev_disparity_cost, min_prior, m_p1);
-  //std::cout << "pixel_disp_bounds = " << pixel_disp_bounds << std::endl;
-  
-  // Loop through disparities for this pixel
-  int sse_index = 0, output_index = 0;
-  int packed_d = 0; // Index for cost and output vectors
-  for (int dy=pixel_disp_bounds[1]; dy<=pixel_disp_bounds[3]; ++dy) {
-
-    // Need the disparity index from all of m_num_disp for proper indexing into full_prior_buffer
-    int full_d = xy_to_disp(pixel_disp_bounds[0], dy);
-
-    for (int dx=pixel_disp_bounds[0]; dx<=pixel_disp_bounds[2]; ++dx) {
-
-      // Get local value and matching disparity value
-      dL[sse_index] = local[packed_d];
-      d0[sse_index] = full_prior_buffer[full_d];
-      
-      // Get the 8 surrounding values.
-      // - Is there any way to speed this up?
-      const int lookup_index = full_d*LOOKUP_TABLE_WIDTH;
-      d1[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index  ]];
-      d2[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index+1]];
-      d3[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index+2]];
-      d4[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index+3]];
-      d5[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index+4]];
-      d6[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index+5]];
-      d7[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index+6]];
-      d8[sse_index] = full_prior_buffer[m_adjacent_disp_lookup[lookup_index+7]];
-
-      ++packed_d;
-      ++full_d;
-      ++sse_index;
-
-      // Keep packing the SSE buffers until they are filled up, then use SSE to operate on
-      // all of the data at once.
-      if (sse_index == SSE_BUFF_LEN){
-
-        compute_path_internals_sse(dL, d0, d1, d2, d3, d4, d5, d6, d7, d8,
-                                   _dJ, _dP, _dp1, dRes, sse_index, output_index, output);
-        //compute_path_internals(dL, d0, d1, d2, d3, d4, d5, d6, d7, d8,
-        //                   min_prev_disparity_cost, min_prior, m_p1, dRes, sse_index, output_index, output);
-
-        sse_index = 0;
-      } // End SSE operations
-
-    }
-  } // End loop through this disparity
-
-  // If there is data left over in the buffer, process it now.
-  if (sse_index > 0) {
-    compute_path_internals_sse(dL, d0, d1, d2, d3, d4, d5, d6, d7, d8,
-                           _dJ, _dP, _dp1, dRes, sse_index, output_index, output);
-    //compute_path_internals(dL, d0, d1, d2, d3, d4, d5, d6, d7, d8,
-    //                       min_prev_disparity_cost, min_prior, m_p1, dRes, sse_index, output_index, output);
-  }
-
-  // Remove the valid disparity scores from full_prior buffer.
+  // Remove the valid disparity scores from the prior grid.
   for (int dy=pixel_disp_bounds_p[1]; dy<=pixel_disp_bounds_p[3]; ++dy) {
 
     // Get initial fill linear storage index for this dy row
-    int full_index = xy_to_disp(pixel_disp_bounds_p[0], dy);
+    int grid_index = prior_grid_index(pixel_disp_bounds_p[0], dy);
 
     for (int dx=pixel_disp_bounds_p[0]; dx<=pixel_disp_bounds_p[2]; ++dx) {
 
-      full_prior_buffer[full_index] = BAD_VAL;
-      ++full_index;
+      full_prior_buffer[grid_index] = BAD_VAL;
+      ++grid_index;
     }
   }
 
-} // End evaluate_path SSE
-#endif
+} // End evaluate_path
 
 
 /* This function is not 100% successful at removing "multiple minimums"
@@ -1391,6 +1293,33 @@ double SemiGlobalMatcher::compute_subpixel_ratio(AccumCostType prev, AccumCostTy
 */
 
 
+Vector<SemiGlobalMatcher::AccumCostType, 9>
+SemiGlobalMatcher::get_subpixel_neighbors(AccumCostType const* accum_vec,
+                                          Vector4i const& bounds, int dx, int dy) const {
+  const int width = (bounds[2] - bounds[0] + 1);
+
+  // Linear index of the min offset that will be checked
+  const int min_index = (dy-bounds[1])*width + (dx-bounds[0]);
+
+  // Get the indices of where to find the four adjacent pixels
+  const int x_left  = (dx == bounds[0]) ? 0 : -1;
+  const int x_right = (dx == bounds[2]) ? 0 :  1;
+  const int y_up    = (dy == bounds[1]) ? 0 : -width;
+  const int y_down  = (dy == bounds[3]) ? 0 :  width;
+
+  Vector<AccumCostType, 9> n;
+  n[0] = accum_vec[min_index+x_left +y_up  ];
+  n[1] = accum_vec[min_index        +y_up  ];
+  n[2] = accum_vec[min_index+x_right+y_up  ];
+  n[3] = accum_vec[min_index+x_left        ];
+  n[4] = accum_vec[min_index               ];
+  n[5] = accum_vec[min_index+x_right       ];
+  n[6] = accum_vec[min_index+x_left +y_down];
+  n[7] = accum_vec[min_index        +y_down];
+  n[8] = accum_vec[min_index+x_right+y_down];
+  return n;
+}
+
 // Test out alternate subpixel methods
 ImageView<PixelMask<Vector2f> > SemiGlobalMatcher::
 create_disparity_view_subpixel(DisparityImage const& integer_disparity) {
@@ -1416,8 +1345,6 @@ create_disparity_view_subpixel(DisparityImage const& integer_disparity) {
     for ( int i = 0; i < m_num_output_cols; i++ ) {
 
       const Vector4i bounds = m_disp_bound_image(i,j);
-      //int height   = (bounds[3] - bounds[1] + 1);
-      int width    = (bounds[2] - bounds[0] + 1);
 
       // Check the input image to find masked pixels
       PixelMask<Vector2i> integer_pixel = integer_disparity(i, j);
@@ -1436,42 +1363,34 @@ create_disparity_view_subpixel(DisparityImage const& integer_disparity) {
         continue;
       }
 
-      // Linear index of the min offset that will be checked
-      int min_index = (dy-bounds[1])*width + (dx-bounds[0]);
-
-      // Get the indices of where to find the four adjacent pixels
-      int x_left  = -1;
-      int x_right =  1;
-      int y_up    = -width;
-      int y_down  =  width;
-
       // Don't interpolate out of bounds
-      bool top_bound, bottom_bound, left_bound, right_bound;
-      top_bound = bottom_bound = left_bound = right_bound = false;
-      if (dx == bounds[0]) { x_left  = 0; left_bound   = true; }
-      if (dx == bounds[2]) { x_right = 0; right_bound  = true; }
-      if (dy == bounds[1]) { y_up    = 0; top_bound    = true; }
-      if (dy == bounds[3]) { y_down  = 0; bottom_bound = true; }
+      bool top_bound    = (dy == bounds[1]);
+      bool bottom_bound = (dy == bounds[3]);
+      bool left_bound   = (dx == bounds[0]);
+      bool right_bound  = (dx == bounds[2]);
 
       // Apply subpixel correction and apply
-      AccumCostType const* accum_vec = get_accum_vector(i, j);
+      // - The low memory accumulation only kept the costs around the best disparity.
+      Vector<AccumCostType, 9> n;
+      if (m_use_low_memory)
+        n = m_subpixel_neighbors(i, j);
+      else
+        n = get_subpixel_neighbors(get_accum_vector(i, j), bounds, dx, dy);
 
       bool debug = false;//((j==2937) && (i >= 4635) && (i <= 4645));
 
       bool valid = true;
       if (m_subpixel_type == SUBPIXEL_PARABOLA) {
-        valid = fitter.find_peak( accum_vec[min_index+x_left+y_up  ],  accum_vec[min_index+y_up  ], accum_vec[min_index+x_right+y_up  ],
-                                  accum_vec[min_index+x_left       ],  accum_vec[min_index       ], accum_vec[min_index+x_right       ],
-                                  accum_vec[min_index+x_left+y_down],  accum_vec[min_index+y_down], accum_vec[min_index+x_right+y_down],
+        valid = fitter.find_peak( n[0], n[1], n[2],
+                                  n[3], n[4], n[5],
+                                  n[6], n[7], n[8],
                                   delta_x, delta_y);
       }
       else {
         // This branch handles all 1D interpolation methods.
         // - These methods are always considered valid.
-        delta_x = compute_subpixel_offset(accum_vec[min_index+x_left], accum_vec[min_index], accum_vec[min_index+x_right], 
-                                          left_bound, right_bound, debug);
-        delta_y = compute_subpixel_offset(accum_vec[min_index+y_up  ], accum_vec[min_index], accum_vec[min_index+y_down ], 
-                                          top_bound, bottom_bound, false);
+        delta_x = compute_subpixel_offset(n[3], n[4], n[5], left_bound, right_bound, debug);
+        delta_y = compute_subpixel_offset(n[1], n[4], n[7], top_bound, bottom_bound, false);
       }
 /*
       if (debug) {
@@ -1613,10 +1532,12 @@ SemiGlobalMatcher::CostType SemiGlobalMatcher::get_cost_block(ImageView<uint8> c
 }
 
 void SemiGlobalMatcher::fill_costs_block(ImageView<uint8> const& left_image,
-                                         ImageView<uint8> const& right_image){
+                                         ImageView<uint8> const& right_image,
+                                         int first_row, int num_rows, CostType* output){
   // Make sure we don't go out of bounds here due to the disparity shift and kernel.
   size_t cost_index = 0;
-  for ( int r = m_min_row; r <= m_max_row; r++ ) { // For each row in left
+  const int end_row = m_min_row + first_row + num_rows - 1;
+  for ( int r = m_min_row + first_row; r <= end_row; r++ ) { // For each row in left
     int output_row = r - m_min_row;
     for ( int c = m_min_col; c <= m_max_col; c++ ) { // For each column in left
       int output_col = c - m_min_col;
@@ -1634,7 +1555,7 @@ void SemiGlobalMatcher::fill_costs_block(ImageView<uint8> const& left_image,
 
           CostType cost = get_cost_block(left_image, right_image, mean_left, std_left,
                                          c, r, c+dx,r+dy, false);
-          m_cost_buffer[cost_index] = cost;
+          output[cost_index] = cost;
           ++cost_index;
         }
       } // End disparity loops
@@ -1664,7 +1585,7 @@ void SemiGlobalMatcher::fill_costs_census3x3(ImageView<uint8> const& left_image,
     for ( int r = 0; r < right_census.rows(); r++ )
       for ( int c = 0; c < right_census.cols(); c++ )
         right_census(c,r) = get_census_value_3x3(right_image, c+half_kernel, r+half_kernel);
-    get_hamming_distance_costs(left_census, right_census);
+    use_census_images(left_census, right_census);
   } else {
     ImageView<uint16> left_census (left_image.cols()-padding,  left_image.rows()-padding ), 
                       right_census(right_image.cols()-padding, right_image.rows()-padding);
@@ -1675,7 +1596,7 @@ void SemiGlobalMatcher::fill_costs_census3x3(ImageView<uint8> const& left_image,
     for ( int r = 0; r < right_census.rows(); r++ )
       for ( int c = 0; c < right_census.cols(); c++ )
         right_census(c,r) = get_census_value_ternary_3x3(right_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
-    get_hamming_distance_costs(left_census, right_census);
+    use_census_images(left_census, right_census);
   } 
 
 }
@@ -1706,7 +1627,7 @@ void SemiGlobalMatcher::fill_costs_census5x5(ImageView<uint8> const& left_image,
       for ( int c = 0; c < right_census.cols(); c++ )
         right_census(c,r) = get_census_value_ternary_5x5(right_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
   }
-  get_hamming_distance_costs(left_census, right_census);
+  use_census_images(left_census, right_census);
 }
 
 void SemiGlobalMatcher::fill_costs_census7x7(ImageView<uint8> const& left_image,
@@ -1735,7 +1656,7 @@ void SemiGlobalMatcher::fill_costs_census7x7(ImageView<uint8> const& left_image,
       for ( int c = 0; c < right_census.cols(); c++ )
         right_census(c,r) = get_census_value_ternary_7x7(right_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
   }
-  get_hamming_distance_costs(left_census, right_census);
+  use_census_images(left_census, right_census);
 }
 
 void SemiGlobalMatcher::fill_costs_census9x9(ImageView<uint8> const& left_image,
@@ -1757,7 +1678,7 @@ void SemiGlobalMatcher::fill_costs_census9x9(ImageView<uint8> const& left_image,
     for ( int r = 0; r < right_census.rows(); r++ )
       for ( int c = 0; c < right_census.cols(); c++ )
         right_census(c,r) = get_census_value_9x9(right_image, c+half_kernel, r+half_kernel);  
-    get_hamming_distance_costs(left_census, right_census);
+    use_census_images(left_census, right_census);
   } else { // TERNARY_CENSUS_TRANSFORM
     ImageView<uint64> left_census (left_image.cols()-padding,  left_image.rows()-padding ), 
                       right_census(right_image.cols()-padding, right_image.rows()-padding);
@@ -1768,7 +1689,7 @@ void SemiGlobalMatcher::fill_costs_census9x9(ImageView<uint8> const& left_image,
     for ( int r = 0; r < right_census.rows(); r++ )
       for ( int c = 0; c < right_census.cols(); c++ )
         right_census(c,r) = get_census_value_ternary_9x9(right_image, c+half_kernel, r+half_kernel, m_ternary_census_threshold);
-    get_hamming_distance_costs(left_census, right_census);
+    use_census_images(left_census, right_census);
   }
 }
 
@@ -1786,9 +1707,13 @@ void SemiGlobalMatcher::compute_disparity_costs(ImageView<uint8> const& left_ima
                                    << "Other cost mode options do not have this restriction.");
     };
   }
+  else if (m_use_low_memory) { // The costs are computed a few rows at a time later
+    m_left_cost_image  = left_image;
+    m_right_cost_image = right_image;
+  }
   else { // Use the default mean of diff cost function
     // Replace this with ASP's efficient existing cost functions?
-    fill_costs_block(left_image, right_image);
+    fill_costs_block(left_image, right_image, 0, m_num_output_rows, m_cost_buffer.get());
   }
 
   /*
@@ -1860,6 +1785,14 @@ void SemiGlobalMatcher::compute_disparity_costs(ImageView<uint8> const& left_ima
 } // end compute_disparity_costs() 
 
 
+void SemiGlobalMatcher::fill_cost_rows(int first_row, int num_rows, CostType* output) {
+  if ((m_cost_type == CENSUS_TRANSFORM) || (m_cost_type == TERNARY_CENSUS_TRANSFORM))
+    get_hamming_distance_costs(m_left_census, m_right_census, first_row, num_rows, output);
+  else
+    fill_costs_block(m_left_cost_image, m_right_cost_image, first_row, num_rows, output);
+}
+
+
 
 
 void SemiGlobalMatcher::two_trip_path_accumulation(ImageView<uint8> const& left_image) {
@@ -1872,8 +1805,8 @@ void SemiGlobalMatcher::two_trip_path_accumulation(ImageView<uint8> const& left_
   // Init this buffer to bad scores representing disparities that were
   //  not in the search range for the given pixel.
   boost::shared_array<AccumCostType> full_prior_buffer;
-  full_prior_buffer.reset(new AccumCostType[m_num_disp]);
-  for (int i=0; i<m_num_disp; ++i)
+  full_prior_buffer.reset(new AccumCostType[get_full_prior_buffer_size()]);
+  for (int i=0; i<get_full_prior_buffer_size(); ++i)
     full_prior_buffer[i] = get_bad_accum_val();  
 
   AccumCostType* full_prior_ptr = full_prior_buffer.get();
@@ -2033,8 +1966,8 @@ void SemiGlobalMatcher::smooth_path_accumulation(ImageView<uint8> const& left_im
   // Init this buffer to bad scores representing disparities that were
   //  not in the search range for the given pixel.
   boost::shared_array<AccumCostType> full_prior_buffer;
-  full_prior_buffer.reset(new AccumCostType[m_num_disp]);
-  for (int i=0; i<m_num_disp; ++i)
+  full_prior_buffer.reset(new AccumCostType[get_full_prior_buffer_size()]);
+  for (int i=0; i<get_full_prior_buffer_size(); ++i)
     full_prior_buffer[i] = get_bad_accum_val();  
 
   AccumCostType* full_prior_ptr = full_prior_buffer.get();
@@ -2345,8 +2278,6 @@ SemiGlobalMatcher::semi_global_matching_func( ImageView<uint8> const& left_image
                                   ", output_height = "<< m_num_output_rows <<
                                   ", output_width = "<< m_num_output_cols <<"\n";
 
-  populate_adjacent_disp_lookup_table();
-
   // By default the search bounds are the same for each pixel,
   //  but set them from the prior disparity image if the user passed it in.
   populate_constant_disp_bound_image();
@@ -2364,6 +2295,9 @@ SemiGlobalMatcher::semi_global_matching_func( ImageView<uint8> const& left_image
 
   compute_disparity_costs(left_image, right_image);
 
+  if (m_use_low_memory)
+    return low_memory_accumulation(left_image);
+
   if (m_use_mgm)
     //smooth_path_accumulation(left_image);
     smooth_path_accumulation_multithreaded(left_image);
@@ -2515,6 +2449,185 @@ void SemiGlobalMatcher::multi_thread_accumulation(ImageView<uint8> const& left_i
 
 
 
+void SemiGlobalMatcher::row_path_accumulation(ImageView<uint8> const& left_image,
+                                              int row, int prev_row,
+                                              CostType      * const costs,
+                                              AccumCostType * const prior_paths,
+                                              AccumCostType *       paths,
+                                              AccumCostType *       sums,
+                                              AccumCostType *       full_prior_buffer) {
+
+  const bool   have_prior   = (prev_row >= 0) && (prev_row < m_num_output_rows);
+  const size_t row_start    = m_buffer_starts(0, row);
+  const size_t row_length   = get_row_buffer_length(row);
+  const size_t prior_start  = have_prior ? m_buffer_starts(0, prev_row)    : 0;
+  const size_t prior_length = have_prior ? get_row_buffer_length(prev_row) : 0;
+
+  // Going down the horizontal path comes from the left, going up it comes from the right.
+  const int step      = (prev_row < row) ? 1 : -1;
+  const int first_col = (step > 0) ? 0 : m_num_output_cols-1;
+
+  const int NUM_PATHS = 4;
+  const int HORIZONTAL_PATH = 3;
+  for (int i=0, col=first_col; i<m_num_output_cols; ++i, col+=step) {
+
+    const size_t offset   = m_buffer_starts(col, row) - row_start;
+    const int    num_disp = get_num_disparities(col, row);
+    CostType * const local_cost_ptr = costs + offset;
+    const int pixel_val = left_image(col+m_min_col, row+m_min_row);
+
+    for (int p=0; p<NUM_PATHS; ++p) {
+      // Location of the previous pixel along this path
+      const int col_p = (p == 0) ? col : ((p == 2) ? col+step : col-step);
+      const int row_p = (p == HORIZONTAL_PATH) ? row : prev_row;
+
+      AccumCostType* output_accum_ptr = paths + p*row_length + offset;
+      if ((col_p < 0) || (col_p >= m_num_output_cols) || (row_p < 0) || (row_p >= m_num_output_rows)) {
+        // The path starts here, just init to the local cost
+        for (int d=0; d<num_disp; ++d) output_accum_ptr[d] = local_cost_ptr[d];
+        continue;
+      }
+
+      AccumCostType* prior_accum_ptr;
+      if (p == HORIZONTAL_PATH)
+        prior_accum_ptr = paths + p*row_length + (m_buffer_starts(col_p, row_p) - row_start);
+      else
+        prior_accum_ptr = prior_paths + p*prior_length + (m_buffer_starts(col_p, row_p) - prior_start);
+
+      int pixel_diff = abs(pixel_val - static_cast<int>(left_image(col_p+m_min_col, row_p+m_min_row)));
+      evaluate_path( col, row, col_p, row_p,
+                     prior_accum_ptr, full_prior_buffer, local_cost_ptr, output_accum_ptr,
+                     pixel_diff );
+    } // End path loop
+
+    if (sums) {
+      AccumCostType* sum_ptr = sums + offset;
+      for (int d=0; d<num_disp; ++d)
+        sum_ptr[d] += paths[offset+d] + paths[row_length+offset+d]
+                    + paths[2*row_length+offset+d] + paths[3*row_length+offset+d];
+    }
+  } // End col loop
+} // End function row_path_accumulation
+
+
+
+SemiGlobalMatcher::DisparityImage
+SemiGlobalMatcher::low_memory_accumulation(ImageView<uint8> const& left_image) {
+
+  //Timer timer_total("\tSGM Low Memory Accumulation");
+
+  const int height     = m_num_output_rows;
+  const int block_rows = get_low_memory_block_rows();
+  const int num_blocks = (height + block_rows - 1) / block_rows;
+
+  // Find the sizes needed for the row and block buffers
+  size_t max_row_length = 0, max_block_length = 0;
+  for (int r=0; r<height; ++r)
+    max_row_length = std::max(max_row_length, get_row_buffer_length(r));
+  for (int b=0; b<num_blocks; ++b) {
+    const int last_row = std::min(height, (b+1)*block_rows) - 1;
+    max_block_length = std::max(max_block_length, m_buffer_starts(0, last_row)
+                                + get_row_buffer_length(last_row) - m_buffer_starts(0, b*block_rows));
+  }
+
+  const int NUM_PATHS        = 4;
+  const int NUM_STORED_PATHS = 3; // The horizontal path does not carry over between rows
+  std::vector<CostType     > block_costs(max_block_length);
+  std::vector<AccumCostType> block_sums (max_block_length);
+  std::vector<AccumCostType> path_rows  (4*NUM_PATHS*max_row_length);
+  AccumCostType* down_prior = &path_rows[0];
+  AccumCostType* down_paths = down_prior + NUM_PATHS*max_row_length;
+  AccumCostType* up_prior   = down_paths + NUM_PATHS*max_row_length;
+  AccumCostType* up_paths   = up_prior   + NUM_PATHS*max_row_length;
+
+  // The downward paths are stored at the row above the start of each block.
+  std::vector<size_t> checkpoint_starts(num_blocks+1, 0);
+  for (int b=1; b<num_blocks; ++b)
+    checkpoint_starts[b+1] = checkpoint_starts[b] + NUM_STORED_PATHS*get_row_buffer_length(b*block_rows-1);
+  std::vector<AccumCostType> checkpoints(std::max(checkpoint_starts[num_blocks], size_t(1)));
+
+  std::vector<AccumCostType> full_prior_buffer(get_full_prior_buffer_size(), get_bad_accum_val());
+  AccumCostType* full_prior_ptr = &full_prior_buffer[0];
+
+  // First trip, top to bottom: store the downward paths every block_rows rows.
+  std::vector<CostType> row_costs(max_row_length);
+  for (int row=0; row<height; ++row) {
+    fill_cost_rows(row, 1, &row_costs[0]);
+    row_path_accumulation(left_image, row, row-1, &row_costs[0], down_prior, down_paths, 0, full_prior_ptr);
+    if (((row+1) % block_rows == 0) && (row+1 < height)) {
+      const int b = (row+1) / block_rows;
+      std::copy(down_paths, down_paths + NUM_STORED_PATHS*get_row_buffer_length(row),
+                checkpoints.begin() + checkpoint_starts[b]);
+    }
+    std::swap(down_prior, down_paths);
+  }
+
+  DisparityImage disparity(m_num_output_cols, height);
+  if (m_subpixel_type != SUBPIXEL_NONE)
+    m_subpixel_neighbors.set_size(m_num_output_cols, height);
+  else
+    m_subpixel_neighbors.reset();
+
+  // Second trip, bottom to top one block at a time: recompute the costs and the
+  //  downward paths of the block, then add the upward paths and select the disparities.
+  std::vector<AccumCostType> select_buffer;
+  DisparityType dx, dy;
+  int min_index = 0;
+  for (int b=num_blocks-1; b>=0; --b) {
+    const int first_row   = b*block_rows;
+    const int end_row     = std::min(height, first_row + block_rows);
+    const size_t block_start  = m_buffer_starts(0, first_row);
+    const size_t block_length = m_buffer_starts(0, end_row-1) + get_row_buffer_length(end_row-1) - block_start;
+
+    fill_cost_rows(first_row, end_row - first_row, &block_costs[0]);
+    std::fill(block_sums.begin(), block_sums.begin() + block_length, 0);
+
+    AccumCostType* prior = (b > 0) ? &checkpoints[checkpoint_starts[b]] : down_prior;
+    for (int row=first_row; row<end_row; ++row) {
+      const size_t offset = m_buffer_starts(0, row) - block_start;
+      row_path_accumulation(left_image, row, row-1, &block_costs[offset], prior, down_paths,
+                            &block_sums[offset], full_prior_ptr);
+      std::swap(down_prior, down_paths);
+      prior = down_prior;
+    }
+
+    for (int row=end_row-1; row>=first_row; --row) {
+      const size_t offset = m_buffer_starts(0, row) - block_start;
+      row_path_accumulation(left_image, row, row+1, &block_costs[offset], up_prior, up_paths,
+                            &block_sums[offset], full_prior_ptr);
+      std::swap(up_prior, up_paths);
+
+      // The accumulation for this row is complete, choose the best disparities.
+      for (int col=0; col<m_num_output_cols; ++col) {
+        if (get_num_disparities(col, row) == 0) {
+          // Pixels with no search area were never valid.
+          disparity(col,row) = DisparityImage::pixel_type();
+          invalidate(disparity(col,row));
+          continue;
+        }
+        const Vector4i bounds = m_disp_bound_image(col, row);
+        AccumCostType *accum_vec = &block_sums[m_buffer_starts(col, row) - block_start];
+        select_best_disparity(accum_vec, bounds, min_index, select_buffer, false);
+        disp_index_to_xy(min_index, col, row, dx, dy);
+        disparity(col,row) = DisparityImage::pixel_type(dx, dy);
+        if (m_subpixel_type != SUBPIXEL_NONE)
+          m_subpixel_neighbors(col,row) = get_subpixel_neighbors(accum_vec, bounds, dx, dy);
+      }
+    } // End upward row loop
+  } // End block loop
+
+  // The cost function inputs are not needed any more.
+  m_left_census.reset();
+  m_right_census.reset();
+  m_left_cost_image.reset();
+  m_right_cost_image.reset();
+
+  vw_out(DebugMessage, "stereo") << "Finished low memory accumulation.\n";
+  return disparity;
+} // End function low_memory_accumulation
+
+
+
 // This version of the function requires four passes and is based on the paper:
 // MGM: A Significantly More Global Matching for Stereovision
 void SemiGlobalMatcher::smooth_path_accumulation_multithreaded(ImageView<uint8> const& left_image) {
@@ -7,14 +7,10 @@
 #include <vw/Stereo/Correlation.h>
 #include <vw/Image/CensusTransform.h>
 #include <vw/Image/Algorithms.h>
+#include <vw/Image/Manipulation.h>
 
 #include <boost/smart_ptr/shared_ptr.hpp>
 
-#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
-  #include <emmintrin.h>
-  #include <smmintrin.h> // SSE4.1
-#endif
-
 namespace vw {
 
 namespace stereo {
@@ -31,8 +27,9 @@ implementation has the following features:
   only the individual search range for every pixel.  When combined with an
   input low-resolution disparity image, this can massively reduce the amount
   of memory required.
-- SSE instructions are used to increase speed but currently they only provide
-  a small improvement.
+- The path accumulation uses SSE4.1, AVX2 or AVX-512 instructions, whichever
+  is the widest that the CPU supports.
+- A low memory mode which does not store the cost volume, see set_low_memory_mode().
   
 Even with the included optimizations this algorithm is slow and requires huge
 amounts of memory to operate on large images.  Be careful not to exceed your
@@ -75,6 +72,13 @@ public: // Definitions
                         SUBPIXEL_LC_BLEND = 5  // Probably the best option
                         };
 
+  /// Vector instruction sets that the path accumulation can use
+  enum SimdLevel {SIMD_NONE   = 0,
+                  SIMD_SSE41  = 1,
+                  SIMD_AVX2   = 2,
+                  SIMD_AVX512 = 3
+                  };
+
 public: // Functions
 
   SemiGlobalMatcher() {} ///< Default constructor
@@ -129,6 +133,34 @@ public: // Functions
   /// Create a subpixel leves disparity image using parabola interpolation
   ImageView<PixelMask<Vector2f> > create_disparity_view_subpixel(DisparityImage const& integer_disparity);
 
+  /// The widest instruction set supported by both this build and the CPU.
+  static SimdLevel max_simd_level();
+
+  /// Use at most this instruction set for the path accumulation.
+  /// - set_parameters() selects max_simd_level().
+  void set_simd_level(SimdLevel level);
+
+  /// Always use the low memory accumulation, even if the full buffers would fit.
+  /// - The low memory accumulation never stores the cost volume.  It sweeps the
+  ///   image twice, storing the downward paths every few rows and recomputing the
+  ///   costs and the paths in between when sweeping back up.  Only the best
+  ///   disparity and its neighbors are kept for each pixel.
+  /// - Memory usage drops from the size of the search volume to roughly its
+  ///   square root times the image width, for about twice the run time.
+  /// - The result is identical to the normal accumulation.
+  /// - This is used automatically when the normal buffers would exceed memory_limit_mb.
+  /// - MGM is not supported, it always uses the normal accumulation.
+  /// - set_parameters() turns this off.
+  void set_low_memory_mode(bool low_memory) { m_low_memory_mode = low_memory; }
+
+private: // Definitions
+
+  /// Computes min(min(adjacent)+p1, same, jump) - min_prior for count consecutive
+  /// entries of the prior grid, see m_prior_grid_width.
+  typedef void (*PathCostFunction)(AccumCostType const* prior, int grid_width, int count,
+                                   AccumCostType jump, AccumCostType min_prior,
+                                   AccumCostType p1, AccumCostType* result);
+
 private: // Variables
 
     // The core parameters
@@ -141,6 +173,8 @@ private: // Variables
     SgmSubpixelMode  m_subpixel_type;
     Vector2i m_search_buffer;
     size_t m_memory_limit_mb; ///< Maximum memory usage allowed in main buffers
+    bool   m_low_memory_mode; ///< Set by set_low_memory_mode()
+    bool   m_use_low_memory;  ///< The current call uses the low memory accumulation
 
     int m_min_row, m_max_row;
     int m_min_col, m_max_col;
@@ -162,21 +196,28 @@ private: // Variables
     /// - Stored as min_col, min_row, max_col, max_row.
     ImageView<Vector4i> m_disp_bound_image;
 
-    /// Lookup table of the adjacent disparities for each disparity
-    /// - For each disparity index, store the disparity indices of the 
-    ///   eight adjacent disparities.
-    /// - Handles outer boundaries by repetition.
-    /// - This vector stores a table of size m_num_disp*8.
-    /// - This allows us to avoid performing any bounds checking in the algorithm core.
-    std::vector<DisparityType> m_adjacent_disp_lookup;
+    /// Row length of the grid of prior costs used by evaluate_path().
+    /// - The grid holds every disparity plus a border of one disparity
+    ///   on each side, so the eight adjacent disparities of any disparity
+    ///   are at fixed offsets and need no bounds checking.
+    /// - The border always holds the bad accumulation value.
+    int m_prior_grid_width, m_prior_grid_size;
+
+    PathCostFunction m_path_cost_function; ///< Chosen by set_simd_level()
 
     /// For each output pixel, store the starting index in m_cost_buffer/m_accum_buffer
     ImageView<size_t> m_buffer_starts;
 
-private: // Functions
+    // The cost function inputs retained by the low memory accumulation
+    // - Census images are widened to 64 bits so all kernel sizes share one type.
+    ImageView<uint64> m_left_census, m_right_census;
+    ImageView<uint8 > m_left_cost_image, m_right_cost_image;
+
+    /// The accumulated costs around the best disparity of each pixel, used
+    ///  for subpixel interpolation after a low memory accumulation.
+    ImageView<Vector<AccumCostType, 9> > m_subpixel_neighbors;
 
-  /// Populate the lookup table m_adjacent_disp_lookup
-  void populate_adjacent_disp_lookup_table();
+private: // Functions
 
   /// Fill in m_disp_bound_image using image-wide contstants
   void populate_constant_disp_bound_image();
@@ -211,9 +252,34 @@ private: // Functions
   /// Fills m_buffer_starts and allocates m_cost_buffer and m_accum_buffer
   void allocate_large_buffers();
 
+  /// Number of rows between the stored downward paths in the low memory accumulation.
+  int get_low_memory_block_rows() const {
+    return std::max(1, static_cast<int>(ceil(sqrt(static_cast<double>(m_num_output_rows)))));
+  }
+
+  /// Estimate the bytes used by the low memory accumulation.
+  /// - m_buffer_starts and m_buffer_lengths must be set for this to work.
+  size_t get_low_memory_usage_bytes() const;
+
+  /// Number of buffer elements used by one output row.
+  size_t get_row_buffer_length(int row) const {
+    size_t end = (row+1 < m_num_output_rows) ? m_buffer_starts(0, row+1) : m_buffer_lengths;
+    return end - m_buffer_starts(0, row);
+  }
+
   /// Return a bad accumulation value used to fill locations we don't visit
   AccumCostType get_bad_accum_val() const { return std::numeric_limits<CostType>::max() + m_p2; }
 
+  /// Number of elements in the full prior buffer passed to evaluate_path().
+  /// - The buffer holds the prior grid followed by the same amount of scratch
+  ///   space and must be filled with get_bad_accum_val().
+  int get_full_prior_buffer_size() const { return 2*m_prior_grid_size; }
+
+  /// Position of a disparity in the prior grid
+  int prior_grid_index(DisparityType dx, DisparityType dy) const {
+    return (dy-m_min_disp_y+1)*m_prior_grid_width + (dx-m_min_disp_x+1);
+  }
+
   /// Returns the number of disparities searched for a given pixel.
   /// - This gets called a lot, may need to speed it up!
   int get_num_disparities(int col, int row) const {
@@ -228,8 +294,10 @@ private: // Functions
   // The following functions are called from inside compute_disparity_costs()
 
   /// Compute mean of differences within a block of pixels.
+  /// - Fills num_rows output rows starting at first_row into output.
   void fill_costs_block    (ImageView<uint8> const& left_image,
-                            ImageView<uint8> const& right_image);
+                            ImageView<uint8> const& right_image,
+                            int first_row, int num_rows, CostType* output);
   // The following functions use two census transform cost function options
   void fill_costs_census3x3(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image);
   void fill_costs_census5x5(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image);
@@ -237,9 +305,21 @@ private: // Functions
   void fill_costs_census9x9(ImageView<uint8> const& left_image, ImageView<uint8> const& right_image);
 
   /// Used to finish computing the census-based disparity costs in the above functions.
+  /// - Fills m_cost_buffer, or keeps the census images for the low memory accumulation.
+  template <typename T>
+  void use_census_images(ImageView<T> const& left_census,
+                         ImageView<T> const& right_census);
+
+  /// Compute the disparity costs of num_rows output rows starting at first_row
+  ///  from a pair of census images.
   template <typename T>
   void get_hamming_distance_costs(ImageView<T> const& left_binary_image,
-                                  ImageView<T> const& right_binary_image);
+                                  ImageView<T> const& right_binary_image,
+                                  int first_row, int num_rows, CostType* output);
+
+  /// Compute the disparity costs of num_rows output rows starting at first_row
+  ///  from the inputs retained by compute_disparity_costs().
+  void fill_cost_rows(int first_row, int num_rows, CostType* output);
 
   /// Compute the mean and STD of a small image patch.
   /// - Does not perform bounds checking.
@@ -268,6 +348,13 @@ private: // Functions
   /// Generate the output disparity view from the accumulated costs.
   DisparityImage create_disparity_view();
 
+  /// Return the accumulated costs around a disparity for subpixel interpolation.
+  /// - Stored row by row, values past the edge of the search range are
+  ///   replaced by the nearest value inside it.
+  Vector<AccumCostType, 9> get_subpixel_neighbors(AccumCostType const* accum_vec,
+                                                  Vector4i const& bounds,
+                                                  int dx, int dy) const;
+
   /// Select the best disparity index in the accumulation vector.
   /// - If needed, applies smoothing to the values in order to yield a single minimum value.
   int select_best_disparity(AccumCostType * accum_vec,
@@ -308,6 +395,23 @@ private: // Functions
   /// Multi-threaded version of the normal SGM accumulation method;
   void multi_thread_accumulation(ImageView<uint8> const& left_image);
 
+  /// Accumulate the paths and select disparities without the large buffers.
+  DisparityImage low_memory_accumulation(ImageView<uint8> const& left_image);
+
+  /// Compute the four paths which enter an output row from prev_row, the row
+  ///  above or below it, for the low memory accumulation.
+  /// - Path buffers hold the vertical path, the diagonal paths from the first
+  ///   and the last column side and the horizontal path, one after the other.
+  ///   Only the first three are read from prior_paths.
+  /// - If sums is not null the four paths are added to it.
+  void row_path_accumulation(ImageView<uint8> const& left_image,
+                             int row, int prev_row,
+                             CostType      * const costs,
+                             AccumCostType * const prior_paths,
+                             AccumCostType *       paths,
+                             AccumCostType *       sums,
+                             AccumCostType *       full_prior_buffer);
+
   /// Allow this helper class to access private members.
   /// - Some of these classes can be found in SGMAssist.h.
   friend class MultiAccumRowBuffer;
@@ -339,22 +443,6 @@ private: // Functions
     dy += bounds[1];
   }
 
-  // The following functions are inlined for speed
-#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
-  /// Use SSE instructions to simultaneousy compute the scores for up to 8 disparities in evaluate_path()
-  inline void compute_path_internals_sse(uint16* dL, uint16* d0, uint16* d1, uint16* d2, uint16* d3,
-                                         uint16* d4, uint16* d5, uint16* d6, uint16* d7, uint16* d8,
-                                         __m128i& _dJ, __m128i& _dP, __m128i& _dp1, uint16* dRes,
-                                         int sse_index, int &output_index, AccumCostType* output);
-#endif
-
-  /// Non-sse backup for compute_path_internals_sse
-  inline void compute_path_internals(uint16* dL, uint16* d0, uint16* d1, uint16* d2, uint16* d3,
-                                     uint16* d4, uint16* d5, uint16* d6, uint16* d7, uint16* d8,
-                                     AccumCostType dJ, AccumCostType dP, AccumCostType dp1, uint16* dRes,
-                                     int sse_index, int &output_index, AccumCostType* output);
-
-
   /// Given disparity cost and adjacent costs, compute subpixel offset.
   double compute_subpixel_offset(AccumCostType prev, AccumCostType center, AccumCostType next,
                                  bool left_bound=false, bool right_bound=false, bool debug=false);
@@ -395,90 +483,33 @@ calc_disparity_sgm(CostFunctionType cost_type,
 //#################################################################################################
 // Function definitions
 
-#if defined(VW_ENABLE_SSE) && (VW_ENABLE_SSE==1)
-void SemiGlobalMatcher::compute_path_internals_sse(uint16* dL, uint16* d0, uint16* d1, uint16* d2, uint16* d3,
-                                                   uint16* d4, uint16* d5, uint16* d6, uint16* d7, uint16* d8,
-                                                   __m128i& _dJ, __m128i& _dP, __m128i& _dp1, uint16* dRes,
-                                                   int sse_index, int &output_index,
-                                                   AccumCostType*       output) {
-  // Load data from arrays into SSE registers
-  __m128i _dL = _mm_load_si128( (__m128i*) dL );
-  __m128i _d0 = _mm_load_si128( (__m128i*) d0 );
-  __m128i _d1 = _mm_load_si128( (__m128i*) d1 );
-  __m128i _d2 = _mm_load_si128( (__m128i*) d2 );
-  __m128i _d3 = _mm_load_si128( (__m128i*) d3 );
-  __m128i _d4 = _mm_load_si128( (__m128i*) d4 );
-  __m128i _d5 = _mm_load_si128( (__m128i*) d5 );
-  __m128i _d6 = _mm_load_si128( (__m128i*) d6 );
-  __m128i _d7 = _mm_load_si128( (__m128i*) d7 );
-  __m128i _d8 = _mm_load_si128( (__m128i*) d8 );
-
-  // Operation = min( min(d1...d8)+dp1, d0, dJ) + dL - dP
-  
-  // Start computing the min
-  __m128i _min12   = _mm_min_epu16(_d1, _d2);
-  __m128i _min34   = _mm_min_epu16(_d3, _d4);
-  __m128i _min56   = _mm_min_epu16(_d5, _d6);
-  __m128i _min78   = _mm_min_epu16(_d7, _d8);
-  // Keep computing the min
-  __m128i _min1234 = _mm_min_epu16(_min12, _min34);
-  __m128i _min5678 = _mm_min_epu16(_min56, _min78);
-  // Finish computing the min
-  __m128i _minAdj = _mm_min_epu16(_min1234, _min5678);
-  __m128i _minO   = _mm_min_epu16(_d0, _dJ);
- 
-  // Perform the required computations
-  __m128i _result = _mm_adds_epu16(_minAdj, _dp1);
-  _result = _mm_min_epu16(_result, _minO);
-  _result = _mm_adds_epu16(_result, _dL);
-  _result = _mm_subs_epu16(_result, _dP);
-
-  // Fetch results from the output register
-  _mm_store_si128( (__m128i*) dRes, _result );
-
-  // Copy the valid results from the register.
-  for (int i=0; i<sse_index; ++i){
-    output[output_index++] = dRes[i];
-  }
-} // end function compute_path_internals_sse
-#endif
-
-void SemiGlobalMatcher::compute_path_internals(uint16* dL, uint16* d0, uint16* d1, uint16* d2, uint16* d3,
-                                               uint16* d4, uint16* d5, uint16* d6, uint16* d7, uint16* d8,
-                                               AccumCostType dJ, AccumCostType dP, AccumCostType dp1, uint16* dRes,
-                                               int sse_index, int &output_index,
-                                               AccumCostType*       output) {
-  // Operation = min( min(d1...d8)+dp1, d0, dJ) + dL - dP
-
-  for (int i=0; i<sse_index; ++i){
-
-    uint16 minAdj = std::min(d1[i], d2[i]);
-    minAdj = std::min(minAdj, d3[i]);
-    minAdj = std::min(minAdj, d4[i]);
-    minAdj = std::min(minAdj, d5[i]);
-    minAdj = std::min(minAdj, d6[i]);
-    minAdj = std::min(minAdj, d7[i]);
-    minAdj = std::min(minAdj, d8[i]);
-    minAdj += dp1;
-
-    uint16 minVal = std::min(minAdj, d0[i]);
-           minVal = std::min(minVal, dJ);
-    output[output_index++] = minVal + (dL[i] - dP);
-  }
-} // end function compute_path_internals
 
+template <typename T>
+void SemiGlobalMatcher::use_census_images(ImageView<T> const& left_census,
+                                          ImageView<T> const& right_census) {
+  if (!m_use_low_memory) {
+    get_hamming_distance_costs(left_census, right_census,
+                               0, m_num_output_rows, m_cost_buffer.get());
+    return;
+  }
+  // The costs are computed a few rows at a time during the accumulation.
+  m_left_census  = pixel_cast<uint64>(left_census );
+  m_right_census = pixel_cast<uint64>(right_census);
+}
 
 // From the census transformed input images, compute the cost of each disparity value.
 template <typename T>
 void SemiGlobalMatcher::get_hamming_distance_costs(ImageView<T> const& left_binary_image,
-                                                   ImageView<T> const& right_binary_image) {
+                                                   ImageView<T> const& right_binary_image,
+                                                   int first_row, int num_rows, CostType* output) {
 
   const int half_kernel = (m_kernel_size - 1) / 2;
 
   // Now compute the disparity costs for each pixel.
   // Make sure we don't go out of bounds here due to the disparity shift and kernel.
   size_t cost_index = 0;
-  for ( int r = m_min_row; r <= m_max_row; r++ ) { // For each row in left
+  const int end_row = m_min_row + first_row + num_rows - 1;
+  for ( int r = m_min_row + first_row; r <= end_row; r++ ) { // For each row in left
     int output_row = r - m_min_row;
     int binary_row = r - half_kernel;
     for ( int c = m_min_col; c <= m_max_col; c++ ) { // For each column in left
@@ -492,7 +523,7 @@ void SemiGlobalMatcher::get_hamming_distance_costs(ImageView<T> const& left_bina
 
           CostType cost = hamming_distance(left_binary_image (binary_col   , binary_row   ), 
                                            right_binary_image(binary_col+dx, binary_row+dy) );
-          m_cost_buffer[cost_index] = cost;
+          output[cost_index] = cost;
           ++cost_index;
         }
       } // End disparity loops   
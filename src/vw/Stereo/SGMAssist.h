@@ -630,6 +630,7 @@ public:
 
     // Determine the buffer size
     m_num_disp          = parent_ptr->m_num_disp;
+    m_full_prior_size   = parent_ptr->get_full_prior_buffer_size();
     m_buffer_size       = get_buffer_size(parent_ptr);
     m_buffer_size_bytes = m_buffer_size*sizeof(SemiGlobalMatcher::AccumCostType);
 
@@ -641,14 +642,14 @@ public:
 
     // Set up the small buffer
     m_bad_disp_value = parent_ptr->get_bad_accum_val();
-    m_full_prior_buffer.reset(new SemiGlobalMatcher::AccumCostType[m_num_disp]);
+    m_full_prior_buffer.reset(new SemiGlobalMatcher::AccumCostType[m_full_prior_size]);
   }
 
   /// Clear both buffers
   void clear_buffers() {
     memset(m_buffer.get(), 0, m_buffer_size_bytes);
 
-    for (size_t i=0; i<m_num_disp; ++i)
+    for (size_t i=0; i<m_full_prior_size; ++i)
       m_full_prior_buffer[i] = m_bad_disp_value;
   }
 
@@ -666,7 +667,7 @@ public:
 private: // Variables
 
   SemiGlobalMatcher::AccumCostType m_bad_disp_value;
-  size_t m_buffer_size, m_buffer_size_bytes, m_num_disp;
+  size_t m_buffer_size, m_buffer_size_bytes, m_num_disp, m_full_prior_size;
 
   /// Buffer which store the accumulated cost info before it is dumped to the main accum buffer
   boost::shared_array<SemiGlobalMatcher::AccumCostType> m_buffer;
@@ -888,8 +889,8 @@ public:
 
     // Init this buffer to bad scores representing disparities that were
     //  not in the search range for the given pixel. 
-    m_full_prior_buffer.reset(new AccumCostType[parent_ptr->m_num_disp]);
-    for (int i=0; i<parent_ptr->m_num_disp; ++i)
+    m_full_prior_buffer.reset(new AccumCostType[parent_ptr->get_full_prior_buffer_size()]);
+    for (int i=0; i<parent_ptr->get_full_prior_buffer_size(); ++i)
       m_full_prior_buffer[i] = parent_ptr->get_bad_accum_val();  
 
     // Allocate a buffer for the "perpendicular direction" results to be written to
@@ -212,3 +212,88 @@ TEST_F( CorrelationU8, CrossCorrelation ) {
   ASSERT_TRUE( is_valid(disparity(10,10)) );
   CheckResult( disparity );
 }
+
+namespace {
+
+  // The unfused search that best_of_search_convolution used to run, one
+  // full tile pass at a time.
+  template <template<class,bool> class CostFuncT, class PixelT>
+  ImageView<PixelMask<Vector2i> >
+  reference_search( ImageView<PixelT> const& left, ImageView<PixelT> const& right,
+                    Vector2i const& search_volume, Vector2i const& kernel_size ) {
+    typedef ImageView<PixelT> ImageType;
+    typedef CostFuncT<ImageType, boost::is_integral<typename PixelChannelType<PixelT>::type>::value> CostT;
+    typedef typename PixelChannelCast<PixelT,typename CostT::accumulator_type>::type AccumT;
+
+    CostT cost_function( left, right, kernel_size );
+    Vector2i result_size = bounding_box(left).size() - kernel_size + Vector2i(1,1);
+    ImageView<PixelMask<Vector2i> > result( result_size[0], result_size[1] );
+    ImageView<AccumT> best ( result_size[0], result_size[1] );
+    ImageView<AccumT> worst( result_size[0], result_size[1] );
+    for ( int32 dy = 0; dy < search_volume[1]; ++dy ) {
+      for ( int32 dx = 0; dx < search_volume[0]; ++dx ) {
+        ImageView<PixelT> right_crop = crop( right, bounding_box(left) + Vector2i(dx,dy) );
+        ImageView<AccumT> cost = fast_box_sum<typename CostT::accumulator_type>
+          ( cost_function( left, right_crop ), kernel_size );
+        cost_function.cost_modification( cost, Vector2i(dx,dy) );
+        for ( int32 j = 0; j < cost.rows(); ++j ) {
+          for ( int32 i = 0; i < cost.cols(); ++i ) {
+            if ( dx == 0 && dy == 0 ) {
+              best(i,j) = worst(i,j) = cost(i,j);
+              result(i,j) = PixelMask<Vector2i>( Vector2i() );
+            } else if ( cost_function.quality_comparison( cost(i,j), best(i,j) ) ) {
+              best(i,j) = cost(i,j);
+              result(i,j).child() = Vector2i(dx,dy);
+            } else if ( !cost_function.quality_comparison( cost(i,j), worst(i,j) ) ) {
+              worst(i,j) = cost(i,j);
+            }
+          }
+        }
+      }
+    }
+    for ( int32 j = 0; j < result.rows(); ++j )
+      for ( int32 i = 0; i < result.cols(); ++i )
+        if ( best(i,j) == worst(i,j) )
+          invalidate( result(i,j) );
+    return result;
+  }
+
+  template <template<class,bool> class CostFuncT, class PixelT>
+  void check_against_reference() {
+    // Wide enough that the search is split into several strips of rows
+    boost::rand48 gen(7);
+    Vector2i kernel_size(7,5), search_volume(6,4);
+    ImageView<PixelT> left = pixel_cast_rescale<PixelT>( uniform_noise_view( gen, 1200, 70 ) );
+    ImageView<PixelT> right = pixel_cast_rescale<PixelT>( uniform_noise_view( gen, 1205, 73 ) );
+
+    ImageView<PixelMask<Vector2i> > expected =
+      reference_search<CostFuncT>( left, right, search_volume, kernel_size );
+    ImageView<PixelMask<Vector2i> > result =
+      best_of_search_convolution<CostFuncT>( left, right, bounding_box(left),
+                                             search_volume, kernel_size );
+    ASSERT_EQ( expected.cols(), result.cols() );
+    ASSERT_EQ( expected.rows(), result.rows() );
+    int32 mismatches = 0;
+    for ( int32 j = 0; j < result.rows(); ++j )
+      for ( int32 i = 0; i < result.cols(); ++i )
+        if ( is_valid(expected(i,j)) != is_valid(result(i,j)) ||
+             expected(i,j).child() != result(i,j).child() )
+          ++mismatches;
+    // Floating point column sums are restarted at every strip, which can
+    // break a near tie the other way.
+    if ( boost::is_integral<typename PixelChannelType<PixelT>::type>::value )
+      EXPECT_EQ( 0, mismatches );
+    else
+      EXPECT_LE( mismatches, result.cols() * result.rows() / 1000 );
+  }
+}
+
+TEST( Correlation, FusedSearchMatchesReference ) {
+  check_against_reference<AbsoluteCost, PixelGray<uint8> >();
+  check_against_reference<SquaredCost,  PixelGray<uint8> >();
+  check_against_reference<NCCCost,      PixelGray<uint8> >();
+  check_against_reference<AbsoluteCost, PixelGray<float> >();
+  check_against_reference<SquaredCost,  PixelGray<float> >();
+  check_against_reference<NCCCost,      PixelGray<float> >();
+  check_against_reference<AbsoluteCost, int16 >();
+}
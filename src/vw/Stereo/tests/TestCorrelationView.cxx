@@ -310,3 +310,31 @@ TEST_F( CorrelationViewGRAYF32, SubtractedMean ) {
   ASSERT_EQ( input1.rows(), disparity_map.rows() );
   check_error( disparity_map, .966, .99, "Cross Correlation" );
 }
+
+TEST_F( CorrelationViewGRAYU8, SeededSearchRanges ) {
+  // A wide search region, narrowed per tile by the seed
+  CorrelationView<image_type, image_type, NullOperation> view =
+    correlate( input1, input2, NullOperation(),
+               BBox2i(-5,-5,10,10), kernel_size,
+               ABSOLUTE_DIFFERENCE, -1 );
+
+  // Seed with the true disparity at full resolution
+  ImageView<PixelMask<Vector2f> > seed( input1.cols(), input1.rows() );
+  fill( seed, PixelMask<Vector2f>( Vector2f(1,1) ) );
+  view.set_search_ranges( disparity_search_ranges( seed, 1, 8 ), 8 );
+  ImageView<PixelMask<Vector2i> > seeded = block_rasterize( view, Vector2i(8,8), 1 );
+  ASSERT_EQ( input1.cols(), seeded.cols() );
+  ASSERT_EQ( input1.rows(), seeded.rows() );
+  check_error( seeded, .983, .99, "Seeded search" );
+
+  // A seed 5 pixels off the true disparity leaves nothing to find
+  fill( seed, PixelMask<Vector2f>( Vector2f(-4,-4) ) );
+  view.set_search_ranges( disparity_search_ranges( seed, 1, 8 ), 8 );
+  ImageView<PixelMask<Vector2i> > missed = block_rasterize( view, Vector2i(8,8), 1 );
+  int32 count_correct = 0;
+  for ( int32 j = 0; j < missed.rows(); ++j )
+    for ( int32 i = 0; i < missed.cols(); ++i )
+      if ( is_valid(missed(i,j)) && missed(i,j).child() == Vector2i(1,1) )
+        count_correct++;
+  EXPECT_EQ( 0, count_correct );
+}
@@ -218,6 +218,30 @@ TEST( DisparityMap, GetDisparityRange ) {
   EXPECT_VECTOR_EQ( Vector2f(), range.max() );
 }
 
+TEST( DisparityMap, DisparitySearchRanges ) {
+  // Seed at half resolution, blocks of three full resolution pixels
+  ImageView<PixelDisp> seed(3,2);
+  seed(0,0) = PixelDisp(Vector2f(1,0));
+  seed(1,0) = PixelDisp(Vector2f(2,-1));
+  seed(2,0) = PixelDisp(Vector2f(5,5));
+  seed(0,1) = PixelDisp(Vector2f(-3,1));
+  seed(1,1) = PixelDisp(Vector2f(9,9));
+  seed(1,1).invalidate();
+  seed(2,1).invalidate();
+
+  ImageView<Vector4i> ranges = disparity_search_ranges(seed, 2, 3, Vector2i(1,0));
+  ASSERT_EQ( 2, ranges.cols() );
+  ASSERT_EQ( 2, ranges.rows() );
+
+  // Seeds (1,0) and (0,1) straddle two blocks, so block (0,0) sees
+  // (0,0), (1,0) and (0,1). The range is padded by the scale plus the margin.
+  EXPECT_VECTOR_EQ( Vector4i(-6-3,-2-2,4+3,2+2), ranges(0,0) );
+  EXPECT_VECTOR_EQ( Vector4i(4-3,-2-2,10+3,10+2), ranges(1,0) );
+  EXPECT_VECTOR_EQ( Vector4i(-6-3,2-2,-6+3,2+2), ranges(0,1) );
+  // No valid seed at all
+  EXPECT_GT( ranges(1,1)[0], ranges(1,1)[2] );
+}
+
 
 TEST( DisparityMap, DisparityFiltering ) {
   // Create an integer disparity image
@@ -270,3 +294,73 @@ TEST( DisparityMap, DisparityFiltering ) {
   }
   EXPECT_EQ(INVALID_COUNT_ANS, invalid_count);
 }
+
+TEST( DisparityMap, DisparityCleanupMatchesFilters ) {
+  // A sloped disparity with a few outliers and holes
+  const int32 IMAGE_SIZE = 61;
+  ImageView<PixelDisp> image(IMAGE_SIZE, IMAGE_SIZE);
+  for (int32 r=0; r<IMAGE_SIZE; ++r) {
+    for (int32 c=0; c<IMAGE_SIZE; ++c) {
+      image(c,r) = PixelDisp(Vector2f(c/4 + (c*r)%3, r/8));
+      if ((c*7 + r*13) % 29 == 0)
+        image(c,r) = PixelDisp(Vector2f(40 + c%5, -20));
+      if ((c*5 + r*3) % 23 == 0)
+        invalidate(image(c,r));
+    }
+  }
+  fill(crop(image, 20, 30, 4, 5), PixelDisp());
+
+  // Rasterize in small tiles so the halos are exercised.
+  const int32 TILE = 16;
+  const int32 half_kernel = 2;
+  for (int32 pass=0; pass<4; ++pass) {
+    DisparityCleanupParams params(half_kernel, half_kernel);
+    params.remove_isolated_pixels = true;
+    ImageView<PixelDisp> reference;
+    switch (pass) {
+    case 0:
+      params.use_thresh = true;
+      params.thresh_pixel_threshold     = 1.0;
+      params.thresh_rejection_threshold = 0.5;
+      reference = disparity_cleanup_using_thresh(image, half_kernel, half_kernel, 1.0, 0.5);
+      break;
+    case 1:
+      params.use_thresh = true;
+      params.thresh_pixel_threshold     = 2.0;
+      params.thresh_rejection_threshold = 0.4;
+      params.remove_isolated_pixels     = false;
+      reference = rm_outliers_using_thresh(image, half_kernel, half_kernel, 2.0, 0.4);
+      break;
+    case 2:
+      params.use_stddev = true;
+      params.stddev_pixel_threshold     = 2.0;
+      params.stddev_rejection_threshold = 0.5;
+      reference = disparity_cleanup_using_stddev(image, half_kernel, half_kernel, 2.0, 0.5);
+      break;
+    default:
+      params.use_plane = true;
+      params.plane_pixel_threshold     = 2.0;
+      params.plane_rejection_threshold = 0.5;
+      reference = disparity_clean_using_plane(image, half_kernel, half_kernel, 2.0, 0.5);
+    };
+
+    ImageView<PixelDisp> result(IMAGE_SIZE, IMAGE_SIZE);
+    for (int32 r=0; r<IMAGE_SIZE; r+=TILE) {
+      for (int32 c=0; c<IMAGE_SIZE; c+=TILE) {
+        BBox2i tile(c, r, std::min(TILE, IMAGE_SIZE-c), std::min(TILE, IMAGE_SIZE-r));
+        crop(result, tile) = crop(disparity_cleanup(image, params), tile);
+      }
+    }
+
+    int32 num_rejected = 0;
+    for (int32 r=0; r<IMAGE_SIZE; ++r) {
+      for (int32 c=0; c<IMAGE_SIZE; ++c) {
+        ASSERT_EQ(is_valid(reference(c,r)), is_valid(result(c,r)))
+          << "pass " << pass << " at " << c << ", " << r;
+        if (is_valid(image(c,r)) && !is_valid(result(c,r)))
+          ++num_rejected;
+      }
+    }
+    EXPECT_GT(num_rejected, 0) << "pass " << pass;
+  }
+}
@@ -409,3 +409,94 @@ TEST_F( PyramidViewU8, NullPreprocess ) {
   ASSERT_EQ( input1.rows(), disparity_map.rows() );
   check_error( disparity_map, .90, .990, "Cross Correlation" );
 }
+
+TEST_F( PyramidViewGRAYU8, SharedPyramidTiles ) {
+  typedef PerPixelIndexView<ConstantIndexFunctor<uint8> > mask_type;
+  typedef PyramidCorrelationView<image_type, image_type, mask_type, mask_type> view_type;
+  view_type view =
+    pyramid_correlate( input1, input2,
+                       constant_view(uint8(255), input1),
+                       constant_view(uint8(255), input2),
+                       PREFILTER_NONE, 0,
+                       search_volume, kernel_size,
+                       ABSOLUTE_DIFFERENCE,
+                       corr_timeout, seconds_per_op,
+                       2, 0, filter_radius, max_levels );
+  ImageView<PixelMask<Vector2i> > whole = view;
+
+  // Each tile builds its own pyramids by default
+  ImageView<PixelMask<Vector2i> > own = block_rasterize( view, Vector2i(128,128), 2 );
+  check_error( own, .90, .98, "Tile pyramids" );
+
+  // Tiles crop the pyramids that were built for the whole image
+  view.set_shared_pyramids( true );
+  ImageView<PixelMask<Vector2i> > tiled = block_rasterize( view, Vector2i(128,128), 2 );
+  check_error( tiled, .90, .98, "Shared pyramids" );
+
+  // Without nodata or a prefilter the two must agree pixel for pixel
+  for ( int32 j = 0; j < own.rows(); ++j ) {
+    for ( int32 i = 0; i < own.cols(); ++i ) {
+      ASSERT_EQ( is_valid(own(i,j)), is_valid(tiled(i,j)) ) << "at " << i << "," << j;
+      if ( is_valid(own(i,j)) ) {
+        ASSERT_EQ( own(i,j).child(), tiled(i,j).child() ) << "at " << i << "," << j;
+      }
+    }
+  }
+
+  // Searching the zones in parallel does not change the result
+  view.set_zone_threads( 4 );
+  ImageView<PixelMask<Vector2i> > threaded = view;
+  for ( int32 j = 0; j < whole.rows(); ++j ) {
+    for ( int32 i = 0; i < whole.cols(); ++i ) {
+      ASSERT_EQ( is_valid(whole(i,j)), is_valid(threaded(i,j)) );
+      if ( is_valid(whole(i,j)) ) {
+        ASSERT_EQ( whole(i,j).child(), threaded(i,j).child() );
+      }
+    }
+  }
+}
+
+TEST_F( PyramidViewGRAYU8, SeededSearchRanges ) {
+  typedef PerPixelIndexView<ConstantIndexFunctor<uint8> > mask_type;
+  typedef PyramidCorrelationView<image_type, image_type, mask_type, mask_type> view_type;
+  view_type view =
+    pyramid_correlate( input1, input2,
+                       constant_view(uint8(255), input1),
+                       constant_view(uint8(255), input2),
+                       PREFILTER_NONE, 0,
+                       search_volume, kernel_size,
+                       ABSOLUTE_DIFFERENCE,
+                       corr_timeout, seconds_per_op,
+                       2, 0, filter_radius, max_levels );
+
+  // Seed with the true disparity at a quarter of the resolution
+  const int32 seed_scale = 4;
+  ImageView<PixelMask<Vector2f> > seed( input1.cols()/seed_scale, input1.rows()/seed_scale );
+  for ( int32 j = 0; j < seed.rows(); ++j )
+    for ( int32 i = 0; i < seed.cols(); ++i ) {
+      Vector2 location( i*seed_scale, j*seed_scale );
+      seed(i,j) = PixelMask<Vector2f>( (scale*location + translation - location) / seed_scale );
+    }
+
+  view.set_search_ranges( disparity_search_ranges( seed, seed_scale, 32 ), 32 );
+  ImageView<PixelMask<Vector2i> > seeded = block_rasterize( view, Vector2i(64,64), 2 );
+  check_error( seeded, .90, .98, "Seeded search" );
+
+  // A seed that is 20 pixels off the true disparity leaves nothing to
+  // find. It is moved towards the middle of the search region, changing
+  // direction at a tile boundary.
+  for ( int32 j = 0; j < seed.rows(); ++j )
+    for ( int32 i = 0; i < seed.cols(); ++i )
+      seed(i,j).child()[0] += ( i*seed_scale < 128 ) ? -20.0/seed_scale : 20.0/seed_scale;
+  view.set_search_ranges( disparity_search_ranges( seed, seed_scale, 32 ), 32 );
+  ImageView<PixelMask<Vector2i> > missed = block_rasterize( view, Vector2i(64,64), 2 );
+  int32 count_correct = 0;
+  for ( int32 j = 0; j < missed.rows(); ++j )
+    for ( int32 i = 0; i < missed.cols(); ++i ) {
+      Vector2 objectf = scale*Vector2(i,j)+translation - Vector2(i,j);
+      if ( is_valid(missed(i,j)) &&
+           missed(i,j).child() == Vector2i( round(objectf[0]), round(objectf[1]) ) )
+        count_correct++;
+    }
+  EXPECT_LT( count_correct, missed.cols()*missed.rows()/10 );
+}
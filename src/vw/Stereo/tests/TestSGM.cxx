@@ -20,6 +20,8 @@
 #include <vw/Image/EdgeExtension.h>
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Stereo/SGM.h>
+#include <vw/Image/UtilityViews.h>
+#include <boost/random/linear_congruential.hpp>
 
 using namespace vw;
 using namespace vw::stereo;
@@ -73,3 +75,106 @@ TEST( SGM, constant_offset ) {
   EXPECT_GT(percent_correct, 0.99);
 }
 
+
+TEST( SGM, simd_levels_match ) {
+
+  // The right image is the left one moved by (5,3)
+  boost::rand48 gen(10);
+  ImageView<uint8> base = pixel_cast<uint8>(255*uniform_noise_view(gen, 120, 100));
+  ImageView<uint8> left  = crop(base, 5, 3, 100, 80);
+  ImageView<uint8> right = crop(base, 0, 0, 109, 85);
+
+  // Searching around a half resolution disparity gives every pixel a
+  //  smaller range than the whole search range.
+  SemiGlobalMatcher::DisparityImage prev_disparity(50, 40);
+  fill(prev_disparity, PixelMask<Vector2i>(Vector2i(2,1)));
+
+  for (int pass=0; pass<4; ++pass) {
+    const bool use_mgm  = (pass % 2 == 1);
+    const bool use_prev = (pass > 1);
+
+    SemiGlobalMatcher::DisparityImage reference;
+    for (int level=SemiGlobalMatcher::SIMD_NONE; level<=SemiGlobalMatcher::max_simd_level(); ++level) {
+      SemiGlobalMatcher matcher(CENSUS_TRANSFORM, use_mgm, 0, 0, 8, 4, 5,
+                                SemiGlobalMatcher::SUBPIXEL_NONE, Vector2i(2,2), 512);
+      matcher.set_simd_level(SemiGlobalMatcher::SimdLevel(level));
+      SemiGlobalMatcher::DisparityImage result
+        = matcher.semi_global_matching_func(left, right, 0, 0, use_prev ? &prev_disparity : 0);
+
+      if (level == SemiGlobalMatcher::SIMD_NONE) {
+        reference = result;
+        int num_correct = 0;
+        for (int row=0; row<result.rows(); ++row)
+          for (int col=0; col<result.cols(); ++col)
+            if (is_valid(result(col,row)) && result(col,row).child() == Vector2i(5,3))
+              ++num_correct;
+        EXPECT_GT(num_correct, 0.9*result.cols()*result.rows()) << "pass " << pass;
+        continue;
+      }
+      ASSERT_EQ(reference.cols(), result.cols());
+      ASSERT_EQ(reference.rows(), result.rows());
+      for (int row=0; row<result.rows(); ++row)
+        for (int col=0; col<result.cols(); ++col) {
+          ASSERT_EQ(is_valid(reference(col,row)), is_valid(result(col,row)))
+            << "level " << level << " pass " << pass;
+          ASSERT_EQ(reference(col,row).child(), result(col,row).child())
+            << "level " << level << " pass " << pass;
+        }
+    }
+  }
+}
+
+TEST( SGM, low_memory_matches ) {
+
+  // The right image is the left one moved by (5,3)
+  boost::rand48 gen(20);
+  ImageView<uint8> base = pixel_cast<uint8>(255*uniform_noise_view(gen, 120, 100));
+  ImageView<uint8> left  = crop(base, 5, 3, 100, 80);
+  ImageView<uint8> right = crop(base, 0, 0, 109, 85);
+
+  // A varying half resolution disparity gives each pixel a different search range.
+  SemiGlobalMatcher::DisparityImage prev_disparity(50, 40);
+  for (int row=0; row<prev_disparity.rows(); ++row)
+    for (int col=0; col<prev_disparity.cols(); ++col)
+      prev_disparity(col,row) = PixelMask<Vector2i>(Vector2i(2+col%2, 1+row%2));
+
+  for (int pass=0; pass<4; ++pass) {
+    const CostFunctionType cost_type = (pass % 2 == 0) ? CENSUS_TRANSFORM : ABSOLUTE_DIFFERENCE;
+    const int  kernel_size = (pass % 2 == 0) ? 5 : 3;
+    const bool use_prev    = (pass > 1);
+
+    // Masked pixels have no search range at all.
+    // - The mask covers the output pixels, whose size depends on the kernel size.
+    const int half_kernel = kernel_size / 2;
+    ImageView<uint8> left_mask(std::min(left.cols()-1-half_kernel, right.cols()-1-half_kernel-8) - half_kernel + 1,
+                               std::min(left.rows()-1-half_kernel, right.rows()-1-half_kernel-4) - half_kernel + 1);
+    fill(left_mask, 255);
+    fill(crop(left_mask, 40, 30, 10, 8), 0);
+
+    SemiGlobalMatcher normal(cost_type, false, 0, 0, 8, 4, kernel_size,
+                             SemiGlobalMatcher::SUBPIXEL_PARABOLA, Vector2i(2,2), 512);
+    SemiGlobalMatcher::DisparityImage reference
+      = normal.semi_global_matching_func(left, right, &left_mask, 0, use_prev ? &prev_disparity : 0);
+    ImageView<PixelMask<Vector2f> > reference_subpixel = normal.create_disparity_view_subpixel(reference);
+
+    SemiGlobalMatcher low_memory(cost_type, false, 0, 0, 8, 4, kernel_size,
+                                 SemiGlobalMatcher::SUBPIXEL_PARABOLA, Vector2i(2,2), 512);
+    low_memory.set_low_memory_mode(true);
+    SemiGlobalMatcher::DisparityImage result
+      = low_memory.semi_global_matching_func(left, right, &left_mask, 0, use_prev ? &prev_disparity : 0);
+    ImageView<PixelMask<Vector2f> > result_subpixel = low_memory.create_disparity_view_subpixel(result);
+
+    ASSERT_EQ(reference.cols(), result.cols());
+    ASSERT_EQ(reference.rows(), result.rows());
+    int num_correct = 0;
+    for (int row=0; row<result.rows(); ++row)
+      for (int col=0; col<result.cols(); ++col) {
+        ASSERT_EQ(is_valid(reference(col,row)), is_valid(result(col,row))) << "pass " << pass;
+        ASSERT_EQ(reference(col,row).child(), result(col,row).child()) << "pass " << pass;
+        EXPECT_EQ(reference_subpixel(col,row).child(), result_subpixel(col,row).child()) << "pass " << pass;
+        if (is_valid(result(col,row)) && result(col,row).child() == Vector2i(5,3))
+          ++num_correct;
+      }
+    EXPECT_GT(num_correct, 0.8*result.cols()*result.rows()) << "pass " << pass;
+  }
+}
@@ -75,8 +75,6 @@ double V2Dot(Vector2 *a, Vector2 *b);
 double V2SquaredLength(Vector2 *a);
 double V2Length(Vector2 *a);
 
-#define MAXPOINTS   100000      /* The most points you can have */
-
 void DrawBezierCurve(int n, BezierCurve bcurve, BezierContour &bc)
 {
     int i;
@@ -237,7 +235,7 @@ static BezierCurve  GenerateBezier(Point2 *d, int first, int last, double *uPrim
         Vector2 tHat1, Vector2 tHat2)
 {
     int     i;
-    Vector2     A[MAXPOINTS][2];    /* Precomputed rhs for eqn  */
+    Vector2     (*A)[2];        /* Precomputed rhs for eqn  */
     int     nPts;           /* Number of pts in sub-curve */
     double  C[2][2];            /* Matrix C     */
     double  X[2];           /* Matrix X         */
@@ -251,6 +249,8 @@ static BezierCurve  GenerateBezier(Point2 *d, int first, int last, double *uPrim
 
     bezCurve = (Point2 *)malloc(4 * sizeof(Point2));
     nPts = last - first + 1;
+    /* On the heap, as contours may be fit on threads with small stacks */
+    A = (Vector2 (*)[2])malloc(nPts * sizeof(*A));
 
 
     /* Compute the A's  */
@@ -292,6 +292,7 @@ static BezierCurve  GenerateBezier(Point2 *d, int first, int last, double *uPrim
         X[0] += V2Dot(&A[i][0], &tmp);
         X[1] += V2Dot(&A[i][1], &tmp);
     }
+    free((void *)A);
 
     /* Compute the determinants of C and X  */
     det_C0_C1 = C[0][0] * C[1][1] - C[1][0] * C[0][1];
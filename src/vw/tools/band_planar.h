@@ -0,0 +1,291 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+#ifndef __VW_BAND_PLANAR_H__
+#define __VW_BAND_PLANAR_H__
+
+#include <cmath>
+#include <vector>
+#include <vw/Image/ImageView.h>
+#include <vw/Image/ImageViewBase.h>
+#include <vw/Image/Manipulation.h>
+#include <vw/Image/PixelAccessors.h>
+#include <vw/Image/PixelMask.h>
+
+/**
+  Band-planar processing of multispectral images for the flood detection tools.
+
+  A per-pixel functor sees one masked Vector pixel at a time and branches on
+  its validity and on each test.  Here a tile is copied into one contiguous
+  float array per band plus a validity byte per pixel, and each step of an
+  algorithm is a loop over whole bands without branches in its body, which
+  the compiler vectorizes.  A BandPlanarView runs such a kernel on each tile
+  as it is rasterized, so it drops into the same block_write_gdal_image()
+  pipelines as per_pixel_view().
+*/
+
+namespace vw {
+namespace band_planar {
+
+//=============================================================================
+// Tiles
+
+/// A tile of a multispectral image, stored one band after another.
+class BandTile {
+public:
+  BandTile() : m_cols(0), m_rows(0), m_num_bands(0) {}
+
+  void set_size(int32 cols, int32 rows, int32 num_bands) {
+    m_cols      = cols;
+    m_rows      = rows;
+    m_num_bands = num_bands;
+    m_bands.resize(num_pixels()*num_bands);
+    m_valid.resize(num_pixels());
+  }
+
+  int32  cols      () const { return m_cols;      }
+  int32  rows      () const { return m_rows;      }
+  int32  num_bands () const { return m_num_bands; }
+  size_t num_pixels() const { return size_t(m_cols)*size_t(m_rows); }
+
+  /// The values of one band, in row-major order.
+  float      * band(int32 b)       { return &m_bands[num_pixels()*b]; }
+  float const* band(int32 b) const { return &m_bands[num_pixels()*b]; }
+
+  /// One byte per pixel, nonzero where the pixel is valid.
+  uint8      * valid()       { return &m_valid[0]; }
+  uint8 const* valid() const { return &m_valid[0]; }
+
+private:
+  int32 m_cols, m_rows, m_num_bands;
+  std::vector<float> m_bands;
+  std::vector<uint8> m_valid;
+};
+
+namespace detail {
+
+  /// How a tile is filled from each pixel type: plain or masked, scalar or Vector.
+  template <class PixelT>
+  struct BandPixel {
+    static const int32 num_bands = 1;
+    static bool  valid(PixelT const&)          { return true; }
+    static float value(PixelT const& p, int32) { return float(p); }
+  };
+
+  template <class ChannelT, size_t N>
+  struct BandPixel<Vector<ChannelT, N> > {
+    static const int32 num_bands = N;
+    static bool  valid(Vector<ChannelT, N> const&)            { return true; }
+    static float value(Vector<ChannelT, N> const& p, int32 b) { return float(p[b]); }
+  };
+
+  template <class ChildT>
+  struct BandPixel<PixelMask<ChildT> > {
+    static const int32 num_bands = BandPixel<ChildT>::num_bands;
+    static bool  valid(PixelMask<ChildT> const& p)          { return is_valid(p); }
+    static float value(PixelMask<ChildT> const& p, int32 b) { return BandPixel<ChildT>::value(p.child(), b); }
+  };
+
+} // end namespace detail
+
+/// Copies an image of scalar or Vector pixels, masked or not, into a tile.
+template <class PixelT>
+void load_tile(ImageView<PixelT> const& pixels, BandTile &tile) {
+  typedef detail::BandPixel<PixelT> traits;
+  tile.set_size(pixels.cols(), pixels.rows(), traits::num_bands);
+
+  uint8* valid = tile.valid();
+  float* bands[traits::num_bands];
+  for (int32 b=0; b<traits::num_bands; ++b)
+    bands[b] = tile.band(b);
+
+  size_t i = 0;
+  for (int32 r=0; r<pixels.rows(); ++r) {
+    for (int32 c=0; c<pixels.cols(); ++c, ++i) {
+      PixelT const& pixel = pixels(c,r);
+      valid[i] = traits::valid(pixel);
+      for (int32 b=0; b<traits::num_bands; ++b)
+        bands[b][i] = traits::value(pixel, b);
+    }
+  }
+}
+
+//=============================================================================
+// Kernels
+// - Those that stand in for a scalar function of the tools give exactly the
+//   same values, so both paths classify pixels the same way.
+// - Divisions are made unconditional on a safe denominator, so that the
+//   selects that follow them do not stop the loop from being vectorized.
+
+/// v = v*gain + offset, as in the conversion of digital numbers to radiance.
+inline void scale_offset(float *v, size_t n, float gain, float offset) {
+  for (size_t i=0; i<n; ++i)
+    v[i] = v[i]*gain + offset;
+}
+
+/// out = (a - b) / (a + b), or zero_value where a + b is zero, as compute_index().
+inline void normalized_difference(float const* a, float const* b, float *out, size_t n,
+                                  float zero_value) {
+  for (size_t i=0; i<n; ++i) {
+    float sum   = a[i] + b[i];
+    float denom = sum + float(sum == 0); // sum, or 1 where it is zero
+    float q     = (a[i] - b[i]) / denom;
+    out[i] = (sum == 0) ? zero_value : q;
+  }
+}
+
+/// out = rescale_to_01(v, min, max)
+inline void rescale_to_01(float const* v, float *out, size_t n, float min, float max) {
+  float rng = max - min;
+  for (size_t i=0; i<n; ++i)
+    out[i] = (v[i] - min) / rng;
+}
+
+/// v = clamp01(v)
+inline void clamp01(float *v, size_t n) {
+  for (size_t i=0; i<n; ++i)
+    v[i] = (v[i] > 1.0f) ? 1.0f : ((v[i] < 0.0f) ? 0.0f : v[i]);
+}
+
+/// acc = std::min(acc, v)
+inline void min_into(float *acc, float const* v, size_t n) {
+  for (size_t i=0; i<n; ++i)
+    acc[i] = (v[i] < acc[i]) ? v[i] : acc[i];
+}
+
+/// Standard Z shaped fuzzy membership function between a and b,
+/// as radar::FuzzyMembershipZFunctor.
+inline void fuzzy_membership_z(float const* v, float *out, size_t n, float a, float b) {
+  const float c = (a+b)/2.0, dba = b-a;
+  for (size_t i=0; i<n; ++i) {
+    double lo = (v[i] - a) / dba;
+    double hi = (v[i] - b) / dba;
+    out[i] = (v[i] < a) ? 1.0f :
+             (v[i] < c) ? float(1.0 - 2.0*(lo*lo)) :
+             (v[i] < b) ? float(2.0*(hi*hi)) : 0.0f;
+  }
+}
+
+/// Standard S shaped fuzzy membership function between a and b,
+/// as radar::FuzzyMembershipSFunctor.
+inline void fuzzy_membership_s(float const* v, float *out, size_t n, float a, float b) {
+  const float c = (a+b)/2.0, dba = b-a;
+  for (size_t i=0; i<n; ++i) {
+    double lo = (v[i] - a) / dba;
+    double hi = (v[i] - b) / dba;
+    out[i] = (v[i] < a) ? 0.0f :
+             (v[i] < c) ? float(2.0*(lo*lo)) :
+             (v[i] < b) ? float(1.0 - 2.0*(hi*hi)) : 1.0f;
+  }
+}
+
+/// v = 10*log10(v), the conversion of radar amplitudes to decibels.
+inline void to_decibels(float *v, size_t n) {
+  for (size_t i=0; i<n; ++i)
+    v[i] = float(10*log10(double(v[i])));
+}
+
+/// Where valid, out = (v > threshold) ? above : below, and elsewhere nodata.
+inline void classify(float const* v, uint8 const* valid, uint8 *out, size_t n,
+                     float threshold, uint8 above, uint8 below, uint8 nodata) {
+  for (size_t i=0; i<n; ++i) {
+    uint8 label = (v[i] > threshold) ? above : below;
+    out[i] = valid[i] ? label : nodata;
+  }
+}
+
+/// Where valid, out = v, and elsewhere nodata.
+inline void mask_to_value(float const* v, uint8 const* valid, float *out, size_t n, float nodata) {
+  for (size_t i=0; i<n; ++i) {
+    float value = v[i];
+    out[i] = valid[i] ? value : nodata;
+  }
+}
+
+/// out = PixelMask<float>(v), with the validity of the tile.
+inline void to_masked(float const* v, uint8 const* valid, PixelMask<float> *out, size_t n) {
+  for (size_t i=0; i<n; ++i) {
+    out[i] = PixelMask<float>(v[i]);
+    if (!valid[i])
+      invalidate(out[i]);
+  }
+}
+
+//=============================================================================
+// Views
+
+/// Runs a kernel on each tile of an image as it is rasterized.
+/// - The kernel is called as kernel(tile, out), with the tile loaded from the
+///   image, and writes one result_type value per pixel of the tile to out in
+///   row-major order.  It may overwrite the tile.
+/// - Tiles are independent, so the kernel must not keep state between them.
+template <class ImageT, class KernelT>
+class BandPlanarView : public ImageViewBase<BandPlanarView<ImageT, KernelT> > {
+  ImageT  m_image;
+  KernelT m_kernel;
+
+public:
+  typedef typename KernelT::result_type pixel_type;
+  typedef pixel_type                    result_type;
+  typedef ProceduralPixelAccessor<BandPlanarView<ImageT, KernelT> > pixel_accessor;
+
+  BandPlanarView(ImageT const& image, KernelT const& kernel)
+    : m_image(image), m_kernel(kernel) {}
+
+  inline int32 cols  () const { return m_image.cols(); }
+  inline int32 rows  () const { return m_image.rows(); }
+  inline int32 planes() const { return 1; }
+
+  inline pixel_accessor origin() const { return pixel_accessor( *this, 0, 0 ); }
+
+  /// Computes a single pixel as a tile of its own, which is slow.
+  inline result_type operator()( int32 i, int32 j, int32 p=0 ) const {
+    return prerasterize(BBox2i(i, j, 1, 1))(i, j, p);
+  }
+
+  typedef CropView<ImageView<pixel_type> > prerasterize_type;
+  inline prerasterize_type prerasterize( BBox2i const& bbox ) const {
+    ImageView<pixel_type> result(bbox.width(), bbox.height());
+    if (!bbox.empty()) {
+      ImageView<typename ImageT::pixel_type> pixels = crop(m_image, bbox);
+      BandTile tile;
+      load_tile(pixels, tile);
+      m_kernel(tile, &result(0,0));
+    }
+    // Fake borders to make the tile look the size of the entire image
+    return prerasterize_type(result, -bbox.min().x(), -bbox.min().y(), cols(), rows());
+  }
+
+  template <class DestT>
+  inline void rasterize( DestT const& dest, BBox2i const& bbox ) const {
+    vw::rasterize( prerasterize(bbox), dest, bbox );
+  }
+}; // End class BandPlanarView
+
+/// Use this to run a kernel over an image like this:
+/// --> = band_planar_view(image, landsat::DetectWaterLandsatKernel(metadata));
+template <class ImageT, class KernelT>
+BandPlanarView<ImageT, KernelT>
+band_planar_view(ImageViewBase<ImageT> const& image, KernelT const& kernel) {
+  return BandPlanarView<ImageT, KernelT>(image.impl(), kernel);
+}
+
+
+}} // end namespace vw::band_planar
+
+#endif
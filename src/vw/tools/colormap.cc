@@ -130,8 +130,10 @@ void do_colormap(Options& opt) {
   ImageViewRef<PixelGray<float> > input_image =
     pixel_cast<PixelGray<float> >(select_channel(disk_img_file,0));
   if (opt.min_val == 0 && opt.max_val == 0) {
-    min_max_channel_values( create_mask( input_image, opt.nodata_value),
-                            opt.min_val, opt.max_val);
+    // One tiled, multi-threaded pass over the image.
+    ChannelStatistics stats = channel_statistics( create_mask( input_image, opt.nodata_value) );
+    opt.min_val = stats.minimum();
+    opt.max_val = stats.maximum();
     vw_out() << "\t--> Image color map range: ["
              << opt.min_val << "  " << opt.max_val << "]\n";
   } else {
@@ -31,6 +31,7 @@
 #include <utility>
 #include <vw/Image.h>
 #include <cmath>
+#include <limits>
 
 #include "contour.h"
 
@@ -290,9 +291,130 @@ void chord_length_parameterize(PointContour c, PointContour::iterator first, Poi
     }
 }
 
-void conrec(vw::ImageView<float>& dem, PointContourSet& cset,
+ContourJoiner::ContourList::iterator
+ContourJoiner::find_end(int level, ContourPoint const& p) {
+    EndMap::iterator iter = m_ends.find(key(level, p));
+    return iter == m_ends.end() ? m_open.end() : iter->second;
+}
+
+void ContourJoiner::add_ends(ContourList::iterator c) {
+    m_ends.insert(std::make_pair(key(c->first, c->second.front()), c));
+    m_ends.insert(std::make_pair(key(c->first, c->second.back()), c));
+}
+
+void ContourJoiner::remove_ends(ContourList::iterator c) {
+    for (int end = 0; end < 2; end++) {
+        EndKey k = key(c->first, end ? c->second.back() : c->second.front());
+        std::pair<EndMap::iterator, EndMap::iterator> range = m_ends.equal_range(k);
+        for (EndMap::iterator iter = range.first; iter != range.second; ++iter) {
+            if (iter->second == c) {
+                m_ends.erase(iter);
+                break;
+            }
+        }
+    }
+}
+
+void ContourJoiner::add_segment(ContourSegment const& s) {
+    if (s.a == s.b) return;
+
+    ContourList::iterator ca = find_end(s.level, s.a);
+    ContourList::iterator cb = find_end(s.level, s.b);
+
+    if (ca == m_open.end() && cb == m_open.end()) {
+        PointContour c;
+        c.push_back(s.a);
+        c.push_back(s.b);
+        add_ends(m_open.insert(m_open.end(), std::make_pair(s.level, c)));
+        return;
+    }
+
+    if (ca == m_open.end() || cb == m_open.end()) {
+        // Extend the one contour that the segment touches
+        ContourList::iterator c = (ca != m_open.end()) ? ca : cb;
+        ContourPoint const& touch = (ca != m_open.end()) ? s.a : s.b;
+        ContourPoint const& other = (ca != m_open.end()) ? s.b : s.a;
+        remove_ends(c);
+        if (c->second.back() == touch)
+            c->second.push_back(other);
+        else
+            c->second.push_front(other);
+        add_ends(c);
+        return;
+    }
+
+    remove_ends(ca);
+    if (ca == cb) {
+        // The segment closes the contour
+        ca->second.push_back(ca->second.back() == s.a ? s.b : s.a);
+        m_closed.splice(m_closed.end(), m_open, ca);
+        return;
+    }
+
+    // The segment bridges two contours. The shorter one is turned, if
+    // need be, to run on from the end of the longer one.
+    remove_ends(cb);
+    PointContour& c1 = ca->second;
+    PointContour& c2 = cb->second;
+    ContourPoint const& p1 = s.a;
+    ContourPoint const& p2 = s.b;
+    if (c1.size() >= c2.size()) {
+        if (c1.back() == p1) {
+            if (c2.front() != p2) c2.reverse();
+            c1.splice(c1.end(), c2);
+        } else {
+            if (c2.back() != p2) c2.reverse();
+            c1.splice(c1.begin(), c2);
+        }
+        add_ends(ca);
+        m_open.erase(cb);
+    } else {
+        if (c2.back() == p2) {
+            if (c1.front() != p1) c1.reverse();
+            c2.splice(c2.end(), c1);
+        } else {
+            if (c1.back() != p1) c1.reverse();
+            c2.splice(c2.begin(), c1);
+        }
+        add_ends(cb);
+        m_open.erase(ca);
+    }
+}
+
+void ContourJoiner::take_finished(double row, PointContourSet& cset) {
+    for (ContourList::iterator c = m_closed.begin(); c != m_closed.end(); ++c)
+        cset.insert(*c);
+    m_closed.clear();
+
+    ContourList::iterator c = m_open.begin();
+    while (c != m_open.end()) {
+        if (c->second.front()[1] < row && c->second.back()[1] < row) {
+            remove_ends(c);
+            cset.insert(*c);
+            c = m_open.erase(c);
+        } else {
+            ++c;
+        }
+    }
+}
+
+void ContourJoiner::take_all(PointContourSet& cset) {
+    take_finished(std::numeric_limits<double>::infinity(), cset);
+}
+
+void conrec(vw::ImageView<float>& dem, PointContourSet& /*cset*/,
                     int cint, float nodataval,
                     std::list<ContourSegment>& seglist) {
+    vw::vw_out(vw::InfoMessage, "console") << "Running CONREC\n";
+    vw::vw_out(vw::DebugMessage, "console") << "\tFinding contours\n";
+    conrec(dem, vw::Vector2i(0, 0), cint, nodataval, seglist);
+    vw::vw_out(vw::DebugMessage, "console")
+        << "\tCONREC found " << seglist.size() << " segments" << std::endl;
+}
+
+void conrec(vw::ImageView<float> const& dem, vw::Vector2i const& origin,
+            int cint, float nodataval,
+            std::list<ContourSegment>& seglist) {
     int m1,m2,m3,case_value;
     double zmin,zmax;
     register int c,i,j,m;
@@ -304,10 +426,7 @@ void conrec(vw::ImageView<float>& dem, PointContourSet& cset,
         { { {0,0,8},{0,2,5},{7,6,9} },
           { {0,3,4},{1,3,1},{4,3,0} },
           { {9,6,7},{5,2,0},{8,0,0} } };
-    ContourSegment seg;
 
-    vw::vw_out(vw::InfoMessage, "console") << "Running CONREC\n";
-    vw::vw_out(vw::DebugMessage, "console") << "\tFinding contours\n";
     for (i=0; i < dem.cols()-1; i++) {
         for (j=0; j < dem.rows()-1; j++) {
             zmin = min_nodata( min_nodata(dem(i,j),   dem(i,j+1),   nodataval),
@@ -334,13 +453,13 @@ void conrec(vw::ImageView<float>& dem, PointContourSet& cset,
                             h[0] += h[m];
                             goodvals++;
                         }
-                        xh[m] = i + im[m-1];
-                        yh[m] = j + jm[m-1];
+                        xh[m] = origin[0] + i + im[m-1];
+                        yh[m] = origin[1] + j + jm[m-1];
                         //printf("h[%d]: %0.2f (%0.2f)\n",m,dem(i+im[m-1],j+jm[m-1]),h[m]);
                     } else {
                         h[0] /= goodvals;
-                        xh[0] = i + 0.5;
-                        yh[0] = j + 0.5;
+                        xh[0] = origin[0] + i + 0.5;
+                        yh[0] = origin[1] + j + 0.5;
                         //printf("h[%d]: ... (%0.2f)\n",m,h[m]);
                     }
 
@@ -469,8 +588,6 @@ void conrec(vw::ImageView<float>& dem, PointContourSet& cset,
             }
         }
     }
-    vw::vw_out(vw::DebugMessage, "console")
-        << "\tCONREC found " << seglist.size() << " segments" << std::endl;
 }
 
 
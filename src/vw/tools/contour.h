@@ -60,6 +60,48 @@ typedef std::list<VWBezierCurve> BezierContour;
 typedef std::multimap<int, BezierContour > BezierContourSet;
 
 void add_segment(PointContourSet& cset, ContourSegment& s);
+
+/*
+ * Joins contour segments into contours as they come, and hands back the
+ * contours that are finished. Segments join where their end points are
+ * equal, which is exact for the segments conrec() finds in neighboring
+ * cells, as both compute the point from the same two pixels.
+ *
+ * Each join costs a lookup by end point, so that the segments of a large
+ * DEM can be fed in a strip of rows at a time, the finished contours
+ * taken out after each strip, and only the contours still open across
+ * the front kept.
+ */
+class ContourJoiner {
+public:
+    void add_segment(ContourSegment const& s);
+
+    // Moves into cset the contours which are closed, or whose two ends
+    // lie above the given row, so that no segment found from that row
+    // on can reach them.
+    void take_finished(double row, PointContourSet& cset);
+
+    // Moves all contours into cset.
+    void take_all(PointContourSet& cset);
+
+    size_t num_open() const { return m_open.size(); }
+
+private:
+    typedef std::list<std::pair<int, PointContour> > ContourList;
+    typedef std::pair<int, std::pair<double, double> > EndKey;
+    typedef std::multimap<EndKey, ContourList::iterator> EndMap;
+
+    static EndKey key(int level, ContourPoint const& p) {
+        return EndKey(level, std::make_pair(p[0], p[1]));
+    }
+    ContourList::iterator find_end(int level, ContourPoint const& p);
+    void add_ends(ContourList::iterator c);
+    void remove_ends(ContourList::iterator c);
+
+    ContourList m_open;    // open contours, with both ends in m_ends
+    ContourList m_closed;  // closed contours, not yet taken
+    EndMap m_ends;
+};
 bool join(PointContour& c1, PointContour& c2);
 vw::Vector2 tangent(const PointContour c, PointContour::iterator p);
 void chord_length_parameterize(PointContour c,
@@ -72,4 +114,12 @@ void chord_length_parameterize(PointContour c,
 void conrec(vw::ImageView<float>& dem, PointContourSet& cset,
             int cint, float nodataval, std::list<ContourSegment>& seglist);
 
+// Finds the contour segments in the cells of a tile of the DEM, whose
+// top-left pixel is at origin in the whole DEM. A tile covering the
+// cells of the rectangle [x0, x1) x [y0, y1) must hold the pixels of
+// [x0, x1] x [y0, y1]. The segments are in the coordinates of the DEM
+// and are appended to seglist.
+void conrec(vw::ImageView<float> const& dem, vw::Vector2i const& origin,
+            int cint, float nodataval, std::list<ContourSegment>& seglist);
+
 
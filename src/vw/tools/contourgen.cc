@@ -31,13 +31,17 @@
 
 //#include <boost/algorithm/minmax_element.hpp>
 #include <boost/program_options.hpp>
+#include <boost/shared_ptr.hpp>
 
 #include <vw/Core/Log.h>
 #include <vw/Core/ProgressCallback.h>
+#include <vw/Core/Settings.h>
+#include <vw/Core/ThreadPool.h>
 #include <vw/Image.h>
 #include <vw/FileIO.h>
 
 #include <cmath>
+#include <vector>
 
 #include "contour.h"
 
@@ -46,12 +50,55 @@ namespace po = boost::program_options;
 // fwd declaration of function in FitCurves.cpp
 BezierContour FitCurve(PointContour &contour, double error);
 
-vw::ImageView<float> load_dem_from_file(std::string file_in) {
-    //    Open the file for reading
-    vw::ImageView<float> dem;
+// Finds the contour segments in one tile of cells of the DEM. The
+// pixels of the row and column past the last cells, which the tile
+// shares with its neighbors, are read along with it.
+class ConrecTileTask : public vw::Task {
+    vw::DiskImageView<float> const& m_dem;
+    vw::BBox2i m_cells;
+    int m_cint;
+    float m_nodataval;
+    SegmentList& m_segments;
+
+public:
+    ConrecTileTask(vw::DiskImageView<float> const& dem, vw::BBox2i const& cells,
+                   int cint, float nodataval, SegmentList& segments)
+        : m_dem(dem), m_cells(cells), m_cint(cint), m_nodataval(nodataval),
+          m_segments(segments) {}
+    virtual ~ConrecTileTask() {}
+
+    virtual void operator()() {
+        vw::BBox2i pixels(m_cells.min(), m_cells.max() + vw::Vector2i(1, 1));
+        vw::ImageView<float> tile = vw::crop(m_dem, pixels);
+        conrec(tile, pixels.min(), m_cint, m_nodataval, m_segments);
+    }
+};
+
+// Fits Bezier curves to a range of contours.
+class FitCurvesTask : public vw::Task {
+    std::vector<PointContourSet::iterator> const& m_contours;
+    std::vector<BezierContour>& m_curves;
+    size_t m_begin, m_end;
+    double m_error;
+
+public:
+    FitCurvesTask(std::vector<PointContourSet::iterator> const& contours,
+                  std::vector<BezierContour>& curves,
+                  size_t begin, size_t end, double error)
+        : m_contours(contours), m_curves(curves), m_begin(begin), m_end(end),
+          m_error(error) {}
+    virtual ~FitCurvesTask() {}
+
+    virtual void operator()() {
+        for (size_t i = m_begin; i < m_end; i++)
+            m_curves[i] = FitCurve(m_contours[i]->second, m_error);
+    }
+};
+
+vw::DiskImageView<float> open_dem_file(std::string file_in) {
     boost::shared_ptr<vw::DiskImageResource> r( vw::DiskImageResourcePtr(file_in) );
-    
-    vw::vw_out(vw::InfoMessage) << "Loading DEM from file" << std::endl;
+
+    vw::vw_out(vw::InfoMessage) << "Opening DEM file" << std::endl;
     vw::vw_out(vw::DebugMessage) << r->rows()
         << "x" << r->cols() << "x" << r->planes()
         << "  " << r->channels() << " channel(s)"
@@ -59,10 +106,30 @@ vw::ImageView<float> load_dem_from_file(std::string file_in) {
         << " pxfmt: " << r->pixel_format()
         << " chtype: " << r->channel_type()
         << "\n";
-    //    Read the data
-    //tpc.set_progress_text("Status (loading image):   " );
-    vw::read_image(dem, *r);
-    return dem;
+    return vw::DiskImageView<float>(r);
+}
+
+// Finds the segments of a strip of cells a tile at a time, with the
+// tiles spread over num_threads threads. The segments of each tile are
+// appended to tile_segments in order, left to right.
+void conrec_strip(vw::DiskImageView<float> const& dem, int row0, int strip_rows,
+        int tile_size, int num_threads, int cint, float nodataval,
+        std::vector<SegmentList>& tile_segments)
+{
+    int cells_wide = dem.cols() - 1;
+    int num_tiles = (cells_wide + tile_size - 1) / tile_size;
+    tile_segments.clear();
+    tile_segments.resize(num_tiles);
+
+    vw::FifoWorkQueue queue(num_threads);
+    for (int t = 0; t < num_tiles; t++) {
+        int col0 = t * tile_size;
+        vw::BBox2i cells(col0, row0, std::min(tile_size, cells_wide - col0), strip_rows);
+        boost::shared_ptr<ConrecTileTask>
+            task(new ConrecTileTask(dem, cells, cint, nodataval, tile_segments[t]));
+        queue.add_task(task);
+    }
+    queue.join_all();
 }
 
 void read_segments_from_file(SegmentList &segment_list,
@@ -94,6 +161,7 @@ void read_segments_from_file(SegmentList &segment_list,
 
 void load_segments_into_pcs(SegmentList &segment_list, PointContourSet &cset) {
     SegmentList::iterator seglist_iter;
+    ContourJoiner joiner;
 
     // Load segments into PointContourSet
     vw::vw_out(vw::InfoMessage)
@@ -102,33 +170,37 @@ void load_segments_into_pcs(SegmentList &segment_list, PointContourSet &cset) {
     for (seglist_iter = segment_list.begin();
          seglist_iter != segment_list.end();
          seglist_iter++) {
-        add_segment(cset, *seglist_iter);
+        joiner.add_segment(*seglist_iter);
     }
+    joiner.take_all(cset);
 }
 
 void fit_Bezier_curves_to_contours(PointContourSet &cset,
-        BezierContourSet &bcset, float error)
+        BezierContourSet &bcset, float error, int num_threads)
 {
-    vw::vw_out(vw::InfoMessage)
-        << "Fitting Bezier curves to contours" << std::endl;
-    PointContourSet::iterator cset_iter;
-    PointContour c;
-    int level;
-
-    for (cset_iter = cset.begin(); cset_iter != cset.end(); cset_iter++) {
-        level = (*cset_iter).first;
-        c = (*cset_iter).second;
-        BezierContour bc = FitCurve(c, error);
-        bcset.insert(make_pair(level, bc));
-        /*
-        std::cout << "adding contour: " << bc.size() << " elems" << std::endl;
-        for (BezierContour::iterator bciter = bc.begin(); bciter != bc.end(); ++bciter) {
-            for (int i = 0; i < 4; i++) {
-                std::cout << "\t" << (*bciter)[i] << std::endl;
-            }
-        }
-        */
+    vw::vw_out(vw::DebugMessage)
+        << "\tFitting Bezier curves to " << cset.size() << " contours" << std::endl;
+
+    std::vector<PointContourSet::iterator> contours;
+    contours.reserve(cset.size());
+    for (PointContourSet::iterator cset_iter = cset.begin(); cset_iter != cset.end(); cset_iter++)
+        contours.push_back(cset_iter);
+
+    // The contours are fit in a few ranges per thread, as their lengths
+    // vary widely.
+    std::vector<BezierContour> curves(contours.size());
+    size_t range = std::max(size_t(1), contours.size() / (4 * size_t(num_threads)));
+    vw::FifoWorkQueue queue(num_threads);
+    for (size_t begin = 0; begin < contours.size(); begin += range) {
+        boost::shared_ptr<FitCurvesTask>
+            task(new FitCurvesTask(contours, curves, begin,
+                                   std::min(begin + range, contours.size()), error));
+        queue.add_task(task);
     }
+    queue.join_all();
+
+    for (size_t i = 0; i < contours.size(); i++)
+        bcset.insert(std::make_pair(contours[i]->first, curves[i]));
 }
 
 Cairo::RefPtr<Cairo::Context> create_png_surface(int dem_w, int dem_h,
@@ -229,9 +301,8 @@ void draw_point_contours(PointContourSet cset,
     }
 }
 
-void draw_Bezier_contours(BezierContourSet bcset, Cairo::RefPtr<Cairo::Context> cr, float nodataval) {
-    vw::vw_out(vw::InfoMessage) << "Writing Bezier contours to output surface\n";
-    BezierContourSet::iterator bcset_iter;
+void draw_Bezier_contours(BezierContourSet const& bcset, Cairo::RefPtr<Cairo::Context> cr, float nodataval) {
+    BezierContourSet::const_iterator bcset_iter;
     double line_width;
     line_width = 2.0;
     //cr->device_to_user_distance(line_width, tmp);
@@ -245,8 +316,8 @@ void draw_Bezier_contours(BezierContourSet bcset, Cairo::RefPtr<Cairo::Context>
             level = newlevel;
         }
 
-        BezierContour contour = (*bcset_iter).second;
-        BezierContour::iterator c_iter = contour.begin();
+        BezierContour const& contour = (*bcset_iter).second;
+        BezierContour::const_iterator c_iter = contour.begin();
         cr->begin_new_path();
         cr->move_to((*c_iter)[0][0], (*c_iter)[0][1]);
         while (++c_iter != contour.end()) {
@@ -260,20 +331,99 @@ void draw_Bezier_contours(BezierContourSet bcset, Cairo::RefPtr<Cairo::Context>
 
 
 
-void write_points_to_file(std::string file_out, SegmentList segment_list, int rows, int cols) {
+void write_points(std::ostream& ofs, SegmentList const& segment_list) {
+    SegmentList::const_iterator iter;
+    for (iter = segment_list.begin(); iter != segment_list.end(); iter++) {
+        ContourSegment const& s = *iter;
+        ofs << std::setprecision(8) << std::fixed
+            << s.a[0] << "\t" << s.a[1] << "\t" << s.b[0] << "\t"
+            << s.b[1] << "\t" << s.level << "\n";
+    }
+}
+
+void write_points_to_file(std::string file_out, SegmentList const& segment_list, int rows, int cols) {
     vw::vw_out(vw::InfoMessage) << "Writing contour points to text file\n";
-    SegmentList::iterator iter;
     std::ofstream ofs;
     ofs.open(file_out.c_str());
     ofs << rows << "\t" << cols << std::endl;
+    write_points(ofs, segment_list);
+    ofs.close();
+}
 
-    for (iter = segment_list.begin(); iter != segment_list.end(); iter++) {
-        ContourSegment s = *iter;
-        ofs << std::setprecision(8) << std::fixed
-            << s.a[0] << "\t" << s.a[1] << "\t" << s.b[0] << "\t"
-            << s.b[1] << "\t" << s.level << std::endl;
+// Fits and draws the given contours, and then drops them.
+void fit_and_draw_contours(PointContourSet& cset, Cairo::RefPtr<Cairo::Context> cr,
+        float error, int num_threads, float nodataval)
+{
+    BezierContourSet bcset;
+    fit_Bezier_curves_to_contours(cset, bcset, error, num_threads);
+    cset.clear();
+    draw_Bezier_contours(bcset, cr, nodataval);
+}
+
+// Runs CONREC over the DEM a strip of tiles at a time. The segments of
+// each strip are written out as they are found, or joined into contours
+// of which those that are finished are fit and drawn, so that only the
+// strip and the contours that cross its lower edge are held at once.
+void contour_dem(std::string file_in, std::string file_out, std::string output_type,
+        std::string image_file, int cint, float nodataval, float error,
+        int tile_size, int num_threads)
+{
+    vw::DiskImageView<float> dem = open_dem_file(file_in);
+    int rows = dem.rows();
+    int cols = dem.cols();
+
+    std::ofstream ofs;
+    Cairo::RefPtr<Cairo::Context> cr;
+    if (output_type == "text") {
+        vw::vw_out(vw::InfoMessage) << "Writing contour points to text file\n";
+        ofs.open(file_out.c_str());
+        ofs << rows << "\t" << cols << std::endl;
+    } else {
+        cr = create_output_surface(output_type, cols, rows, image_file, file_out);
+    }
+
+    vw::vw_out(vw::InfoMessage) << "Running CONREC\n";
+    vw::TerminalProgressCallback tpc("tools.contourgen", "Contouring: ");
+    ContourJoiner joiner;
+    PointContourSet finished;
+    std::vector<SegmentList> tile_segments;
+    size_t num_segments = 0;
+    for (int row0 = 0; row0 < rows - 1; row0 += tile_size) {
+        int strip_rows = std::min(tile_size, rows - 1 - row0);
+        conrec_strip(dem, row0, strip_rows, tile_size, num_threads, cint, nodataval,
+                     tile_segments);
+
+        for (size_t t = 0; t < tile_segments.size(); t++) {
+            num_segments += tile_segments[t].size();
+            if (output_type == "text") {
+                write_points(ofs, tile_segments[t]);
+            } else {
+                SegmentList::const_iterator iter;
+                for (iter = tile_segments[t].begin(); iter != tile_segments[t].end(); iter++)
+                    joiner.add_segment(*iter);
+            }
+        }
+
+        if (output_type != "text") {
+            // No cell below this strip reaches above its last row
+            joiner.take_finished(row0 + strip_rows, finished);
+            fit_and_draw_contours(finished, cr, error, num_threads, nodataval);
+            vw::vw_out(vw::DebugMessage) << "\t" << joiner.num_open()
+                << " contours open at row " << row0 + strip_rows << std::endl;
+        }
+        tpc.report_fractional_progress(row0 + strip_rows, rows - 1);
+    }
+    tpc.report_finished();
+    vw::vw_out(vw::DebugMessage)
+        << "\tCONREC found " << num_segments << " segments" << std::endl;
+
+    if (output_type == "text") {
+        ofs.close();
+    } else {
+        joiner.take_all(finished);
+        fit_and_draw_contours(finished, cr, error, num_threads, nodataval);
+        write_output_file(cr, output_type, file_out);
     }
-    ofs.close();
 }
 
 
@@ -298,6 +448,10 @@ int main(int argc, char *argv[])
             "set \"NO DATA\" value")
         ("contour-interval,c", po::value<int>()->default_value(100),
             "set contour interval")
+        ("tile-size,t", po::value<int>()->default_value(1024),
+            "contour the DEM in tiles of this many cells on a side")
+        ("num-threads", po::value<int>()->default_value(0),
+            "number of threads to use (0 for the default)")
     ;
 
     po::options_description hidden("Hidden options");
@@ -344,6 +498,10 @@ int main(int argc, char *argv[])
     std::string output_type = vm["output-type"].as<std::string>();
     float nodataval = vm["no-data-value"].as<float>();
     int cint = vm["contour-interval"].as<int>();
+    int tile_size = vm["tile-size"].as<int>();
+    int num_threads = vm["num-threads"].as<int>();
+    if (num_threads <= 0)
+        num_threads = vw::vw_settings().default_num_threads();
 
     vw::vw_log().console_log().rule_set().clear();
     vw::vw_log().console_log().rule_set().add_rule(vw::WarningMessage, "console");
@@ -358,6 +516,12 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    if (tile_size < 1) {
+        vw::vw_out(vw::ErrorMessage)
+            << "ERROR: The tile size must be positive." << std::endl;
+        return 1;
+    }
+
     if (input_type != "tiff" && input_type != "text") {
         vw::vw_out(vw::ErrorMessage)
             << "ERROR: Input types other than \"tiff\" or \"text\" "
@@ -372,49 +536,41 @@ int main(int argc, char *argv[])
     vw::vw_out(vw::DebugMessage) << "Image file: " << image_file << std::endl;
     vw::vw_out(vw::DebugMessage) << "No-data value: " << nodataval << std::endl;
     vw::vw_out(vw::DebugMessage) << "Contour interval: " << cint << std::endl;
+    vw::vw_out(vw::DebugMessage) << "Tile size: " << tile_size << std::endl;
+    vw::vw_out(vw::DebugMessage) << "Threads: " << num_threads << std::endl;
 
     // done parsing options
 
-    vw::ImageView<float> dem;
-    //TerminalProgressCallback tpc();
-    PointContourSet cset;
-    SegmentList segment_list;
-    int rows, cols;
     float error = 1.0e-3;
 
     if (input_type == "tiff") {
-        // 1. Load DEM from file
-        dem = load_dem_from_file(file_in);
-        rows = dem.rows();
-        cols = dem.cols();
-
-        // 2. Run contouring algorithm on DEM
-        conrec(dem, cset, cint, nodataval, segment_list);
-
-    }
-    else if (input_type == "text") {
-        // read contour segments from file
-        read_segments_from_file(segment_list, file_in, rows, cols);
+        // Contour the DEM a strip at a time, streaming the output
+        contour_dem(file_in, file_out, output_type, image_file, cint, nodataval,
+                    error, tile_size, num_threads);
+        return 0;
     }
 
+    // read contour segments from file
+    PointContourSet cset;
+    SegmentList segment_list;
+    int rows, cols;
+    read_segments_from_file(segment_list, file_in, rows, cols);
+
     if (output_type == "text") {
         write_points_to_file(file_out, segment_list, rows, cols);
 
     } else { // SVG or PNG
-        // Load segments into point contour set
+        // Join segments into contours
         load_segments_into_pcs(segment_list, cset);
-
-        // Fit Bezier curves to contours
-        BezierContourSet bcset;
-        fit_Bezier_curves_to_contours(cset, bcset, error);
+        segment_list.clear();
 
         Cairo::RefPtr<Cairo::Context> cr;
 
         cr = create_output_surface(output_type, cols, rows, image_file, file_out);
 
-        //Draw contours onto surface
-        //draw_point_contours(cset, cr, nodataval);
-        draw_Bezier_contours(bcset, cr, nodataval);
+        // Fit Bezier curves to contours and draw them onto surface
+        vw::vw_out(vw::InfoMessage) << "Writing Bezier contours to output surface\n";
+        fit_and_draw_contours(cset, cr, error, num_threads, nodataval);
 
         write_output_file(cr, output_type, file_out);
 
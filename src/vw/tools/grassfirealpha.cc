@@ -18,6 +18,7 @@
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Core/Log.h>
 #include <vw/Image/Algorithms.h>
+#include <vw/Image/DistanceTransform.h>
 #include <vw/Image/ImageIO.h>
 #include <vw/Image/ImageView.h>
 #include <vw/Image/ImageViewRef.h>
@@ -167,9 +168,9 @@ void grassfire_nodata( Options& opt,
   cartography::GeoReference georef;
   cartography::read_georeference(georef, input);
   DiskImageView<PixelT> input_image(input);
-  ImageView<int32> distance =
-    grassfire(notnodata(input_image,
-                        inter_type(opt.nodata)));
+  ImageView<float> distance =
+    euclidean_distance(notnodata(input_image,
+                                 inter_type(opt.nodata)));
 
   // Check to see if the user has specified a feather length.  If not,
   // then we send the feather_max to the max pixel value (which
@@ -185,10 +186,12 @@ void grassfire_nodata( Options& opt,
 
   // The user may wish to blur the grassfire result before applying
   // the transfer function.  This makes for an even smoother blend.
+  // The feather blurs are wide, so the ramp is blurred in floating
+  // point, where the recursive filter's cost does not grow with sigma.
   if (opt.blur_sigma > 0)
-    norm_dist = gaussian_filter(pixel_cast<inter_type>(range_type::max() / (opt.feather_max - opt.feather_min) *
-                                                       clamp(pixel_cast<float>(distance) - opt.feather_min,
-                                                             0.0, opt.feather_max - opt.feather_min)), opt.blur_sigma);
+    norm_dist = pixel_cast<inter_type>(recursive_gaussian_filter(float(range_type::max()) / (opt.feather_max - opt.feather_min) *
+                                                                 clamp(pixel_cast<float>(distance) - opt.feather_min,
+                                                                       0.0, opt.feather_max - opt.feather_min), opt.blur_sigma));
 
   ImageViewRef<typename PixelWithAlpha<PixelT>::type> result;
   if ( opt.filter == "linear" ) {
@@ -214,7 +217,7 @@ void grassfire_alpha( Options& opt,
   cartography::GeoReference georef;
   cartography::read_georeference(georef, input);
   DiskImageView<PixelT> input_image(input);
-  ImageView<int32> distance = grassfire(apply_mask(invert_mask(alpha_to_mask(input_image)),1));
+  ImageView<float> distance = euclidean_distance(apply_mask(invert_mask(alpha_to_mask(input_image)),1));
 
   // Check to see if the user has specified a feather length.  If not,
   // then we send the feather_max to the max pixel value (which
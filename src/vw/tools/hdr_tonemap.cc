@@ -30,6 +30,7 @@
 
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
 #include <vw/Image/Algorithms.h>
 #include <vw/Image/Filter.h>
 #include <vw/Image/ImageMath.h>
@@ -40,10 +41,12 @@
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/HDR/CameraCurve.h>
 #include <vw/HDR/GlobalToneMap.h>
+#include <vw/HDR/LocalToneMap.h>
 
 #include <iostream>
 
 #include <boost/program_options.hpp>
+#include <boost/scoped_ptr.hpp>
 namespace po = boost::program_options;
 
 using std::cout;
@@ -52,10 +55,21 @@ using std::string;
 using namespace vw;
 using namespace vw::hdr;
 
+// Write the image a tile at a time, on several threads, so that
+// images too large for memory can be tone mapped.
+template <class ViewT>
+void write_tone_mapped( string const& output_filename, ImageViewBase<ViewT> const& image ) {
+  boost::scoped_ptr<DiskImageResource> r(DiskImageResource::create(output_filename, image.format()));
+  if ( r->has_block_write() )
+    r->set_block_write_size( Vector2i( vw_settings().default_tile_size(),
+                                       vw_settings().default_tile_size() ) );
+  block_write_image( *r, image, TerminalProgressCallback( "tools.hdr_tonemap", "Processing") );
+}
+
 int main( int argc, char *argv[] ) {
   try {
     string input_filename, output_filename, curve_file;
-    float bias, gamma;
+    float bias, gamma, threshold;
     int bit_depth;
 
     po::options_description desc("Options");
@@ -64,6 +78,8 @@ int main( int argc, char *argv[] ) {
       ("input-filename", po::value<string>(&input_filename), "Specify the input filename.")
       ("output-filename,o", po::value<string>(&output_filename)->default_value("tonemap.png"), "Specify the output filename.")
       ("bias,b", po::value<float>(&bias)->default_value(vw::hdr::DRAGO_DEFAULT_BIAS), "Drago Tonemapping Parameter.  (The default of 0.85 works well for most images)")
+      ("local,l", "Use Ashikhmin's local tone mapping operator instead of Drago's global one.")
+      ("threshold,t", po::value<float>(&threshold)->default_value(0.5), "Ashikhmin Tonemapping Parameter.  (Lower values preserve more local contrast)")
       ("gamma,g", po::value<float>(&gamma)->default_value(2.2), "Apply a gamma correction to the tonemapped image.")
       ("bit-depth", po::value<int>(&bit_depth)->default_value(8), "Select a bit depth (8, 16, 32, or 64  [selecting 32 or 64 bit saves as IEE float if supported]")
       ("curves-for-raw-image,c", po::value<string>(&curve_file), "Read the curve lookup tables to a file on disk.  Only use this option if you are processing a raw image from a camera and you have a curves file to match.  You need not specify this option if you are processing a HDR luminance image.");
@@ -101,21 +117,25 @@ int main( int argc, char *argv[] ) {
       tone_mapped = luminance_image(tone_mapped, curves, 1.0);
     }
 
-    cout << "Applying Drago tone-mapping" << endl;
-    // Apply Drago tone-mapping operator.
-    tone_mapped = pow(drago_tone_map(tone_mapped, bias), gamma);
-
-    TerminalProgressCallback tpc( "tools.hdr_tonemap", "Processing");
+    // Both operators need the luminance range of the whole image,
+    // which is found in a first pass over it.
+    if ( vm.count("local") ) {
+      cout << "Applying Ashikhmin tone-mapping" << endl;
+      tone_mapped = pow(ashikhmin_tone_map_view(tone_mapped, threshold), gamma);
+    } else {
+      cout << "Applying Drago tone-mapping" << endl;
+      tone_mapped = pow(drago_tone_map(tone_mapped, bias), gamma);
+    }
 
     // Write out the result to disk.
     if (bit_depth == 8)
-      write_image(output_filename, channel_cast_rescale<uint8>(clamp(tone_mapped)), tpc);
+      write_tone_mapped(output_filename, channel_cast_rescale<uint8>(clamp(tone_mapped)));
     else if (bit_depth == 16)
-      write_image(output_filename, channel_cast_rescale<uint16>(clamp(tone_mapped)), tpc);
+      write_tone_mapped(output_filename, channel_cast_rescale<uint16>(clamp(tone_mapped)));
     else if (bit_depth == 32)
-      write_image(output_filename, channel_cast_rescale<float32>(clamp(tone_mapped)), tpc);
+      write_tone_mapped(output_filename, channel_cast_rescale<float32>(clamp(tone_mapped)));
     else if (bit_depth == 64)
-      write_image(output_filename, tone_mapped, tpc);
+      write_tone_mapped(output_filename, tone_mapped);
     else {
       vw_out() << "Unknown bit depth specified by user.  Please choose from the following options: [ 8, 16, 32, 64 ]\n";
       exit(1);
@@ -48,6 +48,7 @@ struct Options {
   double nodata_value;
   double blur_sigma;
   bool   align_to_georef;
+  bool   multidirectional;
 };
 
 void handle_arguments( int argc, char *argv[], Options& opt ) {
@@ -61,6 +62,7 @@ void handle_arguments( int argc, char *argv[], Options& opt ) {
     ("nodata-value",    po::value(&opt.nodata_value), "Remap the DEM default value to the min altitude value.")
     ("blur",            po::value(&opt.blur_sigma  ), "Pre-blur the DEM with the specified sigma.")
     ("align-to-georef", po::bool_switch(&opt.align_to_georef), "The azimuth is relative to East instead of +x in the image.")
+    ("multidirectional", po::bool_switch(&opt.multidirectional), "Light the DEM from four directions spread around the azimuth.")
     ("help,h", "Display this help message");
 
   po::positional_options_description p;
@@ -96,7 +98,8 @@ int main( int argc, char *argv[] ) {
     do_multitype_hillshade(opt.input_file_name,
                            opt.output_file_name,
                            opt.azimuth, opt.elevation, opt.scale,
-                           opt.nodata_value, opt.blur_sigma, opt.align_to_georef);
+                           opt.nodata_value, opt.blur_sigma, opt.align_to_georef,
+                           opt.multidirectional);
 
   } catch ( const ArgumentErr& e ) {
     vw_out() << e.what() << std::endl;
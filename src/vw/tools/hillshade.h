@@ -22,27 +22,27 @@
 #include <vw/Core/System.h>
 #include <vw/Core/Log.h>
 #include <vw/Core/FundamentalTypes.h>
-#include <vw/Math/EulerAngles.h>
 #include <vw/Image/Algorithms.h>
 #include <vw/Image/ImageViewRef.h>
-#include <vw/Image/Filter.h>
 #include <vw/Image/PixelMask.h>
 #include <vw/Image/MaskViews.h>
-#include <vw/Image/PerPixelAccessorViews.h>
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/FileIO/DiskImageResource.h>
 #include <vw/Cartography/GeoReference.h>
+#include <vw/Cartography/Hillshade.h>
 #include <vw/tools/Common.h>
 
 namespace vw{
 
   /// Do the hillshade work.
+  /// - With multidirectional set, the DEM is lit by four equal lights
+  ///   spread 45 degrees apart and centered on the azimuth.
   template <class PixelT>
   void do_hillshade(std::string const& input_file_name,
                     std::string const& output_file_name,
                     double azimuth, double elevation, double scale,
                     double nodata_value, double blur_sigma,
-                    bool align_to_georef) {
+                    bool align_to_georef, bool multidirectional = false) {
 
     cartography::GeoReference georef;
     bool has_georef = cartography::read_georeference(georef, input_file_name);
@@ -52,14 +52,9 @@ namespace vw{
     // Select the pixel scale.
     float u_scale, v_scale;
     if (scale == 0) {
-      if (georef.is_projected()) {
-        u_scale = georef.transform()(0,0);
-        v_scale = georef.transform()(1,1);
-      } else {
-        double meters_per_degree = 2*M_PI*georef.datum().semi_major_axis()/360.0;
-        u_scale = georef.transform()(0,0) * meters_per_degree;
-        v_scale = georef.transform()(1,1) * meters_per_degree;
-      }
+      Vector2 pixel_scale = cartography::hillshade_pixel_scale(georef);
+      u_scale = pixel_scale[0];
+      v_scale = pixel_scale[1];
     } else {
       u_scale =  scale;
       v_scale = -scale;
@@ -72,27 +67,22 @@ namespace vw{
       std::cout << "Calculating adjustment to longitude East...\n";
       // Find the "natural" azimuth of the image, the vector from the center pixel
       //  to the center-right pixel of the image.
-      Vector2 left_pixel (0,                    disk_dem_file.rows()/2);
-      Vector2 right_pixel(disk_dem_file.cols(), disk_dem_file.rows()/2);
-
-      Vector2 left_lonlat  = georef.pixel_to_lonlat(left_pixel );
-      Vector2 right_lonlat = georef.pixel_to_lonlat(right_pixel);
-      Vector2 lonlat_vec   = right_lonlat - left_lonlat;
-
-      // Get the angle between this vector and the East vector.
-      double  angle = atan2(lonlat_vec[1], lonlat_vec[0]);
-      std::cout << "Image azimuth angle = " << angle*(180/M_PI) << std::endl;
-      azimuth -= angle*(180/M_PI);
+      double angle = cartography::image_azimuth_from_east(georef, bounding_box(disk_dem_file).size());
+      std::cout << "Image azimuth angle = " << angle << std::endl;
+      azimuth -= angle;
       std::cout << "New azimuth value   = " << azimuth << std::endl;
     }
 
-    // Set the direction of the light source.
-    // - Starts in an image space "ENU" coordinate system pointed toward E (right)
-    Vector3f light_0(1,0,0);
-    Vector3f light = vw::math::euler_to_rotation_matrix(elevation*M_PI/180, azimuth*M_PI/180, 0, "yzx") * light_0;
-
-    // Compute the surface normals
+    // Set the direction of the light sources.
+    std::vector<cartography::HillshadeLight> lights;
+    if (multidirectional) {
+      for (int i = 0; i < 4; ++i)
+        lights.push_back(cartography::HillshadeLight(azimuth + 45*i - 67.5, elevation));
+    } else {
+      lights.push_back(cartography::HillshadeLight(azimuth, elevation));
+    }
 
+    // Mask the nodata pixels
     ImageViewRef<PixelMask<PixelT > > dem;
     boost::shared_ptr<vw::DiskImageResource> disk_dem_rsrc(vw::DiskImageResourcePtr(input_file_name));
     if ( !std::isnan(nodata_value) ) {
@@ -107,15 +97,17 @@ namespace vw{
       dem = pixel_cast<PixelMask<PixelT > >(disk_dem_file);
     }
 
-    if ( !std::isnan(blur_sigma) ) {
+    if ( std::isnan(blur_sigma) ) {
+      blur_sigma = 0;
+    } else {
       vw_out() << "\t--> Blurring pixel with gaussian kernal.  Sigma = "
                << blur_sigma << "\n";
-      dem = gaussian_filter(dem, blur_sigma);
     }
 
-    // The final result is the dot product of the light source with the normals
+    // The blur, the normals and the lighting are all computed together
+    // a tile at a time.
     ImageViewRef<PixelMask<PixelGray<uint8> > > shaded_image =
-      channel_cast_rescale<uint8>(clamp(dot_prod(compute_normals(dem, u_scale, v_scale), light)));
+      channel_cast_rescale<uint8>(cartography::hillshade(dem, u_scale, v_scale, lights, blur_sigma));
 
     // Save the result
     vw_out() << "Writing shaded relief image: " << output_file_name << "\n";
@@ -135,7 +127,7 @@ namespace vw{
                               std::string const& output_file,
                               double azimuth, double elevation, double scale,
                               double nodata_value, double blur_sigma,
-                              bool align_to_georef) {
+                              bool align_to_georef, bool multidirectional = false) {
 
     ImageFormat fmt = vw::image_format(input_file);
 
@@ -147,22 +139,26 @@ namespace vw{
       case VW_CHANNEL_UINT8:
         do_hillshade<PixelGray<uint8>  >(input_file, output_file,
                                          azimuth, elevation, scale,
-                                         nodata_value, blur_sigma, align_to_georef);
+                                         nodata_value, blur_sigma, align_to_georef,
+                                         multidirectional);
         break;
       case VW_CHANNEL_INT16:
         do_hillshade<PixelGray<int16>  >(input_file, output_file,
                                          azimuth, elevation, scale,
-                                         nodata_value, blur_sigma, align_to_georef);
+                                         nodata_value, blur_sigma, align_to_georef,
+                                         multidirectional);
         break;
       case VW_CHANNEL_UINT16:
         do_hillshade<PixelGray<uint16> >(input_file, output_file,
                                          azimuth, elevation, scale,
-                                         nodata_value, blur_sigma, align_to_georef);
+                                         nodata_value, blur_sigma, align_to_georef,
+                                         multidirectional);
         break;
       default:
         do_hillshade<PixelGray<float>  >(input_file, output_file,
                                          azimuth, elevation, scale,
-                                         nodata_value, blur_sigma, align_to_georef);
+                                         nodata_value, blur_sigma, align_to_georef,
+                                         multidirectional);
         break;
       }
       break;
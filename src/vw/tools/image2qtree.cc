@@ -61,16 +61,17 @@ int32 compute_resolution(const std::string& p, const GeoTransform& t, const Vect
 void get_normalize_vals(boost::shared_ptr<DiskImageResource> file,
                                const Options& opt) {
   DiskImageView<PixelRGB<float> > min_max_file(file);
-  float new_lo, new_hi;
+  ChannelStatistics stats;
   if ( opt.nodata_set ) {
     PixelRGB<float> no_data_value( opt.nodata );
-    min_max_channel_values( create_mask(min_max_file,no_data_value), new_lo, new_hi );
+    stats = channel_statistics( create_mask(min_max_file,no_data_value) );
   } else if ( file->has_nodata_read() ) {
     PixelRGB<float> no_data_value( file->nodata_read() );
-    min_max_channel_values( create_mask(min_max_file,no_data_value), new_lo, new_hi );
+    stats = channel_statistics( create_mask(min_max_file,no_data_value) );
   } else {
-    min_max_channel_values( min_max_file, new_lo, new_hi );
+    stats = channel_statistics( min_max_file );
   }
+  float new_lo = stats.minimum(), new_hi = stats.maximum();
   lo_value = std::min(new_lo, lo_value);
   hi_value = std::max(new_hi, hi_value);
   cout << "Pixel range for \"" << file->filename() << ": [" << new_lo << " " << new_hi << "]    Output dynamic range: [" << lo_value << " " << hi_value << "]" << endl;
@@ -27,6 +27,7 @@
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
 #include <vw/tools/flood_common.h>
+#include <vw/tools/band_planar.h>
 
 /**
   Tools for processing Landsat data.
@@ -506,6 +507,122 @@ public:
 };
 
 
+/// Computes detect_water() for each pixel of a tile of raw Landsat values,
+/// a band at a time.  The tile is converted to TOA values in place.
+void compute_water_scores(band_planar::BandTile &tile,
+                          LandsatMetadataContainer const& metadata, float *score) {
+  using namespace band_planar;
+  const size_t n = tile.num_pixels();
+  float *blue  = tile.band(BLUE ), *green = tile.band(GREEN), *red   = tile.band(RED  ),
+        *nir   = tile.band(NIR  ), *swir1 = tile.band(SWIR1), *swir2 = tile.band(SWIR2),
+        *temp  = tile.band(TEMP );
+
+  // Convert to TOA as convert_to_toa() does.
+  for (size_t i=0; i<n; ++i) {
+    float temp_rad = temp[i]*metadata.rad_mult[TEMP] + metadata.rad_add[TEMP];
+    temp[i] = metadata.k_constants[2] / log(metadata.k_constants[0]/temp_rad + 1.0);
+  }
+  for (int b=0; b<NUM_BANDS_OF_INTEREST; ++b)
+    if (b != TEMP)
+      scale_offset(tile.band(b), n, metadata.toa_mult[b], metadata.toa_add[b]);
+
+  std::vector<float> cloud(n, 1.0f), term(n), sum(n);
+
+  // Cloud score, as in detect_clouds()
+  rescale_to_01(blue, &term[0], n, 0.1, 0.3);
+  min_into(&cloud[0], &term[0], n);
+  for (size_t i=0; i<n; ++i)
+    sum[i] = red[i] + green[i] + blue[i];
+  rescale_to_01(&sum[0], &term[0], n, 0.2, 0.8);
+  min_into(&cloud[0], &term[0], n);
+  for (size_t i=0; i<n; ++i)
+    sum[i] = nir[i] + swir1[i] + swir2[i];
+  rescale_to_01(&sum[0], &term[0], n, 0.3, 0.8);
+  min_into(&cloud[0], &term[0], n);
+  rescale_to_01(temp, &term[0], n, 300, 290);
+  min_into(&cloud[0], &term[0], n);
+  // detect_water_ndsi_functor returns a bool, so only a nonzero NDSI counts.
+  normalized_difference(green, swir1, &term[0], n, 100);
+  for (size_t i=0; i<n; ++i)
+    term[i] = (term[i] != 0) ? 1.0f : 0.0f;
+  rescale_to_01(&term[0], &term[0], n, 0.8, 0.6);
+  min_into(&cloud[0], &term[0], n);
+
+  // Water score, as in detect_water().  The sum of the shadow bands is
+  //  still in sum.
+  std::fill(score, score+n, 1.0f);
+  rescale_to_01(&sum[0], &term[0], n, 0.35, 0.2);
+  clamp01(&term[0], n);
+  min_into(score, &term[0], n);
+
+  for (size_t i=0; i<n; ++i) {
+    // Mean and sample standard deviation of the dark bands, as
+    //  math::mean() and math::standard_deviation() compute them.
+    double total = 0.0;
+    total += green[i]; total += red[i]; total += nir[i]; total += swir2[i]; total += swir1[i];
+    float  mean = total / 5.0;
+    double d0 = green[i] - double(mean), d1 = red  [i] - double(mean),
+           d2 = nir  [i] - double(mean), d3 = swir2[i] - double(mean),
+           d4 = swir1[i] - double(mean);
+    double squares = 0.0;
+    squares += d0*d0; squares += d1*d1; squares += d2*d2; squares += d3*d3; squares += d4*d4;
+    float  std = sqrt(squares / 4.0);
+    float  z   = (blue[i] - std) / (mean == 0 ? 1.0f : mean);
+    z = (z > 1.0f) ? 1.0f : ((z < 0.0f) ? 0.0f : z);
+    term[i] = (mean == 0) ? 1.0f : z;
+  }
+  min_into(score, &term[0], n);
+
+  rescale_to_01(temp, &term[0], n, 273, 275);
+  min_into(score, &term[0], n);
+
+  normalized_difference(green, swir1, &sum[0], n, 0);
+  rescale_to_01(&sum[0], &term[0], n, 0.3, 0.8);
+  min_into(score, &term[0], n);
+  clamp01(score, n);
+
+  const float CLOUD_THRESHOLD = 0.35;
+  for (size_t i=0; i<n; ++i)
+    score[i] = (cloud[i] > CLOUD_THRESHOLD) ? 0.0f : score[i];
+}
+
+/// Band-planar version of LandsatToaFunctor followed by DetectWaterLandsatFunctor,
+/// for use with band_planar_view() on a raw LandsatImage.
+class DetectWaterLandsatKernel {
+  LandsatMetadataContainer m_metadata;
+  float m_water_thresh;
+public:
+  typedef uint8 result_type;
+
+  DetectWaterLandsatKernel(LandsatMetadataContainer const& metadata, double sensitivity=1.0)
+   : m_metadata(metadata),
+     m_water_thresh(compute_water_threshold(metadata.sun_elevation_degrees)*sensitivity) {}
+
+  void operator()(band_planar::BandTile &tile, uint8 *out) const {
+    std::vector<float> score(tile.num_pixels());
+    compute_water_scores(tile, m_metadata, &score[0]);
+    band_planar::classify(&score[0], tile.valid(), out, score.size(), m_water_thresh,
+                          FLOOD_DETECT_WATER, FLOOD_DETECT_LAND, FLOOD_DETECT_NODATA);
+  }
+};
+
+/// Band-planar version of DetectWaterLandsatFunctorScore.
+class DetectWaterLandsatScoreKernel {
+  LandsatMetadataContainer m_metadata;
+public:
+  typedef float result_type;
+
+  DetectWaterLandsatScoreKernel(LandsatMetadataContainer const& metadata)
+   : m_metadata(metadata) {}
+
+  void operator()(band_planar::BandTile &tile, float *out) const {
+    std::vector<float> score(tile.num_pixels());
+    compute_water_scores(tile, m_metadata, &score[0]);
+    band_planar::mask_to_value(&score[0], tile.valid(), out, score.size(), -1.0);
+  }
+};
+
+
 /// DEBUG class to output the raw water detection score.
 class DetectWaterLandsatFunctorScore  : public ReturnFixedType<float> {
 public: 
@@ -555,15 +672,9 @@ void detect_water(std::vector<std::string> const& image_files, std::string const
                            TerminalProgressCallback("vw", "\t--> Writing TOA input:"));
                              
     block_write_gdal_image("landsat_raw_output.tif",
-                           apply_mask(
-                             per_pixel_view(
-                                per_pixel_view(
-                                  ls_image,
-                                  LandsatToaFunctor(metadata)
-                                ),
-                                DetectWaterLandsatFunctorScore()
-                             ),
-                             -1.0
+                           band_planar::band_planar_view(
+                             ls_image,
+                             DetectWaterLandsatScoreKernel(metadata)
                            ),
                            true, georef,
                            true, -1.0,
@@ -572,16 +683,11 @@ void detect_water(std::vector<std::string> const& image_files, std::string const
   }
 
 
+  // The classification runs a tile at a time over planar bands
   block_write_gdal_image(output_path,
-                         apply_mask(
-                           per_pixel_view(
-                              per_pixel_view(
-                                ls_image,
-                                LandsatToaFunctor(metadata)
-                              ),
-                              DetectWaterLandsatFunctor(metadata.sun_elevation_degrees, sensitivity)
-                           ),
-                           FLOOD_DETECT_NODATA
+                         band_planar::band_planar_view(
+                           ls_image,
+                           DetectWaterLandsatKernel(metadata, sensitivity)
                          ),
                          true, georef,
                          true, FLOOD_DETECT_NODATA,
@@ -25,6 +25,7 @@
 #include <vw/Image/Transform.h>
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
+#include <vw/tools/band_planar.h>
 
 /**
   Tools for processing MODIS data.
@@ -217,31 +218,48 @@ void compute_lswi(ModisImage const& modis, ImageView<float> &lswi) {
 */
 
 /// Forms a convenience image consisting of all the modis image products
+/// - The products are computed over planar bands a strip of rows at a time.
 void form_modis_product_image(ModisImage const& modis, ModisProductImage &products) {
 
-  // Loop through the output image and compute each product at each pixel
+  const int STRIP_ROWS = 256;
   products.set_size(modis.cols(), modis.rows());
-  for (int r=0; r<modis.rows(); ++r) {
-    for (int c=0; c<modis.cols(); ++c) {
-      ModisPixelType pixel = modis(c,r);
-      ModisProductPixelType pixel_out;
-      pixel_out[NDVI] = 0;
-      pixel_out[NDWI] = 0;
-      pixel_out[EVI ] = 0;
-      pixel_out[LSWI] = 0;
-      
-      if (pixel[B2] + pixel[B1] != 0)
-        pixel_out[NDVI] = (pixel[B2] - pixel[B1]) / (pixel[B2] + pixel[B1]);
-      if (pixel[B1] + pixel[B6] != 0)
-        pixel_out[NDWI] = (pixel[B1] - pixel[B6]) / (pixel[B1] + pixel[B6]);
-      if ((6.0*pixel[B1] + pixel[B2] - 7.5*pixel[B3] + 1.0) != 0)
-        pixel_out[EVI ] = 2.5*(pixel[B2] - pixel[B1]) / (6.0*pixel[B1] + pixel[B2] - 7.5*pixel[B3] + 1.0);
-      if (pixel[B2] + pixel[B6] != 0)
-        pixel_out[LSWI] = (pixel[B2] - pixel[B6]) / (pixel[B2] + pixel[B6]);
-      products(c,r) = pixel_out;
+  band_planar::BandTile tile;
+  std::vector<float> ndvi, ndwi, evi, lswi;
+  for (int row=0; row<modis.rows(); row+=STRIP_ROWS) {
+    BBox2i strip(0, row, modis.cols(), std::min(STRIP_ROWS, modis.rows()-row));
+    band_planar::load_tile(ModisImage(crop(modis, strip)), tile);
+    const size_t n = tile.num_pixels();
+    ndvi.resize(n);
+    ndwi.resize(n);
+    evi.resize(n);
+    lswi.resize(n);
+
+    float const* b1 = tile.band(B1);
+    float const* b2 = tile.band(B2);
+    float const* b3 = tile.band(B3);
+    float const* b6 = tile.band(B6);
+    band_planar::normalized_difference(b2, b1, &ndvi[0], n, 0);
+    band_planar::normalized_difference(b1, b6, &ndwi[0], n, 0);
+    band_planar::normalized_difference(b2, b6, &lswi[0], n, 0);
+    for (size_t i=0; i<n; ++i) {
+      double denom = 6.0*b1[i] + b2[i] - 7.5*b3[i] + 1.0;
+      double value = 2.5*(b2[i] - b1[i]) / (denom == 0 ? 1.0 : denom);
+      evi[i] = (denom == 0) ? 0.0f : float(value);
     }
-  }
 
+    // Write the products back out a pixel at a time.
+    size_t i = 0;
+    for (int r=strip.min().y(); r<strip.max().y(); ++r) {
+      for (int c=0; c<modis.cols(); ++c, ++i) {
+        ModisProductPixelType pixel_out;
+        pixel_out[NDVI] = ndvi[i];
+        pixel_out[NDWI] = ndwi[i];
+        pixel_out[EVI ] = evi [i];
+        pixel_out[LSWI] = lswi[i];
+        products(c,r) = pixel_out;
+      }
+    }
+  }
 }} // end namespace vw::modis
 
 
@@ -27,6 +27,7 @@
 #include <vw/FileIO/DiskImageView.h>
 #include <vw/Cartography/GeoReferenceUtils.h>
 #include <vw/tools/flood_common.h>
+#include <vw/tools/band_planar.h>
 
 /**
   Tools for processing multispectral image data.  Only data from the 
@@ -239,6 +240,13 @@ void load_worldview23_metadata(std::vector<std::string> const& input_paths,
 
 
 
+/// The factor that converts WorldView radiance to reflectance, before the
+/// division by the solar irradiance of each band.
+float compute_reflectance_scale_factor(WorldViewMetadataContainer const& metadata) {
+  return metadata.earth_sun_distance*metadata.earth_sun_distance*M_PI /
+         cos(DEG_TO_RAD*(90.0 - metadata.mean_sun_elevation));
+}
+
 /// Convert an input WorldView pixel to top-of-atmosphere value.
 WorldView23ToaPixelType convert_to_toa(WorldView23PixelType       const& pixel_in,
                                        WorldViewMetadataContainer const& metadata)
@@ -249,8 +257,7 @@ WorldView23ToaPixelType convert_to_toa(WorldView23PixelType       const& pixel_i
     rad_pixel[i] = rad_pixel[i]*(metadata.abs_cal_factor[i]/metadata.effective_bandwidth[i]);
 
   // Now convert to reflectance values
-  float scale_factor = metadata.earth_sun_distance*metadata.earth_sun_distance*M_PI /
-                       cos(DEG_TO_RAD*(90.0 - metadata.mean_sun_elevation));
+  float scale_factor = compute_reflectance_scale_factor(metadata);
   WorldView23ToaPixelType pixel = rad_pixel;
   for (int i=0; i<NUM_WORLDVIEW_BANDS; ++i)
     pixel[i] = rad_pixel[i] * scale_factor / WORLDVIEW_ESUN[i];
@@ -415,6 +422,72 @@ public:
   }
 };
 
+/// Band-planar version of WorldView23ToaFunctor followed by
+/// DetectWaterWorldView23Functor, for use with band_planar_view() on a raw
+/// WorldView23Image.  Only the three bands it needs are converted to TOA.
+class DetectWaterWorldView23Kernel {
+  WorldViewMetadataContainer m_metadata;
+  double m_sensitivity;
+public:
+  typedef uint8 result_type;
+
+  DetectWaterWorldView23Kernel(WorldViewMetadataContainer const& metadata, double sensitivity=1.0)
+   : m_metadata(metadata), m_sensitivity(sensitivity) {}
+
+  void operator()(band_planar::BandTile &tile, uint8 *out) const {
+    const size_t n = tile.num_pixels();
+    const float  scale_factor = compute_reflectance_scale_factor(m_metadata);
+    const int    bands[3] = {COASTAL, RED, NIR2};
+    for (int k=0; k<3; ++k) {
+      const int b = bands[k];
+      const float gain = m_metadata.abs_cal_factor[b]/m_metadata.effective_bandwidth[b];
+      float *v = tile.band(b);
+      for (size_t i=0; i<n; ++i) {
+        float rad = v[i]*gain;
+        v[i] = rad * scale_factor / WORLDVIEW_ESUN[b];
+      }
+    }
+
+    std::vector<float> ndvi(n), ndwi2(n);
+    band_planar::normalized_difference(tile.band(RED    ), tile.band(NIR2), &ndvi [0], n, 100);
+    band_planar::normalized_difference(tile.band(COASTAL), tile.band(NIR2), &ndwi2[0], n, 100);
+
+    const double ndvi_low = 0.1*m_sensitivity, ndwi2_low = 0.3*m_sensitivity,
+                 high     = 0.5*m_sensitivity;
+    uint8 const* valid = tile.valid();
+    for (size_t i=0; i<n; ++i) {
+      bool land  = (ndvi[i] < ndvi_low) || (ndwi2[i] < ndwi2_low);
+      bool water = !land && ((ndvi[i] > high) || (ndwi2[i] > high));
+      uint8 label = water ? FLOOD_DETECT_WATER : FLOOD_DETECT_LAND;
+      out[i] = valid[i] ? label : FLOOD_DETECT_NODATA;
+    }
+  }
+};
+
+/// Band-planar version of DetectWaterSpot67Functor.
+class DetectWaterSpot67Kernel {
+  double m_sensitivity;
+public:
+  typedef uint8 result_type;
+
+  DetectWaterSpot67Kernel(double sensitivity=1.0) : m_sensitivity(sensitivity) {}
+
+  void operator()(band_planar::BandTile &tile, uint8 *out) const {
+    const size_t n = tile.num_pixels();
+    std::vector<float> ndvi(n), ndwi(n);
+    band_planar::normalized_difference(tile.band(SPOT_RED ), tile.band(SPOT_NIR), &ndvi[0], n, 100);
+    band_planar::normalized_difference(tile.band(SPOT_BLUE), tile.band(SPOT_NIR), &ndwi[0], n, 100);
+
+    const double ndwi_high = 0.3*m_sensitivity, sum_high = 0.6*m_sensitivity;
+    uint8 const* valid = tile.valid();
+    for (size_t i=0; i<n; ++i) {
+      bool water = (ndwi[i] > ndwi_high) || ((ndvi[i]+ndwi[i]) > sum_high);
+      uint8 label = water ? FLOOD_DETECT_WATER : FLOOD_DETECT_LAND;
+      out[i] = valid[i] ? label : FLOOD_DETECT_NODATA;
+    }
+  }
+};
+
 // High level water detection function for WorldView.
 void detect_water_worldview23(std::vector<std::string> const& image_files, 
                               std::string const& output_path,
@@ -483,17 +556,11 @@ void detect_water_worldview23(std::vector<std::string> const& image_files,
     
   }
 
-  // All the work happens when this call executes
+  // All the work happens when this call executes, a tile at a time over planar bands
   block_write_gdal_image(output_path,
-                         apply_mask(
-                           per_pixel_view(
-                              per_pixel_view(
-                                wv_image,
-                                WorldView23ToaFunctor(metadata)
-                              ),
-                              DetectWaterWorldView23Functor(sensitivity)
-                           ),
-                           FLOOD_DETECT_NODATA
+                         band_planar::band_planar_view(
+                           wv_image,
+                           DetectWaterWorldView23Kernel(metadata, sensitivity)
                          ),
                          true, georef,
                          true, FLOOD_DETECT_NODATA,
@@ -532,14 +599,11 @@ void detect_water_spot67(std::vector<std::string> const& image_files,
                            TerminalProgressCallback("vw", "\t--> NDWI"));
   }
 
-  // All the work happens when this call executes
+  // All the work happens when this call executes, a tile at a time over planar bands
   block_write_gdal_image(output_path,
-                         apply_mask(
-                           per_pixel_view(
-                             spot_image,
-                             DetectWaterSpot67Functor(sensitivity)
-                           ),
-                           FLOOD_DETECT_NODATA
+                         band_planar::band_planar_view(
+                           spot_image,
+                           DetectWaterSpot67Kernel(sensitivity)
                          ),
                          true, georef,
                          true, FLOOD_DETECT_NODATA,
@@ -40,6 +40,7 @@
 #include <vw/Cartography/GeoReferenceUtils.h>
 #include <vw/Cartography/GeoTransform.h>
 #include <vw/tools/flood_common.h>
+#include <vw/tools/band_planar.h>
 
 /**
   Tools for processing radar data.
@@ -96,6 +97,53 @@ public:
   }
 }; // End class FuzzyMembershipSFunctor
 
+/// Band-planar version of FuzzyMembershipZFunctor<PixelMask<float> >, for use
+/// with band_planar_view() on a single channel image.
+class FuzzyMembershipZKernel {
+  float m_a, m_b;
+public:
+  typedef PixelMask<float> result_type;
+
+  FuzzyMembershipZKernel(float a, float b) : m_a(a), m_b(b) {}
+
+  void operator()(band_planar::BandTile &tile, PixelMask<float> *out) const {
+    const size_t n = tile.num_pixels();
+    std::vector<float> fuzz(n);
+    band_planar::fuzzy_membership_z(tile.band(0), &fuzz[0], n, m_a, m_b);
+    float const* v     = tile.band(0);
+    uint8 const* valid = tile.valid();
+    for (size_t i=0; i<n; ++i) {
+      // As with the functor, only the flat ends of the curve are valid for invalid inputs.
+      out[i] = PixelMask<float>(fuzz[i]);
+      if (!valid[i] && (v[i] >= m_a) && (v[i] < m_b))
+        invalidate(out[i]);
+    }
+  }
+}; // End class FuzzyMembershipZKernel
+
+/// Band-planar version of FuzzyMembershipSFunctor<PixelMask<float> >.
+class FuzzyMembershipSKernel {
+  float m_a, m_b;
+public:
+  typedef PixelMask<float> result_type;
+
+  FuzzyMembershipSKernel(float a, float b) : m_a(a), m_b(b) {}
+
+  void operator()(band_planar::BandTile &tile, PixelMask<float> *out) const {
+    const size_t n = tile.num_pixels();
+    std::vector<float> fuzz(n);
+    band_planar::fuzzy_membership_s(tile.band(0), &fuzz[0], n, m_a, m_b);
+    float const* v     = tile.band(0);
+    uint8 const* valid = tile.valid();
+    for (size_t i=0; i<n; ++i) {
+      // As with the functor, only the flat ends of the curve are valid for invalid inputs.
+      out[i] = PixelMask<float>(fuzz[i]);
+      if (!valid[i] && (v[i] >= m_a) && (v[i] < m_b))
+        invalidate(out[i]);
+    }
+  }
+}; // End class FuzzyMembershipSKernel
+
 
 
 //=========================================================================================
@@ -214,11 +262,22 @@ struct Sentinel1DnToDb : public ReturnFixedType<PixelMask<float> > {
   }
 };
 
+/// Band-planar version of Sentinel1DnToDb.
+struct Sentinel1DnToDbKernel {
+  typedef PixelMask<float> result_type;
+
+  void operator()(band_planar::BandTile &tile, PixelMask<float> *out) const {
+    const size_t n = tile.num_pixels();
+    band_planar::to_decibels(tile.band(0), n);
+    band_planar::to_masked(tile.band(0), tile.valid(), out, n);
+  }
+};
+
 /// Function to convert a sentinel1 image from digital numbers (DN) to decibels (DB)
 template <class ImageT>
-UnaryPerPixelView<ImageT,Sentinel1DnToDb>
+band_planar::BandPlanarView<ImageT,Sentinel1DnToDbKernel>
 inline sentinel1_dn_to_db( ImageViewBase<ImageT> const& image) {
-  return UnaryPerPixelView<ImageT,Sentinel1DnToDb>( image.impl(), Sentinel1DnToDb() );
+  return band_planar::band_planar_view(image.impl(), Sentinel1DnToDbKernel());
 }
 
 
@@ -830,17 +889,17 @@ void sar_martinis(std::string const& input_image_path, std::string const& output
 
   // Compute fuzzy classifications on four categories
   typedef PixelMask<float> FuzzyPixelType;
-  typedef FuzzyMembershipSFunctor<RadarTypeM> FuzzyFunctorS;
-  typedef FuzzyMembershipZFunctor<RadarTypeM> FuzzyFunctorZ;
+  typedef FuzzyMembershipSKernel FuzzyKernelS;
+  typedef FuzzyMembershipZKernel FuzzyKernelZ;
   ImageViewRef<FuzzyPixelType> defuzzed;
  
   // SAR
-  FuzzyFunctorZ radar_fuzz_functor(mean_raw_water_value, threshold_mean);
-  ImageViewRef<FuzzyPixelType> radar_fuzz = per_pixel_view(preprocessed_image, radar_fuzz_functor);
+  FuzzyKernelZ radar_fuzz_kernel(mean_raw_water_value, threshold_mean);
+  ImageViewRef<FuzzyPixelType> radar_fuzz = band_planar::band_planar_view(preprocessed_image, radar_fuzz_kernel);
 
   // Body size 
-  FuzzyFunctorS blob_fuzz_functor(min_blob_size, max_blob_size);
-  ImageViewRef<FuzzyPixelType> blob_fuzz = per_pixel_view(blob_sizes, blob_fuzz_functor);
+  FuzzyKernelS blob_fuzz_kernel(min_blob_size, max_blob_size);
+  ImageViewRef<FuzzyPixelType> blob_fuzz = band_planar::band_planar_view(blob_sizes, blob_fuzz_kernel);
 
   if (debug) {
     const double temp_nodata = -1;
@@ -912,14 +971,14 @@ void sar_martinis(std::string const& input_image_path, std::string const& output
     // Elevation
     // - The max value looks a little weird but it comes straight from the paper.
     const double high_height = mean_water_height + stddev_water_height*(stddev_water_height + 3.5);
-    FuzzyFunctorZ height_fuzz_functor(mean_water_height, high_height);
-    ImageViewRef<FuzzyPixelType> height_fuzz = per_pixel_view(dem_in_image_coords, height_fuzz_functor);
+    FuzzyKernelZ height_fuzz_kernel(mean_water_height, high_height);
+    ImageViewRef<FuzzyPixelType> height_fuzz = band_planar::band_planar_view(dem_in_image_coords, height_fuzz_kernel);
     
     // Slope
     const double degrees_low  = 0;
     const double degrees_high = 15;
-    FuzzyFunctorZ slope_fuzz_functor(degrees_low, degrees_high);
-    ImageViewRef<FuzzyPixelType> slope_fuzz = per_pixel_view(get_angle(compute_normals(dem_in_image_coords, 1.0, 1.0)), slope_fuzz_functor);
+    FuzzyKernelZ slope_fuzz_kernel(degrees_low, degrees_high);
+    ImageViewRef<FuzzyPixelType> slope_fuzz = band_planar::band_planar_view(get_angle(compute_normals(dem_in_image_coords, 1.0, 1.0)), slope_fuzz_kernel);
 
     if (debug) {
       block_write_gdal_image("height_fuzz.tif", apply_mask(height_fuzz, dem_nodata_value),
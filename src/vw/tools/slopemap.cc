@@ -16,15 +16,19 @@
 // __END_LICENSE__
 
 #include <vw/Core/Log.h>
+#include <vw/Core/Settings.h>
 #include <vw/Core/FundamentalTypes.h>
 #include <vw/Image/ImageMath.h>
-#include <vw/Image/Algorithms.h>
+#include <vw/Image/ImageViewRef.h>
+#include <vw/Image/BlockRasterize.h>
+#include <vw/Image/EdgeExtension.h>
 #include <vw/Image/Manipulation.h>
-#include <vw/Math/Matrix.h>
-#include <vw/Math/Vector.h>
-#include <vw/Math/LinearAlgebra.h>
+#include <vw/Image/PerPixelViews.h>
+#include <vw/Image/Statistics.h>
 #include <vw/FileIO/DiskImageView.h>
+#include <vw/FileIO/DiskImageResource.h>
 #include <vw/Cartography/GeoReference.h>
+#include <vw/Cartography/SlopeView.h>
 #include <vw/tools/Common.h>
 
 #include <iostream>
@@ -37,270 +41,100 @@ Implements modified versions of finite difference opt.algorithms + fitting a pla
 namespace po = boost::program_options;
 
 #include <boost/filesystem/path.hpp>
+#include <boost/scoped_ptr.hpp>
 namespace fs = boost::filesystem;
 
 using namespace vw;
-using namespace vw::math;
 using namespace vw::cartography;
 
-enum Algorithm { HORN, SA, FH, PLANEFIT };
-
 struct Options {
   std::string input_file_name;
   std::string output_prefix;
   bool output_gradient;
   bool output_aspect;
   bool output_pretty; //probably more for debugging purposes than for anything else
-  Algorithm algorithm;
+  SlopeAlgorithm algorithm;
   bool spherically_defined;
 };
 
-//basic utilities
-
-Vector3 pixel_to_cart (Vector2 pos, double alt, GeoReference GR) {
-  Vector2 loc_longlat2=GR.point_to_lonlat(GR.pixel_to_point(pos));
-  Vector3 loc_longlat3(loc_longlat2(0),loc_longlat2(1),alt);
-  Vector3 loc_cartesian=GR.datum().geodetic_to_cartesian(loc_longlat3);
-  return loc_cartesian;
-}
-
-template <class ImageT>
-Vector3 pixel_to_cart (Vector2 pos, DiskImageView<ImageT> img, GeoReference GR) {
-  return pixel_to_cart(pos,img((int)pos[0],(int)pos[1]),GR);
-}
-
-double dist_from_2pi(double n) {
-  if( fabs(n+2*M_PI) < fabs(n) ) return n+2*M_PI;
-  if( fabs(n-2*M_PI) < fabs(n) ) return n-2*M_PI;
-  return n;
-}
-
-//utilities...
-
-Vector2 gradient_aspect_from_normals(Vector3 center_normal, Vector3 plane_normal) {
-  //gradient angle is absval
-  double dotprod=dot_prod(plane_normal,center_normal);
-  double gradient_angle=acos(dotprod);
-  Vector3 surface_normal_on_sphere_tangent_plane=normalize(plane_normal-dot_prod(plane_normal,center_normal)*center_normal);
-
-  //get projection of (0,0,1) onto sphere tangent plane.
-  Vector3 north(0,0,1);
-  Vector3 north_projected=normalize(north-dot_prod(north,center_normal)*center_normal);
-
-  //find the angle between those two
-  double dotprod2=dot_prod(surface_normal_on_sphere_tangent_plane, north_projected);
-
-  //figure out which angle it is.
-  double aspect=acos(dotprod2);
-  if(dotprod2>1) { dotprod2=1; aspect=0;}
-  if(dotprod2<-1) { dotprod2=-1; aspect=0;}
-
-  if( dot_prod((cross_prod(north_projected,surface_normal_on_sphere_tangent_plane)),center_normal) < 0)
-    aspect=M_PI+aspect;
-  else
-    aspect=M_PI-aspect;
-
-  if(aspect>=2*M_PI)
-    aspect=aspect-2*M_PI;
-  return Vector2(aspect,gradient_angle);
-}
-
-Vector2 gradient_aspect_from_dx_dy(double& dx, double& dy) {
-  //total gradient:
-  double gradient=norm_2(Vector2(dx,dy));
-  double gradient_angle=atan(gradient);
-  //aspect: dy/dx=tan(angle)
-  double aspect=atan(dy/dx);
-  if(dx<0) aspect=aspect+M_PI;
-  aspect=2*M_PI-aspect+M_PI/2;
-  if(aspect<0) aspect=2*M_PI+aspect;
-  if(aspect>=2*M_PI) aspect=aspect-2*M_PI*(int)(aspect/2/M_PI);
-  return Vector2(aspect,gradient_angle);
-}
-
-Vector2 gradient_aspect_from_dtheta_dphi(double rho, double theta, double phi, double& dtheta, double& dphi, Vector3 center) {
-  double r_comp=1;
-  double theta_comp=dtheta/rho;
-  double phi_comp=1/(rho*sin(theta))*dphi;
-
-  double n_x=r_comp*sin(theta)*cos(phi)-phi_comp*sin(phi)+theta_comp*cos(theta)*cos(phi);
-  double n_y=r_comp*sin(theta)*sin(phi)+phi_comp*cos(phi)+theta_comp*cos(theta)*sin(phi);
-  double n_z=r_comp*cos(theta)-theta_comp*sin(theta);
-
-  Vector3 plane_normal=normalize(Vector3(n_x,n_y,n_z));
-  center=normalize(center);
-  return gradient_aspect_from_normals(center, plane_normal);
-}
-
-template <class ImageT>
-Vector2 uneven_grid (const ::Options& opt, int x, int y, DiskImageView<ImageT> img, GeoReference GR) {
-
-  Vector3 center=pixel_to_cart(Vector2(x,y),img,GR);
-  Vector3 center_normal=normalize(center);
-  Vector3 center_below=pixel_to_cart(Vector2(x,y),0,GR);
-
-  Vector3 north=Vector3(0,0,1);
-        Vector3 north_projected=normalize(north-dot_prod(north,center_normal)*center_normal);
-
-  //define temporary axis
-  Vector3 up_normal=normalize(north_projected);        //also theta hat
-  Vector3 third=normalize(cross_prod(up_normal,center_normal));     //also phi hat
-
-  //spherical
-  Vector2 lonlat=GR.pixel_to_lonlat(Vector2(x,y));
-  double lat=lonlat(1);
-  double lon=lonlat(0);
-
-  //rise= run*slope
-  Matrix<double> rises;  //rise over vector distance
-  Matrix<double> runs;  //components in either direction
-
-  //different ways of weighting neighbors.
-  if(opt.algorithm==HORN) { rises=Matrix<double>(12,1); runs=Matrix<double>(12,2); }
-  if(opt.algorithm==SA)   { rises=Matrix<double>(8,1); runs=Matrix<double>(8,2); }
-  if(opt.algorithm==FH)   { rises=Matrix<double>(4,1); runs=Matrix<double>(4,2); }
-
-  int ct=0;
-  for(int i=-1;i<=1;i++) {
-    for(int j=-1;j<=1;j++) {
-      if(i==0 && j==0) continue;
-      int repeat=1;
-      if(opt.algorithm==HORN) {
-        if((i==0 && j!=0) || (i!=0 && j==0)) //for horn, weight direct neighbors twice
-          repeat=2;
-      }
-      if(opt.algorithm==FH) {
-        if(i!=0 && j!=0) //ignore diagonals
-          continue;
-      }
-
-      for(int k=0;k<repeat;k++) {
-        if(!opt.spherically_defined) {
-          Vector3 neighbor=pixel_to_cart(Vector2(x+i,y+j),img,GR);
-          Vector3 neighbor_below_rescale=normalize(neighbor)*(norm_2(center_below)/dot_prod(normalize(neighbor),center_normal));
-          Vector3 v=neighbor_below_rescale-center_below;
-          //or, project both onto tangent plane...
-          rises(ct,0)=(img(x+i,y+j)-img(x,y))/norm_2(v);
-          v=normalize(v);
-          runs(ct,0)=dot_prod(v,up_normal);
-          runs(ct,1)=dot_prod(v,third);
-        } else {
-          rises(ct,0)=(img(x+i,y+j)-img(x,y));
-          Vector2 neighbor_lonlat=GR.pixel_to_lonlat(Vector2(x+i,y+j));
-          runs(ct,0)=(neighbor_lonlat[1]-lonlat[1])*M_PI/180.0;
-          runs(ct,1)=dist_from_2pi(neighbor_lonlat[0]-lonlat[0])*M_PI/180.0;
-        }
-        ct++;
-      }
-    }
-  }
-  //solve using least squares
-  //gradient components=(VtV)-1Vt * rises
-  Matrix<double> VtV(2,2);
-  VtV=transpose(runs)*runs;
-  Matrix<double> VtVinv(2,2);
-  VtVinv(0,0)=VtV(1,1);
-  VtVinv(1,1)=VtV(0,0);
-  VtVinv(0,1)=-VtV(0,1);
-  VtVinv(1,0)=-VtV(1,0);
-  VtVinv=VtVinv/(VtV(0,0)*VtV(1,1)-VtV(0,1)*VtV(1,0));
-
-  Matrix<double> ans=VtVinv*transpose(runs)*rises;
-
-  if(opt.spherically_defined) {
-    double rho=norm_2(center);
-    double phi=lon/180.0*M_PI;
-    double theta=(-lat+90.0)/180.0*M_PI;
-    double dtheta=ans(0,0);
-    double dphi=-ans(1,0);
-    return gradient_aspect_from_dtheta_dphi(rho, theta, phi, dtheta, dphi, center);
+// Hue from the aspect, saturation from the gradient and value from both.
+struct RawPrettyFunctor : public ReturnFixedType<PixelHSV<double> > {
+  PixelHSV<double> operator()( Vector2 const& res ) const {
+    return PixelHSV<double>( res[0], res[1], res[1] + 0.2*fabs(M_PI-res[0]) );
   }
-  //otherwise,
-  return gradient_aspect_from_dx_dy(ans(0,1), ans(0,0));
-}
+};
 
-template <class ImageT>
-Vector2 interpolate_plane (int x, int y, DiskImageView<ImageT> img, GeoReference GR) {
-  Matrix<double> A(9,4);
-  int i=0;
-  int j=0;
-  int ct=0;
-  Vector3 center_normal=pixel_to_cart(Vector2(x,y),img,GR);
-
-  for(i=-1;i<=1;i++) {
-    for(j=-1;j<=1;j++) {
-      Vector3 tmp=pixel_to_cart(Vector2(x+i,y+j),img,GR);
-      A(ct,0)=tmp(0);
-      A(ct,1)=tmp(1);
-      A(ct,2)=tmp(2);
-      A(ct,3)=1;
-      ct++;
-    }
+// Stretches each channel of a raw pretty pixel into the range it is
+// displayed with.  The value is stretched from its range over the
+// whole image.
+class NormalizePrettyFunctor : public ReturnFixedType<PixelHSV<double> > {
+  double m_min, m_ratio;
+public:
+  NormalizePrettyFunctor( double min, double max )
+    : m_min(min), m_ratio( max == min ? 0.0 : (0.6-0.3)/(max-min) ) {}
+
+  PixelHSV<double> operator()( PixelHSV<double> const& pix ) const {
+    return PixelHSV<double>( pix.h() / (2*M_PI),
+                             pix.s() * (0.9/(M_PI/2)) + 0.1,
+                             (pix.v() - m_min) * m_ratio + 0.3 );
   }
+};
 
-  Matrix<double> U;
-  Matrix<double> VT;
-  Vector<double> s;
-
-  svd(A, U, s, VT);
-  Vector<double> plane_normal(3);
-  plane_normal(0)=VT(3,0);
-  plane_normal(1)=VT(3,1);
-  plane_normal(2)=VT(3,2);
-  //normalize sphere normal
-  center_normal=normalize(center_normal);
-  plane_normal=normalize(plane_normal);
-  if(dot_prod(plane_normal,center_normal) <0) plane_normal=plane_normal*-1;
-  return gradient_aspect_from_normals(center_normal, plane_normal);
+template <class ImageT>
+void write_output( std::string const& filename, ImageViewBase<ImageT> const& image,
+                   GeoReference const* georef, std::string const& tag ) {
+  vw_out() << "Writing " << tag << ": " << filename << "\n";
+  boost::scoped_ptr<DiskImageResource> r( DiskImageResource::create( filename, image.format() ) );
+  if ( r->has_block_write() )
+    r->set_block_write_size( Vector2i( vw_settings().default_tile_size(),
+                                       vw_settings().default_tile_size() ) );
+  if ( georef )
+    write_georeference( *r, *georef );
+  block_write_image( *r, image.impl(),
+                     TerminalProgressCallback( "tools.slopemap", "Writing " + tag + ":" ) );
 }
 
 template <class imageT>
-void do_slopemap (const ::Options &opt) { //not sure what the arguments are
+void do_slopemap (const ::Options &opt) {
 
   GeoReference GR;
   read_georeference( GR, opt.input_file_name );
 
   DiskImageView<imageT> img(opt.input_file_name);
 
-  int x;
-  int y;
-
-  ImageView<double> gradient_angle;
-  ImageView<double> aspect;
-  ImageView<PixelHSV<double> > pretty;
-
-  if(opt.output_gradient)
-    gradient_angle.set_size(img.cols(),img.rows());
-  if(opt.output_aspect)
-    aspect.set_size(img.cols(),img.rows());
-  if(opt.output_pretty) pretty.set_size(img.cols(),img.rows());
-
-  for(x=1;x<img.cols()-1;x++) {
-    for(y=1;y<img.rows()-1;y++) {
-      Vector2 res;
-      //these are pretty similar...
-      if(opt.algorithm==PLANEFIT) res=interpolate_plane(x,y,img,GR);
-      else res=uneven_grid(opt, x,y,img,GR);
-
-      if(opt.output_aspect)   aspect(x,y) = res(0);
-      if(opt.output_gradient) gradient_angle(x,y) = res(1);
-      if(opt.output_pretty)   pretty(x,y) = PixelHSV<double>(res(0),res(1),(res(1))+0.2*fabs(M_PI-res(0)));//(res(1)/M_PI*2)*fabs(M_PI-res(0)));
-     }
-  }
-  ImageView<PixelRGB<uint8> > pretty2;
+  // Tiles are computed once, in parallel, and shared by every output.
+  int32 tile_size = vw_settings().default_tile_size();
+  ImageViewRef<Vector2> res =
+    block_cache( slope_aspect( img, GR, opt.algorithm, opt.spherically_defined ),
+                 Vector2i(tile_size, tile_size) );
+
+  if(opt.output_gradient) write_output( opt.output_prefix + "_gradient.tif", select_channel(res,1), &GR, "gradient" );
+  if(opt.output_aspect)   write_output( opt.output_prefix + "_aspect.tif",   select_channel(res,0), &GR, "aspect" );
 
   if(opt.output_pretty) {
-    select_channel(pretty,0)=normalize(select_channel(pretty,0),0,2*M_PI,0,1);
-    select_channel(pretty,1)=normalize(select_channel(pretty,1),0,M_PI/2,0.1,1);
-    select_channel(pretty,2)=normalize(select_channel(pretty,2),0.3,0.6);
+    // The pretty image is left blank on the border, like the slope itself.
+    ImageViewRef<PixelHSV<double> > pretty =
+      crop( edge_extend( crop( per_pixel_view( res, RawPrettyFunctor() ),
+                               1, 1, res.cols()-2, res.rows()-2 ),
+                         -1, -1, res.cols(), res.rows(), ZeroEdgeExtension() ),
+            0, 0, res.cols(), res.rows() );
+
+    // Find the range of the value channel a tile at a time.
+    double v_min = 0, v_max = 0;
+    std::vector<BBox2i> tiles = subdivide_bbox( pretty, tile_size, tile_size );
+    for ( size_t i = 0; i < tiles.size(); ++i ) {
+      ImageView<double> value = crop( select_channel(pretty,2), tiles[i] );
+      double tile_min, tile_max;
+      min_max_channel_values( value, tile_min, tile_max );
+      if ( i == 0 || tile_min < v_min ) v_min = tile_min;
+      if ( i == 0 || tile_max > v_max ) v_max = tile_max;
+    }
 
-    pretty2=pixel_cast_rescale<PixelRGB<uint8> >( copy(pretty) );
-    pretty2=PixelRGB<uint8>(255,255,255)-pretty2;
+    write_output( opt.output_prefix + "_pretty.tif",
+                  PixelRGB<uint8>(255,255,255) -
+                  pixel_cast_rescale<PixelRGB<uint8> >( per_pixel_view( pretty, NormalizePrettyFunctor(v_min, v_max) ) ),
+                  NULL, "pretty" );
   }
-  //save everything to file
-  if(opt.output_gradient) write_georeferenced_image( opt.output_prefix + "_gradient.tif" , gradient_angle, GR);
-  if(opt.output_aspect)   write_georeferenced_image( opt.output_prefix + "_aspect.tif"   , aspect, GR);
-  if(opt.output_pretty)   write_image( opt.output_prefix + "_pretty.tif"   , pretty2);
 }
 
 
@@ -361,13 +195,13 @@ int main( int argc, char *argv[] ) {
   }
   else {
     if(algorithm_string=="horn")
-      opt.algorithm=HORN;
+      opt.algorithm=HornSlope;
     else if(algorithm_string=="fh")
-      opt.algorithm=FH;
+      opt.algorithm=FlemingHofferSlope;
     else if(algorithm_string=="sa")
-      opt.algorithm=SA;
+      opt.algorithm=SharpnackAkinSlope;
     else if(algorithm_string=="planefit")
-      opt.algorithm=PLANEFIT;
+      opt.algorithm=PlaneFitSlope;
   }
 
   opt.output_aspect   = !(vm.count("no-aspect"));
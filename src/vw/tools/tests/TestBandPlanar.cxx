@@ -0,0 +1,247 @@
+// __BEGIN_LICENSE__
+//  Copyright (c) 2006-2013, United States Government as represented by the
+//  Administrator of the National Aeronautics and Space Administration. All
+//  rights reserved.
+//
+//  The NASA Vision Workbench is licensed under the Apache License,
+//  Version 2.0 (the "License"); you may not use this file except in
+//  compliance with the License. You may obtain a copy of the License at
+//  http://www.apache.org/licenses/LICENSE-2.0
+//
+//  Unless required by applicable law or agreed to in writing, software
+//  distributed under the License is distributed on an "AS IS" BASIS,
+//  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+//  See the License for the specific language governing permissions and
+//  limitations under the License.
+// __END_LICENSE__
+
+
+// The band-planar kernels replace per-pixel functors in the flood
+// detection tools, and must give bit for bit the same output, masks
+// included. landsat.h and radar.h do not build against this tree, so
+// the primitives their kernels are made of are checked here against
+// the formulas of the functors they replace.
+
+#include <gtest/gtest_VW.h>
+#include <test/Helpers.h>
+
+#include <vw/tools/band_planar.h>
+#include <vw/tools/multispectral.h>
+
+#include <cstdlib>
+#include <cmath>
+
+using namespace vw;
+
+namespace {
+
+  // An odd tile size, so the kernels never see a multiple of the vector width.
+  const int32 COLS = 97;
+  const int32 ROWS = 61;
+
+  float frand( float lo, float hi ) {
+    return lo + (hi-lo)*( std::rand() / float(RAND_MAX) );
+  }
+
+  // Floats match if they are identical or both NaN.
+  bool same_value( float a, float b ) {
+    return a == b || ( a != a && b != b );
+  }
+
+  // radar::FuzzyMembershipZFunctor and FuzzyMembershipSFunctor on a float
+  float fuzzy_z( float v, float a, float b ) {
+    float c = (a+b)/2.0, dba = b-a;
+    if ( v < a ) return 1.0f;
+    if ( v < c ) return float( 1.0 - 2.0*pow( (v-a)/dba, 2.0 ) );
+    if ( v < b ) return float( 2.0*pow( (v-b)/dba, 2.0 ) );
+    return 0.0f;
+  }
+  float fuzzy_s( float v, float a, float b ) {
+    float c = (a+b)/2.0, dba = b-a;
+    if ( v < a ) return 0.0f;
+    if ( v < c ) return float( 2*pow( (v-a)/dba, 2.0 ) );
+    if ( v < b ) return float( 1.0 - 2*pow( (v-b)/dba, 2.0 ) );
+    return 1.0f;
+  }
+
+  template <class ImageT>
+  void expect_same( ImageViewBase<ImageT> const& functor_view,
+                    ImageViewBase<ImageT> const& kernel_view ) {
+    ImageT const& expected = functor_view.impl();
+    ImageT const& actual   = kernel_view.impl();
+    ASSERT_EQ( expected.cols(), actual.cols() );
+    ASSERT_EQ( expected.rows(), actual.rows() );
+    for ( int32 r = 0; r < expected.rows(); ++r ) {
+      for ( int32 c = 0; c < expected.cols(); ++c ) {
+        EXPECT_TRUE( same_value( expected(c,r), actual(c,r) ) ) << "at " << c << "," << r;
+      }
+    }
+  }
+
+  // The normalized difference of the first two bands, as a test kernel
+  // for the view itself.
+  struct NormalizedDifferenceKernel {
+    typedef PixelMask<float> result_type;
+    void operator()( band_planar::BandTile &tile, PixelMask<float> *out ) const {
+      const size_t n = tile.num_pixels();
+      std::vector<float> ratio( n );
+      band_planar::normalized_difference( tile.band(0), tile.band(1), &ratio[0], n, -1.0f );
+      band_planar::to_masked( &ratio[0], tile.valid(), out, n );
+    }
+  };
+
+  // Kernels are also run on a tile that does not start at the origin.
+  const BBox2i SUB_TILE( 5, 3, 40, 30 );
+}
+
+TEST( BandPlanar, FuzzyMembership ) {
+  std::srand( 7 );
+  std::vector<float> v( COLS*ROWS );
+  for ( size_t i = 0; i < v.size(); ++i )
+    v[i] = frand( -5, 25 );
+  // The ends and the middle of the curve exactly.
+  v[0] = 3.0f; v[1] = 7.5f; v[2] = 12.0f;
+
+  std::vector<float> z( v.size() ), s( v.size() );
+  band_planar::fuzzy_membership_z( &v[0], &z[0], v.size(), 3, 12 );
+  band_planar::fuzzy_membership_s( &v[0], &s[0], v.size(), 3, 12 );
+  for ( size_t i = 0; i < v.size(); ++i ) {
+    EXPECT_EQ( fuzzy_z( v[i], 3, 12 ), z[i] ) << "at " << v[i];
+    EXPECT_EQ( fuzzy_s( v[i], 3, 12 ), s[i] ) << "at " << v[i];
+  }
+}
+
+TEST( BandPlanar, Primitives ) {
+  std::srand( 11 );
+  const size_t n = COLS*ROWS;
+  std::vector<float> a( n ), b( n ), v( n );
+  std::vector<uint8> valid( n );
+  for ( size_t i = 0; i < n; ++i ) {
+    a[i] = frand( 0, 2000 );
+    b[i] = ( i % 17 == 0 ) ? -a[i] : frand( 0, 2000 ); // Zero denominators
+    v[i] = float( std::rand() % 1000 );                 // Includes zero
+    valid[i] = std::rand() % 7 != 0;
+  }
+
+  // compute_index()
+  std::vector<float> ratio( n );
+  band_planar::normalized_difference( &a[0], &b[0], &ratio[0], n, -1.0f );
+  for ( size_t i = 0; i < n; ++i ) {
+    float sum = a[i] + b[i];
+    EXPECT_EQ( ( sum == 0 ) ? -1.0f : ( a[i] - b[i] ) / sum, ratio[i] );
+  }
+
+  // Sentinel1DnToDb, on digital numbers
+  std::vector<float> db( v );
+  band_planar::to_decibels( &db[0], n );
+  for ( size_t i = 0; i < n; ++i )
+    EXPECT_EQ( float( 10*log10( uint16( v[i] ) ) ), db[i] );
+
+  std::vector<PixelMask<float> > masked( n );
+  std::vector<uint8> labels( n );
+  band_planar::to_masked( &db[0], &valid[0], &masked[0], n );
+  band_planar::classify( &ratio[0], &valid[0], &labels[0], n, 0.0f, 1, 0, 255 );
+  for ( size_t i = 0; i < n; ++i ) {
+    EXPECT_EQ( bool(valid[i]), is_valid( masked[i] ) );
+    EXPECT_TRUE( same_value( db[i], masked[i].child() ) );
+    EXPECT_EQ( valid[i] ? uint8( ratio[i] > 0 ) : uint8(255), labels[i] );
+  }
+}
+
+TEST( BandPlanar, View ) {
+  std::srand( 13 );
+  typedef PixelMask<Vector<uint16,3> > PixelT;
+  ImageView<PixelT> input( COLS, ROWS );
+  for ( int32 r = 0; r < ROWS; ++r ) {
+    for ( int32 c = 0; c < COLS; ++c ) {
+      Vector<uint16,3> value;
+      for ( int b = 0; b < 3; ++b )
+        value[b] = std::rand() % 2000;
+      if ( std::rand() % 20 == 0 )
+        value[0] = value[1] = 0; // Zero denominators
+      input(c,r) = PixelT( value );
+      if ( std::rand() % 11 == 0 )
+        invalidate( input(c,r) );
+    }
+  }
+
+  ImageView<PixelMask<float> > kernel = band_planar::band_planar_view( input, NormalizedDifferenceKernel() );
+  ImageView<PixelMask<float> > sub    = crop( band_planar::band_planar_view( input, NormalizedDifferenceKernel() ),
+                                              SUB_TILE );
+  ASSERT_EQ( COLS, kernel.cols() );
+  ASSERT_EQ( ROWS, kernel.rows() );
+  for ( int32 r = 0; r < ROWS; ++r ) {
+    for ( int32 c = 0; c < COLS; ++c ) {
+      float a = input(c,r).child()[0], b = input(c,r).child()[1];
+      EXPECT_EQ( is_valid( input(c,r) ), is_valid( kernel(c,r) ) );
+      EXPECT_EQ( ( a + b == 0 ) ? -1.0f : ( a - b ) / ( a + b ), kernel(c,r).child() );
+      if ( SUB_TILE.contains( Vector2i(c,r) ) ) {
+        PixelMask<float> const& s = sub( c - SUB_TILE.min().x(), r - SUB_TILE.min().y() );
+        EXPECT_EQ( is_valid( kernel(c,r) ), is_valid( s ) );
+        EXPECT_EQ( kernel(c,r).child(), s.child() );
+      }
+    }
+  }
+}
+
+TEST( BandPlanar, DetectWaterWorldView23 ) {
+  using namespace multispectral;
+  std::srand( 17 );
+
+  WorldViewMetadataContainer metadata;
+  for ( int b = 0; b < 8; ++b ) {
+    metadata.abs_cal_factor     [b] = 0.01f * ( 1 + b % 3 );
+    metadata.effective_bandwidth[b] = 0.05f + 0.01f * b;
+  }
+  metadata.mean_sun_elevation = 35.0f;
+  metadata.earth_sun_distance = 1.01f;
+
+  ImageView<WorldView23PixelType> input( COLS, ROWS );
+  for ( int32 r = 0; r < ROWS; ++r ) {
+    for ( int32 c = 0; c < COLS; ++c ) {
+      Vector<uint16,8> value;
+      for ( int b = 0; b < 8; ++b )
+        value[b] = std::rand() % 2000;
+      if ( std::rand() % 20 == 0 )
+        value[COASTAL] = value[multispectral::RED] = value[NIR2] = 0; // Zero denominators
+      input(c,r) = WorldView23PixelType( value );
+      if ( std::rand() % 11 == 0 )
+        invalidate( input(c,r) );
+    }
+  }
+
+  for ( double sensitivity = 0.5; sensitivity <= 1.5; sensitivity += 0.5 ) {
+    ImageView<uint8> functor =
+      apply_mask( per_pixel_view( per_pixel_view( input, WorldView23ToaFunctor( metadata ) ),
+                                  DetectWaterWorldView23Functor( sensitivity ) ),
+                  FLOOD_DETECT_NODATA );
+    ImageView<uint8> kernel = band_planar::band_planar_view( input, DetectWaterWorldView23Kernel( metadata, sensitivity ) );
+    expect_same( functor, kernel );
+  }
+}
+
+TEST( BandPlanar, DetectWaterSpot67 ) {
+  using namespace multispectral;
+  std::srand( 19 );
+
+  ImageView<Spot67PixelType> input( COLS, ROWS );
+  for ( int32 r = 0; r < ROWS; ++r ) {
+    for ( int32 c = 0; c < COLS; ++c ) {
+      Vector<uint8,5> value;
+      for ( int b = 0; b < 5; ++b )
+        value[b] = std::rand() % 256;
+      if ( std::rand() % 20 == 0 )
+        value[SPOT_BLUE] = value[SPOT_NIR] = 0; // Zero denominators
+      input(c,r) = Spot67PixelType( value );
+      if ( std::rand() % 11 == 0 )
+        invalidate( input(c,r) );
+    }
+  }
+
+  for ( double sensitivity = 0.5; sensitivity <= 1.5; sensitivity += 0.5 ) {
+    ImageView<uint8> functor = apply_mask( per_pixel_view( input, DetectWaterSpot67Functor( sensitivity ) ),
+                                           FLOOD_DETECT_NODATA );
+    ImageView<uint8> kernel  = band_planar::band_planar_view( input, DetectWaterSpot67Kernel( sensitivity ) );
+    expect_same( functor, kernel );
+  }
+}